@@ -0,0 +1,64 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_FILEIO_MAPPED_FILE_HPP
+#define GRAPHLAB_FILEIO_MAPPED_FILE_HPP
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <graphlab/logger/logger.hpp>
+
+namespace graphlab {
+
+/**
+ * A local file mapped read only into memory, for the lifetime of the
+ * object.
+ */
+class mapped_file {
+ public:
+  explicit mapped_file(const std::string& path): m_path(path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) log_and_throw("Unable to open " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      log_and_throw("Unable to stat " + path);
+    }
+    m_size = st.st_size;
+    if (m_size > 0) {
+      void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (mapped == MAP_FAILED) {
+        ::close(fd);
+        log_and_throw("Unable to map " + path);
+      }
+      m_data = static_cast<const char*>(mapped);
+    }
+    ::close(fd);
+  }
+
+  ~mapped_file() {
+    if (m_data != nullptr) munmap(const_cast<char*>(m_data), m_size);
+  }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  const char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+  const std::string& path() const { return m_path; }
+
+ private:
+  std::string m_path;
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+};
+
+} // namespace graphlab
+#endif
@@ -0,0 +1,318 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_FLEXIBLE_TYPE_FAST_FIELD_PARSERS_HPP
+#define GRAPHLAB_FLEXIBLE_TYPE_FAST_FIELD_PARSERS_HPP
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <graphlab/flexible_type/flexible_type.hpp>
+
+namespace graphlab {
+
+/**
+ * Parses a decimal integer with an optional sign, in one pass with no
+ * locale or whitespace handling. Returns false if [p, end) is not an
+ * integer, or does not fit in a flex_int.
+ */
+inline bool fast_parse_int(const char* p, const char* end, flex_int& out) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+  if (p == end) return false;
+  uint64_t value = 0;
+  for (; p < end; ++p) {
+    unsigned digit = (unsigned char)(*p) - '0';
+    if (digit > 9) return false;
+    if (value > (UINT64_MAX - digit) / 10) return false;
+    value = value * 10 + digit;
+  }
+  const uint64_t limit = uint64_t(INT64_MAX) + (negative ? 1 : 0);
+  if (value > limit) return false;
+  out = negative ? flex_int(uint64_t(0) - value) : flex_int(value);
+  return true;
+}
+
+/**
+ * Parses a floating point number.
+ *
+ * Decimals with at most 19 significant digits, a mantissa below 2^53 and
+ * a power of ten of magnitude at most 22 are exact as one multiplication
+ * or division of two exactly representable doubles (Clinger's fast path),
+ * which covers most numbers in text files. Anything else (long mantissas,
+ * large exponents, "nan", "inf", hexadecimal) goes to strtod.
+ */
+inline bool fast_parse_float(const char* p, const char* end, flex_float& out) {
+  static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char* begin = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+  uint64_t mantissa = 0;
+  int significant_digits = 0;
+  int exponent = 0;
+  bool any_digits = false;
+  bool exact = true;
+  for (; p < end && (unsigned char)(*p - '0') <= 9; ++p) {
+    mantissa = mantissa * 10 + (*p - '0');
+    if (mantissa != 0) ++significant_digits;
+    any_digits = true;
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && (unsigned char)(*p - '0') <= 9; ++p) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa != 0) ++significant_digits;
+      --exponent;
+      any_digits = true;
+    }
+  }
+  if (significant_digits > 19) exact = false;
+  if (any_digits && p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exponent = false;
+    if (p < end && (*p == '-' || *p == '+')) negative_exponent = (*p++ == '-');
+    if (p == end) return false;
+    int e = 0;
+    for (; p < end && (unsigned char)(*p - '0') <= 9; ++p) {
+      if (e < 100000) e = e * 10 + (*p - '0');
+    }
+    exponent += negative_exponent ? -e : e;
+  }
+  if (any_digits && p == end && exact && mantissa <= (uint64_t(1) << 53) &&
+      exponent >= -22 && exponent <= 22) {
+    double value = double(mantissa);
+    value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+    out = negative ? -value : value;
+    return true;
+  }
+  std::string str(begin, end);
+  if (str.empty()) return false;
+  char* str_end = nullptr;
+  out = std::strtod(str.c_str(), &str_end);
+  return str_end == str.c_str() + str.size();
+}
+
+/**
+ * A parser of datetimes in a fixed format, compiled from a strptime style
+ * format string with the directives %Y (4 digits), %m, %d, %H, %M, %S
+ * (2 digits each), %b (month abbreviation), %f (1 to 6 digits of
+ * fractional seconds), %ZP (an optional time zone: "Z", or an offset
+ * "+HH", "+HH:MM" or "+HHMM", possibly after "GMT" or "UTC") and %%.
+ * Other characters must match exactly.
+ *
+ * The fields of the format are matched in one pass, with no backtracking
+ * and no locale, and converted to a timestamp arithmetically. Formats with
+ * other directives do not compile, and strings which do not match the
+ * fixed layout exactly (single digit days, fractional seconds without %f,
+ * time zone names, ...) do not parse; both are left to
+ * gl_sarray::str_to_datetime.
+ */
+class datetime_format_parser {
+ public:
+  explicit datetime_format_parser(const std::string& format = "%Y-%m-%dT%H:%M:%S%ZP") {
+    for (size_t i = 0; i < format.size(); ++i) {
+      if (format[i] != '%') {
+        m_elements.push_back({element_kind::LITERAL, format[i]});
+        continue;
+      }
+      if (++i == format.size()) {
+        m_compiled = false;
+        return;
+      }
+      switch (format[i]) {
+        case 'Y': m_elements.push_back({element_kind::YEAR, 0}); break;
+        case 'm': m_elements.push_back({element_kind::MONTH, 0}); break;
+        case 'b': m_elements.push_back({element_kind::MONTH_NAME, 0}); break;
+        case 'd': m_elements.push_back({element_kind::DAY, 0}); break;
+        case 'H': m_elements.push_back({element_kind::HOUR, 0}); break;
+        case 'M': m_elements.push_back({element_kind::MINUTE, 0}); break;
+        case 'S': m_elements.push_back({element_kind::SECOND, 0}); break;
+        case 'f': m_elements.push_back({element_kind::FRACTION, 0}); break;
+        case '%': m_elements.push_back({element_kind::LITERAL, '%'}); break;
+        case 'Z':
+          if (i + 1 < format.size() && format[i + 1] == 'P') {
+            m_elements.push_back({element_kind::TIMEZONE, 0});
+            ++i;
+            break;
+          }
+          m_compiled = false;
+          return;
+        default:
+          m_compiled = false;
+          return;
+      }
+    }
+  }
+
+  /// Whether the format only uses directives this parser implements.
+  bool compiled() const { return m_compiled; }
+
+  /**
+   * Parses [p, end) as a datetime in the format. Without a time zone, the
+   * time is taken as UTC and the datetime has no time zone.
+   */
+  inline bool parse(const char* p, const char* end, flex_date_time& out) const {
+    if (!m_compiled) return false;
+    int year = 1970, month = 1, day = 1, hour = 0, minute = 0, second = 0;
+    int microsecond = 0;
+    int tz_minutes = 0;
+    bool has_timezone = false;
+    for (const auto& element: m_elements) {
+      switch (element.kind) {
+        case element_kind::LITERAL:
+          if (p == end || *p != element.literal) return false;
+          ++p;
+          break;
+        case element_kind::YEAR:
+          if (!read_digits(p, end, 4, year)) return false;
+          break;
+        case element_kind::MONTH:
+          if (!read_digits(p, end, 2, month)) return false;
+          break;
+        case element_kind::MONTH_NAME:
+          if (!read_month_name(p, end, month)) return false;
+          break;
+        case element_kind::DAY:
+          if (!read_digits(p, end, 2, day)) return false;
+          break;
+        case element_kind::HOUR:
+          if (!read_digits(p, end, 2, hour)) return false;
+          break;
+        case element_kind::MINUTE:
+          if (!read_digits(p, end, 2, minute)) return false;
+          break;
+        case element_kind::SECOND:
+          if (!read_digits(p, end, 2, second)) return false;
+          break;
+        case element_kind::FRACTION: {
+          int ndigits = 0;
+          for (; p < end && ndigits < 6 && (unsigned char)(*p - '0') <= 9; ++p, ++ndigits) {
+            microsecond = microsecond * 10 + (*p - '0');
+          }
+          if (ndigits == 0 || (p < end && (unsigned char)(*p - '0') <= 9)) return false;
+          for (; ndigits < 6; ++ndigits) microsecond *= 10;
+          break;
+        }
+        case element_kind::TIMEZONE:
+          if (!read_timezone(p, end, has_timezone, tz_minutes)) return false;
+          break;
+      }
+    }
+    if (p != end) return false;
+    if (month < 1 || month > 12 || day < 1 || day > days_in_month(year, month) ||
+        hour > 23 || minute > 59 || second > 59) {
+      return false;
+    }
+    int64_t timestamp = days_from_civil(year, month, day) * 86400 +
+        hour * 3600 + minute * 60 + second - int64_t(tz_minutes) * 60;
+    out = flex_date_time(timestamp,
+                         has_timezone ? tz_minutes / flex_date_time::TIMEZONE_RESOLUTION_IN_MINUTES
+                                      : flex_date_time::EMPTY_TIMEZONE,
+                         microsecond);
+    return true;
+  }
+
+  inline bool parse(const std::string& str, flex_date_time& out) const {
+    return parse(str.data(), str.data() + str.size(), out);
+  }
+
+  /**
+   * Days from 1970-01-01 to a date of the proleptic Gregorian calendar.
+   */
+  static inline int64_t days_from_civil(int64_t year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+  }
+
+ private:
+  enum class element_kind {
+    LITERAL, YEAR, MONTH, MONTH_NAME, DAY, HOUR, MINUTE, SECOND, FRACTION, TIMEZONE
+  };
+  struct element {
+    element_kind kind;
+    char literal;
+  };
+
+  static inline bool read_digits(const char*& p, const char* end, int ndigits, int& out) {
+    if (end - p < ndigits) return false;
+    int value = 0;
+    for (int i = 0; i < ndigits; ++i) {
+      unsigned digit = (unsigned char)(p[i]) - '0';
+      if (digit > 9) return false;
+      value = value * 10 + digit;
+    }
+    p += ndigits;
+    out = value;
+    return true;
+  }
+
+  static inline bool read_month_name(const char*& p, const char* end, int& month) {
+    static const char* names = "janfebmaraprmayjunjulaugsepoctnovdec";
+    if (end - p < 3) return false;
+    char name[3];
+    for (int i = 0; i < 3; ++i) name[i] = (p[i] >= 'A' && p[i] <= 'Z') ? p[i] - 'A' + 'a' : p[i];
+    for (int m = 0; m < 12; ++m) {
+      if (names[3 * m] == name[0] && names[3 * m + 1] == name[1] && names[3 * m + 2] == name[2]) {
+        month = m + 1;
+        p += 3;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static inline bool read_timezone(const char*& p, const char* end,
+                                   bool& has_timezone, int& tz_minutes) {
+    if (p == end) return true;
+    if (*p == 'Z') {
+      ++p;
+      has_timezone = true;
+      return true;
+    }
+    if (end - p >= 3 && (std::string(p, 3) == "GMT" || std::string(p, 3) == "UTC")) {
+      p += 3;
+      has_timezone = true;
+      if (p == end) return true;
+    }
+    if (*p != '+' && *p != '-') return false;
+    bool negative = (*p++ == '-');
+    int hours = 0, minutes = 0;
+    if (!read_digits(p, end, 2, hours)) return false;
+    if (p < end && *p == ':') {
+      ++p;
+      if (!read_digits(p, end, 2, minutes)) return false;
+    } else if (p < end) {
+      if (!read_digits(p, end, 2, minutes)) return false;
+    }
+    int offset = hours * 60 + minutes;
+    if (minutes > 59 || offset % flex_date_time::TIMEZONE_RESOLUTION_IN_MINUTES != 0 ||
+        offset > flex_date_time::TIMEZONE_HIGH * flex_date_time::TIMEZONE_RESOLUTION_IN_MINUTES) {
+      return false;
+    }
+    has_timezone = true;
+    tz_minutes = negative ? -offset : offset;
+    return true;
+  }
+
+  static inline int days_in_month(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return days[month - 1] + (month == 2 && leap ? 1 : 0);
+  }
+
+  bool m_compiled = true;
+  std::vector<element> m_elements;
+};
+
+} // namespace graphlab
+#endif
@@ -14,6 +14,7 @@
 #include <string>
 #include <iostream>
 #include <graphlab/sframe/sframe_rows.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/sframe/group_aggregate_value.hpp>
 #include <graphlab/flexible_type/flexible_type.hpp>
 
@@ -297,6 +298,9 @@ class gl_sarray {
 
   /**
    * Returns a gl_sarray of values parsed from an avro file.
+   *
+   * \see gl_sframe::construct_from_avro to decode the records of a local
+   * file in parallel, into one typed column per field.
    */
   static gl_sarray from_avro(const std::string& filename);
 
@@ -558,6 +562,44 @@ class gl_sarray {
       std::function<bool(size_t, const std::shared_ptr<sframe_rows>&)> callback,
       size_t nthreads = (size_t)(-1));
 
+  /**
+   * Same as \ref materialize_to_callback, but presents each block of the
+   * numeric SArray as a contiguous typed array with a validity bitmap
+   * (\ref typed_column_view) instead of flexible_type values, for
+   * vectorized consumers. T is flex_int or flex_float; an integer SArray can
+   * be read as flex_float. Throws if the SArray holds other types.
+   *
+   * \code
+   * std::vector<double> partial_sums(thread::cpu_count(), 0);
+   * sa.materialize_to_callback<flex_float>(
+   *     [&](size_t threadid, const typed_column_view<flex_float>& values) {
+   *       const double* data = values.data();  // missing values are 0
+   *       double sum = 0;
+   *       for (size_t i = 0; i < values.size(); ++i) sum += data[i];
+   *       partial_sums[threadid] += sum;
+   *       return false;
+   *     }, thread::cpu_count());
+   * \endcode
+   *
+   * \param callback The callback to call
+   * \param nthreads Number of threads. If not specified, #cpus is used
+   */
+  template <typename T>
+  void materialize_to_callback(
+      std::function<bool(size_t, const typed_column_view<T>&)> callback,
+      size_t nthreads = (size_t)(-1)) {
+    std::vector<typed_column_view<T> > views(
+        nthreads == (size_t)(-1) ? thread::cpu_count() : nthreads);
+    materialize_to_callback(
+        [&](size_t threadid, const std::shared_ptr<sframe_rows>& rows) {
+          auto& view = views[threadid];
+          if (!rows->get_typed_column(0, view)) {
+            log_and_throw("SArray values cannot be read as a numeric typed column");
+          }
+          return callback(threadid, view);
+        }, nthreads);
+  }
+
 
   /**
    * Returns a one pass range object with begin() and end() iterators.
@@ -947,6 +989,44 @@ class gl_sarray {
                   flex_type_enum dtype,
                   bool skip_undefined=true) const;
 
+  /**
+   * Transform each element of the \ref gl_sarray by a typed function.
+   *
+   * "In" and "Out" must be flexible_type content types (flex_int,
+   * flex_float, flex_string, flex_vec, ...), and "fn" a function or functor
+   * callable as Out(In). Values are unboxed a block at a time into a
+   * contiguous array of In (converting with flexible_type::to if the
+   * array holds another type), "fn" is called in a tight loop the compiler
+   * can inline and vectorize, and the results are written as an SArray of
+   * type Out. Unlike the flexible_type version, there is no std::function
+   * call and no type dispatch per element.
+   *
+   * As with the flexible_type version, missing values are skipped and stay
+   * missing unless skip_undefined is false. In that case "fn" is also called
+   * on the missing values, which it receives as a default constructed In
+   * (0, an empty string, an empty vector, ...), and its result is written.
+   *
+   * Example:
+   * \code
+   * auto sa = gl_sarray({1.0, 2.0, FLEX_UNDEFINED});
+   * std::cout << sa.apply<flex_float, flex_float>([](double x) { return 2 * x + 1; });
+   * \endcode
+   *
+   * Produces output:
+   * \code{.txt}
+   * dtype: float
+   * Rows: 3
+   * [3.0, 5.0, None]
+   * \endcode
+   *
+   * \param fn The function to transform each element.
+   *
+   * \param skip_undefined Optional. If true, will not apply "fn" to
+   * any undefined values. Defaults to true.
+   */
+  template <typename In, typename Out, typename Fn>
+  gl_sarray apply(Fn fn, bool skip_undefined=true) const;
+
   /**
    * Filter this \ref gl_sarray by a function.  Returns a new \ref gl_sarray
    * filtered by this \ref gl_sarray.  If "fn" evaluates an element to true,
@@ -1219,6 +1299,26 @@ class gl_sarray {
    */
   gl_sarray str_to_datetime(const std::string& str_format="%Y-%m-%dT%H:%M:%S%ZP") const;
 
+  /**
+   * Same as \ref str_to_datetime, with a fast path for fixed layout formats.
+   *
+   * Formats made of %Y, %m, %d, %H, %M, %S, %b, %f, %ZP and literal
+   * characters are compiled into a datetime_format_parser, which matches
+   * the fields of the format in one pass, without backtracking, and
+   * converts them to a timestamp arithmetically, in parallel over the
+   * segments of the array. The values it does not read (a single digit
+   * day, a time zone name, ...) and formats with other directives go
+   * through \ref str_to_datetime.
+   *
+   * \code
+   * auto sa = gl_sarray({"2011-10-20T09:30:10Z", "2011-10-20T09:30:10-05:30"});
+   * std::cout << sa.fast_str_to_datetime();
+   * \endcode
+   *
+   * \see str_to_datetime
+   */
+  gl_sarray fast_str_to_datetime(const std::string& str_format="%Y-%m-%dT%H:%M:%S%ZP") const;
+
 
   /**
    * Create a new \ref gl_sarray with all the values cast to
@@ -1775,6 +1875,50 @@ class gl_sarray {
   gl_sarray cumulative_std() const;
   gl_sarray cumulative_avg() const;
 
+  /**
+   * Parallel version of \ref cumulative_aggregate, by a two pass segmented
+   * prefix scan.
+   *
+   * The array is split into one contiguous segment per core. The first pass
+   * aggregates each segment independently. The partial aggregate preceding
+   * each segment is then obtained by combining the partial aggregates of the
+   * earlier segments, and the second pass rescans every segment starting
+   * from its preceding aggregate, emitting one value per row.
+   *
+   * Any aggregator, builtin or user defined, is scanned in parallel; the
+   * result is the same as the sequential one as long as combine() is
+   * associative and consistent with add_element(). In the second pass the
+   * \ref rolling_operators, which accept adds after a combine, take each
+   * element straight into the preceding aggregate. Other aggregators add
+   * the elements of the segment into a local aggregate, and every row
+   * emits a copy of the preceding aggregate combined with a
+   * partial_finalize()d copy of the local one; copies are made with save()
+   * and load().
+   * Missing values are skipped; rows before the first non-missing value
+   * are missing.
+   *
+   * \code
+   *   sa = gl_sarray({1, 2, 3, 4, 5});
+   *   sa.parallel_cumulative_aggregate(std::make_shared<rolling_operators::sum>());
+   * \endcode
+   *
+   * produces an SArray that looks like the following:
+   * \code
+   *  dtype: int
+   *  [1, 3, 6, 10, 15]
+   * \endcode
+   */
+  gl_sarray parallel_cumulative_aggregate(
+      std::shared_ptr<group_aggregate_value> aggregator) const;
+
+  /**
+   * Same as the aggregator version of \ref parallel_cumulative_aggregate,
+   * given the name of a builtin aggregator ("__builtin__sum__",
+   * "__builtin__avg__", "__builtin__var__", "__builtin__stdv__",
+   * "__builtin__min__", "__builtin__max__", ...).
+   */
+  gl_sarray parallel_cumulative_aggregate(const std::string& name) const;
+
   /**
    * Apply an aggregate function over a moving window.
    * 
@@ -1822,6 +1966,69 @@ class gl_sarray {
                                   ssize_t end,
                                   size_t min_observations=size_t(-1)) const;
 
+  /**
+   * Apply an aggregator over a moving window, in a single streaming pass.
+   *
+   * "window_start", "window_end" and "min_observations" have the same
+   * meaning as in \ref builtin_rolling_apply. Positions of the window
+   * beyond either end of the SArray count as missing values. With
+   * min_observations=0, the aggregate of every window is emitted, empty
+   * windows included.
+   *
+   * The window is updated as rows enter and leave it rather than being
+   * re-aggregated for every row. If the aggregator supports removal
+   * (\ref invertible_aggregate_value, such as the aggregators in
+   * graphlab/sframe/rolling_aggregate_value.hpp) each row costs O(1)
+   * aggregator updates. Other aggregators, including user defined
+   * subclasses of \ref group_aggregate_value, are maintained with two
+   * stacks of partial aggregates merged by combine(), with amortized O(1)
+   * combines per row. In either case the cost does not depend on the
+   * width of the window.
+   *
+   * Example:
+   * \code
+   * gl_sarray a{0,1,2,3,4,5,6,7,8,9};
+   * auto result = a.rolling_apply(std::make_shared<rolling_operators::sum>(), -3, 0);
+   * \endcode
+   *
+   * Produces an SArray with these values:
+   * \code
+   * {NULL,NULL,NULL,6,10,14,18,22,26,30}
+   * \endcode
+   */
+  gl_sarray rolling_apply(std::shared_ptr<group_aggregate_value> aggregator,
+                          ssize_t window_start,
+                          ssize_t window_end,
+                          size_t min_observations=size_t(-1)) const;
+
+  /**
+   * Same as the aggregator version of \ref rolling_apply, given the name of
+   * a builtin aggregator as in \ref builtin_rolling_apply. sum, avg, var,
+   * stdv, min, max and count use the invertible aggregators of
+   * rolling_operators.
+   */
+  gl_sarray rolling_apply(const std::string& fn_name,
+                          ssize_t window_start,
+                          ssize_t window_end,
+                          size_t min_observations=size_t(-1)) const;
+
+  /**
+   * Moving window aggregates. See \ref rolling_apply.
+   */
+  gl_sarray rolling_sum(ssize_t window_start, ssize_t window_end,
+                        size_t min_observations=size_t(-1)) const;
+  gl_sarray rolling_mean(ssize_t window_start, ssize_t window_end,
+                         size_t min_observations=size_t(-1)) const;
+  gl_sarray rolling_var(ssize_t window_start, ssize_t window_end,
+                        size_t min_observations=size_t(-1)) const;
+  gl_sarray rolling_stdv(ssize_t window_start, ssize_t window_end,
+                         size_t min_observations=size_t(-1)) const;
+  gl_sarray rolling_min(ssize_t window_start, ssize_t window_end,
+                        size_t min_observations=size_t(-1)) const;
+  gl_sarray rolling_max(ssize_t window_start, ssize_t window_end,
+                        size_t min_observations=size_t(-1)) const;
+  gl_sarray rolling_count(ssize_t window_start, ssize_t window_end) const;
+
   /**
    * \internal
    * Gets the internal implementation object.
@@ -2059,4 +2266,9 @@ class gl_sarray_writer {
 };
 
 } // namespace graphlab
+
+#include "gl_sarray_typed_apply_impl.hpp"
+#include "gl_sarray_rolling_impl.hpp"
+#include "gl_sarray_cumulative_impl.hpp"
+#include "gl_sarray_datetime_impl.hpp"
 #endif
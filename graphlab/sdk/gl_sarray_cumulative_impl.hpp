@@ -0,0 +1,151 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SARRAY_CUMULATIVE_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SARRAY_CUMULATIVE_IMPL_HPP
+#include <vector>
+#include <memory>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/sframe/group_aggregate_value.hpp>
+#include <graphlab/sframe/rolling_aggregate_value.hpp>
+#include "gl_sarray.hpp"
+
+namespace graphlab {
+
+namespace gl_sarray_impl {
+
+/**
+ * Opens one range per contiguous segment of "source" (which must be
+ * materialized). Ranges are opened sequentially, and can then be read
+ * in parallel.
+ */
+inline std::vector<gl_sarray_range> open_segment_ranges(const gl_sarray& source,
+                                                        size_t nsegments) {
+  size_t n = source.size();
+  std::vector<gl_sarray_range> ranges;
+  for (size_t segmentid = 0; segmentid < nsegments; ++segmentid) {
+    ranges.push_back(source.range_iterator(n * segmentid / nsegments,
+                                           n * (segmentid + 1) / nsegments));
+  }
+  return ranges;
+}
+
+/**
+ * Second pass of the segmented prefix scan over one segment: calls
+ * write(value) with the running aggregate of each element of "values",
+ * starting from "prefix", the aggregate of the elements before the
+ * segment. "seen" is true if the prefix holds a value; rows before the
+ * first value are missing.
+ *
+ * An aggregator which accepts adds after a combine (see
+ * \ref accepts_add_after_combine) takes each element straight into the
+ * prefix. Any other aggregator adds the elements into a local aggregate,
+ * and each row emits a copy of the prefix combined with a partial_finalize()d
+ * copy of the local aggregate. The copies are made into scratch aggregates
+ * allocated once per segment, and only when an element was added since the
+ * previous row.
+ */
+template <typename Range, typename WriteFn>
+void scan_segment(group_aggregate_value& prefix, bool seen,
+                  Range& values, const WriteFn& write) {
+  if (accepts_add_after_combine(prefix)) {
+    for (const auto& element: values) {
+      if (element.get_type() != flex_type_enum::UNDEFINED) {
+        prefix.add_element_simple(element);
+        seen = true;
+      }
+      write(seen ? prefix.emit() : FLEX_UNDEFINED);
+    }
+    return;
+  }
+  std::unique_ptr<group_aggregate_value> local(prefix.new_instance());
+  std::unique_ptr<group_aggregate_value> local_copy(prefix.new_instance());
+  std::unique_ptr<group_aggregate_value> scratch(prefix.new_instance());
+  std::vector<char> buffer;
+  flexible_type current = seen ? prefix.emit() : FLEX_UNDEFINED;
+  for (const auto& element: values) {
+    if (element.get_type() != flex_type_enum::UNDEFINED) {
+      local->add_element_simple(element);
+      seen = true;
+      copy_aggregate(*local, *local_copy, buffer);
+      local_copy->partial_finalize();
+      copy_aggregate(prefix, *scratch, buffer);
+      scratch->combine(*local_copy);
+      current = scratch->emit();
+    }
+    write(current);
+  }
+}
+
+} // namespace gl_sarray_impl
+
+inline gl_sarray gl_sarray::parallel_cumulative_aggregate(
+    std::shared_ptr<group_aggregate_value> aggregator) const {
+  if (!aggregator->support_type(dtype())) {
+    log_and_throw("Aggregator " + aggregator->name() +
+                  " does not support input type " + flex_type_enum_to_name(dtype()));
+  }
+  flex_type_enum output_type = aggregator->set_input_types({dtype()});
+
+  gl_sarray source(*this);
+  source.materialize();
+  gl_sarray_writer writer(output_type);
+  size_t nsegments = writer.num_segments();
+
+  // pass 1: partial aggregate of each segment
+  std::vector<std::unique_ptr<group_aggregate_value> > partials(nsegments);
+  std::vector<char> has_value(nsegments, false);
+  {
+    auto ranges = gl_sarray_impl::open_segment_ranges(source, nsegments);
+    parallel_for(0, nsegments, [&](size_t segmentid) {
+      partials[segmentid].reset(aggregator->new_instance());
+      for (const auto& value: ranges[segmentid]) {
+        if (value.get_type() == flex_type_enum::UNDEFINED) continue;
+        partials[segmentid]->add_element_simple(value);
+        has_value[segmentid] = true;
+      }
+      partials[segmentid]->partial_finalize();
+    });
+  }
+
+  // exclusive prefix of the partial aggregates
+  std::vector<std::unique_ptr<group_aggregate_value> > prefixes(nsegments);
+  std::vector<char> prefix_has_value(nsegments, false);
+  for (size_t segmentid = 0; segmentid < nsegments; ++segmentid) {
+    prefixes[segmentid].reset(aggregator->new_instance());
+    prefixes[segmentid]->partial_finalize();
+    if (segmentid > 0) {
+      prefixes[segmentid]->combine(*prefixes[segmentid - 1]);
+      prefixes[segmentid]->combine(*partials[segmentid - 1]);
+      prefix_has_value[segmentid] = prefix_has_value[segmentid - 1] ||
+                                    has_value[segmentid - 1];
+    }
+  }
+  partials.clear();
+
+  // pass 2: rescan each segment from its prefix
+  auto ranges = gl_sarray_impl::open_segment_ranges(source, nsegments);
+  parallel_for(0, nsegments, [&](size_t segmentid) {
+    gl_sarray_impl::scan_segment(*prefixes[segmentid], prefix_has_value[segmentid],
+                                 ranges[segmentid],
+                                 [&](const flexible_type& value) {
+                                   writer.write(value, segmentid);
+                                 });
+  });
+  return writer.close();
+}
+
+inline gl_sarray gl_sarray::parallel_cumulative_aggregate(const std::string& name) const {
+  return parallel_cumulative_aggregate(rolling_operators::get_builtin_aggregator(name));
+}
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SARRAY_DATETIME_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SARRAY_DATETIME_IMPL_HPP
+#include <string>
+#include <vector>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/flexible_type/fast_field_parsers.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include "gl_sarray.hpp"
+
+namespace graphlab {
+
+inline gl_sarray gl_sarray::fast_str_to_datetime(const std::string& str_format) const {
+  if (dtype() != flex_type_enum::STRING) {
+    log_and_throw("fast_str_to_datetime requires a string array");
+  }
+  datetime_format_parser parser(str_format);
+  if (!parser.compiled()) return str_to_datetime(str_format);
+
+  gl_sarray source(*this);
+  source.materialize();
+
+  // pass 1: the fast path, leaving missing the values outside of its layout
+  gl_sarray_writer writer(flex_type_enum::DATETIME);
+  size_t nsegments = writer.num_segments();
+  std::vector<size_t> num_unparsed(nsegments, 0);
+  {
+    auto ranges = gl_sarray_impl::open_segment_ranges(source, nsegments);
+    parallel_for(0, nsegments, [&](size_t segmentid) {
+      flex_date_time value;
+      for (const auto& element: ranges[segmentid]) {
+        if (element.get_type() == flex_type_enum::UNDEFINED) {
+          writer.write(FLEX_UNDEFINED, segmentid);
+        } else if (parser.parse(element.get<flex_string>(), value)) {
+          writer.write(value, segmentid);
+        } else {
+          writer.write(FLEX_UNDEFINED, segmentid);
+          ++num_unparsed[segmentid];
+        }
+      }
+    });
+  }
+  gl_sarray parsed = writer.close();
+  size_t total_unparsed = 0;
+  for (size_t count: num_unparsed) total_unparsed += count;
+  if (total_unparsed == 0) return parsed;
+
+  // pass 2: the other values through str_to_datetime, merged in
+  gl_sarray fallback = source.apply([parser](const flexible_type& x) -> flexible_type {
+    flex_date_time value;
+    return parser.parse(x.get<flex_string>(), value) ? FLEX_UNDEFINED : x;
+  }, flex_type_enum::STRING).str_to_datetime(str_format);
+  fallback.materialize();
+  parsed.materialize();
+  gl_sarray_writer merged(flex_type_enum::DATETIME, nsegments);
+  auto parsed_ranges = gl_sarray_impl::open_segment_ranges(parsed, nsegments);
+  auto fallback_ranges = gl_sarray_impl::open_segment_ranges(fallback, nsegments);
+  parallel_for(0, nsegments, [&](size_t segmentid) {
+    auto fallback_iter = fallback_ranges[segmentid].begin();
+    for (const auto& value: parsed_ranges[segmentid]) {
+      merged.write(value.get_type() == flex_type_enum::UNDEFINED ? *fallback_iter : value,
+                   segmentid);
+      ++fallback_iter;
+    }
+  });
+  return merged.close();
+}
+
+} // namespace graphlab
+
+#endif
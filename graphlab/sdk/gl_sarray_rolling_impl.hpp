@@ -0,0 +1,182 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SARRAY_ROLLING_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SARRAY_ROLLING_IMPL_HPP
+#include <vector>
+#include <memory>
+#include <climits>
+#include <algorithm>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/sframe/group_aggregate_value.hpp>
+#include <graphlab/sframe/rolling_aggregate_value.hpp>
+#include "gl_sarray.hpp"
+
+namespace graphlab {
+
+namespace gl_sarray_impl {
+
+/**
+ * Returns whether a window holding "num_non_null" non missing values
+ * passes "min_observations" (see gl_sarray::rolling_apply).
+ */
+inline bool window_has_min_observations(size_t num_non_null,
+                                        size_t window_size,
+                                        size_t min_observations) {
+  if (min_observations == size_t(-1)) return num_non_null == window_size;
+  if (min_observations == 0) return true;
+  return num_non_null >= min_observations;
+}
+
+/**
+ * Emits the moving window aggregates of rows [begin, end) of a sequence of
+ * n values, calling emit(value) in row order. Positions of the windows
+ * outside [0, n) count as missing values. next_value() must return the
+ * values in order, starting from the first row of the window of "begin".
+ */
+template <typename NextFn, typename EmitFn>
+void rolling_scan(ssize_t begin, ssize_t end, ssize_t n,
+                  ssize_t window_start, ssize_t window_end,
+                  size_t min_observations,
+                  const group_aggregate_value& prototype,
+                  NextFn next_value, EmitFn emit) {
+  if (begin == end) return;
+  size_t window_size = window_end - window_start + 1;
+  sliding_window_aggregate window(prototype);
+  // position of the next row to push, and of the front of the window
+  ssize_t next = std::max<ssize_t>(0, std::min(n, begin + window_start));
+  ssize_t front = next;
+  for (ssize_t i = begin; i < end; ++i) {
+    ssize_t last = std::min(n - 1, i + window_end);
+    for (; next <= last; ++next) window.push_back(next_value());
+    for (; front < i + window_start && front < next; ++front) window.pop_front();
+    if (window_has_min_observations(window.num_non_null(), window_size, min_observations)) {
+      emit(window.emit());
+    } else {
+      emit(FLEX_UNDEFINED);
+    }
+  }
+}
+
+/**
+ * Checks the arguments of a moving window aggregate and sets the input type
+ * of the aggregator. Returns the output type.
+ */
+inline flex_type_enum init_rolling_aggregator(group_aggregate_value& aggregator,
+                                              flex_type_enum input_type,
+                                              ssize_t window_start,
+                                              ssize_t window_end) {
+  if (window_end < window_start) {
+    log_and_throw("Window end must be greater than or equal to window start");
+  }
+  if ((size_t)(window_end - window_start) >= (size_t)UINT_MAX) {
+    log_and_throw("Window size is too large");
+  }
+  if (!aggregator.support_type(input_type)) {
+    log_and_throw("Aggregator " + aggregator.name() +
+                  " does not support input type " + flex_type_enum_to_name(input_type));
+  }
+  return aggregator.set_input_types({input_type});
+}
+
+} // namespace gl_sarray_impl
+
+/*
+ * Output rows are split into one contiguous range per writer segment. Each
+ * segment reads its input rows once, from the start of the window of its
+ * first row to the end of the window of its last row, through rolling_scan.
+ */
+inline gl_sarray gl_sarray::rolling_apply(
+    std::shared_ptr<group_aggregate_value> aggregator,
+    ssize_t window_start,
+    ssize_t window_end,
+    size_t min_observations) const {
+  flex_type_enum output_type = gl_sarray_impl::init_rolling_aggregator(
+      *aggregator, dtype(), window_start, window_end);
+
+  gl_sarray source(*this);
+  source.materialize();
+  ssize_t n = source.size();
+  gl_sarray_writer writer(output_type);
+  size_t nsegments = writer.num_segments();
+
+  // the ranges are opened sequentially, then read in parallel
+  std::vector<std::pair<ssize_t, ssize_t> > rows(nsegments);
+  std::vector<gl_sarray_range> ranges;
+  for (size_t segmentid = 0; segmentid < nsegments; ++segmentid) {
+    ssize_t begin = n * segmentid / nsegments;
+    ssize_t end = n * (segmentid + 1) / nsegments;
+    rows[segmentid] = {begin, end};
+    ssize_t read_begin = std::max<ssize_t>(0, std::min(n, begin + window_start));
+    ssize_t read_end = std::max(read_begin, std::min(n, end - 1 + window_end + 1));
+    ranges.push_back(source.range_iterator(read_begin, read_end));
+  }
+
+  parallel_for(0, nsegments, [&](size_t segmentid) {
+    ssize_t begin = rows[segmentid].first;
+    ssize_t end = rows[segmentid].second;
+    auto iter = ranges[segmentid].begin();
+    gl_sarray_impl::rolling_scan(
+        begin, end, n, window_start, window_end, min_observations, *aggregator,
+        [&]() {
+          flexible_type value = *iter;
+          ++iter;
+          return value;
+        },
+        [&](const flexible_type& value) { writer.write(value, segmentid); });
+  });
+  return writer.close();
+}
+
+inline gl_sarray gl_sarray::rolling_apply(const std::string& fn_name,
+                                          ssize_t window_start,
+                                          ssize_t window_end,
+                                          size_t min_observations) const {
+  return rolling_apply(rolling_operators::get_builtin_aggregator(fn_name),
+                       window_start, window_end, min_observations);
+}
+
+inline gl_sarray gl_sarray::rolling_sum(ssize_t window_start, ssize_t window_end,
+                                        size_t min_observations) const {
+  return rolling_apply("__builtin__sum__", window_start, window_end, min_observations);
+}
+
+inline gl_sarray gl_sarray::rolling_mean(ssize_t window_start, ssize_t window_end,
+                                         size_t min_observations) const {
+  return rolling_apply("__builtin__avg__", window_start, window_end, min_observations);
+}
+
+inline gl_sarray gl_sarray::rolling_var(ssize_t window_start, ssize_t window_end,
+                                        size_t min_observations) const {
+  return rolling_apply("__builtin__var__", window_start, window_end, min_observations);
+}
+
+inline gl_sarray gl_sarray::rolling_stdv(ssize_t window_start, ssize_t window_end,
+                                         size_t min_observations) const {
+  return rolling_apply("__builtin__stdv__", window_start, window_end, min_observations);
+}
+
+inline gl_sarray gl_sarray::rolling_min(ssize_t window_start, ssize_t window_end,
+                                        size_t min_observations) const {
+  return rolling_apply("__builtin__min__", window_start, window_end, min_observations);
+}
+
+inline gl_sarray gl_sarray::rolling_max(ssize_t window_start, ssize_t window_end,
+                                        size_t min_observations) const {
+  return rolling_apply("__builtin__max__", window_start, window_end, min_observations);
+}
+
+inline gl_sarray gl_sarray::rolling_count(ssize_t window_start, ssize_t window_end) const {
+  return rolling_apply("__builtin__count__", window_start, window_end, 0);
+}
+
+} // namespace graphlab
+
+#endif
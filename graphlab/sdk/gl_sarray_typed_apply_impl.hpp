@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SARRAY_TYPED_APPLY_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SARRAY_TYPED_APPLY_IMPL_HPP
+#include <vector>
+#include <memory>
+#include <type_traits>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include "gl_sarray.hpp"
+#include "gl_sarray_cumulative_impl.hpp"
+
+namespace graphlab {
+
+/**
+ * \internal
+ * Helpers of the typed \ref gl_sarray::apply.
+ */
+namespace gl_sarray_impl {
+
+/**
+ * Unboxes a value into "out". Returns false if the value is missing.
+ */
+template <typename T>
+inline bool unbox(const flexible_type& value, T& out) {
+  if (value.get_type() == type_to_enum<T>::value) {
+    out = value.get<T>();
+    return true;
+  } else if (value.get_type() == flex_type_enum::UNDEFINED) {
+    return false;
+  }
+  out = value.to<T>();
+  return true;
+}
+
+/**
+ * The number of rows a typed apply unboxes and applies at a time.
+ */
+static constexpr size_t typed_apply_block_size = 4096;
+
+/**
+ * Per segment scratch buffers of a typed apply, reused across blocks.
+ */
+template <typename In, typename Out>
+struct typed_apply_buffers {
+  std::vector<In> input;
+  std::vector<Out> output;
+  std::vector<char> valid;
+};
+
+} // namespace gl_sarray_impl
+
+/*
+ * Each writer segment reads one contiguous range of the input rows, opened
+ * by gl_sarray_impl::open_segment_ranges, so that writer segment i receives
+ * the rows of range i. The rows are applied in blocks of
+ * typed_apply_block_size, through the buffers of the segment.
+ */
+template <typename In, typename Out, typename Fn>
+gl_sarray gl_sarray::apply(Fn fn, bool skip_undefined) const {
+  static_assert(type_to_enum<In>::value != flex_type_enum::UNDEFINED,
+                "In must be one of the flexible_type content types");
+  static_assert(type_to_enum<Out>::value != flex_type_enum::UNDEFINED,
+                "Out must be one of the flexible_type content types");
+  gl_sarray source(*this);
+  source.materialize();
+  gl_sarray_writer writer(type_to_enum<Out>::value);
+  size_t nsegments = writer.num_segments();
+  std::vector<gl_sarray_impl::typed_apply_buffers<In, Out> > buffers(nsegments);
+  auto ranges = gl_sarray_impl::open_segment_ranges(source, nsegments);
+
+  parallel_for(0, nsegments, [&](size_t segmentid) {
+    auto& buf = buffers[segmentid];
+    buf.input.resize(gl_sarray_impl::typed_apply_block_size);
+    buf.output.resize(gl_sarray_impl::typed_apply_block_size);
+    buf.valid.resize(gl_sarray_impl::typed_apply_block_size);
+    auto iter = ranges[segmentid].begin();
+    auto end = ranges[segmentid].end();
+    while (iter != end) {
+      // unbox a block into a contiguous typed buffer. Missing values
+      // which are not skipped are passed to fn as a default In.
+      size_t n = 0;
+      bool all_valid = true;
+      for (; n < gl_sarray_impl::typed_apply_block_size && iter != end; ++n, ++iter) {
+        buf.valid[n] = gl_sarray_impl::unbox(*iter, buf.input[n]);
+        if (!buf.valid[n] && !skip_undefined) {
+          buf.input[n] = In();
+          buf.valid[n] = 1;
+        }
+        all_valid &= (buf.valid[n] != 0);
+      }
+
+      // a branch free loop when there is no missing value
+      if (all_valid) {
+        for (size_t i = 0; i < n; ++i) buf.output[i] = fn(buf.input[i]);
+      } else {
+        for (size_t i = 0; i < n; ++i) {
+          if (buf.valid[i]) buf.output[i] = fn(buf.input[i]);
+        }
+      }
+
+      for (size_t i = 0; i < n; ++i) {
+        if (buf.valid[i]) writer.write(flexible_type(std::move(buf.output[i])), segmentid);
+        else writer.write(FLEX_UNDEFINED, segmentid);
+      }
+    }
+  });
+  return writer.close();
+}
+
+} // namespace graphlab
+
+#endif
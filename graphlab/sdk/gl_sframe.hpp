@@ -370,8 +370,164 @@ groupby_descriptor_type ARGMAX(const std::string& agg, const std::string& out);
  */
 groupby_descriptor_type ARGMIN(const std::string& agg, const std::string& out);
 
+/**
+ * Approximate count distinct aggregator for groupby, by a HyperLogLog
+ * sketch. Each group holds 2^register_bits bytes, and the relative
+ * standard error of the count is 1.04 / sqrt(2^register_bits): about 1.6%
+ * for the default of 12.
+ *
+ * Example: Get the approximate number of unique movies rated by each user.
+ * \code
+ * sf.groupby({"user"},
+ *            {{"num_movies", aggregate::APPROX_COUNT_DISTINCT("movie")}});
+ * \endcode
+ */
+groupby_descriptor_type APPROX_COUNT_DISTINCT(const std::string& col,
+                                              size_t register_bits = 12);
+
+///@{
+/**
+ * Approximate quantile aggregator for groupby, by a mergeable KLL sketch
+ * of parameter k. Unlike \ref QUANTILE, the memory of each group is
+ * bounded by O(k) whatever its size, and the rank error is about 1.7 / k
+ * of the group size. The single quantile version returns a float, and the
+ * other an array.
+ *
+ * \code
+ * sf.groupby({"user"},
+ *            {{"median_rating", aggregate::APPROX_QUANTILE("rating", 0.5)}});
+ * \endcode
+ */
+groupby_descriptor_type APPROX_QUANTILE(const std::string& col, double quantile,
+                                        size_t k = 200);
+groupby_descriptor_type APPROX_QUANTILE(const std::string& col,
+                                        const std::vector<double>& quantiles,
+                                        size_t k = 200);
+///@}
+
+/**
+ * Approximate top k aggregator for groupby, by a space saving sketch.
+ * Returns a dictionary of the (at most) k most frequent values of each
+ * group to their estimated counts. The sketch monitors "capacity" values
+ * (at least 4k); a value occuring in more than 1 / capacity of its group
+ * is always found, and its count is overestimated by at most
+ * group size / capacity.
+ *
+ * \code
+ * sf.groupby({"user"},
+ *            {{"top_genres", aggregate::FREQUENT_ITEMS("genre", 3)}});
+ * \endcode
+ */
+groupby_descriptor_type FREQUENT_ITEMS(const std::string& col, size_t k = 10,
+                                       size_t capacity = 0);
+
+/**
+ * Describing a window aggregate over one column, computed within each
+ * partition of a \ref gl_sframe::window_aggregate.
+ *
+ * An object of window_descriptor_type is constructed using \ref CUMULATIVE
+ * or \ref ROLLING.
+ */
+struct window_descriptor_type {
+  /// column as input into the aggregator
+  std::string m_column;
+
+  /// aggregator
+  std::shared_ptr<group_aggregate_value> m_aggregator;
+
+  /// whether this is a cumulative aggregate, rather than a moving window
+  bool m_cumulative = true;
+
+  /// moving window bounds, relative to the current row, inclusive
+  ssize_t m_window_start = 0;
+  ssize_t m_window_end = 0;
+
+  /// see \ref gl_sarray::rolling_apply
+  size_t m_min_observations = size_t(-1);
+};
+
+///@{
+/**
+ * Cumulative aggregate of a column within each partition, in partition
+ * order. The aggregator is either a \ref group_aggregate_value or the name
+ * of a builtin aggregator ("__builtin__sum__", "__builtin__avg__", ...).
+ *
+ * Example: Running total of the amount spent by each user.
+ * \code
+ * sf.window_aggregate({"user"}, "time",
+ *                     {{"total", aggregate::CUMULATIVE("__builtin__sum__", "amount")}});
+ * \endcode
+ *
+ * \see gl_sframe::window_aggregate
+ */
+window_descriptor_type CUMULATIVE(std::shared_ptr<group_aggregate_value> aggregator,
+                                  const std::string& col);
+window_descriptor_type CUMULATIVE(const std::string& builtin_operator_name,
+                                  const std::string& col);
+///@}
+
+///@{
+/**
+ * Moving window aggregate of a column within each partition, in partition
+ * order. "window_start", "window_end" and "min_observations" are as in
+ * \ref gl_sarray::rolling_apply, with windows bounded by the partition.
+ *
+ * Example: Mean of the last 3 ratings of each user.
+ * \code
+ * sf.window_aggregate({"user"}, "time",
+ *                     {{"recent", aggregate::ROLLING("__builtin__avg__", "rating", -2, 0, 1)}});
+ * \endcode
+ *
+ * \see gl_sframe::window_aggregate
+ */
+window_descriptor_type ROLLING(std::shared_ptr<group_aggregate_value> aggregator,
+                               const std::string& col,
+                               ssize_t window_start, ssize_t window_end,
+                               size_t min_observations = size_t(-1));
+window_descriptor_type ROLLING(const std::string& builtin_operator_name,
+                               const std::string& col,
+                               ssize_t window_start, ssize_t window_end,
+                               size_t min_observations = size_t(-1));
+///@}
+
 } // aggregate
 
+/**
+ * Statistics of a \ref gl_sframe::hash_join.
+ */
+struct join_statistics {
+  /// true if the left gl_sframe was the build side
+  bool build_is_left = false;
+  size_t num_build_rows = 0;
+  size_t num_probe_rows = 0;
+  size_t num_output_rows = 0;
+  /// number of radix partitions
+  size_t num_partitions = 0;
+  /// number of partition spill files written, on both sides
+  size_t num_spills = 0;
+  /// probe rows rejected by the bloom filter
+  size_t num_probe_rows_filtered = 0;
+  /// keys detected as heavy hitters by sampling, and joined by broadcast
+  size_t num_heavy_keys = 0;
+  size_t num_heavy_build_rows = 0;
+  size_t num_heavy_probe_rows = 0;
+  /// largest and mean number of probe rows in a partition
+  size_t max_partition_probe_rows = 0;
+  double mean_partition_probe_rows = 0;
+};
+
+/**
+ * A filter on a column of a Parquet file, read by
+ * \ref gl_sframe::construct_from_parquet: rows are kept if
+ * "column op value", where op is one of "==", "!=", "<", "<=", ">" and
+ * ">=". Missing values never match.
+ */
+struct parquet_predicate {
+  std::string column;
+  std::string op;
+  flexible_type value;
+};
+
 /**
  * \ingroup group_glsdk
  * A tabular, column-mutable dataframe object that can scale to big data. 
@@ -517,6 +673,124 @@ class gl_sframe {
   void construct_from_csvs(std::string csv_file, csv_parsing_config_map csv_config,
     str_flex_type_map column_type_hints);
 
+  /**
+   * Same as \ref construct_from_csvs, reading one local csv file in parallel.
+   *
+   * The file is split into one byte range per thread. Each range is first
+   * scanned for its number of quote characters and its first newline after
+   * an even and an odd number of them, so that the first record boundary of
+   * every range (the first newline outside of quotes) follows from the
+   * ranges before it. The records of each range are then tokenized in
+   * parallel, finding delimiters, quotes and newlines 16 bytes at a time
+   * with SSE2 where available, and integer, float and string fields are
+   * converted directly into the typed segments of a \ref gl_sframe_writer.
+   * Columns hinted as other types are read as strings and converted with
+   * \ref gl_sarray::str_to_datetime or \ref gl_sarray::astype.
+   *
+   * csv_config accepts "use_header", "delimiter", "quote_char",
+   * "escape_char", "double_quote", "comment_char", "skip_initial_space",
+   * "na_values" and "continue_on_failure". A column_type_hints entry for
+   * "__all_columns__" applies to every column, and columns without a hint
+   * are strings. Columns without a header are named X1, X2, ...
+   *
+   * Directories, globs, remote and gzip compressed files, multi-character
+   * delimiters and "row_limit" are read by \ref construct_from_csvs, as are
+   * files whose quote characters are unbalanced (quotes inside unquoted
+   * fields), which defeat the quote parity.
+   *
+   * \code
+   * gl_sframe sf;
+   * sf.construct_from_csvs_parallel("events.csv", {{"delimiter", "\t"}},
+   *                                 {{"user", flex_type_enum::INTEGER},
+   *                                  {"score", flex_type_enum::FLOAT}});
+   * \endcode
+   *
+   * Defined in <graphlab/sdk/gl_sframe_csv.hpp>, which must be included to call it.
+   */
+  void construct_from_csvs_parallel(std::string csv_file, csv_parsing_config_map csv_config,
+                                    str_flex_type_map column_type_hints);
+
+  /**
+   * Constructs a gl_sframe from an Arrow IPC file (a Feather V2 file),
+   * written by \ref save_columnar or by another Arrow writer.
+   *
+   * The file is mapped into memory, and its batches are read in place and
+   * written into the segments of a \ref gl_sframe_writer in parallel. To
+   * use the columns without building a gl_sframe at all, map the file with
+   * a columnar_file_reader, whose column views point into the mapping.
+   *
+   * Columns must be Int64, Double, microsecond Timestamp, LargeUtf8 (plain,
+   * or dictionary encoded with Int64 indices), or LargeList of Double. See
+   * graphlab/sframe/columnar_file.hpp.
+   *
+   * \see save_columnar
+   *
+   * Defined in <graphlab/sdk/gl_sframe_columnar.hpp>, which must be included to call it.
+   */
+  void construct_from_columnar(const std::string& path);
+
+  /**
+   * Constructs a gl_sframe from a local Parquet file.
+   *
+   * The file is mapped into memory and its row groups are decoded in
+   * parallel, each into its own segment of a \ref gl_sframe_writer. Only
+   * the column chunks of the requested columns are read, and row groups
+   * whose min / max statistics show that no row can match the predicates
+   * are skipped without being read. In the other row groups the predicate
+   * columns are decoded first, and the other columns are only decoded
+   * when some row matches.
+   *
+   * Flat columns (required or optional leaves of the root) are supported,
+   * in uncompressed or snappy compressed pages. Columns in groups and
+   * repeated columns are left out of the gl_sframe.
+   *
+   * \param path The local path of the file.
+   * \param columns Optional. The columns to read, in order. All the flat
+   * columns by default.
+   * \param predicates Optional. Filters the rows, see \ref parquet_predicate.
+   *
+   * \code
+   * gl_sframe sf;
+   * sf.construct_from_parquet("events.parquet", {"user", "score"},
+   *                           {{"score", ">=", 0.5}, {"country", "==", "FR"}});
+   * \endcode
+   *
+   * Defined in <graphlab/sdk/gl_sframe_parquet.hpp>, which must be included to call it.
+   */
+  void construct_from_parquet(const std::string& path,
+                              const std::vector<std::string>& columns = {},
+                              const std::vector<parquet_predicate>& predicates = {});
+
+  /**
+   * Constructs a gl_sframe from an Avro object container file, with one
+   * typed column per field of its top level record.
+   *
+   * Unlike \ref gl_sarray::from_avro, which decodes the file on one thread
+   * into a column of dicts, the file is mapped into memory and split into
+   * byte ranges, each starting at the first block after a sync marker, and
+   * the blocks of the ranges are decoded in parallel straight into the
+   * segments of a \ref gl_sframe_writer. Column types come from the schema:
+   * ints, longs and booleans are integers, floats, doubles and decimals are
+   * floats, strings, bytes, enums and fixeds are strings, dates and
+   * timestamps are datetimes, arrays of numbers are vectors, other arrays
+   * are lists, and maps and records are dicts. Unions of null and a type
+   * have the type, with null as missing value. Null fields and unions of
+   * other types are string columns, holding their values as strings.
+   *
+   * Files with the "null" and "snappy" codecs are decoded in parallel.
+   * Other codecs are read by \ref gl_sarray::from_avro, and its values
+   * converted to the same column types. Remote files and schemas without a
+   * top level record are read by \ref gl_sarray::from_avro and unpacked.
+   *
+   * \code
+   * gl_sframe sf;
+   * sf.construct_from_avro("events.avro");
+   * \endcode
+   *
+   * Defined in <graphlab/sdk/gl_sframe_avro.hpp>, which must be included to call it.
+   */
+  void construct_from_avro(const std::string& path);
+
   /// Copy assignment
   gl_sframe& operator=(const gl_sframe&);
   /// Move assignment
@@ -792,6 +1066,110 @@ class gl_sframe {
       std::function<bool(size_t, const std::shared_ptr<sframe_rows>&)> callback,
       size_t nthreads = (size_t)(-1));
 
+  /**
+   * Same as \ref materialize_to_callback, but presents the requested
+   * numeric columns of each block as contiguous typed arrays with validity
+   * bitmaps (\ref typed_column_view), in the order of "columns", instead
+   * of flexible_type rows. T is flex_int or flex_float; integer columns can
+   * be read as flex_float. Throws if a column holds other types.
+   *
+   * \code
+   * sf.materialize_to_callback<flex_float>({"x", "y"},
+   *     [&](size_t threadid, const std::vector<typed_column_view<flex_float> >& cols) {
+   *       const double* x = cols[0].data();
+   *       const double* y = cols[1].data();
+   *       for (size_t i = 0; i < cols[0].size(); ++i) dot[threadid] += x[i] * y[i];
+   *       return false;
+   *     });
+   * \endcode
+   *
+   * \param columns The columns to read.
+   * \param callback The callback to call
+   * \param nthreads Number of threads. If not specified, #cpus is used
+   */
+  template <typename T>
+  void materialize_to_callback(
+      const std::vector<std::string>& columns,
+      std::function<bool(size_t, const std::vector<typed_column_view<T> >&)> callback,
+      size_t nthreads = (size_t)(-1)) {
+    std::vector<std::vector<typed_column_view<T> > > views(
+        nthreads == (size_t)(-1) ? thread::cpu_count() : nthreads,
+        std::vector<typed_column_view<T> >(columns.size()));
+    select_columns(columns).materialize_to_callback(
+        [&](size_t threadid, const std::shared_ptr<sframe_rows>& rows) {
+          auto& block = views[threadid];
+          for (size_t i = 0; i < block.size(); ++i) {
+            if (!rows->get_typed_column(i, block[i])) {
+              log_and_throw("Column \"" + columns[i] +
+                            "\" cannot be read as a numeric typed column");
+            }
+          }
+          return callback(threadid, block);
+        }, nthreads);
+  }
+
+  /**
+   * Calls a callback function passing the rows of the given columns, for
+   * which "predicate" evaluates to true.
+   *
+   * The projection and the filter are added to the lazy query before it is
+   * executed, so columns which are neither requested nor used by the
+   * predicate are not read, and rows failing the predicate never reach the
+   * callback. "predicate" is a gl_sarray expression over columns of this
+   * SFrame, of the same length, such as <code>sf["a"] > 3</code>.
+   *
+   * \code
+   * sf.materialize_to_callback({"user", "score"}, sf["score"] > 3,
+   *     [&](size_t threadid, const std::shared_ptr<sframe_rows>& rows) {
+   *       for (const auto& row: *rows) {
+   *         // row[0] is "user", row[1] is "score"
+   *       }
+   *       return false;
+   *     });
+   * \endcode
+   *
+   * \param columns The columns to read, in the order of the row values.
+   * \param predicate The row filter.
+   * \param callback The callback to call
+   * \param nthreads Number of threads. If not specified, #cpus is used
+   *
+   * \see materialize_to_callback
+   */
+  void materialize_to_callback(
+      const std::vector<std::string>& columns,
+      const gl_sarray& predicate,
+      std::function<bool(size_t, const std::shared_ptr<sframe_rows>&)> callback,
+      size_t nthreads = (size_t)(-1)) {
+    select_columns(columns)[predicate].materialize_to_callback(callback, nthreads);
+  }
+
+  /**
+   * Calls a callback function passing the rows of the given columns.
+   * Columns which are not requested are not read.
+   *
+   * \see materialize_to_callback
+   */
+  void materialize_to_callback(
+      const std::vector<std::string>& columns,
+      std::function<bool(size_t, const std::shared_ptr<sframe_rows>&)> callback,
+      size_t nthreads = (size_t)(-1)) {
+    select_columns(columns).materialize_to_callback(callback, nthreads);
+  }
+
+  /**
+   * Typed version of the filtered materialize_to_callback: presents the
+   * requested columns of the rows for which "predicate" evaluates to true
+   * as \ref typed_column_view.
+   */
+  template <typename T>
+  void materialize_to_callback(
+      const std::vector<std::string>& columns,
+      const gl_sarray& predicate,
+      std::function<bool(size_t, const std::vector<typed_column_view<T> >&)> callback,
+      size_t nthreads = (size_t)(-1)) {
+    select_columns(columns)[predicate].materialize_to_callback<T>(columns, callback, nthreads);
+  }
+
   /**
    * Returns a one pass range object with begin() and end() iterators.
    *
@@ -902,6 +1280,26 @@ class gl_sframe {
    */
   void save(const std::string& path, const std::string& format="") const;
 
+  /**
+   * Saves the SFrame as a local Arrow IPC file (a Feather V2 file), which
+   * Arrow readers such as pyarrow.ipc.open_file and pyarrow.feather read.
+   * Each batch of "batch_size" rows holds each column as 64 byte aligned
+   * little endian buffers: Int64 integers, Double floats, Timestamp
+   * microsecond datetimes in UTC, LargeUtf8 strings, dictionary encoded
+   * when they repeat, and LargeList of Double vectors, so that a reader
+   * maps the file and uses the columns in place. The time zones of
+   * datetimes are saved in an extra Int8 column after each datetime column.
+   * See graphlab/sframe/columnar_file.hpp for the layout.
+   *
+   * Batches are encoded in parallel. Only integer, float, datetime, string
+   * and vector columns can be saved.
+   *
+   * \see construct_from_columnar
+   *
+   * Defined in <graphlab/sdk/gl_sframe_columnar.hpp>, which must be included to call it.
+   */
+  void save_columnar(const std::string& path, size_t batch_size = 256 * 1024) const;
+
 
   /**
    * Performs an incomplete save of an existing SFrame into a directory.
@@ -1716,6 +2114,105 @@ class gl_sframe {
                     const std::map<std::string, aggregate::groupby_descriptor_type>& operators 
                     = std::map<std::string, aggregate::groupby_descriptor_type>()) const;
 
+  /**
+   * Same as \ref groupby, aggregating in the SDK within a bounded amount of
+   * memory.
+   *
+   * Rows are read in parallel and each thread pre-aggregates them into its
+   * own open addressing hash table, keyed by the 128 bit hash of the group
+   * columns (\ref hash128). When a thread's table outgrows its share of
+   * "memory_budget" (the size of its keys, plus the saved size of a sample
+   * of its aggregate states, taken again as the states grow), its partial
+   * aggregates are spilled to a temporary file with
+   * \ref group_aggregate_value::save, laid out by hash partition. The
+   * partitions are then merged in parallel, loading the spilled states and
+   * merging them with \ref group_aggregate_value::combine together with
+   * the states still in memory.
+   *
+   * With few distinct groups nothing is spilled and the groups are merged
+   * directly from the thread local tables. With many distinct groups,
+   * memory is bounded by the budget during aggregation, and by about one
+   * hash partition per thread during the merge.
+   *
+   * Works with builtin and user defined aggregators, which must implement
+   * save(), load() and combine().
+   *
+   * \code
+   * sf.groupby({"user"},
+   *            {{"rating_sum", aggregate::SUM("rating")}},
+   *            size_t(4) << 30);
+   * \endcode
+   *
+   * \param groupkeys Columns to group on.
+   * \param operators Map of output column names to aggregators.
+   * \param memory_budget Approximate memory for the partial aggregates, in bytes.
+   */
+  gl_sframe groupby(const std::vector<std::string>& groupkeys,
+                    const std::map<std::string, aggregate::groupby_descriptor_type>& operators,
+                    size_t memory_budget) const;
+
+  /**
+   * Same as \ref groupby, for a gl_sframe sorted in ascending order of the
+   * group keys (missing values first), where each group is a run of rows.
+   *
+   * Nothing is hashed and one group per thread is held in memory: rows are
+   * aggregated in parallel over contiguous segments, and the groups
+   * spanning two segments are combined with
+   * \ref group_aggregate_value::combine. The order of the keys is checked
+   * as the rows are read, and an unsorted input throws. The result is
+   * sorted on the group keys.
+   *
+   * \code
+   * auto daily = events.sorted_groupby({"day"},
+   *                                    {{"count", aggregate::COUNT()}});
+   * \endcode
+   */
+  gl_sframe sorted_groupby(
+      const std::vector<std::string>& groupkeys,
+      const std::map<std::string, aggregate::groupby_descriptor_type>& operators) const;
+
+  /**
+   * Partitioned window aggregates, the equivalent of SQL
+   * <code>agg(col) OVER (PARTITION BY partition_by ORDER BY order_by)</code>.
+   *
+   * Returns a copy of this \ref gl_sframe with one new column per operator,
+   * aligned with the original rows. Each value is the cumulative or moving
+   * window aggregate (see \ref aggregate::CUMULATIVE and
+   * \ref aggregate::ROLLING) of the operator column over the rows of the
+   * same partition, in ascending order of "order_by" (ties and an empty
+   * "order_by" keep the row order).
+   *
+   * All operators are computed together, in one read of the gl_sframe. Rows
+   * are hash partitioned in parallel on the "partition_by" columns, each
+   * partition is grouped and sorted locally, and the window aggregates are
+   * computed inside each group. This needs neither a global sort nor a join
+   * back to the original rows. Partitions are spilled to disk when the rows
+   * outgrow "memory_budget", and are processed a few at a time; the results
+   * of each partition are kept in row order, spilled too past half the
+   * budget, and merged back into the order of the rows. The rows of one
+   * "partition_by" group are held in memory together.
+   *
+   * Example: Running total and moving average of the amount spent by each
+   * user.
+   * \code
+   * auto ret = sf.window_aggregate(
+   *     {"user"}, "time",
+   *     {{"total", aggregate::CUMULATIVE("__builtin__sum__", "amount")},
+   *      {"avg_3", aggregate::ROLLING("__builtin__avg__", "amount", -2, 0, 1)}});
+   * \endcode
+   *
+   * \param partition_by The partition columns.
+   * \param order_by The ordering column within a partition, or "".
+   * \param operators Map of output column names to window aggregates.
+   * \param memory_budget Approximate memory for the buffered rows and
+   * results, in bytes.
+   */
+  gl_sframe window_aggregate(
+      const std::vector<std::string>& partition_by,
+      const std::string& order_by,
+      const std::map<std::string, aggregate::window_descriptor_type>& operators,
+      size_t memory_budget = size_t(1) << 30) const;
+
    /**
     * Joins two \ref gl_sframe objects. Merges the current (left) \ref
     * gl_sframe with the given (right) \ref gl_sframe using a SQL-style
@@ -1850,6 +2347,180 @@ class gl_sframe {
                  const std::map<std::string, std::string>& joinkeys, 
                  const std::string& how="inner") const;
 
+  ///@{
+  /**
+   * Same as \ref join, as a partitioned hash join in the SDK within a
+   * bounded amount of memory.
+   *
+   * The gl_sframe of smaller estimated memory is the build side. Its rows are
+   * radix partitioned on the 128 bit hash of their key columns
+   * (\ref hash128), and their hashes added to a bloom filter. The other
+   * gl_sframe is then scanned once: rows rejected by the bloom filter cannot
+   * match, and are dropped (or emitted at once, for an outer side) without
+   * being partitioned. Partitions are sized so that the build rows of each
+   * fit in a thread's share of "memory_budget", and are joined in parallel
+   * with a hash table on the build rows; a partition which does not fit is
+   * split again on more bits of the hash first. A quarter of the budget is
+   * kept for the heavy hitters below, and either side spills its partitions
+   * to temporary files when its buffered rows outgrow half of the rest.
+   *
+   * Before partitioning, key frequencies are sampled on both sides. Keys
+   * holding more than half of a partition's fair share of the sample are
+   * heavy hitters: their build rows are kept aside in one small hash table
+   * shared by all threads, and their probe rows are joined against it
+   * during the probe scan, by whichever thread reads them. A hot key is
+   * thus spread over all threads instead of making one partition the
+   * straggler. If the build rows of the heavy keys outgrow their quarter of
+   * the budget, they are partitioned like the other rows instead. What
+   * happened is reported in "statistics", if given.
+   *
+   * Key columns must have the same types on both sides. The result has the
+   * left columns followed by the right columns which are not keys; right
+   * column names which already exist are suffixed with ".1". Row order is
+   * not preserved.
+   *
+   * \code
+   * auto enriched = facts.hash_join(dimension, {"product_id"}, "left",
+   *                                 size_t(2) << 30);
+   * \endcode
+   *
+   * \param right The \ref gl_sframe to join.
+   * \param joinkeys The key columns, or a map of left to right key columns.
+   * \param how "inner", "left", "right" or "outer", as in \ref join.
+   * \param memory_budget Approximate memory for the buffered rows, in bytes.
+   * \param statistics Optional. Filled with the \ref join_statistics.
+   */
+  gl_sframe hash_join(const gl_sframe& right,
+                      const std::vector<std::string>& joinkeys,
+                      const std::string& how = "inner",
+                      size_t memory_budget = size_t(1) << 30,
+                      join_statistics* statistics = nullptr) const;
+
+  gl_sframe hash_join(const gl_sframe& right,
+                      const std::map<std::string, std::string>& joinkeys,
+                      const std::string& how = "inner",
+                      size_t memory_budget = size_t(1) << 30,
+                      join_statistics* statistics = nullptr) const;
+  ///@}
+
+  ///@{
+  /**
+   * Same as \ref join, as a streaming sort-merge join of two gl_sframes
+   * both sorted in ascending order of their key columns (e.g. outputs of
+   * \ref sort, or time ordered logs), with missing values first.
+   *
+   * Nothing is hashed: the two sides are split into the same key ranges by
+   * binary search, and the ranges are merged in parallel. Only the right
+   * rows of the current key are held in memory. The order of the keys is
+   * checked as the rows are read, and an unsorted input throws. The
+   * result is sorted on the keys, and has the same columns as
+   * \ref hash_join.
+   *
+   * \code
+   * auto events = clicks.sort("user").merge_join(sessions.sort("user"), {"user"});
+   * \endcode
+   */
+  gl_sframe merge_join(const gl_sframe& right,
+                       const std::vector<std::string>& joinkeys,
+                       const std::string& how = "inner") const;
+
+  gl_sframe merge_join(const gl_sframe& right,
+                       const std::map<std::string, std::string>& joinkeys,
+                       const std::string& how = "inner") const;
+  ///@}
+
+  /**
+   * As-of join of two \ref gl_sframe objects sorted by a time column. Each
+   * row of the current (left) gl_sframe is matched with the last row of
+   * the right gl_sframe whose "on" value is less than or equal to its own,
+   * and which has the same values in the "by" columns.
+   *
+   * Both gl_sframes must be sorted in ascending order of "on", an integer,
+   * float or datetime column present in both, with no missing value. The
+   * join is a single merge pass over the two inputs, holding one right row
+   * per distinct value of the "by" columns.
+   *
+   * The result has the left columns followed by the right columns other
+   * than "on" and "by". Right column names which already exist on the left
+   * are suffixed with ".1".
+   *
+   * \param right The \ref gl_sframe to join.
+   * \param on The time column.
+   * \param by Optional. Columns which must match exactly.
+   * \param how Optional. "left" (default) keeps the left rows without a
+   * match, with missing right values. "inner" drops them.
+   *
+   * Example:
+   * \code
+   * auto trades = gl_sframe({{"t", {2, 5, 9}}, {"qty", {10, 20, 30}}});
+   * auto quotes = gl_sframe({{"t", {1, 4, 5, 8}}, {"price", {1.0, 1.5, 2.0, 2.5}}});
+   * std::cout << trades.asof_join(quotes, "t");
+   * \endcode
+   *
+   * Produces output:
+   * \code{.txt}
+   * +---+-----+-------+
+   * | t | qty | price |
+   * +---+-----+-------+
+   * | 2 |  10 |  1.0  |
+   * | 5 |  20 |  2.0  |
+   * | 9 |  30 |  2.5  |
+   * +---+-----+-------+
+   * [3 rows x 3 columns]
+   * \endcode
+   */
+  gl_sframe asof_join(const gl_sframe& right,
+                      const std::string& on,
+                      const std::vector<std::string>& by = std::vector<std::string>(),
+                      const std::string& how="left") const;
+
+  /**
+   * Apply an aggregator over a moving range of a sorted key column.
+   *
+   * The window of each row holds the rows whose "key_column" value lies in
+   * [key + range_start, key + range_end]. "key_column" must be an integer,
+   * float or datetime column sorted in ascending order, with no missing
+   * value; for datetimes, range_start and range_end are in seconds. For
+   * instance, "the last 5 minutes" is (-300, 0).
+   *
+   * Returns an SArray aligned with the rows of this gl_sframe, holding the
+   * aggregate of "value_column" over each window, or a missing value if the
+   * window has less than "min_observations" non missing values. As in
+   * \ref gl_sarray::rolling_apply, size_t(-1) (the default) requires every
+   * value of the window to be non missing, and 0 emits every window. An
+   * empty window is missing unless "min_observations" is 0.
+   *
+   * This is a single streaming pass which holds only the rows of the current
+   * window. As in \ref gl_sarray::rolling_apply, each row entering or
+   * leaving the window is an O(1) update for aggregators supporting
+   * removal, and amortized O(1) combines for the other ones.
+   *
+   * Example:
+   * \code
+   * // sum of the readings of the last 5 minutes
+   * auto s = sf.rolling_apply_by_range("time", "reading",
+   *                                    std::make_shared<rolling_operators::sum>(),
+   *                                    -300, 0);
+   * \endcode
+   */
+  gl_sarray rolling_apply_by_range(const std::string& key_column,
+                                   const std::string& value_column,
+                                   std::shared_ptr<group_aggregate_value> aggregator,
+                                   double range_start,
+                                   double range_end,
+                                   size_t min_observations = size_t(-1)) const;
+
+  /**
+   * Same as \ref rolling_apply_by_range, given the name of a builtin
+   * aggregator as in \ref gl_sarray::rolling_apply.
+   */
+  gl_sarray rolling_apply_by_range(const std::string& key_column,
+                                   const std::string& value_column,
+                                   const std::string& fn_name,
+                                   double range_start,
+                                   double range_end,
+                                   size_t min_observations = size_t(-1)) const;
+
   /**
    * Filter an \ref gl_sframe by values inside an iterable object. Result is an
    * \ref gl_sframe that only includes (or excludes) the rows that have a
@@ -2611,6 +3282,35 @@ class gl_sframe {
    */
   gl_sframe sort(const std::vector<std::pair<std::string, bool>>& column_and_ascending) const;
 
+  /**
+   * Same as \ref sort, as an external sort in the SDK within a bounded
+   * amount of memory. Missing values sort first in ascending order, and
+   * last in descending order. The sort is stable.
+   *
+   * The sort columns of each row are encoded into one byte string which
+   * compares bytewise in the requested order (order preserving encodings
+   * of integers, floats, datetimes and strings, with the bytes of
+   * descending columns inverted), so that rows are compared with memcmp,
+   * mostly on an integer prefix, instead of column by column.
+   *
+   * Splitters between output partitions are picked from a sample of the
+   * keys. Rows are read in parallel, and each thread sorts its buffered
+   * rows into a run and writes it to disk, by partition, whenever they
+   * outgrow its share of "memory_budget". Each partition is then k-way
+   * merged from all the runs, in parallel.
+   *
+   * \code
+   * auto sorted = sf.external_sort({{"user", true}, {"time", false}},
+   *                                size_t(8) << 30);
+   * \endcode
+   *
+   * \param column_and_ascending The integer, float, string or datetime
+   * columns to sort on, each with its direction.
+   * \param memory_budget Approximate memory for the buffered rows, in bytes.
+   */
+  gl_sframe external_sort(const std::vector<std::pair<std::string, bool> >& column_and_ascending,
+                          size_t memory_budget = size_t(1) << 30) const;
+
   /**
    * Remove missing values from an \ref gl_sframe. A missing value is either "FLEX_UNDEFINED"
    * or "NaN".  If "how" is "any", a row will be removed if any of the
@@ -3061,4 +3761,11 @@ class gl_sframe_writer {
 
 
 } // graphlab
+
+#include "gl_sframe_time_series_impl.hpp"
+#include "gl_sframe_groupby_impl.hpp"
+#include "gl_sframe_join_impl.hpp"
+#include "gl_sframe_sorted_impl.hpp"
+#include "gl_sframe_sort_impl.hpp"
+#include "gl_sframe_window_impl.hpp"
 #endif // GRAPHLAB_UNITY_GL_SFRAME_HPP
@@ -0,0 +1,100 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_AVRO_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_AVRO_IMPL_HPP
+#include <string>
+#include <vector>
+#include <memory>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/fileio/fs_utils.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/sframe/avro_reader.hpp>
+#include "gl_sarray.hpp"
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+inline void gl_sframe::construct_from_avro(const std::string& path) {
+  std::unique_ptr<avro_file> file;
+  if (path.find("://") == std::string::npos &&
+      fileio::get_file_status(path) == fileio::file_status::REGULAR_FILE) {
+    file.reset(new avro_file(path));
+  }
+  bool typed = file != nullptr && file->root().kind == avro_schema_node::RECORD &&
+               !file->root().children.empty();
+  if (!typed) {
+    // remote files and schemas without a top level record are unpacked
+    // with the types of the values
+    *this = gl_sarray::from_avro(path).unpack("");
+    return;
+  }
+  const std::vector<std::string>& names = file->root().names;
+  const std::vector<size_t>& fields = file->root().children;
+  std::vector<flex_type_enum> types;
+  // null fields and mixed unions are read as strings
+  for (size_t child: fields) types.push_back(file->column_type(child));
+
+  if (!file->codec_supported()) {
+    // other codecs are read by from_avro, and its values converted as the
+    // blocks would have been decoded
+    auto schema = std::make_shared<std::vector<avro_schema_node> >(file->schema());
+    gl_sarray records = gl_sarray::from_avro(path);
+    gl_sframe ret;
+    try {
+      for (size_t i = 0; i < fields.size(); ++i) {
+        size_t node = fields[i];
+        flexible_type name = names[i];
+        ret.add_column(records.apply([schema, node, name](const flexible_type& record) {
+          if (record.get_type() == flex_type_enum::DICT) {
+            for (const auto& item: record.get<flex_dict>()) {
+              if (item.first == name) {
+                return avro_file::column_value(*schema, node,
+                                               avro_file::convert(*schema, node, item.second));
+              }
+            }
+          }
+          return flexible_type(FLEX_UNDEFINED);
+        }, types[i], false), names[i]);
+      }
+      ret.materialize();
+    } catch (const std::string& error) {
+      // a value which cannot be converted to its column type fails the
+      // apply through log_and_throw; other errors are not recoverable here
+      logstream(LOG_WARNING) << "Unable to convert the values of " << path
+                             << " to the column types of its schema (" << error << "); "
+                             << "reading them with the types of the values" << std::endl;
+      std::vector<flexible_type> keys(names.begin(), names.end());
+      ret = records.unpack("", {}, FLEX_UNDEFINED, keys).select_columns(names);
+    }
+    *this = ret;
+    return;
+  }
+
+  // one segment per byte range, starting at the first block in the range
+  size_t nsegments = thread::cpu_count();
+  gl_sframe_writer writer(names, types, nsegments);
+  parallel_for(0, nsegments, [&](size_t segmentid) {
+    std::vector<flexible_type> values(fields.size());
+    auto blocks = file->block_range(file->size() * segmentid / nsegments,
+                                    file->size() * (segmentid + 1) / nsegments);
+    file->for_each_record(blocks.first, blocks.second, [&](const std::vector<flexible_type>& row) {
+      for (size_t i = 0; i < row.size(); ++i) {
+        values[i] = avro_file::column_value(file->schema(), fields[i], row[i]);
+      }
+      writer.write(values, segmentid);
+    });
+  });
+  *this = writer.close();
+}
+
+} // namespace graphlab
+
+#endif
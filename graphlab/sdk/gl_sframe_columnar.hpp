@@ -0,0 +1,21 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_COLUMNAR_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_COLUMNAR_HPP
+
+/**
+ * \file
+ * Defines gl_sframe::save_columnar and gl_sframe::construct_from_columnar.
+ * They are kept out of gl_sframe.hpp, so that only the programs which use
+ * them compile them.
+ */
+#include "gl_sframe.hpp"
+#include "gl_sframe_columnar_impl.hpp"
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_COLUMNAR_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_COLUMNAR_IMPL_HPP
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/sframe/columnar_file.hpp>
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+inline void gl_sframe::save_columnar(const std::string& path, size_t batch_size) const {
+  if (batch_size == 0) log_and_throw("batch_size must be positive");
+  std::vector<std::string> names = column_names();
+  std::vector<flex_type_enum> types = column_types();
+  size_t ncolumns = names.size();
+  columnar_file_writer out(path, names, types);
+
+  gl_sframe source(*this);
+  source.materialize();
+  size_t n = source.size();
+  size_t nbatches = (n + batch_size - 1) / batch_size;
+  size_t nthreads = thread::cpu_count();
+  // batches are encoded nthreads at a time, and written in order
+  for (size_t first = 0; first < nbatches; first += nthreads) {
+    size_t count = std::min(nthreads, nbatches - first);
+    std::vector<gl_sframe_range> ranges;
+    std::vector<size_t> batch_rows;
+    for (size_t i = 0; i < count; ++i) {
+      size_t begin = (first + i) * batch_size;
+      size_t end = std::min(n, begin + batch_size);
+      ranges.push_back(source.range_iterator(begin, end));
+      batch_rows.push_back(end - begin);
+    }
+    std::vector<std::vector<columnar_encoded_chunk> > encoded(count);
+    parallel_for(0, count, [&](size_t i) {
+      std::vector<std::vector<flexible_type> > columns(ncolumns);
+      for (auto& column: columns) column.reserve(batch_rows[i]);
+      for (const auto& row: ranges[i]) {
+        for (size_t c = 0; c < ncolumns; ++c) columns[c].push_back(row[c]);
+      }
+      for (size_t c = 0; c < ncolumns; ++c) {
+        encoded[i].push_back(encode_columnar_chunk(columns[c], types[c]));
+        std::vector<flexible_type>().swap(columns[c]);
+      }
+    });
+    for (size_t i = 0; i < count; ++i) out.write_batch(batch_rows[i], encoded[i]);
+  }
+  out.close();
+}
+
+inline void gl_sframe::construct_from_columnar(const std::string& path) {
+  columnar_file_reader in(path);
+  size_t ncolumns = in.num_columns();
+  if (ncolumns == 0) {
+    *this = gl_sframe();
+    return;
+  }
+  size_t nbatches = in.num_batches();
+  size_t nsegments = std::max<size_t>(1, std::min(thread::cpu_count(), nbatches));
+  gl_sframe_writer writer(in.column_names(), in.column_types(), nsegments);
+  parallel_for(0, nsegments, [&](size_t segmentid) {
+    std::vector<flexible_type> row(ncolumns);
+    std::vector<columnar_column_view> views(ncolumns);
+    for (size_t b = nbatches * segmentid / nsegments;
+         b < nbatches * (segmentid + 1) / nsegments; ++b) {
+      for (size_t c = 0; c < ncolumns; ++c) views[c] = in.column(b, c);
+      for (size_t r = 0; r < in.batch_num_rows(b); ++r) {
+        for (size_t c = 0; c < ncolumns; ++c) row[c] = views[c].value(r);
+        writer.write(row, segmentid);
+      }
+    }
+  });
+  *this = writer.close();
+}
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,21 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_CSV_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_CSV_HPP
+
+/**
+ * \file
+ * Defines gl_sframe::construct_from_csvs_parallel, the parallel csv reader.
+ * It is kept out of gl_sframe.hpp, so that only the programs which use it
+ * compile it.
+ */
+#include "gl_sframe.hpp"
+#include "gl_sframe_csv_impl.hpp"
+
+#endif
@@ -0,0 +1,492 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_CSV_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_CSV_IMPL_HPP
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/flexible_type/fast_field_parsers.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/fileio/general_fstream.hpp>
+#include <graphlab/fileio/fs_utils.hpp>
+#include <graphlab/sframe/csv_tokenizer.hpp>
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+namespace gl_sframe_impl {
+
+/**
+ * Reads a single character option of a csv config into c. Returns false
+ * if the option is longer than one character.
+ */
+inline bool csv_config_char(const csv_parsing_config_map& config,
+                            const std::string& key, char& c) {
+  auto iter = config.find(key);
+  if (iter == config.end()) return true;
+  if (iter->second.get_type() == flex_type_enum::UNDEFINED) return true;
+  flex_string value = iter->second.to<flex_string>();
+  if (value.size() > 1) return false;
+  c = value.empty() ? 0 : value[0];
+  return true;
+}
+
+inline bool csv_config_flag(const csv_parsing_config_map& config,
+                            const std::string& key, bool default_value) {
+  auto iter = config.find(key);
+  if (iter == config.end() || iter->second.get_type() == flex_type_enum::UNDEFINED) {
+    return default_value;
+  }
+  return !iter->second.is_zero();
+}
+
+/**
+ * The parser of the fields of one column of a csv file.
+ *
+ * The parser is picked once per column from the column type, so that
+ * converting a field is one call to a parser for that type, with no type
+ * dispatch and no backtracking: integers and floats with
+ * fast_parse_int and fast_parse_float, and datetimes with a
+ * datetime_format_parser for the default format of
+ * gl_sarray::str_to_datetime.
+ */
+class csv_field_parser {
+ public:
+  explicit csv_field_parser(flex_type_enum type = flex_type_enum::STRING) {
+    switch (type) {
+      case flex_type_enum::INTEGER: m_type = type; m_parse = &parse_integer; break;
+      case flex_type_enum::FLOAT: m_type = type; m_parse = &parse_float; break;
+      case flex_type_enum::DATETIME: m_type = type; m_parse = &parse_datetime; break;
+      default: m_type = flex_type_enum::STRING; m_parse = &parse_string; break;
+    }
+  }
+
+  /// The type of the parsed values.
+  flex_type_enum type() const { return m_type; }
+
+  /**
+   * Converts a field. Returns false if the field is not a value of the type
+   * (or, for datetimes, not in the layout of the fast path).
+   */
+  inline bool operator()(const std::string& field, flexible_type& out) const {
+    return m_parse(*this, field, out);
+  }
+
+ private:
+  typedef bool (*parse_function)(const csv_field_parser&, const std::string&, flexible_type&);
+
+  static bool parse_integer(const csv_field_parser&, const std::string& field,
+                            flexible_type& out) {
+    flex_int value = 0;
+    if (!fast_parse_int(field.data(), field.data() + field.size(), value)) return false;
+    out = value;
+    return true;
+  }
+
+  static bool parse_float(const csv_field_parser&, const std::string& field,
+                          flexible_type& out) {
+    flex_float value = 0;
+    if (!fast_parse_float(field.data(), field.data() + field.size(), value)) return false;
+    out = value;
+    return true;
+  }
+
+  static bool parse_datetime(const csv_field_parser& parser, const std::string& field,
+                             flexible_type& out) {
+    flex_date_time value;
+    if (!parser.m_datetime.parse(field, value)) return false;
+    out = value;
+    return true;
+  }
+
+  static bool parse_string(const csv_field_parser&, const std::string& field,
+                           flexible_type& out) {
+    out = field;
+    return true;
+  }
+
+  flex_type_enum m_type;
+  parse_function m_parse;
+  datetime_format_parser m_datetime;
+};
+
+/**
+ * Scans the bytes [begin, end) of a file for their quote parity.
+ */
+inline csv_quote_scan scan_csv_range(const std::string& filename, size_t begin, size_t end,
+                                     const csv_tokenizer& tokenizer) {
+  const size_t block_size = 4 * 1024 * 1024;
+  csv_quote_scan scan;
+  if (begin >= end) return scan;
+  general_ifstream fin(filename);
+  fin.seekg(begin);
+  std::vector<char> buffer(std::min(block_size, end - begin));
+  for (size_t position = begin; position < end; ) {
+    size_t len = std::min(buffer.size(), end - position);
+    fin.read(buffer.data(), len);
+    if (size_t(fin.gcount()) != len) log_and_throw("Error reading " + filename);
+    tokenizer.scan_quotes(buffer.data(), buffer.data() + len, position - begin, scan);
+    position += len;
+  }
+  return scan;
+}
+
+/**
+ * The first record boundary in each of the byte ranges [range_begin[r],
+ * range_begin[r + 1]), from the quote parity of the ranges before it. The
+ * first range starts at a record. The boundaries are a guess, since a quote
+ * inside an unquoted field flips the parity; for_each_csv_record checks
+ * them.
+ */
+inline std::vector<size_t> csv_record_begins(const std::string& filename,
+                                             const std::vector<size_t>& range_begin,
+                                             const csv_tokenizer& tokenizer) {
+  size_t nranges = range_begin.size() - 1;
+  std::vector<csv_quote_scan> scans(nranges);
+  parallel_for(0, nranges, [&](size_t r) {
+    scans[r] = scan_csv_range(filename, range_begin[r], range_begin[r + 1], tokenizer);
+  });
+  std::vector<size_t> record_begin(nranges + 1, range_begin[nranges]);
+  std::vector<size_t> parity(nranges, 0);
+  for (size_t r = 1; r < nranges; ++r) {
+    parity[r] = (parity[r - 1] + scans[r - 1].num_quotes) & 1;
+  }
+  for (size_t r = nranges - 1; r >= 1; --r) {
+    size_t first = scans[r].first_newline[parity[r]];
+    record_begin[r] = (first == csv_quote_scan::NONE) ? record_begin[r + 1]
+                                                      : range_begin[r] + first + 1;
+  }
+  record_begin[0] = range_begin[0];
+  return record_begin;
+}
+
+/**
+ * How reading the records of a byte range of a csv file ended.
+ */
+enum class csv_range_status {
+  COMPLETE,      ///< The last record of the range ends at its end.
+  MISALIGNED,    ///< The last record of the range continues past its end.
+  UNTERMINATED,  ///< The file ends inside a quoted field.
+  STOPPED        ///< fn asked to stop.
+};
+
+/**
+ * Calls fn(fields, nfields, line, line_end) on each record in the bytes
+ * [begin, end) of a file, where begin is the start of a record, until fn
+ * returns false. end is expected to be the end of a record: the record
+ * boundaries found from the quote parity are checked by each range, since
+ * a range whose last record continues past its end was followed by a
+ * range starting inside a record.
+ */
+template <typename Fn>
+inline csv_range_status for_each_csv_record(const std::string& filename, size_t begin,
+                                            size_t end, size_t file_size,
+                                            const csv_tokenizer& tokenizer, Fn fn) {
+  const size_t block_size = 4 * 1024 * 1024;
+  if (begin >= end) return csv_range_status::COMPLETE;
+  general_ifstream fin(filename);
+  fin.seekg(begin);
+  std::string buffer;
+  std::vector<std::string> fields;
+  size_t nfields = 0;
+  size_t position = begin;
+  size_t consumed = 0;
+  while (true) {
+    // keep the partial record at the end of the buffer, and read the next block
+    buffer.erase(0, consumed);
+    size_t len = std::min(block_size, end - position);
+    size_t old_size = buffer.size();
+    buffer.resize(old_size + len);
+    fin.read(&buffer[old_size], len);
+    if (size_t(fin.gcount()) != len) log_and_throw("Error reading " + filename);
+    position += len;
+    bool at_end = (position == end);
+    bool final = at_end && end == file_size;
+
+    const char* p = buffer.data();
+    const char* buffer_end = p + buffer.size();
+    while (p < buffer_end) {
+      const char* line = p;
+      auto status = tokenizer.tokenize(p, buffer_end, final, fields, nfields);
+      if (status == csv_tokenizer::status::INCOMPLETE) break;
+      if (status == csv_tokenizer::status::UNTERMINATED) return csv_range_status::UNTERMINATED;
+      if (status == csv_tokenizer::status::RECORD && !fn(fields, nfields, line, p)) {
+        return csv_range_status::STOPPED;
+      }
+    }
+    if (at_end) {
+      return p == buffer_end ? csv_range_status::COMPLETE : csv_range_status::MISALIGNED;
+    }
+    consumed = p - buffer.data();
+  }
+}
+
+/**
+ * Makes column names unique by suffixing repeated names with ".1", ".2",
+ * and names the empty ones X1, X2, ... by position.
+ */
+inline std::vector<std::string> unique_csv_column_names(std::vector<std::string> names) {
+  std::set<std::string> seen;
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (names[i].empty()) names[i] = "X" + std::to_string(i + 1);
+    std::string name = names[i];
+    for (size_t k = 1; seen.count(name); ++k) name = names[i] + "." + std::to_string(k);
+    names[i] = name;
+    seen.insert(name);
+  }
+  return names;
+}
+
+} // namespace gl_sframe_impl
+
+inline void gl_sframe::construct_from_csvs_parallel(std::string csv_file,
+                                                    csv_parsing_config_map csv_config,
+                                                    str_flex_type_map column_type_hints) {
+  // options
+  csv_dialect dialect;
+  bool supported = csv_file.find("://") == std::string::npos &&
+      !(csv_file.size() >= 3 && csv_file.substr(csv_file.size() - 3) == ".gz") &&
+      fileio::get_file_status(csv_file) == fileio::file_status::REGULAR_FILE;
+  supported &= gl_sframe_impl::csv_config_char(csv_config, "delimiter", dialect.delimiter);
+  supported &= gl_sframe_impl::csv_config_char(csv_config, "quote_char", dialect.quote_char);
+  supported &= gl_sframe_impl::csv_config_char(csv_config, "escape_char", dialect.escape_char);
+  supported &= gl_sframe_impl::csv_config_char(csv_config, "comment_char", dialect.comment_char);
+  supported &= dialect.delimiter != 0 && dialect.delimiter != '\n' && dialect.delimiter != '\r';
+  dialect.double_quote = gl_sframe_impl::csv_config_flag(csv_config, "double_quote", true);
+  dialect.skip_initial_space =
+      gl_sframe_impl::csv_config_flag(csv_config, "skip_initial_space", true);
+  if (csv_config.count("line_terminator")) {
+    flex_string terminator = csv_config["line_terminator"].to<flex_string>();
+    supported &= (terminator == "\n" || terminator == "\r\n");
+  }
+  if (csv_config.count("row_limit")) {
+    supported &= csv_config["row_limit"].is_zero();
+  }
+  if (!supported) {
+    // remote or compressed files, globs, directories, and multi-character
+    // delimiters are read by the sequential parser
+    construct_from_csvs(csv_file, csv_config, column_type_hints);
+    return;
+  }
+  bool use_header = gl_sframe_impl::csv_config_flag(csv_config, "use_header", true);
+  bool continue_on_failure =
+      gl_sframe_impl::csv_config_flag(csv_config, "continue_on_failure", false);
+  std::vector<std::string> na_values{"NA"};
+  if (csv_config.count("na_values")) {
+    const flexible_type& na = csv_config["na_values"];
+    na_values.clear();
+    if (na.get_type() == flex_type_enum::LIST) {
+      for (const auto& value: na.get<flex_list>()) na_values.push_back(value.to<flex_string>());
+    } else if (na.get_type() != flex_type_enum::UNDEFINED) {
+      na_values.push_back(na.to<flex_string>());
+    }
+  }
+  csv_tokenizer tokenizer(dialect);
+  size_t file_size = 0;
+  {
+    general_ifstream fin(csv_file);
+    file_size = fin.file_size();
+  }
+
+  // the header, or the first record for the number of columns
+  std::vector<std::string> names;
+  size_t data_begin = 0;
+  {
+    general_ifstream fin(csv_file);
+    std::string buffer;
+    std::vector<std::string> fields;
+    size_t nfields = 0;
+    bool found = false;
+    size_t consumed = 0;
+    while (!found) {
+      size_t read_position = consumed + buffer.size();
+      size_t len = std::min<size_t>(1024 * 1024, file_size - read_position);
+      buffer.resize(buffer.size() + len);
+      fin.read(&buffer[buffer.size() - len], len);
+      bool final = (read_position + len == file_size);
+      const char* p = buffer.data();
+      const char* end = p + buffer.size();
+      while (p < end) {
+        auto status = tokenizer.tokenize(p, end, final, fields, nfields);
+        if (status == csv_tokenizer::status::INCOMPLETE) break;
+        if (status == csv_tokenizer::status::UNTERMINATED) {
+          log_and_throw("Unterminated quoted field in the first line of " + csv_file);
+        }
+        if (status == csv_tokenizer::status::RECORD) {
+          found = true;
+          break;
+        }
+      }
+      size_t offset = p - buffer.data();
+      buffer.erase(0, offset);
+      consumed += offset;
+      if (final) break;
+    }
+    if (!found) {
+      *this = gl_sframe();
+      return;
+    }
+    for (size_t i = 0; i < nfields; ++i) {
+      names.push_back(use_header ? fields[i] : "X" + std::to_string(i + 1));
+    }
+    names = gl_sframe_impl::unique_csv_column_names(names);
+    data_begin = use_header ? consumed : 0;
+  }
+  size_t ncolumns = names.size();
+
+  // column types. Integers, floats, datetimes and strings are parsed as
+  // the file is read; other types are read as strings and converted
+  // afterwards. Datetimes outside of the layout of the fast path are kept
+  // in an extra string column, and parsed afterwards by str_to_datetime.
+  std::vector<flex_type_enum> types(ncolumns, flex_type_enum::STRING);
+  if (column_type_hints.count("__all_columns__")) {
+    std::fill(types.begin(), types.end(), column_type_hints["__all_columns__"]);
+  }
+  for (const auto& hint: column_type_hints) {
+    if (hint.first == "__all_columns__") continue;
+    auto iter = std::find(names.begin(), names.end(), hint.first);
+    if (iter == names.end()) {
+      log_and_throw("Column type hint for unknown column \"" + hint.first + "\"");
+    }
+    types[iter - names.begin()] = hint.second;
+  }
+  std::vector<gl_sframe_impl::csv_field_parser> parsers;
+  std::vector<std::string> write_names(names);
+  std::vector<flex_type_enum> write_types;
+  std::vector<size_t> fallback_column(ncolumns, size_t(-1));
+  for (size_t i = 0; i < ncolumns; ++i) {
+    parsers.emplace_back(types[i]);
+    write_types.push_back(parsers[i].type());
+    if (types[i] == flex_type_enum::DATETIME) {
+      std::string fallback_name = "__" + names[i] + "_unparsed";
+      while (std::find(write_names.begin(), write_names.end(), fallback_name) != write_names.end()) {
+        fallback_name = "_" + fallback_name;
+      }
+      fallback_column[i] = write_names.size();
+      write_names.push_back(fallback_name);
+      write_types.push_back(flex_type_enum::STRING);
+    }
+  }
+
+  // byte ranges, each starting after a byte which is not an escape character
+  size_t nthreads = thread::cpu_count();
+  size_t min_range_size = 4 * 1024 * 1024;
+  size_t nranges = std::max<size_t>(1, std::min(nthreads, (file_size - data_begin) / min_range_size));
+  std::vector<size_t> range_begin(nranges + 1, file_size);
+  range_begin[0] = data_begin;
+  {
+    general_ifstream fin(csv_file);
+    std::vector<char> window(4096);
+    for (size_t r = 1; r < nranges; ++r) {
+      size_t start = std::max(range_begin[r - 1],
+                              data_begin + (file_size - data_begin) * r / nranges);
+      fin.clear();
+      fin.seekg(start - 1);
+      fin.read(window.data(), std::min(window.size(), file_size - (start - 1)));
+      size_t got = fin.gcount();
+      size_t i = 0;
+      while (dialect.escape_char && i + 1 < got && window[i] == dialect.escape_char) ++i;
+      range_begin[r] = std::min(start + i, file_size);
+    }
+  }
+
+  std::vector<size_t> record_begin =
+      gl_sframe_impl::csv_record_begins(csv_file, range_begin, tokenizer);
+
+  // records, one range per segment. A parse error is only raised once
+  // every range has checked that it ends at the start of the next one.
+  gl_sframe_writer writer(write_names, write_types, nranges);
+  atomic<size_t> num_failures;
+  std::vector<atomic<size_t> > num_fallbacks(ncolumns);
+  std::vector<gl_sframe_impl::csv_range_status> status(nranges);
+  std::vector<std::string> failed_line(nranges);
+  parallel_for(0, nranges, [&](size_t r) {
+    std::vector<flexible_type> row(write_names.size());
+    auto write_record = [&](const std::vector<std::string>& fields, size_t nfields,
+                            const char* line, const char* line_end) {
+      bool ok = (nfields == ncolumns);
+      for (size_t i = 0; ok && i < ncolumns; ++i) {
+        if (fallback_column[i] != size_t(-1)) row[fallback_column[i]] = FLEX_UNDEFINED;
+        if (std::find(na_values.begin(), na_values.end(), fields[i]) != na_values.end() ||
+            (fields[i].empty() && write_types[i] != flex_type_enum::STRING)) {
+          row[i] = FLEX_UNDEFINED;
+        } else {
+          ok = parsers[i](fields[i], row[i]);
+          if (!ok && fallback_column[i] != size_t(-1)) {
+            row[i] = FLEX_UNDEFINED;
+            row[fallback_column[i]] = fields[i];
+            num_fallbacks[i].inc();
+            ok = true;
+          }
+        }
+      }
+      if (ok) {
+        writer.write(row, r);
+      } else if (continue_on_failure) {
+        num_failures.inc();
+      } else {
+        failed_line[r].assign(line, std::min<size_t>(line_end - line, 256));
+        return false;
+      }
+      return true;
+    };
+    status[r] = gl_sframe_impl::for_each_csv_record(csv_file, record_begin[r],
+                                                    record_begin[r + 1], file_size,
+                                                    tokenizer, write_record);
+  });
+  for (size_t r = 0; r < nranges; ++r) {
+    if (status[r] == gl_sframe_impl::csv_range_status::MISALIGNED) {
+      // a range ended inside a record: quotes inside unquoted fields threw
+      // off the quote parity, so read the file sequentially
+      logprogress_stream << "Unbalanced quotes in " << csv_file
+                         << ", parsing it sequentially" << std::endl;
+      construct_from_csvs(csv_file, csv_config, column_type_hints);
+      return;
+    }
+  }
+  for (size_t r = 0; r < nranges; ++r) {
+    if (status[r] == gl_sframe_impl::csv_range_status::STOPPED) {
+      log_and_throw("Unable to parse line \"" + failed_line[r] + "\"");
+    }
+    if (status[r] == gl_sframe_impl::csv_range_status::UNTERMINATED) {
+      if (!continue_on_failure) log_and_throw("Unterminated quoted field at the end of " + csv_file);
+      num_failures.inc();
+    }
+  }
+  if (num_failures.value > 0) {
+    logprogress_stream << num_failures.value << " lines failed to parse correctly" << std::endl;
+  }
+  gl_sframe ret = writer.close();
+  for (size_t i = 0; i < ncolumns; ++i) {
+    if (fallback_column[i] != size_t(-1)) {
+      const std::string& fallback_name = write_names[fallback_column[i]];
+      if (num_fallbacks[i].value > 0) {
+        gl_sframe merge({{"fast", ret[names[i]]},
+                         {"fallback", ret[fallback_name].str_to_datetime()}});
+        ret.replace_add_column(merge.apply([](const sframe_rows::row& row) {
+          return row[0].get_type() == flex_type_enum::UNDEFINED ? row[1] : row[0];
+        }, flex_type_enum::DATETIME), names[i]);
+      }
+      ret.remove_column(fallback_name);
+    } else if (types[i] != write_types[i]) {
+      ret.replace_add_column(ret[names[i]].astype(types[i]), names[i]);
+    }
+  }
+  *this = ret;
+}
+
+} // namespace graphlab
+
+#endif
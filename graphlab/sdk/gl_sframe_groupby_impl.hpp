@@ -0,0 +1,682 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_GROUPBY_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_GROUPBY_IMPL_HPP
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <unistd.h>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/sframe/group_aggregate_value.hpp>
+#include <graphlab/sframe/sketch_aggregate_value.hpp>
+#include <graphlab/util/cityhash_gl.hpp>
+#include <graphlab/fileio/fileio_constants.hpp>
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+namespace aggregate {
+
+inline groupby_descriptor_type APPROX_COUNT_DISTINCT(const std::string& col,
+                                                     size_t register_bits) {
+  if (register_bits < 4 || register_bits > 16) {
+    log_and_throw("APPROX_COUNT_DISTINCT register_bits must be between 4 and 16");
+  }
+  return groupby_descriptor_type(
+      std::make_shared<sketch_operators::approx_count_distinct>(register_bits), {col});
+}
+
+inline groupby_descriptor_type APPROX_QUANTILE(const std::string& col, double quantile,
+                                               size_t k) {
+  return groupby_descriptor_type(
+      std::make_shared<sketch_operators::approx_quantile>(
+          std::vector<double>{quantile}, false, k), {col});
+}
+
+inline groupby_descriptor_type APPROX_QUANTILE(const std::string& col,
+                                               const std::vector<double>& quantiles,
+                                               size_t k) {
+  if (quantiles.empty()) log_and_throw("APPROX_QUANTILE requires at least one quantile");
+  return groupby_descriptor_type(
+      std::make_shared<sketch_operators::approx_quantile>(quantiles, true, k), {col});
+}
+
+inline groupby_descriptor_type FREQUENT_ITEMS(const std::string& col, size_t k,
+                                              size_t capacity) {
+  if (k == 0) log_and_throw("FREQUENT_ITEMS requires k > 0");
+  return groupby_descriptor_type(
+      std::make_shared<sketch_operators::frequent_items>(k, capacity), {col});
+}
+
+} // namespace aggregate
+
+namespace gl_sframe_impl {
+
+/**
+ * Returns the 128 bit hash of the values of a group key.
+ */
+inline uint128_t hash_group_key(const std::vector<flexible_type>& key) {
+  uint128_t h = hash128((uint64_t)key.size());
+  for (const auto& value: key) h = hash128_combine(h, value.hash128());
+  return h;
+}
+
+/**
+ * Returns a rough estimate of the memory held by a row.
+ */
+inline size_t join_row_memory(const std::vector<flexible_type>& values) {
+  size_t ret = 48 + 16 * values.size();
+  for (const auto& value: values) {
+    switch (value.get_type()) {
+      case flex_type_enum::STRING: ret += value.get<flex_string>().size(); break;
+      case flex_type_enum::VECTOR: ret += 8 * value.get<flex_vec>().size(); break;
+      case flex_type_enum::LIST: ret += 32 * value.get<flex_list>().size(); break;
+      case flex_type_enum::DICT: ret += 64 * value.get<flex_dict>().size(); break;
+      default: break;
+    }
+  }
+  return ret;
+}
+
+/**
+ * An open addressing hash table of partial aggregates, keyed by the hash of
+ * the group columns.
+ *
+ * Slots hold the low 64 bits of the group hash next to the group index, so
+ * that probing touches one contiguous array and group keys are compared
+ * only on a hash match. Groups are stored densely: their keys, full hashes,
+ * and their nops aggregates, group after group.
+ *
+ * The table tracks the memory it holds (\ref bytes): the keys are measured
+ * with join_row_memory as they are inserted, and the aggregate states,
+ * which may grow with every element, by the saved size of a sample of
+ * groups (\ref sample_state_bytes).
+ */
+class groupby_hash_table {
+ public:
+  explicit groupby_hash_table(size_t nops): m_nops(nops) {
+    m_slots.resize(16);
+  }
+
+  size_t num_groups() const { return m_keys.size(); }
+
+  /**
+   * Estimated memory held by the table: the measured keys, slots and state
+   * objects, and the sampled size of the aggregate states.
+   */
+  size_t bytes() const { return m_key_bytes + m_state_bytes_per_group * num_groups(); }
+
+  /// Estimated memory held by a group of the table, on average.
+  size_t bytes_per_group() const {
+    return num_groups() == 0 ? 0 : bytes() / num_groups();
+  }
+
+  /**
+   * Updates the size of the aggregate states of a group from the saved
+   * size of the states of up to nsamples groups, spread over the table.
+   */
+  void sample_state_bytes(size_t nsamples) {
+    size_t ngroups = num_groups();
+    m_groups_at_sample = ngroups;
+    if (ngroups == 0 || m_nops == 0) return;
+    nsamples = std::min(nsamples, ngroups);
+    size_t total = 0;
+    for (size_t i = 0; i < nsamples; ++i) {
+      size_t group = i * ngroups / nsamples;
+      for (size_t op = 0; op < m_nops; ++op) {
+        oarchive oarc(m_sample_buffer);
+        value(group, op).save(oarc);
+        total += oarc.off;
+      }
+    }
+    m_state_bytes_per_group = total / nsamples;
+  }
+
+  /**
+   * True if the states should be sampled again: the number of groups has
+   * doubled since the last sample.
+   */
+  bool needs_sample() const {
+    return num_groups() > 0 && num_groups() >= 2 * m_groups_at_sample;
+  }
+
+  /**
+   * Returns the index of the group, inserting it with new instances of the
+   * prototypes if it does not exist.
+   */
+  size_t find_or_insert(uint128_t hash,
+                        const std::vector<flexible_type>& key,
+                        const std::vector<std::unique_ptr<group_aggregate_value> >& prototypes) {
+    uint64_t low = (uint64_t)hash;
+    size_t mask = m_slots.size() - 1;
+    size_t i = low & mask;
+    while (m_slots[i].group != 0) {
+      if (m_slots[i].hash == low) {
+        size_t group = m_slots[i].group - 1;
+        if (m_hashes[group] == hash && m_keys[group] == key) return group;
+      }
+      i = (i + 1) & mask;
+    }
+    size_t group = m_keys.size();
+    m_slots[i].hash = low;
+    m_slots[i].group = group + 1;
+    m_keys.push_back(key);
+    m_hashes.push_back(hash);
+    for (const auto& prototype: prototypes) {
+      m_values.emplace_back(prototype->new_instance());
+    }
+    // two slots per group at the largest load, the hash, and the pointer
+    // and object of each state
+    m_key_bytes += join_row_memory(key) + 2 * sizeof(slot) + sizeof(uint128_t) +
+                   m_nops * (sizeof(void*) + 64);
+    if (2 * m_keys.size() > m_slots.size()) grow();
+    return group;
+  }
+
+  group_aggregate_value& value(size_t group, size_t op) {
+    return *m_values[group * m_nops + op];
+  }
+
+  /// The aggregate of a group, which may be moved out of the table.
+  std::unique_ptr<group_aggregate_value>& state(size_t group, size_t op) {
+    return m_values[group * m_nops + op];
+  }
+
+  const std::vector<flexible_type>& key(size_t group) const { return m_keys[group]; }
+
+  uint128_t hash(size_t group) const { return m_hashes[group]; }
+
+  void clear() {
+    std::vector<slot>(16).swap(m_slots);
+    std::vector<std::vector<flexible_type> >().swap(m_keys);
+    std::vector<uint128_t>().swap(m_hashes);
+    std::vector<std::unique_ptr<group_aggregate_value> >().swap(m_values);
+    m_key_bytes = 0;
+    m_groups_at_sample = 0;
+  }
+
+ private:
+  struct slot {
+    uint64_t hash = 0;
+    /// group index + 1, 0 if empty
+    size_t group = 0;
+  };
+
+  void grow() {
+    std::vector<slot> slots(m_slots.size() * 2);
+    size_t mask = slots.size() - 1;
+    for (const auto& s: m_slots) {
+      if (s.group == 0) continue;
+      size_t i = s.hash & mask;
+      while (slots[i].group != 0) i = (i + 1) & mask;
+      slots[i] = s;
+    }
+    m_slots.swap(slots);
+  }
+
+  size_t m_nops;
+  std::vector<slot> m_slots;
+  std::vector<std::vector<flexible_type> > m_keys;
+  std::vector<uint128_t> m_hashes;
+  std::vector<std::unique_ptr<group_aggregate_value> > m_values;
+  size_t m_key_bytes = 0;
+  /// Saved size of the states of a group, at the last sample
+  size_t m_state_bytes_per_group = 0;
+  size_t m_groups_at_sample = 0;
+  std::vector<char> m_sample_buffer;
+};
+
+/**
+ * A spill file of partially combined groups, written in hash bucket order.
+ * Bucket b holds counts[b] groups in the bytes [offsets[b], offsets[b + 1]).
+ * The file is removed with the spill, so that it is not left behind by an
+ * exception.
+ */
+struct groupby_spill {
+  std::string filename;
+  std::vector<size_t> offsets;
+  std::vector<size_t> counts;
+
+  groupby_spill() {}
+  groupby_spill(const groupby_spill&) = delete;
+  groupby_spill& operator=(const groupby_spill&) = delete;
+  groupby_spill(groupby_spill&& other) noexcept { *this = std::move(other); }
+  groupby_spill& operator=(groupby_spill&& other) noexcept {
+    remove();
+    filename.swap(other.filename);
+    offsets.swap(other.offsets);
+    counts.swap(other.counts);
+    return *this;
+  }
+  ~groupby_spill() { remove(); }
+
+  void remove() noexcept {
+    if (!filename.empty()) std::remove(filename.c_str());
+    filename.clear();
+  }
+};
+
+/**
+ * The groups of one bucket of a spill.
+ */
+struct groupby_run {
+  const groupby_spill* spill;
+  size_t bucket;
+
+  size_t count() const { return spill->counts[bucket]; }
+  size_t bytes() const { return spill->offsets[bucket + 1] - spill->offsets[bucket]; }
+};
+
+/**
+ * Returns the hash bucket of a group.
+ */
+inline size_t groupby_partition(uint128_t hash, size_t nbuckets) {
+  return (uint64_t)(hash >> 64) % nbuckets;
+}
+
+/**
+ * Returns the part of a group when a partition is split at some depth. The
+ * hash is independent of the bucket, and of the parts at other depths.
+ */
+inline size_t groupby_subpartition(uint128_t hash, size_t depth, size_t nparts) {
+  return hash64((uint64_t)hash, (uint64_t)depth) % nparts;
+}
+
+/**
+ * Returns a new temporary file name for a groupby spill.
+ */
+inline std::string groupby_spill_filename() {
+  static atomic<size_t> counter;
+  return fileio::get_system_temp_directory() + "/gl_groupby_spill_" +
+      std::to_string(getpid()) + "_" + std::to_string(counter.inc());
+}
+
+/**
+ * Writes all the groups of a table to a spill file, bucket by bucket:
+ * hash, key, then the saved state of each aggregate.
+ */
+inline groupby_spill spill_groupby_table(groupby_hash_table& table,
+                                         size_t nops, size_t nbuckets) {
+  groupby_spill spill;
+  spill.filename = groupby_spill_filename();
+  spill.offsets.resize(nbuckets + 1);
+  spill.counts.resize(nbuckets);
+  std::vector<std::vector<size_t> > buckets(nbuckets);
+  for (size_t group = 0; group < table.num_groups(); ++group) {
+    buckets[groupby_partition(table.hash(group), nbuckets)].push_back(group);
+  }
+  std::ofstream fout(spill.filename, std::ios::binary);
+  if (!fout.good()) log_and_throw("Unable to open groupby spill file " + spill.filename);
+  for (size_t b = 0; b < nbuckets; ++b) {
+    spill.offsets[b] = fout.tellp();
+    spill.counts[b] = buckets[b].size();
+    oarchive oarc(fout);
+    for (size_t group: buckets[b]) {
+      uint128_t hash = table.hash(group);
+      oarc << (uint64_t)(hash >> 64) << (uint64_t)hash << table.key(group);
+      for (size_t op = 0; op < nops; ++op) {
+        table.value(group, op).partial_finalize();
+        table.value(group, op).save(oarc);
+      }
+    }
+    fout.flush();
+  }
+  spill.offsets[nbuckets] = fout.tellp();
+  if (!fout.good()) log_and_throw("Error writing groupby spill file " + spill.filename);
+  table.clear();
+  return spill;
+}
+
+/**
+ * Loads the groups of a run into a table, combining them with the groups
+ * already there.
+ */
+inline void merge_groupby_run(const groupby_run& run, groupby_hash_table& merged,
+                              const std::vector<std::unique_ptr<group_aggregate_value> >& prototypes) {
+  std::ifstream fin(run.spill->filename, std::ios::binary);
+  fin.seekg(run.spill->offsets[run.bucket]);
+  iarchive iarc(fin);
+  std::unique_ptr<group_aggregate_value> loaded;
+  std::vector<flexible_type> key;
+  for (size_t i = 0; i < run.count(); ++i) {
+    uint64_t high = 0, low = 0;
+    iarc >> high >> low >> key;
+    uint128_t hash = (uint128_t(high) << 64) + low;
+    size_t before = merged.num_groups();
+    size_t group = merged.find_or_insert(hash, key, prototypes);
+    for (size_t op = 0; op < prototypes.size(); ++op) {
+      if (group == before) {
+        merged.value(group, op).load(iarc);
+      } else {
+        loaded.reset(prototypes[op]->new_instance());
+        loaded->load(iarc);
+        merged.value(group, op).combine(*loaded);
+      }
+    }
+  }
+}
+
+/**
+ * Splits the groups of some runs into nparts spill files of one bucket each,
+ * by groupby_subpartition at the given depth.
+ */
+inline std::vector<groupby_spill> split_groupby_runs(
+    const std::vector<groupby_run>& runs,
+    const std::vector<std::unique_ptr<group_aggregate_value> >& prototypes,
+    size_t depth, size_t nparts) {
+  std::vector<groupby_spill> parts(nparts);
+  std::vector<std::unique_ptr<std::ofstream> > fouts;
+  std::vector<std::unique_ptr<oarchive> > oarcs;
+  for (auto& part: parts) {
+    part.filename = groupby_spill_filename();
+    part.offsets = {0, 0};
+    part.counts = {0};
+    fouts.emplace_back(new std::ofstream(part.filename, std::ios::binary));
+    if (!fouts.back()->good()) log_and_throw("Unable to open groupby spill file " + part.filename);
+    oarcs.emplace_back(new oarchive(*fouts.back()));
+  }
+  std::vector<std::unique_ptr<group_aggregate_value> > loaded;
+  for (const auto& prototype: prototypes) loaded.emplace_back(prototype->new_instance());
+  std::vector<flexible_type> key;
+  for (const auto& run: runs) {
+    std::ifstream fin(run.spill->filename, std::ios::binary);
+    fin.seekg(run.spill->offsets[run.bucket]);
+    iarchive iarc(fin);
+    for (size_t i = 0; i < run.count(); ++i) {
+      uint64_t high = 0, low = 0;
+      iarc >> high >> low >> key;
+      size_t part = groupby_subpartition((uint128_t(high) << 64) + low, depth, nparts);
+      oarchive& oarc = *oarcs[part];
+      oarc << high << low << key;
+      for (auto& value: loaded) {
+        value->load(iarc);
+        value->save(oarc);
+      }
+      ++parts[part].counts[0];
+    }
+  }
+  for (size_t part = 0; part < nparts; ++part) {
+    oarcs[part].reset();
+    fouts[part]->flush();
+    parts[part].offsets[1] = fouts[part]->tellp();
+    if (!fouts[part]->good()) {
+      log_and_throw("Error writing groupby spill file " + parts[part].filename);
+    }
+  }
+  return parts;
+}
+
+/// A group still in the table of the thread which aggregated it.
+typedef std::pair<groupby_hash_table*, size_t> groupby_resident_group;
+
+/**
+ * Merges the spilled runs and the resident groups of one hash partition,
+ * and calls emit(table) on the merged groups. The states of resident groups
+ * are moved out of their tables as they are merged.
+ *
+ * The resident groups are estimated at the average size of the groups of
+ * their table. A partition whose groups are estimated over the budget is
+ * split by another hash of its groups into parts written to spill files of
+ * their own, which are merged one at a time, down to a few levels: below
+ * that the partition holds a few very large groups, which splitting cannot
+ * shrink.
+ */
+template <typename Emit>
+inline void merge_groupby_partition(
+    const std::vector<groupby_run>& runs,
+    const std::vector<groupby_resident_group>& resident,
+    const std::vector<std::unique_ptr<group_aggregate_value> >& prototypes,
+    size_t budget, size_t depth, Emit& emit) {
+  const size_t max_depth = 4;
+  const size_t max_parts = 16;
+  size_t spilled_bytes = 0;
+  for (const auto& run: runs) spilled_bytes += run.bytes();
+  size_t bytes = spilled_bytes;
+  for (const auto& group: resident) bytes += group.first->bytes_per_group();
+  if (bytes > budget && spilled_bytes > 0 && depth < max_depth) {
+    size_t nparts = std::min(max_parts, bytes / std::max<size_t>(budget, 1) + 1);
+    std::vector<groupby_spill> parts = split_groupby_runs(runs, prototypes, depth, nparts);
+    std::vector<std::vector<groupby_resident_group> > resident_parts(nparts);
+    for (const auto& group: resident) {
+      resident_parts[groupby_subpartition(group.first->hash(group.second), depth, nparts)]
+          .push_back(group);
+    }
+    for (size_t part = 0; part < nparts; ++part) {
+      std::vector<groupby_run> part_runs{{&parts[part], 0}};
+      merge_groupby_partition(part_runs, resident_parts[part], prototypes,
+                              budget, depth + 1, emit);
+      parts[part].remove();
+    }
+    return;
+  }
+  size_t nops = prototypes.size();
+  groupby_hash_table merged(nops);
+  for (const auto& run: runs) merge_groupby_run(run, merged, prototypes);
+  for (const auto& group: resident) {
+    groupby_hash_table& table = *group.first;
+    size_t before = merged.num_groups();
+    size_t target = merged.find_or_insert(table.hash(group.second), table.key(group.second),
+                                          prototypes);
+    for (size_t op = 0; op < nops; ++op) {
+      auto& state = table.state(group.second, op);
+      if (target == before) {
+        merged.state(target, op) = std::move(state);
+      } else {
+        merged.value(target, op).combine(*state);
+        state.reset();
+      }
+    }
+  }
+  emit(merged);
+}
+
+} // namespace gl_sframe_impl
+
+/*
+ * Pass 1 reads the rows in parallel, one segment per thread, aggregating
+ * into thread local tables. A table whose measured size (keys, and sampled
+ * state sizes) exceeds its share of the memory budget is spilled, in hash
+ * buckets. Pass 2 packs the buckets into partitions which fit the share of
+ * the budget of a thread, so that their number follows the spilled bytes,
+ * and merges one partition at a time per thread: spilled states are loaded
+ * and combined, then the groups still in memory, and each partition is
+ * emitted as one writer segment. A partition over budget is split again
+ * when merged, and the tables of pass 1 are released as they are drained.
+ */
+inline gl_sframe gl_sframe::groupby(
+    const std::vector<std::string>& groupkeys,
+    const std::map<std::string, aggregate::groupby_descriptor_type>& operators,
+    size_t memory_budget) const {
+  // columns read: the group keys, then the aggregator inputs
+  std::vector<std::string> columns = groupkeys;
+  auto position_of = [&](const std::string& name) {
+    auto iter = std::find(columns.begin(), columns.end(), name);
+    if (iter != columns.end()) return (size_t)(iter - columns.begin());
+    columns.push_back(name);
+    return columns.size() - 1;
+  };
+  size_t nkeys = groupkeys.size();
+  std::vector<std::string> output_names = groupkeys;
+  std::vector<flex_type_enum> output_types;
+  for (const auto& key: groupkeys) output_types.push_back(select_column(key).dtype());
+  std::vector<std::unique_ptr<group_aggregate_value> > prototypes;
+  std::vector<std::vector<size_t> > input_positions;
+  for (const auto& op: operators) {
+    const auto& desc = op.second;
+    if (desc.m_aggregator == nullptr) log_and_throw("Invalid aggregator for " + op.first);
+    std::vector<flex_type_enum> input_types;
+    std::vector<size_t> positions;
+    for (const auto& column: desc.m_group_columns) {
+      flex_type_enum type = select_column(column).dtype();
+      if (!desc.m_aggregator->support_type(type)) {
+        log_and_throw("Aggregator " + desc.m_aggregator->name() +
+                      " does not support input type " + flex_type_enum_to_name(type));
+      }
+      input_types.push_back(type);
+      positions.push_back(position_of(column));
+    }
+    prototypes.emplace_back(desc.m_aggregator->new_instance());
+    output_types.push_back(prototypes.back()->set_input_types(input_types));
+    output_names.push_back(op.first);
+    input_positions.push_back(positions);
+  }
+  size_t nops = prototypes.size();
+
+  gl_sframe source = select_columns(columns);
+  source.materialize();
+  size_t n = source.size();
+  size_t nthreads = thread::cpu_count();
+  size_t nbuckets = 64 * nthreads;
+  size_t thread_budget = std::max<size_t>(1, memory_budget / nthreads);
+  // the states of a table are sampled when its number of groups doubles,
+  // and every sample_interval rows since states grow with their elements
+  const size_t sample_interval = 1024;
+  const size_t state_samples = 16;
+
+  std::vector<gl_sframe_impl::groupby_hash_table> tables;
+  for (size_t threadid = 0; threadid < nthreads; ++threadid) tables.emplace_back(nops);
+  std::vector<std::vector<gl_sframe_impl::groupby_spill> > spills(nthreads);
+  {
+    std::vector<gl_sframe_range> ranges;
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      ranges.push_back(source.range_iterator(n * threadid / nthreads,
+                                             n * (threadid + 1) / nthreads));
+    }
+    parallel_for(0, nthreads, [&](size_t threadid) {
+      auto& table = tables[threadid];
+      std::vector<flexible_type> key(nkeys);
+      std::vector<flexible_type> inputs;
+      size_t rows_since_sample = 0;
+      for (const auto& row: ranges[threadid]) {
+        for (size_t i = 0; i < nkeys; ++i) key[i] = row[i];
+        size_t group = table.find_or_insert(gl_sframe_impl::hash_group_key(key),
+                                            key, prototypes);
+        for (size_t op = 0; op < nops; ++op) {
+          const auto& positions = input_positions[op];
+          if (positions.size() == 1) {
+            table.value(group, op).add_element_simple(row[positions[0]]);
+          } else {
+            inputs.resize(positions.size());
+            for (size_t i = 0; i < positions.size(); ++i) inputs[i] = row[positions[i]];
+            table.value(group, op).add_element(inputs);
+          }
+        }
+        if (++rows_since_sample >= sample_interval || table.needs_sample()) {
+          table.sample_state_bytes(state_samples);
+          rows_since_sample = 0;
+        }
+        if (table.bytes() >= thread_budget) {
+          spills[threadid].push_back(
+              gl_sframe_impl::spill_groupby_table(table, nops, nbuckets));
+        }
+      }
+      for (size_t group = 0; group < table.num_groups(); ++group) {
+        for (size_t op = 0; op < nops; ++op) table.value(group, op).partial_finalize();
+      }
+      table.sample_state_bytes(state_samples);
+    });
+  }
+
+  // bytes of each bucket: spilled, and measured for the groups still in
+  // memory
+  std::vector<size_t> bucket_bytes(nbuckets, 0);
+  for (const auto& thread_spills: spills) {
+    for (const auto& spill: thread_spills) {
+      for (size_t b = 0; b < nbuckets; ++b) {
+        bucket_bytes[b] += spill.offsets[b + 1] - spill.offsets[b];
+      }
+    }
+  }
+  std::vector<std::vector<gl_sframe_impl::groupby_resident_group> > resident(nbuckets);
+  for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+    auto& table = tables[threadid];
+    for (size_t group = 0; group < table.num_groups(); ++group) {
+      size_t b = gl_sframe_impl::groupby_partition(table.hash(group), nbuckets);
+      resident[b].push_back({&table, group});
+      bucket_bytes[b] += table.bytes_per_group();
+    }
+  }
+
+  // consecutive buckets packed into partitions of at most the budget of a
+  // thread, and at least nthreads partitions
+  size_t merge_budget = thread_budget;
+  size_t total_bytes = 0;
+  for (size_t bytes: bucket_bytes) total_bytes += bytes;
+  size_t partition_bytes = std::max<size_t>(1, std::min(merge_budget, total_bytes / nthreads));
+  std::vector<size_t> partition_begin{0};
+  size_t filled = 0;
+  for (size_t b = 0; b < nbuckets; ++b) {
+    if (filled > 0 && filled + bucket_bytes[b] > partition_bytes) {
+      partition_begin.push_back(b);
+      filled = 0;
+    }
+    filled += bucket_bytes[b];
+  }
+  partition_begin.push_back(nbuckets);
+  size_t npartitions = partition_begin.size() - 1;
+
+  // a table is released once the last partition with groups in it is merged
+  std::vector<atomic<size_t> > table_users(nthreads);
+  for (size_t partition = 0; partition < npartitions; ++partition) {
+    std::vector<bool> used(nthreads, false);
+    for (size_t b = partition_begin[partition]; b < partition_begin[partition + 1]; ++b) {
+      for (const auto& group: resident[b]) used[group.first - tables.data()] = true;
+    }
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      if (used[threadid]) table_users[threadid].inc();
+    }
+  }
+
+  gl_sframe_writer writer(output_names, output_types, npartitions);
+  parallel_for(0, npartitions, [&](size_t partition) {
+    std::vector<gl_sframe_impl::groupby_run> runs;
+    std::vector<gl_sframe_impl::groupby_resident_group> partition_resident;
+    for (size_t b = partition_begin[partition]; b < partition_begin[partition + 1]; ++b) {
+      for (const auto& thread_spills: spills) {
+        for (const auto& spill: thread_spills) {
+          if (spill.counts[b] > 0) runs.push_back({&spill, b});
+        }
+      }
+      partition_resident.insert(partition_resident.end(), resident[b].begin(), resident[b].end());
+      std::vector<gl_sframe_impl::groupby_resident_group>().swap(resident[b]);
+    }
+    std::vector<bool> used(nthreads, false);
+    for (const auto& group: partition_resident) used[group.first - tables.data()] = true;
+
+    std::vector<flexible_type> out(nkeys + nops);
+    auto emit = [&](gl_sframe_impl::groupby_hash_table& merged) {
+      for (size_t group = 0; group < merged.num_groups(); ++group) {
+        const auto& key = merged.key(group);
+        std::copy(key.begin(), key.end(), out.begin());
+        for (size_t op = 0; op < nops; ++op) out[nkeys + op] = merged.value(group, op).emit();
+        writer.write(out, partition);
+      }
+    };
+    gl_sframe_impl::merge_groupby_partition(runs, partition_resident, prototypes,
+                                            merge_budget, 0, emit);
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      if (used[threadid] && table_users[threadid].dec() == 0) tables[threadid].clear();
+    }
+  });
+  // the spill files are removed with the spills
+  return writer.close();
+}
+
+} // namespace graphlab
+
+#endif
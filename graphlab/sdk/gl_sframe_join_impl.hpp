@@ -0,0 +1,715 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_JOIN_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_JOIN_IMPL_HPP
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <algorithm>
+#include <atomic>
+#include <unistd.h>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/sketches/bloom_filter.hpp>
+#include <graphlab/util/cityhash_gl.hpp>
+#include <graphlab/fileio/fileio_constants.hpp>
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+namespace gl_sframe_impl {
+
+/**
+ * A row of one side of a hash join, with the hash of its key columns.
+ */
+struct join_row {
+  uint128_t hash;
+  std::vector<flexible_type> values;
+};
+
+/**
+ * The rows of one side of a join, radix partitioned on "radix_bits" bits
+ * of their key hash, starting "shift" bits from its top.
+ *
+ * Each thread appends to its own partition buffers. When the buffers of a
+ * thread exceed its share of the memory budget, they are spilled to a
+ * file, partition by partition, so that a partition can later be read
+ * back from every spill with one seek each.
+ */
+class join_partitioned_rows {
+ public:
+  join_partitioned_rows(size_t nthreads, size_t radix_bits, size_t thread_budget,
+                        size_t shift = 0)
+      : m_radix_bits(radix_bits), m_shift(shift), m_thread_budget(thread_budget),
+        m_threads(nthreads) {
+    for (auto& thread: m_threads) {
+      thread.partitions.resize(num_partitions());
+      thread.counts.resize(num_partitions(), 0);
+      thread.partition_bytes.resize(num_partitions(), 0);
+    }
+  }
+
+  ~join_partitioned_rows() {
+    for (auto& thread: m_threads) {
+      for (auto& spill: thread.spills) std::remove(spill.filename.c_str());
+    }
+  }
+
+  size_t num_partitions() const { return size_t(1) << m_radix_bits; }
+
+  /// The bits of the hash after the ones of this partitioning.
+  size_t next_shift() const { return m_shift + m_radix_bits; }
+
+  size_t partition_of(uint128_t hash) const {
+    if (m_radix_bits == 0) return 0;
+    uint64_t bits = m_shift < 64 ? (uint64_t)(hash >> 64) << m_shift
+                                 : (uint64_t)hash << (m_shift - 64);
+    return bits >> (64 - m_radix_bits);
+  }
+
+  void add(size_t threadid, uint128_t hash, std::vector<flexible_type>&& values) {
+    auto& thread = m_threads[threadid];
+    size_t partition = partition_of(hash);
+    size_t bytes = join_row_memory(values);
+    thread.bytes += bytes;
+    thread.partition_bytes[partition] += bytes;
+    ++thread.counts[partition];
+    thread.partitions[partition].push_back(join_row{hash, std::move(values)});
+    if (thread.bytes > m_thread_budget) spill(threadid);
+  }
+
+  /**
+   * Calls fn(join_row&) on every row of a partition, spilled rows first.
+   * Rows in memory are passed as is, and may be moved from.
+   */
+  template <typename Fn>
+  void for_each(size_t partition, Fn fn) {
+    join_row row;
+    for (auto& thread: m_threads) {
+      for (const auto& spill: thread.spills) {
+        if (spill.counts[partition] == 0) continue;
+        std::ifstream fin(spill.filename, std::ios::binary);
+        fin.seekg(spill.offsets[partition]);
+        iarchive iarc(fin);
+        for (size_t i = 0; i < spill.counts[partition]; ++i) {
+          uint64_t high = 0, low = 0;
+          iarc >> high >> low >> row.values;
+          row.hash = (uint128_t(high) << 64) + low;
+          fn(row);
+        }
+      }
+    }
+    for (auto& thread: m_threads) {
+      for (auto& r: thread.partitions[partition]) fn(r);
+    }
+  }
+
+  /**
+   * Releases the rows of a partition held in memory.
+   */
+  void clear(size_t partition) {
+    for (auto& thread: m_threads) std::vector<join_row>().swap(thread.partitions[partition]);
+  }
+
+  /**
+   * Returns the number of rows added to a partition.
+   */
+  size_t partition_size(size_t partition) const {
+    size_t ret = 0;
+    for (const auto& thread: m_threads) ret += thread.counts[partition];
+    return ret;
+  }
+
+  /**
+   * Returns the estimated memory of the rows added to a partition.
+   */
+  size_t partition_memory(size_t partition) const {
+    size_t ret = 0;
+    for (const auto& thread: m_threads) ret += thread.partition_bytes[partition];
+    return ret;
+  }
+
+  size_t num_spills() const {
+    size_t ret = 0;
+    for (const auto& thread: m_threads) ret += thread.spills.size();
+    return ret;
+  }
+
+ private:
+  struct spill_file {
+    std::string filename;
+    std::vector<size_t> offsets;
+    std::vector<size_t> counts;
+  };
+
+  struct thread_rows {
+    std::vector<std::vector<join_row> > partitions;
+    std::vector<spill_file> spills;
+    std::vector<size_t> counts;
+    std::vector<size_t> partition_bytes;
+    size_t bytes = 0;
+  };
+
+  void spill(size_t threadid) {
+    static atomic<size_t> counter;
+    auto& thread = m_threads[threadid];
+    spill_file spill;
+    spill.filename = fileio::get_system_temp_directory() + "/gl_join_spill_" +
+        std::to_string(getpid()) + "_" + std::to_string(counter.inc());
+    spill.offsets.resize(num_partitions());
+    spill.counts.resize(num_partitions());
+    std::ofstream fout(spill.filename, std::ios::binary);
+    if (!fout.good()) log_and_throw("Unable to open join spill file " + spill.filename);
+    for (size_t p = 0; p < num_partitions(); ++p) {
+      auto& rows = thread.partitions[p];
+      spill.offsets[p] = fout.tellp();
+      spill.counts[p] = rows.size();
+      oarchive oarc(fout);
+      for (const auto& row: rows) {
+        oarc << (uint64_t)(row.hash >> 64) << (uint64_t)row.hash << row.values;
+      }
+      fout.flush();
+      std::vector<join_row>().swap(rows);
+    }
+    if (!fout.good()) log_and_throw("Error writing join spill file " + spill.filename);
+    thread.spills.push_back(std::move(spill));
+    thread.bytes = 0;
+  }
+
+  size_t m_radix_bits;
+  size_t m_shift;
+  size_t m_thread_budget;
+  std::vector<thread_rows> m_threads;
+};
+
+/**
+ * Returns true if the key columns of two rows are equal.
+ */
+inline bool join_keys_equal(const std::vector<flexible_type>& a,
+                            const std::vector<size_t>& a_positions,
+                            const std::vector<flexible_type>& b,
+                            const std::vector<size_t>& b_positions) {
+  for (size_t i = 0; i < a_positions.size(); ++i) {
+    if (!(a[a_positions[i]] == b[b_positions[i]])) return false;
+  }
+  return true;
+}
+
+/**
+ * The columns of a join: the left columns, then the right columns which
+ * are not keys, suffixed with ".1" when their name already exists.
+ */
+struct join_layout {
+  std::vector<size_t> left_key_positions;
+  std::vector<size_t> right_key_positions;
+  std::vector<std::string> output_names;
+  std::vector<flex_type_enum> output_types;
+  /// for each left column, the right key column it is joined to, or -1
+  std::vector<ssize_t> left_to_right_key;
+  /// right columns which are not keys
+  std::vector<size_t> right_value_positions;
+
+  join_layout(const gl_sframe& left, const gl_sframe& right,
+              const std::map<std::string, std::string>& joinkeys) {
+    if (joinkeys.empty()) log_and_throw("Join requires at least one key column");
+    for (const auto& key: joinkeys) {
+      if (!left.contains_column(key.first)) {
+        log_and_throw("Column \"" + key.first + "\" not found");
+      }
+      if (!right.contains_column(key.second)) {
+        log_and_throw("Column \"" + key.second + "\" not found");
+      }
+      if (left.select_column(key.first).dtype() != right.select_column(key.second).dtype()) {
+        log_and_throw("Join key columns \"" + key.first + "\" and \"" + key.second +
+                      "\" have different types");
+      }
+      left_key_positions.push_back(left.column_index(key.first));
+      right_key_positions.push_back(right.column_index(key.second));
+    }
+    output_names = left.column_names();
+    output_types = left.column_types();
+    left_to_right_key.resize(output_names.size(), -1);
+    for (size_t i = 0; i < left_key_positions.size(); ++i) {
+      left_to_right_key[left_key_positions[i]] = right_key_positions[i];
+    }
+    std::vector<std::string> right_names = right.column_names();
+    std::vector<flex_type_enum> right_types = right.column_types();
+    for (size_t i = 0; i < right_names.size(); ++i) {
+      if (std::find(right_key_positions.begin(), right_key_positions.end(), i) !=
+          right_key_positions.end()) continue;
+      std::string name = right_names[i];
+      while (std::find(output_names.begin(), output_names.end(), name) != output_names.end()) {
+        name += ".1";
+      }
+      output_names.push_back(name);
+      output_types.push_back(right_types[i]);
+      right_value_positions.push_back(i);
+    }
+  }
+
+  /**
+   * Fills "out" with the output row of a left and a right row, either of
+   * which can be null for an unmatched row.
+   */
+  void assemble(const std::vector<flexible_type>* left_row,
+                const std::vector<flexible_type>* right_row,
+                std::vector<flexible_type>& out) const {
+    size_t nleft = left_to_right_key.size();
+    out.resize(output_names.size());
+    for (size_t i = 0; i < nleft; ++i) {
+      if (left_row) out[i] = (*left_row)[i];
+      else if (left_to_right_key[i] >= 0) out[i] = (*right_row)[left_to_right_key[i]];
+      else out[i] = FLEX_UNDEFINED;
+    }
+    for (size_t i = 0; i < right_value_positions.size(); ++i) {
+      out[nleft + i] = right_row ? (*right_row)[right_value_positions[i]] : FLEX_UNDEFINED;
+    }
+  }
+};
+
+/**
+ * A chained hash table over the rows of one side of a join.
+ */
+class join_hash_index {
+ public:
+  explicit join_hash_index(const std::vector<join_row>& rows) {
+    size_t nbuckets = 16;
+    while (nbuckets < 2 * rows.size()) nbuckets *= 2;
+    m_mask = nbuckets - 1;
+    m_heads.resize(nbuckets, size_t(NONE));
+    m_next.resize(rows.size(), size_t(NONE));
+    m_hashes.resize(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      size_t bucket = (uint64_t)rows[i].hash & m_mask;
+      m_next[i] = m_heads[bucket];
+      m_heads[bucket] = i;
+      m_hashes[i] = rows[i].hash;
+    }
+  }
+
+  /**
+   * Calls fn(i) for each row i whose hash is "hash".
+   */
+  template <typename Fn>
+  void find(uint128_t hash, Fn fn) const {
+    for (size_t i = m_heads[(uint64_t)hash & m_mask]; i != NONE; i = m_next[i]) {
+      if (m_hashes[i] == hash) fn(i);
+    }
+  }
+
+ private:
+  static const size_t NONE = size_t(-1);
+  size_t m_mask;
+  std::vector<size_t> m_heads;
+  std::vector<size_t> m_next;
+  std::vector<uint128_t> m_hashes;
+};
+
+/**
+ * Samples the key hashes of a (materialized) gl_sframe, in chunks spread
+ * evenly over its rows, and returns the sorted hashes holding at least
+ * "min_fraction" of the sample.
+ */
+inline std::vector<uint128_t> sample_heavy_join_keys(const gl_sframe& source,
+                                                     const std::vector<size_t>& key_positions,
+                                                     double min_fraction) {
+  const size_t nchunks = 64, chunk_size = 256;
+  size_t n = source.size();
+  std::map<uint128_t, size_t> counts;
+  size_t nsampled = 0;
+  std::vector<flexible_type> key(key_positions.size());
+  auto sample = [&](size_t start, size_t end) {
+    for (const auto& row: source.range_iterator(start, end)) {
+      for (size_t i = 0; i < key.size(); ++i) key[i] = row[key_positions[i]];
+      ++counts[hash_group_key(key)];
+      ++nsampled;
+    }
+  };
+  if (n <= nchunks * chunk_size) {
+    sample(0, n);
+  } else {
+    for (size_t c = 0; c < nchunks; ++c) {
+      size_t start = (n - chunk_size) * c / (nchunks - 1);
+      sample(start, start + chunk_size);
+    }
+  }
+  std::vector<uint128_t> heavy;
+  size_t min_count = std::max<size_t>(8, std::ceil(min_fraction * nsampled));
+  for (const auto& count: counts) {
+    if (count.second >= min_count) heavy.push_back(count.first);
+  }
+  return heavy;
+}
+
+/**
+ * Returns the estimated memory of the rows of a (materialized) gl_sframe,
+ * from a sample of its rows.
+ */
+inline size_t estimate_join_memory(const gl_sframe& source) {
+  size_t n = source.size();
+  size_t nsample = std::min<size_t>(n, 1000);
+  if (nsample == 0) return 0;
+  size_t sample_bytes = 0;
+  for (const auto& row: source.range_iterator(0, nsample)) sample_bytes += join_row_memory(row);
+  return sample_bytes / nsample * n;
+}
+
+/**
+ * Returns the number of radix bits, up to max_bits, splitting "bytes" into
+ * partitions of at most "budget" bytes each, and into at least
+ * "min_partitions".
+ */
+inline size_t join_radix_bits(size_t bytes, size_t budget, size_t min_partitions,
+                              size_t max_bits) {
+  size_t radix_bits = 0;
+  while (radix_bits < max_bits &&
+         ((size_t(1) << radix_bits) < min_partitions || (bytes >> radix_bits) > budget)) {
+    ++radix_bits;
+  }
+  return radix_bits;
+}
+
+/**
+ * Joins one partition of the build and probe rows, calling joined(build,
+ * probe), build_only(build) and probe_only(probe) on the values of the
+ * output rows.
+ *
+ * The build rows of the partition are loaded in a hash table when they fit
+ * in "budget". A larger partition is split on the next bits of the hash
+ * into sub-partitions, spilled as needed, which are joined one at a time;
+ * down to a few levels, below which the partition is held by a few keys
+ * which splitting cannot separate.
+ */
+template <typename Joined, typename BuildOnly, typename ProbeOnly>
+void join_partition(join_partitioned_rows& build_rows, join_partitioned_rows& probe_rows,
+                    size_t partition,
+                    const std::vector<size_t>& build_key_positions,
+                    const std::vector<size_t>& probe_key_positions,
+                    bool keep_build, bool keep_probe, size_t budget, size_t depth,
+                    Joined& joined, BuildOnly& build_only, ProbeOnly& probe_only) {
+  const size_t max_depth = 4, bits_per_level = 8;
+  size_t build_memory = build_rows.partition_memory(partition);
+  if (build_memory > budget && depth < max_depth) {
+    size_t radix_bits = join_radix_bits(build_memory, budget, 2, bits_per_level);
+    // sub-partitions take the low half of the hash, which the first
+    // partitioning leaves alone
+    size_t shift = std::max<size_t>(64, build_rows.next_shift());
+    join_partitioned_rows build_parts(1, radix_bits, budget, shift);
+    join_partitioned_rows probe_parts(1, radix_bits, budget, shift);
+    build_rows.for_each(partition, [&](join_row& row) {
+      build_parts.add(0, row.hash, std::move(row.values));
+    });
+    build_rows.clear(partition);
+    probe_rows.for_each(partition, [&](join_row& row) {
+      probe_parts.add(0, row.hash, std::move(row.values));
+    });
+    probe_rows.clear(partition);
+    for (size_t part = 0; part < build_parts.num_partitions(); ++part) {
+      join_partition(build_parts, probe_parts, part, build_key_positions, probe_key_positions,
+                     keep_build, keep_probe, budget, depth + 1,
+                     joined, build_only, probe_only);
+    }
+    return;
+  }
+
+  std::vector<join_row> rows;
+  build_rows.for_each(partition, [&](join_row& row) { rows.push_back(std::move(row)); });
+  build_rows.clear(partition);
+  join_hash_index index(rows);
+  std::vector<char> matched(keep_build ? rows.size() : 0, false);
+  probe_rows.for_each(partition, [&](join_row& row) {
+    bool found = false;
+    index.find(row.hash, [&](size_t i) {
+      if (!join_keys_equal(rows[i].values, build_key_positions,
+                           row.values, probe_key_positions)) return;
+      joined(rows[i].values, row.values);
+      if (keep_build) matched[i] = true;
+      found = true;
+    });
+    if (!found && keep_probe) probe_only(row.values);
+  });
+  probe_rows.clear(partition);
+  if (keep_build) {
+    for (size_t i = 0; i < rows.size(); ++i) {
+      if (!matched[i]) build_only(rows[i].values);
+    }
+  }
+}
+
+} // namespace gl_sframe_impl
+
+/*
+ * The side with the smaller estimated memory is the build side. Key
+ * frequencies are first sampled on both sides to find the heavy hitters.
+ * Build rows are then read in parallel and added to a bloom filter; rows of
+ * heavy keys are kept aside in a broadcast table, and the others radix
+ * partitioned on the hash of their key. A broadcast table which outgrows
+ * its share of the budget is given up: its rows are partitioned like the
+ * others. The probe side is then read in parallel: rows of heavy keys are
+ * joined against the broadcast table at once, rows rejected by the filter
+ * cannot match and are either dropped or emitted as unmatched, and the
+ * rest are partitioned the same way. Finally each partition is joined by
+ * one thread, with a hash table on its build rows, into its own writer
+ * segment; a partition whose build rows outgrow the share of the budget of
+ * a thread is split further first. Both sides spill partitions when over
+ * their half of the memory budget.
+ */
+inline gl_sframe gl_sframe::hash_join(const gl_sframe& right,
+                                      const std::map<std::string, std::string>& joinkeys,
+                                      const std::string& how,
+                                      size_t memory_budget,
+                                      join_statistics* statistics) const {
+  if (how != "inner" && how != "left" && how != "right" && how != "outer") {
+    log_and_throw("Invalid join type \"" + how + "\"");
+  }
+  gl_sframe_impl::join_layout layout(*this, right, joinkeys);
+  const auto& left_key_positions = layout.left_key_positions;
+  const auto& right_key_positions = layout.right_key_positions;
+
+  gl_sframe left_source(*this), right_source(right);
+  left_source.materialize();
+  right_source.materialize();
+  size_t left_bytes = gl_sframe_impl::estimate_join_memory(left_source);
+  size_t right_bytes = gl_sframe_impl::estimate_join_memory(right_source);
+  bool build_is_left = left_bytes < right_bytes;
+  gl_sframe& build_source = build_is_left ? left_source : right_source;
+  gl_sframe& probe_source = build_is_left ? right_source : left_source;
+  const auto& build_key_positions = build_is_left ? left_key_positions : right_key_positions;
+  const auto& probe_key_positions = build_is_left ? right_key_positions : left_key_positions;
+  bool keep_left = (how == "left" || how == "outer");
+  bool keep_right = (how == "right" || how == "outer");
+  bool keep_build = build_is_left ? keep_left : keep_right;
+  bool keep_probe = build_is_left ? keep_right : keep_left;
+  size_t nbuild = build_source.size();
+  size_t nprobe = probe_source.size();
+  size_t nthreads = thread::cpu_count();
+
+  // A quarter of the budget is set aside for the broadcast table of the
+  // heavy keys, and the build and probe rows get half of the rest each.
+  // Partitions are sized so that the build side of each thread's partition
+  // fits in its share; partitions which do not are split again when joined.
+  size_t broadcast_budget = std::max<size_t>(memory_budget / 4, 1024 * 1024);
+  size_t partition_budget = memory_budget - std::min(memory_budget, broadcast_budget);
+  size_t build_bytes = build_is_left ? left_bytes : right_bytes;
+  size_t thread_budget = std::max<size_t>(partition_budget / 2 / nthreads, 1024 * 1024);
+  size_t radix_bits = gl_sframe_impl::join_radix_bits(build_bytes, thread_budget,
+                                                      4 * nthreads, 10);
+  gl_sframe_impl::join_partitioned_rows build_rows(nthreads, radix_bits, thread_budget);
+  gl_sframe_impl::join_partitioned_rows probe_rows(nthreads, radix_bits, thread_budget);
+  size_t npartitions = build_rows.num_partitions();
+
+  // heavy hitters: keys with more than half of a partition's fair share
+  std::vector<uint128_t> heavy_keys;
+  {
+    double min_fraction = 0.5 / npartitions;
+    auto probe_heavy = gl_sframe_impl::sample_heavy_join_keys(
+        probe_source, probe_key_positions, min_fraction);
+    auto build_heavy = gl_sframe_impl::sample_heavy_join_keys(
+        build_source, build_key_positions, min_fraction);
+    std::set_union(probe_heavy.begin(), probe_heavy.end(),
+                   build_heavy.begin(), build_heavy.end(), std::back_inserter(heavy_keys));
+  }
+  auto is_heavy = [&](uint128_t hash) {
+    return !heavy_keys.empty() &&
+        std::binary_search(heavy_keys.begin(), heavy_keys.end(), hash);
+  };
+
+  size_t nsegments = std::max(npartitions, nthreads);
+  gl_sframe_writer writer(layout.output_names, layout.output_types, nsegments);
+  std::vector<size_t> segment_rows(nsegments, 0);
+  auto emit = [&](const std::vector<flexible_type>* left_row,
+                  const std::vector<flexible_type>* right_row,
+                  std::vector<flexible_type>& out, size_t segmentid) {
+    layout.assemble(left_row, right_row, out);
+    writer.write(out, segmentid);
+    ++segment_rows[segmentid];
+  };
+  auto emit_joined = [&](const std::vector<flexible_type>& build_row,
+                         const std::vector<flexible_type>& probe_row,
+                         std::vector<flexible_type>& out, size_t segmentid) {
+    if (build_is_left) emit(&build_row, &probe_row, out, segmentid);
+    else emit(&probe_row, &build_row, out, segmentid);
+  };
+  auto emit_build_only = [&](const std::vector<flexible_type>& build_row,
+                             std::vector<flexible_type>& out, size_t segmentid) {
+    if (build_is_left) emit(&build_row, nullptr, out, segmentid);
+    else emit(nullptr, &build_row, out, segmentid);
+  };
+  auto emit_probe_only = [&](const std::vector<flexible_type>& probe_row,
+                             std::vector<flexible_type>& out, size_t segmentid) {
+    if (build_is_left) emit(nullptr, &probe_row, out, segmentid);
+    else emit(&probe_row, nullptr, out, segmentid);
+  };
+
+  // partition the build side, and fill the bloom filter
+  sdk_sketches::bloom_filter filter(nbuild);
+  std::vector<std::vector<gl_sframe_impl::join_row> > thread_heavy_rows(nthreads);
+  atomic<size_t> broadcast_bytes;
+  std::atomic<bool> broadcast_full(false);
+  {
+    std::vector<gl_sframe_range> ranges;
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      ranges.push_back(build_source.range_iterator(nbuild * threadid / nthreads,
+                                                   nbuild * (threadid + 1) / nthreads));
+    }
+    parallel_for(0, nthreads, [&](size_t threadid) {
+      std::vector<flexible_type> key(build_key_positions.size());
+      for (const auto& row: ranges[threadid]) {
+        for (size_t i = 0; i < key.size(); ++i) key[i] = row[build_key_positions[i]];
+        uint128_t hash = gl_sframe_impl::hash_group_key(key);
+        filter.concurrent_add(hash);
+        if (!broadcast_full.load(std::memory_order_relaxed) && is_heavy(hash)) {
+          size_t bytes = gl_sframe_impl::join_row_memory(row);
+          if (broadcast_bytes.inc(bytes) > broadcast_budget) {
+            broadcast_full.store(true, std::memory_order_relaxed);
+          }
+          thread_heavy_rows[threadid].push_back(gl_sframe_impl::join_row{hash, row});
+        } else {
+          build_rows.add(threadid, hash, std::vector<flexible_type>(row));
+        }
+      }
+    });
+  }
+
+  // the broadcast table of the build rows of heavy keys, or if it is too
+  // large, no heavy keys
+  std::vector<gl_sframe_impl::join_row> heavy_rows;
+  if (broadcast_full.load(std::memory_order_relaxed)) {
+    parallel_for(0, nthreads, [&](size_t threadid) {
+      for (auto& row: thread_heavy_rows[threadid]) {
+        build_rows.add(threadid, row.hash, std::move(row.values));
+      }
+      std::vector<gl_sframe_impl::join_row>().swap(thread_heavy_rows[threadid]);
+    });
+    heavy_keys.clear();
+  }
+  for (auto& rows: thread_heavy_rows) {
+    std::move(rows.begin(), rows.end(), std::back_inserter(heavy_rows));
+    std::vector<gl_sframe_impl::join_row>().swap(rows);
+  }
+  gl_sframe_impl::join_hash_index heavy_index(heavy_rows);
+  // per thread, as heavy rows are matched by every thread
+  std::vector<std::vector<char> > heavy_matched(
+      nthreads, std::vector<char>(keep_build ? heavy_rows.size() : 0, false));
+
+  // partition the probe side, joining the heavy keys and filtering out the
+  // rows which cannot match
+  std::vector<size_t> num_filtered(nthreads, 0), num_heavy_probe(nthreads, 0);
+  {
+    std::vector<gl_sframe_range> ranges;
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      ranges.push_back(probe_source.range_iterator(nprobe * threadid / nthreads,
+                                                   nprobe * (threadid + 1) / nthreads));
+    }
+    parallel_for(0, nthreads, [&](size_t threadid) {
+      std::vector<flexible_type> key(probe_key_positions.size());
+      std::vector<flexible_type> values;
+      std::vector<flexible_type> out;
+      for (const auto& row: ranges[threadid]) {
+        for (size_t i = 0; i < key.size(); ++i) key[i] = row[probe_key_positions[i]];
+        uint128_t hash = gl_sframe_impl::hash_group_key(key);
+        if (is_heavy(hash)) {
+          ++num_heavy_probe[threadid];
+          values = row;
+          bool found = false;
+          heavy_index.find(hash, [&](size_t i) {
+            if (!gl_sframe_impl::join_keys_equal(heavy_rows[i].values, build_key_positions,
+                                                 values, probe_key_positions)) return;
+            emit_joined(heavy_rows[i].values, values, out, threadid);
+            if (keep_build) heavy_matched[threadid][i] = true;
+            found = true;
+          });
+          if (!found && keep_probe) emit_probe_only(values, out, threadid);
+        } else if (filter.may_contain(hash)) {
+          probe_rows.add(threadid, hash, std::vector<flexible_type>(row));
+        } else {
+          ++num_filtered[threadid];
+          if (keep_probe) emit_probe_only(row, out, threadid);
+        }
+      }
+    });
+  }
+  if (keep_build) {
+    std::vector<flexible_type> out;
+    for (size_t i = 0; i < heavy_rows.size(); ++i) {
+      bool matched = false;
+      for (const auto& thread_matched: heavy_matched) matched = matched || thread_matched[i];
+      if (!matched) emit_build_only(heavy_rows[i].values, out, 0);
+    }
+  }
+
+  if (statistics) {
+    join_statistics& stats = *statistics;
+    stats = join_statistics();
+    stats.build_is_left = build_is_left;
+    stats.num_build_rows = nbuild;
+    stats.num_probe_rows = nprobe;
+    stats.num_partitions = npartitions;
+    stats.num_heavy_keys = heavy_keys.size();
+    stats.num_heavy_build_rows = heavy_rows.size();
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      stats.num_probe_rows_filtered += num_filtered[threadid];
+      stats.num_heavy_probe_rows += num_heavy_probe[threadid];
+    }
+    size_t partitioned_rows = 0;
+    for (size_t partition = 0; partition < npartitions; ++partition) {
+      size_t size = probe_rows.partition_size(partition);
+      stats.max_partition_probe_rows = std::max(stats.max_partition_probe_rows, size);
+      partitioned_rows += size;
+    }
+    stats.mean_partition_probe_rows = double(partitioned_rows) / npartitions;
+  }
+
+  // join each partition
+  parallel_for(0, npartitions, [&](size_t partition) {
+    std::vector<flexible_type> out;
+    auto joined = [&](const std::vector<flexible_type>& build_row,
+                      const std::vector<flexible_type>& probe_row) {
+      emit_joined(build_row, probe_row, out, partition);
+    };
+    auto build_only = [&](const std::vector<flexible_type>& build_row) {
+      emit_build_only(build_row, out, partition);
+    };
+    auto probe_only = [&](const std::vector<flexible_type>& probe_row) {
+      emit_probe_only(probe_row, out, partition);
+    };
+    gl_sframe_impl::join_partition(build_rows, probe_rows, partition,
+                                   build_key_positions, probe_key_positions,
+                                   keep_build, keep_probe, thread_budget, 0,
+                                   joined, build_only, probe_only);
+  });
+
+  if (statistics) {
+    statistics->num_spills = build_rows.num_spills() + probe_rows.num_spills();
+    for (size_t count: segment_rows) statistics->num_output_rows += count;
+  }
+  return writer.close();
+}
+
+inline gl_sframe gl_sframe::hash_join(const gl_sframe& right,
+                                      const std::vector<std::string>& joinkeys,
+                                      const std::string& how,
+                                      size_t memory_budget,
+                                      join_statistics* statistics) const {
+  std::map<std::string, std::string> keys;
+  for (const auto& key: joinkeys) keys[key] = key;
+  return hash_join(right, keys, how, memory_budget, statistics);
+}
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_PARQUET_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_PARQUET_IMPL_HPP
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/sframe/parquet_reader.hpp>
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+namespace gl_sframe_impl {
+
+/**
+ * A parquet_predicate resolved against the columns of a parquet_file.
+ */
+struct parquet_filter {
+  enum comparison { EQ, NE, LT, LE, GT, GE };
+  size_t column;
+  comparison op;
+  flexible_type value;
+
+  bool matches(const flexible_type& x) const {
+    if (x.get_type() == flex_type_enum::UNDEFINED) return false;
+    switch (op) {
+      case EQ: return x == value;
+      case NE: return x != value;
+      case LT: return x < value;
+      case LE: return x <= value;
+      case GT: return x > value;
+      default: return x >= value;
+    }
+  }
+
+  /**
+   * Returns true if no value between min and max can match.
+   */
+  bool excludes(const flexible_type& min, const flexible_type& max) const {
+    switch (op) {
+      case EQ: return value < min || value > max;
+      case NE: return min == value && max == value;
+      case LT: return !(min < value);
+      case LE: return min > value;
+      case GT: return !(max > value);
+      default: return max < value;
+    }
+  }
+};
+
+inline bool parquet_comparable(flex_type_enum column, flex_type_enum value) {
+  auto is_number = [](flex_type_enum t) {
+    return t == flex_type_enum::INTEGER || t == flex_type_enum::FLOAT;
+  };
+  if (column == flex_type_enum::STRING) return value == flex_type_enum::STRING;
+  if (column == flex_type_enum::DATETIME) return value == flex_type_enum::DATETIME;
+  return is_number(column) && is_number(value);
+}
+
+inline parquet_filter resolve_parquet_predicate(const parquet_file& file,
+                                                const parquet_predicate& predicate) {
+  static const std::vector<std::string> ops{"==", "!=", "<", "<=", ">", ">="};
+  parquet_filter filter;
+  int column = file.find_column(predicate.column);
+  if (column < 0) {
+    log_and_throw("Column " + predicate.column + " is not a flat column of the parquet file");
+  }
+  auto op = std::find(ops.begin(), ops.end(), predicate.op);
+  if (op == ops.end()) log_and_throw("Unknown predicate operator " + predicate.op);
+  filter.column = column;
+  filter.op = parquet_filter::comparison(op - ops.begin());
+  filter.value = predicate.value;
+  flex_type_enum column_type = file.columns()[column].type;
+  if (!parquet_comparable(column_type, filter.value.get_type())) {
+    log_and_throw("Predicate on column " + predicate.column + " of type " +
+                  flex_type_enum_to_name(column_type) + " cannot compare a " +
+                  flex_type_enum_to_name(filter.value.get_type()));
+  }
+  return filter;
+}
+
+} // namespace gl_sframe_impl
+
+inline void gl_sframe::construct_from_parquet(const std::string& path,
+                                              const std::vector<std::string>& columns,
+                                              const std::vector<parquet_predicate>& predicates) {
+  parquet_file file(path);
+
+  std::vector<size_t> projection;
+  if (columns.empty()) {
+    for (size_t c = 0; c < file.columns().size(); ++c) projection.push_back(c);
+  } else {
+    for (const auto& name: columns) {
+      int column = file.find_column(name);
+      if (column < 0) log_and_throw("Column " + name + " is not a flat column of " + path);
+      if (std::find(projection.begin(), projection.end(), size_t(column)) != projection.end()) {
+        log_and_throw("Column " + name + " is selected twice");
+      }
+      projection.push_back(column);
+    }
+  }
+  std::vector<gl_sframe_impl::parquet_filter> filters;
+  for (const auto& predicate: predicates) {
+    filters.push_back(gl_sframe_impl::resolve_parquet_predicate(file, predicate));
+  }
+  if (projection.empty()) {
+    *this = gl_sframe();
+    return;
+  }
+
+  // row groups which may hold matching rows, from their statistics
+  std::vector<size_t> row_groups;
+  for (size_t g = 0; g < file.row_groups().size(); ++g) {
+    int64_t num_rows = file.row_groups()[g].num_rows;
+    bool skip = num_rows == 0;
+    for (const auto& filter: filters) {
+      if (skip) break;
+      flexible_type min, max;
+      // missing values never match, so neither does a column of them
+      skip = file.column_null_count(g, filter.column) == num_rows ||
+             (file.column_bounds(g, filter.column, min, max) && filter.excludes(min, max));
+    }
+    if (!skip) row_groups.push_back(g);
+  }
+
+  std::vector<std::string> names;
+  std::vector<flex_type_enum> types;
+  for (size_t c: projection) {
+    names.push_back(file.columns()[c].name);
+    types.push_back(file.columns()[c].type);
+  }
+  std::set<size_t> filter_columns;
+  for (const auto& filter: filters) filter_columns.insert(filter.column);
+
+  // one segment per row group
+  size_t nsegments = std::max<size_t>(1, row_groups.size());
+  gl_sframe_writer writer(names, types, nsegments);
+  parallel_for(0, row_groups.size(), [&](size_t segmentid) {
+    size_t g = row_groups[segmentid];
+    size_t num_rows = file.row_groups()[g].num_rows;
+    std::vector<std::vector<flexible_type> > values(file.columns().size());
+    std::vector<unsigned char> selected(num_rows, 1);
+    size_t num_selected = num_rows;
+    for (size_t c: filter_columns) {
+      file.read_column(g, c, values[c]);
+      num_selected = 0;
+      for (const auto& filter: filters) {
+        if (filter.column != c) continue;
+        for (size_t r = 0; r < num_rows; ++r) {
+          if (selected[r] && !filter.matches(values[c][r])) selected[r] = 0;
+        }
+      }
+      for (size_t r = 0; r < num_rows; ++r) num_selected += selected[r];
+      if (num_selected == 0) return;
+    }
+    for (size_t c: projection) {
+      if (values[c].empty()) file.read_column(g, c, values[c]);
+    }
+    std::vector<flexible_type> row(projection.size());
+    for (size_t r = 0; r < num_rows; ++r) {
+      if (!selected[r]) continue;
+      for (size_t i = 0; i < projection.size(); ++i) row[i] = std::move(values[projection[i]][r]);
+      writer.write(row, segmentid);
+    }
+  });
+  *this = writer.close();
+}
+
+} // namespace graphlab
+
+#endif
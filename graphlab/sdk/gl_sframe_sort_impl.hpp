@@ -0,0 +1,470 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_SORT_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_SORT_IMPL_HPP
+#include <deque>
+#include <queue>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/fileio/fileio_constants.hpp>
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+namespace gl_sframe_impl {
+
+inline void append_big_endian(std::string& out, uint64_t value, size_t nbytes = 8) {
+  for (size_t i = nbytes; i > 0; --i) out.push_back(char((value >> (8 * (i - 1))) & 0xff));
+}
+
+/**
+ * Appends to "out" an encoding of a value of a column of the given type,
+ * such that comparing encodings bytewise (memcmp) orders values as sort()
+ * does, missing values first. Descending columns have all the bytes of
+ * their encoding inverted.
+ *
+ * - A leading byte is 0 for a missing value and 1 otherwise.
+ * - Integers are 8 bytes big endian, with the sign bit flipped.
+ * - Floats are their 8 bytes big endian, with the sign bit flipped if
+ *   positive, and all bits flipped if negative.
+ * - Datetimes are their posix timestamp as an integer, then their
+ *   microseconds as 4 bytes big endian.
+ * - Strings have their 0 bytes escaped as (0, 0xff), and end with (0, 0),
+ *   so that a prefix sorts first.
+ */
+inline void encode_sort_value(const flexible_type& value, flex_type_enum type,
+                              bool ascending, std::string& out) {
+  size_t begin = out.size();
+  if (value.get_type() == flex_type_enum::UNDEFINED) {
+    out.push_back(0);
+  } else {
+    out.push_back(1);
+    switch (type) {
+      case flex_type_enum::INTEGER:
+        append_big_endian(out, uint64_t(value.get<flex_int>()) ^ (uint64_t(1) << 63));
+        break;
+      case flex_type_enum::FLOAT: {
+        double d = value.get<flex_float>();
+        uint64_t bits = 0;
+        std::memcpy(&bits, &d, sizeof(bits));
+        bits = (bits >> 63) ? ~bits : (bits | (uint64_t(1) << 63));
+        append_big_endian(out, bits);
+        break;
+      }
+      case flex_type_enum::DATETIME: {
+        const auto& dt = value.get<flex_date_time>();
+        append_big_endian(out, uint64_t(dt.posix_timestamp()) ^ (uint64_t(1) << 63));
+        append_big_endian(out, uint32_t(dt.microsecond()), 4);
+        break;
+      }
+      case flex_type_enum::STRING:
+        for (char c: value.get<flex_string>()) {
+          out.push_back(c);
+          if (c == 0) out.push_back(char(0xff));
+        }
+        out.push_back(0);
+        out.push_back(0);
+        break;
+      default:
+        log_and_throw("Cannot sort on a column of type " + std::string(flex_type_enum_to_name(type)));
+    }
+  }
+  if (!ascending) {
+    for (size_t i = begin; i < out.size(); ++i) out[i] = ~out[i];
+  }
+}
+
+/**
+ * A row to sort, with its encoded key.
+ */
+struct sort_record {
+  std::string key;
+  std::vector<flexible_type> values;
+};
+
+/**
+ * Sorts records on their keys. Records are ordered by the first 8 bytes
+ * of their key as an integer, and by the whole key only on a tie, so that
+ * most comparisons are one integer comparison.
+ */
+inline void sort_records(std::vector<sort_record>& records) {
+  std::vector<std::pair<uint64_t, size_t> > order(records.size());
+  for (size_t i = 0; i < records.size(); ++i) {
+    const std::string& key = records[i].key;
+    uint64_t prefix = 0;
+    for (size_t j = 0; j < 8; ++j) {
+      prefix = (prefix << 8) | (j < key.size() ? (unsigned char)key[j] : 0);
+    }
+    order[i] = {prefix, i};
+  }
+  std::sort(order.begin(), order.end(),
+            [&](const std::pair<uint64_t, size_t>& a, const std::pair<uint64_t, size_t>& b) {
+              if (a.first != b.first) return a.first < b.first;
+              return records[a.second].key < records[b.second].key;
+            });
+  std::vector<sort_record> sorted(records.size());
+  for (size_t i = 0; i < order.size(); ++i) sorted[i] = std::move(records[order[i].second]);
+  records.swap(sorted);
+}
+
+/**
+ * A sorted run written to disk, laid out by output partition: partition p
+ * holds counts[p] records starting at offsets[p]. The file is removed with
+ * the run, so that it is not left behind by an exception.
+ */
+struct sort_run_file {
+  std::string filename;
+  std::vector<size_t> offsets;
+  std::vector<size_t> counts;
+
+  sort_run_file() {}
+  sort_run_file(const sort_run_file&) = delete;
+  sort_run_file& operator=(const sort_run_file&) = delete;
+  sort_run_file(sort_run_file&& other) noexcept { *this = std::move(other); }
+  sort_run_file& operator=(sort_run_file&& other) noexcept {
+    remove();
+    filename.swap(other.filename);
+    offsets.swap(other.offsets);
+    counts.swap(other.counts);
+    return *this;
+  }
+  ~sort_run_file() { remove(); }
+
+  void remove() noexcept {
+    if (!filename.empty()) std::remove(filename.c_str());
+    filename.clear();
+  }
+};
+
+/**
+ * Returns a new temporary file name for a sort run.
+ */
+inline std::string sort_run_filename() {
+  static atomic<size_t> counter;
+  return fileio::get_system_temp_directory() + "/gl_sort_run_" +
+      std::to_string(getpid()) + "_" + std::to_string(counter.inc());
+}
+
+/**
+ * Returns the position in a sorted run of the first record of each
+ * partition, given the partition splitters, and the size of the run.
+ */
+inline std::vector<size_t> sort_run_bounds(const std::vector<sort_record>& run,
+                                           const std::vector<std::string>& splitters) {
+  std::vector<size_t> bounds(1, 0);
+  for (const auto& splitter: splitters) {
+    auto iter = std::lower_bound(run.begin() + bounds.back(), run.end(), splitter,
+                                 [](const sort_record& r, const std::string& s) {
+                                   return r.key < s;
+                                 });
+    bounds.push_back(iter - run.begin());
+  }
+  bounds.push_back(run.size());
+  return bounds;
+}
+
+inline sort_run_file spill_sort_run(const std::vector<sort_record>& run,
+                                    const std::vector<std::string>& splitters) {
+  sort_run_file file;
+  file.filename = sort_run_filename();
+  std::ofstream fout(file.filename, std::ios::binary);
+  if (!fout.good()) log_and_throw("Unable to open sort run file " + file.filename);
+  auto bounds = sort_run_bounds(run, splitters);
+  for (size_t p = 0; p + 1 < bounds.size(); ++p) {
+    file.offsets.push_back(fout.tellp());
+    file.counts.push_back(bounds[p + 1] - bounds[p]);
+    oarchive oarc(fout);
+    for (size_t i = bounds[p]; i < bounds[p + 1]; ++i) oarc << run[i].key << run[i].values;
+    fout.flush();
+  }
+  if (!fout.good()) log_and_throw("Error writing sort run file " + file.filename);
+  return file;
+}
+
+/**
+ * A cursor over one partition of a sorted run, on disk or in memory.
+ */
+class sort_run_cursor {
+ public:
+  sort_run_cursor(const sort_run_file& file, size_t partition)
+      : m_remaining(file.counts[partition]) {
+    if (m_remaining == 0) return;
+    m_fin.reset(new std::ifstream(file.filename, std::ios::binary));
+    m_fin->seekg(file.offsets[partition]);
+    m_iarc.reset(new iarchive(*m_fin));
+    next();
+  }
+
+  sort_run_cursor(const std::vector<sort_record>& run, size_t begin, size_t end)
+      : m_remaining(end - begin), m_run(&run), m_position(begin) {
+    next();
+  }
+
+  bool valid() const { return m_current != nullptr; }
+  const sort_record& current() const { return *m_current; }
+
+  void next() {
+    if (m_remaining == 0) {
+      m_current = nullptr;
+      return;
+    }
+    --m_remaining;
+    if (m_run) {
+      m_current = &(*m_run)[m_position++];
+    } else {
+      (*m_iarc) >> m_record.key >> m_record.values;
+      m_current = &m_record;
+    }
+  }
+
+ private:
+  size_t m_remaining;
+  const std::vector<sort_record>* m_run = nullptr;
+  size_t m_position = 0;
+  std::unique_ptr<std::ifstream> m_fin;
+  std::unique_ptr<iarchive> m_iarc;
+  sort_record m_record;
+  const sort_record* m_current = nullptr;
+};
+
+/**
+ * One partition of a sorted run on disk.
+ */
+struct sort_run_slice {
+  sort_run_file* file;
+  size_t partition;
+  /// whether the run is an intermediate merge, removed once merged
+  bool intermediate;
+};
+
+/**
+ * Calls fn(record) on the records of some cursors, in key order.
+ */
+template <typename Fn>
+inline void merge_sort_cursors(std::vector<std::unique_ptr<sort_run_cursor> >& cursors, Fn fn) {
+  auto greater = [&](size_t a, size_t b) {
+    return cursors[a]->current().key > cursors[b]->current().key;
+  };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+  for (size_t i = 0; i < cursors.size(); ++i) {
+    if (cursors[i]->valid()) heap.push(i);
+  }
+  while (!heap.empty()) {
+    size_t i = heap.top();
+    heap.pop();
+    fn(cursors[i]->current());
+    cursors[i]->next();
+    if (cursors[i]->valid()) heap.push(i);
+  }
+}
+
+/**
+ * Merges one partition of the runs on disk and of runs in memory, calling
+ * fn(record) in key order. At most max_fanin runs on disk are open at
+ * once: with more, groups of max_fanin are first merged into intermediate
+ * runs, pass after pass.
+ */
+template <typename Fn>
+inline void merge_sort_partition(std::vector<sort_run_slice> slices,
+                                 std::vector<std::unique_ptr<sort_run_cursor> > memory_cursors,
+                                 size_t max_fanin, Fn fn) {
+  max_fanin = std::max<size_t>(max_fanin, 2);
+  std::deque<sort_run_file> intermediates;
+  while (slices.size() > max_fanin) {
+    std::vector<sort_run_slice> next;
+    for (size_t begin = 0; begin < slices.size(); begin += max_fanin) {
+      size_t end = std::min(begin + max_fanin, slices.size());
+      if (end - begin == 1) {
+        next.push_back(slices[begin]);
+        continue;
+      }
+      std::vector<std::unique_ptr<sort_run_cursor> > cursors;
+      for (size_t i = begin; i < end; ++i) {
+        cursors.emplace_back(new sort_run_cursor(*slices[i].file, slices[i].partition));
+      }
+      intermediates.emplace_back();
+      sort_run_file& merged = intermediates.back();
+      merged.filename = sort_run_filename();
+      merged.offsets.push_back(0);
+      merged.counts.push_back(0);
+      {
+        std::ofstream fout(merged.filename, std::ios::binary);
+        if (!fout.good()) log_and_throw("Unable to open sort run file " + merged.filename);
+        oarchive oarc(fout);
+        merge_sort_cursors(cursors, [&](const sort_record& record) {
+          oarc << record.key << record.values;
+          ++merged.counts[0];
+        });
+        fout.flush();
+        if (!fout.good()) log_and_throw("Error writing sort run file " + merged.filename);
+      }
+      cursors.clear();
+      for (size_t i = begin; i < end; ++i) {
+        if (slices[i].intermediate) slices[i].file->remove();
+      }
+      next.push_back({&merged, 0, true});
+    }
+    slices.swap(next);
+  }
+  std::vector<std::unique_ptr<sort_run_cursor> > cursors(std::move(memory_cursors));
+  for (const auto& slice: slices) {
+    cursors.emplace_back(new sort_run_cursor(*slice.file, slice.partition));
+  }
+  merge_sort_cursors(cursors, fn);
+}
+
+} // namespace gl_sframe_impl
+
+/*
+ * A sample sort with external runs. Splitters between the output
+ * partitions are first picked from a sample of the keys. Rows are then
+ * read in parallel and their keys encoded; each thread sorts its buffer
+ * into a run whenever it outgrows its share of the memory budget, and
+ * writes it to disk by partition. Finally each partition is k-way merged
+ * from all the runs, in parallel, into its own writer segment, in several
+ * passes when it has more runs on disk than files a merge may open. The
+ * row number is appended to every key, which makes the sort stable.
+ */
+inline gl_sframe gl_sframe::external_sort(
+    const std::vector<std::pair<std::string, bool> >& column_and_ascending,
+    size_t memory_budget) const {
+  if (column_and_ascending.empty()) log_and_throw("Sort requires at least one column");
+  std::vector<size_t> key_positions;
+  std::vector<flex_type_enum> key_types;
+  std::vector<bool> key_ascending;
+  std::vector<std::string> names = column_names();
+  std::vector<flex_type_enum> types = column_types();
+  for (const auto& column: column_and_ascending) {
+    if (!contains_column(column.first)) {
+      log_and_throw("Column \"" + column.first + "\" not found");
+    }
+    size_t position = column_index(column.first);
+    flex_type_enum type = types[position];
+    if (type != flex_type_enum::INTEGER && type != flex_type_enum::FLOAT &&
+        type != flex_type_enum::STRING && type != flex_type_enum::DATETIME) {
+      log_and_throw("Only integer, float, string and datetime columns can be sorted");
+    }
+    key_positions.push_back(position);
+    key_types.push_back(type);
+    key_ascending.push_back(column.second);
+  }
+  auto encode_key = [&](const std::vector<flexible_type>& row, std::string& key) {
+    key.clear();
+    for (size_t i = 0; i < key_positions.size(); ++i) {
+      gl_sframe_impl::encode_sort_value(row[key_positions[i]], key_types[i],
+                                        key_ascending[i], key);
+    }
+  };
+
+  gl_sframe source(*this);
+  source.materialize();
+  size_t n = source.size();
+  size_t nthreads = thread::cpu_count();
+  size_t npartitions = 2 * nthreads;
+
+  // splitters, from chunks of rows spread over the gl_sframe
+  std::vector<std::string> splitters;
+  {
+    const size_t nchunks = 64, chunk_size = 64;
+    std::vector<std::string> sample;
+    std::string key;
+    auto add_sample = [&](size_t start, size_t end) {
+      for (const auto& row: source.range_iterator(start, end)) {
+        encode_key(row, key);
+        sample.push_back(key);
+      }
+    };
+    if (n <= nchunks * chunk_size) {
+      add_sample(0, n);
+    } else {
+      for (size_t c = 0; c < nchunks; ++c) {
+        size_t start = (n - chunk_size) * c / (nchunks - 1);
+        add_sample(start, start + chunk_size);
+      }
+    }
+    std::sort(sample.begin(), sample.end());
+    for (size_t p = 1; p < npartitions && !sample.empty(); ++p) {
+      splitters.push_back(sample[sample.size() * p / npartitions]);
+    }
+  }
+
+  // sorted runs: spilled, and the last one of each thread in memory
+  size_t thread_budget = std::max<size_t>(memory_budget / nthreads, 1024 * 1024);
+  std::vector<std::vector<gl_sframe_impl::sort_run_file> > run_files(nthreads);
+  std::vector<std::vector<gl_sframe_impl::sort_record> > runs(nthreads);
+  {
+    std::vector<gl_sframe_range> ranges;
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      ranges.push_back(source.range_iterator(n * threadid / nthreads,
+                                             n * (threadid + 1) / nthreads));
+    }
+    parallel_for(0, nthreads, [&](size_t threadid) {
+      auto& run = runs[threadid];
+      size_t bytes = 0;
+      size_t row_number = n * threadid / nthreads;
+      for (const auto& row: ranges[threadid]) {
+        gl_sframe_impl::sort_record record;
+        record.values = row;
+        encode_key(record.values, record.key);
+        gl_sframe_impl::append_big_endian(record.key, row_number++);
+        bytes += 32 + record.key.size() + gl_sframe_impl::join_row_memory(record.values);
+        run.push_back(std::move(record));
+        if (bytes > thread_budget) {
+          gl_sframe_impl::sort_records(run);
+          run_files[threadid].push_back(gl_sframe_impl::spill_sort_run(run, splitters));
+          std::vector<gl_sframe_impl::sort_record>().swap(run);
+          bytes = 0;
+        }
+      }
+      gl_sframe_impl::sort_records(run);
+    });
+  }
+  std::vector<std::vector<size_t> > run_bounds(nthreads);
+  for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+    run_bounds[threadid] = gl_sframe_impl::sort_run_bounds(runs[threadid], splitters);
+  }
+
+  // every merge opens at most max_fanin run files, with nthreads merges
+  // running at once
+  size_t max_fanin = std::max<size_t>(4, 256 / nthreads);
+  size_t nsegments = splitters.size() + 1;
+  gl_sframe_writer writer(names, types, nsegments);
+  parallel_for(0, nsegments, [&](size_t partition) {
+    std::vector<gl_sframe_impl::sort_run_slice> slices;
+    std::vector<std::unique_ptr<gl_sframe_impl::sort_run_cursor> > memory_cursors;
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      for (auto& file: run_files[threadid]) {
+        if (file.counts[partition] > 0) slices.push_back({&file, partition, false});
+      }
+      memory_cursors.emplace_back(new gl_sframe_impl::sort_run_cursor(
+          runs[threadid], run_bounds[threadid][partition], run_bounds[threadid][partition + 1]));
+    }
+    gl_sframe_impl::merge_sort_partition(
+        slices, std::move(memory_cursors), max_fanin,
+        [&](const gl_sframe_impl::sort_record& record) { writer.write(record.values, partition); });
+  });
+  // the run files are removed with run_files
+  return writer.close();
+}
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,402 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_SORTED_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_SORTED_IMPL_HPP
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/sframe/group_aggregate_value.hpp>
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+namespace gl_sframe_impl {
+
+/**
+ * Compares two values in ascending sort order, missing values first.
+ * Returns a negative number, 0, or a positive number.
+ */
+inline int compare_sort_values(const flexible_type& a, const flexible_type& b) {
+  bool a_missing = a.get_type() == flex_type_enum::UNDEFINED;
+  bool b_missing = b.get_type() == flex_type_enum::UNDEFINED;
+  if (a_missing || b_missing) return int(b_missing) - int(a_missing);
+  if (a < b) return -1;
+  if (b < a) return 1;
+  return 0;
+}
+
+/**
+ * Compares two keys lexicographically, in ascending sort order.
+ */
+inline int compare_sort_keys(const std::vector<flexible_type>& a,
+                             const std::vector<flexible_type>& b) {
+  for (size_t i = 0; i < a.size(); ++i) {
+    int c = compare_sort_values(a[i], b[i]);
+    if (c != 0) return c;
+  }
+  return 0;
+}
+
+inline void extract_key(const std::vector<flexible_type>& row,
+                        const std::vector<size_t>& positions,
+                        std::vector<flexible_type>& key) {
+  key.resize(positions.size());
+  for (size_t i = 0; i < positions.size(); ++i) key[i] = row[positions[i]];
+}
+
+/**
+ * Returns the first row in [lo, hi) of a gl_sframe sorted on the key
+ * columns whose key is not less than "key", by binary search.
+ */
+inline size_t sorted_lower_bound(const gl_sframe& source,
+                                 const std::vector<size_t>& positions,
+                                 const std::vector<flexible_type>& key,
+                                 size_t lo, size_t hi) {
+  std::vector<flexible_type> row_key;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    for (const auto& row: source.range_iterator(mid, mid + 1)) {
+      extract_key(row, positions, row_key);
+    }
+    if (compare_sort_keys(row_key, key) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+/**
+ * Reads the rows of a range of a gl_sframe sorted on its key columns,
+ * checking the order as it goes: keys must be non decreasing, and within
+ * [lower, upper) when those are given.
+ */
+class sorted_row_reader {
+ public:
+  sorted_row_reader(gl_sframe_range& range,
+                    const std::vector<size_t>& positions,
+                    const std::vector<flexible_type>* lower,
+                    const std::vector<flexible_type>* upper)
+      : m_iter(range.begin()), m_end(range.end()), m_positions(positions),
+        m_lower(lower), m_upper(upper) {
+    next();
+  }
+
+  bool valid() const { return m_valid; }
+  const std::vector<flexible_type>& row() const { return m_row; }
+  const std::vector<flexible_type>& key() const { return m_key; }
+
+  void next() {
+    m_valid = (m_iter != m_end);
+    if (!m_valid) return;
+    m_row = *m_iter;
+    ++m_iter;
+    m_previous_key.swap(m_key);
+    extract_key(m_row, m_positions, m_key);
+    if ((m_has_previous && compare_sort_keys(m_key, m_previous_key) < 0) ||
+        (m_lower && compare_sort_keys(m_key, *m_lower) < 0) ||
+        (m_upper && compare_sort_keys(m_key, *m_upper) >= 0)) {
+      log_and_throw("gl_sframe must be sorted in ascending order of the key columns");
+    }
+    m_has_previous = true;
+  }
+
+ private:
+  gl_sframe_range::iterator m_iter;
+  gl_sframe_range::iterator m_end;
+  const std::vector<size_t>& m_positions;
+  const std::vector<flexible_type>* m_lower;
+  const std::vector<flexible_type>* m_upper;
+  std::vector<flexible_type> m_row;
+  std::vector<flexible_type> m_key;
+  std::vector<flexible_type> m_previous_key;
+  bool m_valid = false;
+  bool m_has_previous = false;
+};
+
+/**
+ * A group of a sorted groupby: its key and its aggregates.
+ */
+struct sorted_group {
+  std::vector<flexible_type> key;
+  std::vector<std::unique_ptr<group_aggregate_value> > values;
+};
+
+/**
+ * The first and last groups of a segment of a sorted groupby, which may
+ * continue into the neighbouring segments.
+ */
+struct sorted_segment_groups {
+  bool empty = true;
+  /// true if the segment has a single group, its head
+  bool single = true;
+  sorted_group head;
+  sorted_group tail;
+};
+
+} // namespace gl_sframe_impl
+
+/*
+ * Both sides are split into the same key ranges, at the keys found at even
+ * row intervals of the left side, by binary search; the ranges are then
+ * merged in parallel, each into its own writer segment. Each merge buffers
+ * the right rows of one key group at a time.
+ */
+inline gl_sframe gl_sframe::merge_join(const gl_sframe& right,
+                                       const std::map<std::string, std::string>& joinkeys,
+                                       const std::string& how) const {
+  if (how != "inner" && how != "left" && how != "right" && how != "outer") {
+    log_and_throw("Invalid join type \"" + how + "\"");
+  }
+  gl_sframe_impl::join_layout layout(*this, right, joinkeys);
+  const auto& left_key_positions = layout.left_key_positions;
+  const auto& right_key_positions = layout.right_key_positions;
+  bool keep_left = (how == "left" || how == "outer");
+  bool keep_right = (how == "right" || how == "outer");
+
+  gl_sframe left_source(*this), right_source(right);
+  left_source.materialize();
+  right_source.materialize();
+  size_t nleft = left_source.size();
+  size_t nright = right_source.size();
+  size_t nsegments = std::max<size_t>(1, std::min<size_t>(thread::cpu_count(),
+                                                          nleft / 1024));
+
+  // split keys, and the bounds of their ranges on both sides
+  std::vector<std::vector<flexible_type> > splits(nsegments + 1);
+  std::vector<size_t> left_bounds(nsegments + 1, 0), right_bounds(nsegments + 1, 0);
+  left_bounds[nsegments] = nleft;
+  right_bounds[nsegments] = nright;
+  for (size_t segmentid = 1; segmentid < nsegments; ++segmentid) {
+    for (const auto& row: left_source.range_iterator(nleft * segmentid / nsegments,
+                                                     nleft * segmentid / nsegments + 1)) {
+      gl_sframe_impl::extract_key(row, left_key_positions, splits[segmentid]);
+    }
+    // unsorted left rows would give overlapping key ranges
+    if (segmentid > 1 &&
+        gl_sframe_impl::compare_sort_keys(splits[segmentid - 1], splits[segmentid]) > 0) {
+      log_and_throw("gl_sframe must be sorted in ascending order of the key columns");
+    }
+    left_bounds[segmentid] = gl_sframe_impl::sorted_lower_bound(
+        left_source, left_key_positions, splits[segmentid], left_bounds[segmentid - 1], nleft);
+    right_bounds[segmentid] = gl_sframe_impl::sorted_lower_bound(
+        right_source, right_key_positions, splits[segmentid], right_bounds[segmentid - 1], nright);
+  }
+  std::vector<gl_sframe_range> left_ranges, right_ranges;
+  for (size_t segmentid = 0; segmentid < nsegments; ++segmentid) {
+    left_ranges.push_back(left_source.range_iterator(left_bounds[segmentid],
+                                                     left_bounds[segmentid + 1]));
+    right_ranges.push_back(right_source.range_iterator(right_bounds[segmentid],
+                                                       right_bounds[segmentid + 1]));
+  }
+
+  gl_sframe_writer writer(layout.output_names, layout.output_types, nsegments);
+  parallel_for(0, nsegments, [&](size_t segmentid) {
+    const std::vector<flexible_type>* lower = segmentid > 0 ? &splits[segmentid] : nullptr;
+    const std::vector<flexible_type>* upper =
+        segmentid + 1 < nsegments ? &splits[segmentid + 1] : nullptr;
+    gl_sframe_impl::sorted_row_reader left_rows(left_ranges[segmentid], left_key_positions,
+                                                lower, upper);
+    gl_sframe_impl::sorted_row_reader right_rows(right_ranges[segmentid], right_key_positions,
+                                                 lower, upper);
+    std::vector<flexible_type> out;
+    std::vector<flexible_type> group_key;
+    std::vector<std::vector<flexible_type> > group;
+    while (left_rows.valid() || right_rows.valid()) {
+      int c = !left_rows.valid() ? 1 : !right_rows.valid() ? -1 :
+          gl_sframe_impl::compare_sort_keys(left_rows.key(), right_rows.key());
+      if (c < 0) {
+        if (keep_left) {
+          layout.assemble(&left_rows.row(), nullptr, out);
+          writer.write(out, segmentid);
+        }
+        left_rows.next();
+      } else if (c > 0) {
+        if (keep_right) {
+          layout.assemble(nullptr, &right_rows.row(), out);
+          writer.write(out, segmentid);
+        }
+        right_rows.next();
+      } else {
+        group_key = right_rows.key();
+        group.clear();
+        while (right_rows.valid() &&
+               gl_sframe_impl::compare_sort_keys(right_rows.key(), group_key) == 0) {
+          group.push_back(right_rows.row());
+          right_rows.next();
+        }
+        while (left_rows.valid() &&
+               gl_sframe_impl::compare_sort_keys(left_rows.key(), group_key) == 0) {
+          for (const auto& right_row: group) {
+            layout.assemble(&left_rows.row(), &right_row, out);
+            writer.write(out, segmentid);
+          }
+          left_rows.next();
+        }
+      }
+    }
+  });
+  return writer.close();
+}
+
+inline gl_sframe gl_sframe::merge_join(const gl_sframe& right,
+                                       const std::vector<std::string>& joinkeys,
+                                       const std::string& how) const {
+  std::map<std::string, std::string> keys;
+  for (const auto& key: joinkeys) keys[key] = key;
+  return merge_join(right, keys, how);
+}
+
+/*
+ * Rows are split into contiguous segments aggregated in parallel. Each key
+ * group is a run of rows: the groups strictly inside a segment are emitted
+ * as soon as their run ends, into writer segment 2 * segmentid + 1. The
+ * first and last group of each segment may span segments; they are kept
+ * and stitched together in order afterwards, into the even writer
+ * segments between them.
+ */
+inline gl_sframe gl_sframe::sorted_groupby(
+    const std::vector<std::string>& groupkeys,
+    const std::map<std::string, aggregate::groupby_descriptor_type>& operators) const {
+  // columns read: the group keys, then the aggregator inputs
+  std::vector<std::string> columns = groupkeys;
+  auto position_of = [&](const std::string& name) {
+    auto iter = std::find(columns.begin(), columns.end(), name);
+    if (iter != columns.end()) return (size_t)(iter - columns.begin());
+    columns.push_back(name);
+    return columns.size() - 1;
+  };
+  size_t nkeys = groupkeys.size();
+  std::vector<std::string> output_names = groupkeys;
+  std::vector<flex_type_enum> output_types;
+  for (const auto& key: groupkeys) output_types.push_back(select_column(key).dtype());
+  std::vector<std::unique_ptr<group_aggregate_value> > prototypes;
+  std::vector<std::vector<size_t> > input_positions;
+  for (const auto& op: operators) {
+    const auto& desc = op.second;
+    if (desc.m_aggregator == nullptr) log_and_throw("Invalid aggregator for " + op.first);
+    std::vector<flex_type_enum> input_types;
+    std::vector<size_t> positions;
+    for (const auto& column: desc.m_group_columns) {
+      flex_type_enum type = select_column(column).dtype();
+      if (!desc.m_aggregator->support_type(type)) {
+        log_and_throw("Aggregator " + desc.m_aggregator->name() +
+                      " does not support input type " + flex_type_enum_to_name(type));
+      }
+      input_types.push_back(type);
+      positions.push_back(position_of(column));
+    }
+    prototypes.emplace_back(desc.m_aggregator->new_instance());
+    output_types.push_back(prototypes.back()->set_input_types(input_types));
+    output_names.push_back(op.first);
+    input_positions.push_back(positions);
+  }
+  size_t nops = prototypes.size();
+  std::vector<size_t> key_positions(nkeys);
+  for (size_t i = 0; i < nkeys; ++i) key_positions[i] = i;
+
+  gl_sframe source = select_columns(columns);
+  source.materialize();
+  size_t n = source.size();
+  size_t nsegments = thread::cpu_count();
+  gl_sframe_writer writer(output_names, output_types, 2 * nsegments + 1);
+  auto write_group = [&](const gl_sframe_impl::sorted_group& group, size_t segmentid) {
+    std::vector<flexible_type> out(nkeys + nops);
+    std::copy(group.key.begin(), group.key.end(), out.begin());
+    for (size_t op = 0; op < nops; ++op) out[nkeys + op] = group.values[op]->emit();
+    writer.write(out, segmentid);
+  };
+
+  std::vector<gl_sframe_impl::sorted_segment_groups> segments(nsegments);
+  {
+    std::vector<gl_sframe_range> ranges;
+    for (size_t segmentid = 0; segmentid < nsegments; ++segmentid) {
+      ranges.push_back(source.range_iterator(n * segmentid / nsegments,
+                                             n * (segmentid + 1) / nsegments));
+    }
+    parallel_for(0, nsegments, [&](size_t segmentid) {
+      auto& segment = segments[segmentid];
+      gl_sframe_impl::sorted_row_reader rows(ranges[segmentid], key_positions,
+                                             nullptr, nullptr);
+      gl_sframe_impl::sorted_group current;
+      bool is_head = true;
+      std::vector<flexible_type> inputs;
+      while (rows.valid()) {
+        if (segment.empty || gl_sframe_impl::compare_sort_keys(rows.key(), current.key) != 0) {
+          if (!segment.empty) {
+            if (is_head) {
+              segment.head = std::move(current);
+            } else {
+              for (auto& value: current.values) value->partial_finalize();
+              write_group(current, 2 * segmentid + 1);
+            }
+            is_head = false;
+          }
+          current.key = rows.key();
+          current.values.clear();
+          for (const auto& prototype: prototypes) {
+            current.values.emplace_back(prototype->new_instance());
+          }
+          segment.empty = false;
+        }
+        const auto& row = rows.row();
+        for (size_t op = 0; op < nops; ++op) {
+          const auto& positions = input_positions[op];
+          if (positions.size() == 1) {
+            current.values[op]->add_element_simple(row[positions[0]]);
+          } else {
+            inputs.resize(positions.size());
+            for (size_t i = 0; i < positions.size(); ++i) inputs[i] = row[positions[i]];
+            current.values[op]->add_element(inputs);
+          }
+        }
+        rows.next();
+      }
+      if (segment.empty) return;
+      segment.single = is_head;
+      if (is_head) segment.head = std::move(current);
+      else segment.tail = std::move(current);
+      for (auto& value: segment.head.values) value->partial_finalize();
+      for (auto& value: segment.tail.values) value->partial_finalize();
+    });
+  }
+
+  // stitch the groups spanning segment boundaries, in order
+  gl_sframe_impl::sorted_group pending;
+  bool has_pending = false;
+  for (size_t segmentid = 0; segmentid < nsegments; ++segmentid) {
+    auto& segment = segments[segmentid];
+    if (segment.empty) continue;
+    int c = has_pending ? gl_sframe_impl::compare_sort_keys(pending.key, segment.head.key) : -1;
+    if (c > 0) log_and_throw("gl_sframe must be sorted in ascending order of the group keys");
+    if (c == 0) {
+      for (size_t op = 0; op < nops; ++op) {
+        pending.values[op]->combine(*segment.head.values[op]);
+      }
+    } else {
+      if (has_pending) write_group(pending, 2 * segmentid);
+      pending = std::move(segment.head);
+      has_pending = true;
+    }
+    if (!segment.single) {
+      write_group(pending, 2 * segmentid);
+      pending = std::move(segment.tail);
+    }
+  }
+  if (has_pending) write_group(pending, 2 * nsegments);
+  return writer.close();
+}
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,261 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_TIME_SERIES_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_TIME_SERIES_IMPL_HPP
+#include <deque>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/sframe/group_aggregate_value.hpp>
+#include <graphlab/sframe/rolling_aggregate_value.hpp>
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+/**
+ * \internal
+ * Helpers of the ordered (time series) operations of \ref gl_sframe.
+ */
+namespace gl_sframe_impl {
+
+/**
+ * Returns the position of a value of an ordering column (integer, float or
+ * datetime) on a numeric axis. Datetimes are in microseconds since the
+ * epoch, which doubles hold exactly.
+ */
+inline double ordering_key(const flexible_type& value, const std::string& column) {
+  switch(value.get_type()) {
+   case flex_type_enum::INTEGER:
+   case flex_type_enum::FLOAT:
+     return value.to<flex_float>();
+   case flex_type_enum::DATETIME: {
+     const auto& dt = value.get<flex_date_time>();
+     return double(dt.posix_timestamp()) * flex_date_time::MICROSECONDS_PER_SECOND +
+         dt.microsecond();
+   }
+   case flex_type_enum::UNDEFINED:
+     log_and_throw("Column \"" + column + "\" has missing values");
+   default:
+     log_and_throw("Column \"" + column + "\" must be of integer, float or datetime type");
+  }
+}
+
+/**
+ * Converts an offset along an ordering column of the given type to the
+ * axis of ordering_key(). Datetime offsets are in seconds.
+ */
+inline double ordering_offset(double offset, flex_type_enum type) {
+  if (type == flex_type_enum::DATETIME) return offset * flex_date_time::MICROSECONDS_PER_SECOND;
+  return offset;
+}
+
+/**
+ * Throws unless "key", read after "previous", keeps the column sorted.
+ */
+inline void check_sorted(double previous, double key, const std::string& column) {
+  if (key < previous) {
+    log_and_throw("Column \"" + column + "\" must be sorted in ascending order");
+  }
+}
+
+} // namespace gl_sframe_impl
+
+/*
+ * A single pass over (key, value). Rows are buffered from the front of the
+ * window (or the next row to emit, if earlier) to the last row read. A row
+ * is emitted once a row past the end of its window has been read; rows
+ * enter the sliding window as its end reaches them, and leave as its start
+ * passes them.
+ */
+inline gl_sarray gl_sframe::rolling_apply_by_range(
+    const std::string& key_column,
+    const std::string& value_column,
+    std::shared_ptr<group_aggregate_value> aggregator,
+    double range_start,
+    double range_end,
+    size_t min_observations) const {
+  if (range_end < range_start) {
+    log_and_throw("Range end must be greater than or equal to range start");
+  }
+  flex_type_enum key_type = select_column(key_column).dtype();
+  flex_type_enum value_type = select_column(value_column).dtype();
+  if (!aggregator->support_type(value_type)) {
+    log_and_throw("Aggregator " + aggregator->name() +
+                  " does not support input type " + flex_type_enum_to_name(value_type));
+  }
+  flex_type_enum output_type = aggregator->set_input_types({value_type});
+  double start_offset = gl_sframe_impl::ordering_offset(range_start, key_type);
+  double end_offset = gl_sframe_impl::ordering_offset(range_end, key_type);
+
+  gl_sarray_writer writer(output_type, 1);
+  sliding_window_aggregate window(*aggregator);
+  // buffered rows, the first being row "buffer_begin"
+  std::deque<std::pair<double, flexible_type> > buffer;
+  size_t buffer_begin = 0;
+  size_t num_read = 0;
+  size_t next_emit = 0;
+  size_t window_begin = 0;
+  size_t window_end = 0;
+
+  auto emit_row = [&]() {
+    double key = buffer[next_emit - buffer_begin].first;
+    for (; window_end < num_read &&
+         buffer[window_end - buffer_begin].first <= key + end_offset; ++window_end) {
+      window.push_back(buffer[window_end - buffer_begin].second);
+    }
+    for (; window_begin < window_end &&
+         buffer[window_begin - buffer_begin].first < key + start_offset; ++window_begin) {
+      window.pop_front();
+    }
+    // an empty window only passes min_observations = 0
+    if ((min_observations == 0 || window.size() > 0) &&
+        gl_sarray_impl::window_has_min_observations(window.num_non_null(), window.size(),
+                                                    min_observations)) {
+      writer.write(window.emit(), 0);
+    } else {
+      writer.write(FLEX_UNDEFINED, 0);
+    }
+    ++next_emit;
+    size_t keep = std::min(window_begin, next_emit);
+    for (; buffer_begin < keep; ++buffer_begin) buffer.pop_front();
+  };
+
+  gl_sframe source = select_columns({key_column, value_column});
+  for (const auto& row: source.range_iterator()) {
+    double key = gl_sframe_impl::ordering_key(row[0], key_column);
+    if (num_read > 0) gl_sframe_impl::check_sorted(buffer.back().first, key, key_column);
+    buffer.emplace_back(key, row[1]);
+    ++num_read;
+    while (next_emit < num_read &&
+           buffer[next_emit - buffer_begin].first + end_offset < key) {
+      emit_row();
+    }
+  }
+  while (next_emit < num_read) emit_row();
+  return writer.close();
+}
+
+inline gl_sarray gl_sframe::rolling_apply_by_range(
+    const std::string& key_column,
+    const std::string& value_column,
+    const std::string& fn_name,
+    double range_start,
+    double range_end,
+    size_t min_observations) const {
+  return rolling_apply_by_range(key_column, value_column,
+                                rolling_operators::get_builtin_aggregator(fn_name),
+                                range_start, range_end, min_observations);
+}
+
+/*
+ * A single merge pass: for each left row, the right cursor is advanced
+ * over the rows with a key less than or equal to the left key, recording
+ * the last one seen for each value of the "by" columns.
+ */
+inline gl_sframe gl_sframe::asof_join(const gl_sframe& right,
+                                      const std::string& on,
+                                      const std::vector<std::string>& by,
+                                      const std::string& how) const {
+  if (how != "left" && how != "inner") {
+    log_and_throw("Invalid as-of join type " + how + ": must be \"left\" or \"inner\"");
+  }
+  // right columns carried to the output: all but "on" and "by"
+  std::vector<std::string> key_columns = by;
+  key_columns.insert(key_columns.begin(), on);
+  std::vector<std::string> right_values;
+  for (const auto& name: right.column_names()) {
+    if (std::find(key_columns.begin(), key_columns.end(), name) == key_columns.end()) {
+      right_values.push_back(name);
+    }
+  }
+  std::vector<std::string> output_names = column_names();
+  std::vector<flex_type_enum> output_types = column_types();
+  for (const auto& name: right_values) {
+    std::string output_name = name;
+    while (std::find(output_names.begin(), output_names.end(), output_name) != output_names.end()) {
+      output_name += ".1";
+    }
+    output_names.push_back(output_name);
+    output_types.push_back(right.select_column(name).dtype());
+  }
+
+  // right rows are read as [on, by..., carried columns...]
+  std::vector<std::string> right_columns = key_columns;
+  right_columns.insert(right_columns.end(), right_values.begin(), right_values.end());
+  std::vector<size_t> right_key_positions(key_columns.size());
+  for (size_t i = 0; i < key_columns.size(); ++i) right_key_positions[i] = i;
+  std::vector<size_t> left_key_positions;
+  for (const auto& name: key_columns) left_key_positions.push_back(column_index(name));
+  size_t nby = by.size();
+  auto group_of = [nby](const sframe_rows::row& row,
+                        const std::vector<size_t>& positions) -> flexible_type {
+    if (nby == 0) return flex_int(0);
+    if (nby == 1) return row[positions[1]];
+    flex_list key(nby);
+    for (size_t i = 0; i < nby; ++i) key[i] = row[positions[i + 1]];
+    return key;
+  };
+
+  std::unordered_map<flexible_type, std::vector<flexible_type> > latest;
+  gl_sframe right_source = right.select_columns(right_columns);
+  auto right_range = right_source.range_iterator();
+  auto right_iter = right_range.begin();
+  auto right_end = right_range.end();
+  double right_key = 0;
+  bool has_right_key = false;
+  bool right_started = false;
+  double last_right_key = 0;
+
+  gl_sframe_writer writer(output_names, output_types, 1);
+  std::vector<flexible_type> out(output_names.size());
+  size_t nleft = num_columns();
+  size_t on_position = left_key_positions[0];
+  double last_left_key = 0;
+  bool left_started = false;
+  for (const auto& row: range_iterator()) {
+    double key = gl_sframe_impl::ordering_key(row[on_position], on);
+    if (left_started) gl_sframe_impl::check_sorted(last_left_key, key, on);
+    last_left_key = key;
+    left_started = true;
+
+    while (right_iter != right_end) {
+      if (!has_right_key) {
+        right_key = gl_sframe_impl::ordering_key((*right_iter)[0], on);
+        if (right_started) gl_sframe_impl::check_sorted(last_right_key, right_key, on);
+        last_right_key = right_key;
+        right_started = true;
+        has_right_key = true;
+      }
+      if (right_key > key) break;
+      const auto& right_row = *right_iter;
+      auto& values = latest[group_of(right_row, right_key_positions)];
+      values.resize(right_values.size());
+      for (size_t i = 0; i < right_values.size(); ++i) values[i] = right_row[i + 1 + nby];
+      ++right_iter;
+      has_right_key = false;
+    }
+
+    auto match = latest.find(group_of(row, left_key_positions));
+    if (match == latest.end() && how == "inner") continue;
+    for (size_t i = 0; i < nleft; ++i) out[i] = row[i];
+    for (size_t i = 0; i < right_values.size(); ++i) {
+      out[nleft + i] = (match == latest.end()) ? FLEX_UNDEFINED : match->second[i];
+    }
+    writer.write(out, 0);
+  }
+  return writer.close();
+}
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,370 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SFRAME_WINDOW_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SFRAME_WINDOW_IMPL_HPP
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/sframe/group_aggregate_value.hpp>
+#include <graphlab/sframe/rolling_aggregate_value.hpp>
+#include "gl_sarray.hpp"
+#include "gl_sframe.hpp"
+
+namespace graphlab {
+
+namespace aggregate {
+
+/**
+ * \internal
+ * Returns the aggregator of a builtin name, preferring the invertible ones.
+ */
+inline std::shared_ptr<group_aggregate_value> window_aggregator(const std::string& name) {
+  return rolling_operators::get_builtin_aggregator(name);
+}
+
+inline window_descriptor_type CUMULATIVE(std::shared_ptr<group_aggregate_value> aggregator,
+                                         const std::string& col) {
+  window_descriptor_type ret;
+  ret.m_column = col;
+  ret.m_aggregator = aggregator;
+  return ret;
+}
+
+inline window_descriptor_type CUMULATIVE(const std::string& builtin_operator_name,
+                                         const std::string& col) {
+  return CUMULATIVE(window_aggregator(builtin_operator_name), col);
+}
+
+inline window_descriptor_type ROLLING(std::shared_ptr<group_aggregate_value> aggregator,
+                                      const std::string& col,
+                                      ssize_t window_start, ssize_t window_end,
+                                      size_t min_observations) {
+  window_descriptor_type ret;
+  ret.m_column = col;
+  ret.m_aggregator = aggregator;
+  ret.m_cumulative = false;
+  ret.m_window_start = window_start;
+  ret.m_window_end = window_end;
+  ret.m_min_observations = min_observations;
+  return ret;
+}
+
+inline window_descriptor_type ROLLING(const std::string& builtin_operator_name,
+                                      const std::string& col,
+                                      ssize_t window_start, ssize_t window_end,
+                                      size_t min_observations) {
+  return ROLLING(window_aggregator(builtin_operator_name), col,
+                 window_start, window_end, min_observations);
+}
+
+} // namespace aggregate
+
+namespace gl_sframe_impl {
+
+/**
+ * A row of a partitioned window aggregate: its partition and order keys,
+ * the operator input values, and its position in the gl_sframe.
+ */
+struct window_row {
+  flexible_type group;
+  flexible_type order;
+  std::vector<flexible_type> values;
+  size_t row_number;
+};
+
+inline size_t window_row_memory(const window_row& row) {
+  size_t ret = 64 + join_row_memory(row.values);
+  if (row.group.get_type() == flex_type_enum::STRING) ret += row.group.get<flex_string>().size();
+  if (row.group.get_type() == flex_type_enum::LIST) ret += 32 * row.group.get<flex_list>().size();
+  return ret;
+}
+
+/**
+ * Writes buffered window rows to disk by hash partition, in the layout of
+ * a sort_run_file, and clears them.
+ */
+inline sort_run_file spill_window_rows(std::vector<std::vector<window_row> >& buckets) {
+  sort_run_file file;
+  file.filename = sort_run_filename();
+  std::ofstream fout(file.filename, std::ios::binary);
+  if (!fout.good()) log_and_throw("Unable to open window spill file " + file.filename);
+  for (auto& bucket: buckets) {
+    file.offsets.push_back(fout.tellp());
+    file.counts.push_back(bucket.size());
+    oarchive oarc(fout);
+    for (const auto& row: bucket) oarc << row.group << row.order << row.values << row.row_number;
+    fout.flush();
+    std::vector<window_row>().swap(bucket);
+  }
+  if (!fout.good()) log_and_throw("Error writing window spill file " + file.filename);
+  return file;
+}
+
+/**
+ * Appends the rows of one partition of a spill_window_rows() file to rows.
+ */
+inline void read_window_rows(const sort_run_file& file, size_t partition,
+                             std::vector<window_row>& rows) {
+  size_t count = file.counts[partition];
+  if (count == 0) return;
+  std::ifstream fin(file.filename, std::ios::binary);
+  fin.seekg(file.offsets[partition]);
+  iarchive iarc(fin);
+  for (size_t i = 0; i < count; ++i) {
+    window_row row;
+    iarc >> row.group >> row.order >> row.values >> row.row_number;
+    rows.push_back(std::move(row));
+  }
+  if (!fin.good()) log_and_throw("Error reading window spill file " + file.filename);
+}
+
+/**
+ * Computes the window aggregates of the rows of one hash partition, which
+ * are consumed. Rows are grouped on their partition key and each group is
+ * sorted on (order, row number). Returns one record per row, keyed by its
+ * big endian row number and holding its aggregates, sorted on the key.
+ */
+inline std::vector<sort_record> window_partition(
+    std::vector<window_row>& partition_rows,
+    const std::vector<aggregate::window_descriptor_type>& descriptors, bool has_order) {
+  size_t nops = descriptors.size();
+  std::vector<sort_record> results;
+  results.reserve(partition_rows.size());
+  std::unordered_map<flexible_type, std::vector<window_row> > groups;
+  for (auto& entry: partition_rows) groups[entry.group].push_back(std::move(entry));
+  std::vector<window_row>().swap(partition_rows);
+  for (auto& group: groups) {
+    auto& rows = group.second;
+    if (has_order) {
+      std::sort(rows.begin(), rows.end(), [](const window_row& a, const window_row& b) {
+        if (a.order < b.order) return true;
+        if (b.order < a.order) return false;
+        return a.row_number < b.row_number;
+      });
+    } else {
+      std::sort(rows.begin(), rows.end(), [](const window_row& a, const window_row& b) {
+        return a.row_number < b.row_number;
+      });
+    }
+    size_t first = results.size();
+    for (const auto& row: rows) {
+      results.emplace_back();
+      append_big_endian(results.back().key, row.row_number);
+      results.back().values.resize(nops);
+    }
+    ssize_t nrows = rows.size();
+    for (size_t op = 0; op < nops; ++op) {
+      const auto& desc = descriptors[op];
+      if (desc.m_cumulative) {
+        std::unique_ptr<group_aggregate_value> value(desc.m_aggregator->new_instance());
+        bool seen = false;
+        for (ssize_t i = 0; i < nrows; ++i) {
+          const flexible_type& element = rows[i].values[op];
+          if (element.get_type() != flex_type_enum::UNDEFINED) {
+            value->add_element_simple(element);
+            seen = true;
+          }
+          results[first + i].values[op] = seen ? value->emit() : FLEX_UNDEFINED;
+        }
+      } else {
+        ssize_t next = std::max<ssize_t>(0, std::min(nrows, desc.m_window_start));
+        size_t current = first;
+        gl_sarray_impl::rolling_scan(
+            0, nrows, nrows, desc.m_window_start, desc.m_window_end,
+            desc.m_min_observations, *desc.m_aggregator,
+            [&]() { return rows[next++].values[op]; },
+            [&](const flexible_type& value) { results[current++].values[op] = value; });
+      }
+    }
+    std::vector<window_row>().swap(rows);
+  }
+  sort_records(results);
+  return results;
+}
+
+} // namespace gl_sframe_impl
+
+/*
+ * Rows are read in parallel segments and hash partitioned on the group
+ * key, each thread spilling its partitions to disk whenever they outgrow
+ * its share of the memory budget. Partitions, sized so that each fits in
+ * a thread's share, are then processed in parallel: the rows of one
+ * partition are grouped, each group sorted on (order, row number), and one
+ * record of aggregates per row is kept, sorted on the row number and split
+ * by output segment (spilled when the results outgrow half the budget).
+ * Finally each output segment k-way merges the records of its rows from
+ * all partitions, so that the result columns are aligned with the rows.
+ */
+inline gl_sframe gl_sframe::window_aggregate(
+    const std::vector<std::string>& partition_by,
+    const std::string& order_by,
+    const std::map<std::string, aggregate::window_descriptor_type>& operators,
+    size_t memory_budget) const {
+  // columns read, and the positions of the keys and operator inputs in them
+  std::vector<std::string> columns;
+  auto position_of = [&](const std::string& name) {
+    auto iter = std::find(columns.begin(), columns.end(), name);
+    if (iter != columns.end()) return (size_t)(iter - columns.begin());
+    columns.push_back(name);
+    return columns.size() - 1;
+  };
+  std::vector<size_t> partition_positions;
+  for (const auto& name: partition_by) partition_positions.push_back(position_of(name));
+  size_t order_position = order_by.empty() ? 0 : position_of(order_by);
+  std::vector<size_t> value_positions;
+  std::vector<std::string> output_names;
+  std::vector<aggregate::window_descriptor_type> descriptors;
+  std::vector<flex_type_enum> output_types;
+  for (const auto& op: operators) {
+    if (contains_column(op.first)) {
+      log_and_throw("Column \"" + op.first + "\" already exists");
+    }
+    auto desc = op.second;
+    flex_type_enum input_type = select_column(desc.m_column).dtype();
+    desc.m_aggregator.reset(desc.m_aggregator->new_instance());
+    if (desc.m_cumulative) {
+      if (!desc.m_aggregator->support_type(input_type)) {
+        log_and_throw("Aggregator " + desc.m_aggregator->name() +
+                      " does not support input type " + flex_type_enum_to_name(input_type));
+      }
+      output_types.push_back(desc.m_aggregator->set_input_types({input_type}));
+    } else {
+      output_types.push_back(gl_sarray_impl::init_rolling_aggregator(
+          *desc.m_aggregator, input_type, desc.m_window_start, desc.m_window_end));
+    }
+    output_names.push_back(op.first);
+    value_positions.push_back(position_of(desc.m_column));
+    descriptors.push_back(desc);
+  }
+  size_t nops = descriptors.size();
+  size_t npartition_by = partition_by.size();
+  bool has_order = !order_by.empty();
+
+  gl_sframe source = select_columns(columns);
+  source.materialize();
+  size_t n = source.size();
+  size_t nthreads = thread::cpu_count();
+  size_t thread_budget = std::max<size_t>(memory_budget / nthreads, 1024 * 1024);
+  size_t npartitions = std::max<size_t>(
+      4 * nthreads, gl_sframe_impl::estimate_join_memory(source) / thread_budget + 1);
+
+  // hash partition the rows, spilling each thread's buffers over its budget
+  std::vector<std::vector<std::vector<gl_sframe_impl::window_row> > > buckets(
+      nthreads, std::vector<std::vector<gl_sframe_impl::window_row> >(npartitions));
+  std::vector<std::vector<gl_sframe_impl::sort_run_file> > row_files(nthreads);
+  {
+    std::vector<gl_sframe_range> ranges;
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      ranges.push_back(source.range_iterator(n * threadid / nthreads,
+                                             n * (threadid + 1) / nthreads));
+    }
+    parallel_for(0, nthreads, [&](size_t threadid) {
+      size_t row_number = n * threadid / nthreads;
+      size_t bytes = 0;
+      for (const auto& row: ranges[threadid]) {
+        gl_sframe_impl::window_row entry;
+        if (npartition_by == 0) {
+          entry.group = flex_int(0);
+        } else if (npartition_by == 1) {
+          entry.group = row[partition_positions[0]];
+        } else {
+          flex_list key(npartition_by);
+          for (size_t i = 0; i < npartition_by; ++i) key[i] = row[partition_positions[i]];
+          entry.group = key;
+        }
+        if (has_order) entry.order = row[order_position];
+        entry.values.resize(nops);
+        for (size_t i = 0; i < nops; ++i) entry.values[i] = row[value_positions[i]];
+        entry.row_number = row_number++;
+        bytes += gl_sframe_impl::window_row_memory(entry);
+        size_t partition = entry.group.hash() % npartitions;
+        buckets[threadid][partition].push_back(std::move(entry));
+        if (bytes > thread_budget) {
+          row_files[threadid].push_back(gl_sframe_impl::spill_window_rows(buckets[threadid]));
+          bytes = 0;
+        }
+      }
+    });
+  }
+
+  // aggregate each partition into records of results, keyed by row number
+  // and split at the first row of each output segment
+  size_t nsegments = nthreads;
+  std::vector<std::string> splitters(nsegments - 1);
+  for (size_t segmentid = 1; segmentid < nsegments; ++segmentid) {
+    gl_sframe_impl::append_big_endian(splitters[segmentid - 1], n * segmentid / nsegments);
+  }
+  std::vector<std::vector<gl_sframe_impl::sort_record> > results(npartitions);
+  std::vector<std::vector<size_t> > result_bounds(npartitions);
+  std::vector<gl_sframe_impl::sort_run_file> result_files(npartitions);
+  atomic<size_t> resident_bytes;
+  parallel_for(0, npartitions, [&](size_t partition) {
+    std::vector<gl_sframe_impl::window_row> rows;
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      for (const auto& file: row_files[threadid]) {
+        gl_sframe_impl::read_window_rows(file, partition, rows);
+      }
+      auto& bucket = buckets[threadid][partition];
+      std::move(bucket.begin(), bucket.end(), std::back_inserter(rows));
+      std::vector<gl_sframe_impl::window_row>().swap(bucket);
+    }
+    auto records = gl_sframe_impl::window_partition(rows, descriptors, has_order);
+    size_t bytes = 0;
+    for (const auto& record: records) bytes += 32 + gl_sframe_impl::join_row_memory(record.values);
+    if (resident_bytes.inc(bytes) > memory_budget / 2) {
+      resident_bytes.dec(bytes);
+      result_files[partition] = gl_sframe_impl::spill_sort_run(records, splitters);
+    } else {
+      result_bounds[partition] = gl_sframe_impl::sort_run_bounds(records, splitters);
+      results[partition] = std::move(records);
+    }
+  });
+  row_files.clear();
+  buckets.clear();
+
+  // merge the results of each output segment from all partitions, in row order
+  size_t max_fanin = std::max<size_t>(4, 256 / nthreads);
+  gl_sframe_writer writer(output_names, output_types, nsegments);
+  parallel_for(0, nsegments, [&](size_t segmentid) {
+    std::vector<gl_sframe_impl::sort_run_slice> slices;
+    std::vector<std::unique_ptr<gl_sframe_impl::sort_run_cursor> > memory_cursors;
+    for (size_t partition = 0; partition < npartitions; ++partition) {
+      auto& file = result_files[partition];
+      if (!file.filename.empty()) {
+        if (file.counts[segmentid] > 0) slices.push_back({&file, segmentid, false});
+      } else if (!results[partition].empty()) {
+        const auto& bounds = result_bounds[partition];
+        memory_cursors.emplace_back(new gl_sframe_impl::sort_run_cursor(
+            results[partition], bounds[segmentid], bounds[segmentid + 1]));
+      }
+    }
+    gl_sframe_impl::merge_sort_partition(
+        slices, std::move(memory_cursors), max_fanin,
+        [&](const gl_sframe_impl::sort_record& record) { writer.write(record.values, segmentid); });
+  });
+  // the result files are removed with result_files
+  gl_sframe ret(*this);
+  ret.add_columns(writer.close());
+  return ret;
+}
+
+} // namespace graphlab
+
+#endif
@@ -961,6 +961,211 @@ class gl_sgraph {
   gl_sgraph triple_apply(const lambda_triple_apply_fn& lambda,
                          const std::vector<std::string>& mutated_fields) const;
 
+  /**
+   * Schema-compiled version of \ref triple_apply.
+   *
+   * Only the listed vertex and edge fields are loaded, and each field name is
+   * resolved once to an integer slot. The lambda receives a
+   * \ref typed_edge_triple whose source, edge and target are flat arrays of
+   * flexible_type addressed by slot: slot i of source and target is
+   * vertex_fields[i] and slot j of edge is edge_fields[j]. No maps are built
+   * and no field names are looked up while the edges are visited.
+   *
+   * Vertex data of the requested fields is held in memory, and so are the
+   * requested fields of the edges. The source and target ids of the edges
+   * are mapped to dense vertex indices once, as the edges are loaded, and
+   * the edges are then visited in parallel over those indices with the same
+   * source / target locking as \ref triple_apply.
+   *
+   * Example
+   *
+   * \code
+   * enum { PAGERANK = 0, PAGERANK_PREV = 1, TOTAL_WEIGHT = 2 };
+   * enum { WEIGHT = 0 };
+   * auto pr_update = [](typed_edge_triple& triple)->void {
+   *   triple.target_as<flex_float>(PAGERANK) +=
+   *       triple.source_as<flex_float>(PAGERANK_PREV) *
+   *       triple.edge_as<flex_float>(WEIGHT) /
+   *       triple.source_as<flex_float>(TOTAL_WEIGHT);
+   * };
+   * g2 = g2.triple_apply(pr_update, {"pagerank"},
+   *                      {"pagerank", "pagerank_prev", "total_weight"},
+   *                      {"weight"});
+   * \endcode
+   *
+   * ### Reductions
+   *
+   * When the lambda only accumulates into mutated vertex fields, for instance
+   * <code>degree += 1</code> or <code>pagerank += x</code>, the fields can be
+   * declared as commutative reductions (\ref triple_reduction_enum) on
+   * integer, float or vector fields. No vertex locks are taken in that case.
+   * Instead:
+   *  - The lambda sees a private copy of the source and target vertices. A
+   *    reduced field starts at 0 for SUM (a vector of zeros for vector fields),
+   *    and at the value before the triple apply for MIN and MAX. The other
+   *    fields are read only: the copy of a vertex is reused across the edges
+   *    of a worker, and only its reduced fields are reset for each edge.
+   *  - Once the lambda returns, the value left in each reduced field is the
+   *    contribution of the edge, and is folded into the vertex with the
+   *    declared operator. Integer and float fields are folded with atomic
+   *    operations, vector fields into per worker partial buffers which are
+   *    merged at the end.
+   *
+   * \code
+   * auto degree_count_fn = [](typed_edge_triple& triple)->void {
+   *   triple.source_as<flex_int>(0) += 1;
+   *   triple.target_as<flex_int>(0) += 1;
+   * };
+   * g2 = g.triple_apply(degree_count_fn, {"degree"}, {"degree"}, {},
+   *                     {{"degree", triple_reduction_enum::SUM}});
+   * \endcode
+   *
+   * \param lambda The function applied to each edge triple.
+   * \param mutated_fields Fields written back to the graph. Each must be in
+   *    vertex_fields or edge_fields.
+   * \param vertex_fields The vertex fields visible to the lambda, in slot order.
+   * \param edge_fields The edge fields visible to the lambda, in slot order.
+   * \param reductions Optional. The reduction of each mutated vertex field. If
+   *    not empty, every mutated vertex field must have a reduction.
+   *
+   * \note mutated fields must be pre-allocated before triple_apply.
+   *
+   * \see typed_edge_triple
+   * \see lambda_typed_triple_apply_fn
+   */
+  gl_sgraph triple_apply(const lambda_typed_triple_apply_fn& lambda,
+                         const std::vector<std::string>& mutated_fields,
+                         const std::vector<std::string>& vertex_fields,
+                         const std::vector<std::string>& edge_fields
+                             = std::vector<std::string>(),
+                         const std::map<std::string, triple_reduction_enum>& reductions
+                             = std::map<std::string, triple_reduction_enum>()) const;
+
+  /**
+   * Block mode version of \ref triple_apply for numeric fields.
+   *
+   * Instead of being called once per edge, the lambda is called once per
+   * contiguous batch of edges and receives an \ref edge_triple_batch: the
+   * source and target of every edge in the batch as indices of the vertices
+   * the batch references, the requested vertex fields of those vertices as
+   * arrays, and the requested edge fields as arrays indexed by position in
+   * the batch. This allows the update to be written as one tight loop over
+   * the batch.
+   *
+   * No vertex locks are taken. Updates to mutated vertex fields are made
+   * through batch local accumulators which all start from 0. They are added
+   * into one shared accumulator per field after each batch, which is summed
+   * into the vertex field once all edges have been visited:
+   *
+   * \code
+   * INPUT: G
+   * OUTPUT: G'
+   * G' = copy(G)
+   * PARALLEL FOR batch in edges of G':
+   *   lambda(batch) // adds into accumulator[batch]
+   *   accumulator += accumulator[batch]
+   * END PARALLEL FOR
+   * FOR f in mutated vertex fields:
+   *   G'.vertices[f] += accumulator[f]
+   * END FOR
+   * RETURN G'
+   * \endcode
+   *
+   * Mutated edge fields are written back as is.
+   *
+   * Example
+   *
+   * \code
+   * enum { PAGERANK = 0, PAGERANK_PREV = 1, TOTAL_WEIGHT = 2 };
+   * auto pr_update = [](edge_triple_batch& batch)->void {
+   *   const double* prev = batch.vertex_field(PAGERANK_PREV);
+   *   const double* total = batch.vertex_field(TOTAL_WEIGHT);
+   *   const double* weight = batch.edge_field(0);
+   *   double* pagerank = batch.vertex_accumulator(PAGERANK);
+   *   for (size_t i = 0; i < batch.num_edges; ++i) {
+   *     size_t src = batch.source[i];
+   *     pagerank[batch.target[i]] += prev[src] * weight[i] / total[src];
+   *   }
+   * };
+   * g2 = g2.batch_triple_apply(pr_update, {"pagerank"},
+   *                            {"pagerank", "pagerank_prev", "total_weight"},
+   *                            {"weight"});
+   * \endcode
+   *
+   * \param lambda The function applied to each batch of edges.
+   * \param mutated_fields Fields written back to the graph. Each must be in
+   *    vertex_fields or edge_fields.
+   * \param vertex_fields The vertex fields visible to the lambda, in slot order.
+   *    Must be integer or float fields.
+   * \param edge_fields The edge fields visible to the lambda, in slot order.
+   *    Must be integer or float fields.
+   *
+   * Missing values are presented as NaN, and a missing value which is still
+   * NaN when written back stays missing. Integer fields are written back as
+   * integers: an accumulator is rounded and added to the original integer
+   * value, and an edge value the lambda did not change is kept as is, so
+   * integers above 2^53 are not rounded through double.
+   *
+   * \note One accumulator array of num_vertices doubles is held per mutated
+   * vertex field.
+   *
+   * \see edge_triple_batch
+   * \see lambda_batch_triple_apply_fn
+   */
+  gl_sgraph batch_triple_apply(const lambda_batch_triple_apply_fn& lambda,
+                               const std::vector<std::string>& mutated_fields,
+                               const std::vector<std::string>& vertex_fields,
+                               const std::vector<std::string>& edge_fields
+                                   = std::vector<std::string>()) const;
+
+  /**
+   * Schema-compiled triple apply restricted to the edges touching a set of
+   * active vertices.
+   *
+   * Same as the schema-compiled \ref triple_apply, except that the lambda is
+   * only called on the edges selected by "frontier" (see
+   * \ref triple_apply_frontier and \ref frontier_edges_enum). The frontier
+   * is either an explicit list of vertex ids, or is built from the vertex
+   * data as the vertices for which a field moved by more than epsilon from a
+   * reference field.
+   *
+   * When the frontier covers a small fraction of the vertices and no edge
+   * field is mutated, the selected edges are fetched with \ref get_edges
+   * queries on the active vertex ids, so edge data which does not touch the
+   * frontier is not scanned by the triple apply. Otherwise all edges are
+   * loaded and the edges outside of the frontier are skipped (and, when
+   * edges are mutated, keep their values).
+   *
+   * For instance, one iteration of delta pagerank, pushing from the vertices
+   * whose pagerank changed by more than 1E-3 in the previous iteration:
+   * \code
+   * enum { PAGERANK = 0, PAGERANK_PREV = 1, OUT_DEGREE = 2 };
+   * auto push = [](typed_edge_triple& triple) {
+   *   double delta = triple.source_as<flex_float>(PAGERANK)
+   *                  - triple.source_as<flex_float>(PAGERANK_PREV);
+   *   triple.target_as<flex_float>(PAGERANK) +=
+   *       0.85 * delta / triple.source_as<flex_int>(OUT_DEGREE);
+   * };
+   * g2 = g.frontier_triple_apply(push, {"pagerank"},
+   *                              {"pagerank", "pagerank_prev", "out_degree"}, {},
+   *                              triple_apply_frontier::changed("pagerank", "pagerank_prev", 1E-3,
+   *                                                             frontier_edges_enum::SOURCE));
+   * \endcode
+   *
+   * \param lambda The function applied to each selected edge triple.
+   * \param mutated_fields Fields that lambda may modify.
+   * \param vertex_fields Vertex fields presented to lambda, in slot order.
+   * \param edge_fields Edge fields presented to lambda, in slot order.
+   * \param frontier The active vertices and the edges to visit.
+   *
+   * \see triple_apply
+   */
+  gl_sgraph frontier_triple_apply(const lambda_typed_triple_apply_fn& lambda,
+                                  const std::vector<std::string>& mutated_fields,
+                                  const std::vector<std::string>& vertex_fields,
+                                  const std::vector<std::string>& edge_fields,
+                                  const triple_apply_frontier& frontier) const;
+
   /**
    * Save the sgraph into a directory.
    */
@@ -1074,4 +1279,6 @@ class gl_sgraph {
 };
 
 } // namespace graphlab
+
+#include "gl_sgraph_triple_apply_impl.hpp"
 #endif
@@ -0,0 +1,279 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SGRAPH_ADJACENCY_HPP
+#define GRAPHLAB_UNITY_GL_SGRAPH_ADJACENCY_HPP
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include "gl_sframe.hpp"
+#include "gl_sgraph.hpp"
+
+namespace graphlab {
+
+/**
+ * \ingroup group_glsdk
+ * A set of edges relative to a vertex.
+ */
+enum class edge_dir_enum: char {
+  NO_EDGES = 0,  ///< No edges.
+  IN_EDGES = 1,  ///< Edges for which the vertex is the target.
+  OUT_EDGES = 2, ///< Edges for which the vertex is the source.
+  ALL_EDGES = 3  ///< In and out edges.
+};
+
+namespace gl_sgraph_impl {
+
+/// True if "dir" includes the in edges.
+inline bool has_in_edges(edge_dir_enum dir) {
+  return dir == edge_dir_enum::IN_EDGES || dir == edge_dir_enum::ALL_EDGES;
+}
+
+/// True if "dir" includes the out edges.
+inline bool has_out_edges(edge_dir_enum dir) {
+  return dir == edge_dir_enum::OUT_EDGES || dir == edge_dir_enum::ALL_EDGES;
+}
+
+/**
+ * Compressed adjacency of one edge direction: the neighbors of vertex v
+ * are neighbors[offsets[v] .. offsets[v + 1]), reached through edges
+ * edge_ids[offsets[v] .. offsets[v + 1]). Neighbors and edge ids take
+ * 32 bits each unless the graph has 2^32 or more vertices or edges.
+ */
+struct adjacency_index {
+  std::vector<size_t> offsets;
+  compact_id_array neighbors;
+  compact_id_array edge_ids;
+
+  /**
+   * Builds the adjacency from "from" to "to" by a counting sort over
+   * the edge list. IdArray is any array of vertex indices with size()
+   * and operator[].
+   */
+  template <typename IdArray>
+  void build(size_t num_vertices, const IdArray& from, const IdArray& to) {
+    size_t nedges = from.size();
+    offsets.assign(num_vertices + 1, 0);
+    for (size_t eid = 0; eid < nedges; ++eid) ++offsets[from[eid] + 1];
+    for (size_t v = 0; v < num_vertices; ++v) offsets[v + 1] += offsets[v];
+    neighbors.assign(nedges, num_vertices == 0 ? 0 : num_vertices - 1);
+    edge_ids.assign(nedges, nedges == 0 ? 0 : nedges - 1);
+    std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t eid = 0; eid < nedges; ++eid) {
+      size_t pos = cursor[from[eid]]++;
+      neighbors.set(pos, to[eid]);
+      edge_ids.set(pos, eid);
+    }
+  }
+
+  inline bool empty() const { return offsets.empty(); }
+
+  /// Bytes used by the index of a graph of the given size.
+  static size_t estimate_memory(size_t num_vertices, size_t num_edges) {
+    return (num_vertices + 1) * sizeof(size_t) +
+           num_edges * (compact_id_array::value_size(num_vertices) +
+                        compact_id_array::value_size(num_edges));
+  }
+};
+
+} // namespace gl_sgraph_impl
+
+/**
+ * \ingroup group_glsdk
+ * The neighbors of a vertex in a \ref gl_sgraph_adjacency.
+ *
+ * Iterating over the range yields the vertex index of each neighbor;
+ * \ref edge_id(i) is the id of the edge leading to the i-th neighbor.
+ */
+struct neighbor_range {
+  /// Forward iterator over the vertex indices of the neighbors.
+  class iterator {
+   public:
+    iterator(const gl_sgraph_impl::compact_id_array* ids, size_t pos)
+        : m_ids(ids), m_pos(pos) { }
+    inline size_t operator*() const { return (*m_ids)[m_pos]; }
+    inline iterator& operator++() { ++m_pos; return *this; }
+    inline bool operator==(const iterator& other) const { return m_pos == other.m_pos; }
+    inline bool operator!=(const iterator& other) const { return m_pos != other.m_pos; }
+   private:
+    const gl_sgraph_impl::compact_id_array* m_ids;
+    size_t m_pos;
+  };
+
+  const gl_sgraph_impl::compact_id_array* neighbors = NULL;
+  const gl_sgraph_impl::compact_id_array* edges = NULL;
+  /// Position of the first neighbor in neighbors and edges.
+  size_t offset = 0;
+  size_t length = 0;
+
+  inline size_t size() const { return length; }
+  inline bool empty() const { return length == 0; }
+  inline iterator begin() const { return iterator(neighbors, offset); }
+  inline iterator end() const { return iterator(neighbors, offset + length); }
+  /// Vertex index of the i-th neighbor.
+  inline size_t operator[](size_t i) const { return (*neighbors)[offset + i]; }
+  /// Id of the edge leading to the i-th neighbor.
+  inline size_t edge_id(size_t i) const { return (*edges)[offset + i]; }
+};
+
+/**
+ * \ingroup group_glsdk
+ * An opt-in in memory CSR (out edges) / CSC (in edges) index of a
+ * \ref gl_sgraph, for neighbor access in traversals.
+ *
+ * Vertices are renumbered to a dense index in [0, num_vertices()) following
+ * the row order of \ref gl_sgraph::get_vertices; \ref index_of and
+ * \ref vertex_id convert between ids and indices. Edges are numbered by
+ * edge id in [0, num_edges()); the requested edge fields are kept in memory
+ * and read with \ref edge_data.
+ *
+ * The index is built with one scan over the vertex ids and the edges. The
+ * constructor throws if the estimated memory usage (\ref estimate_memory)
+ * exceeds the memory budget.
+ *
+ * \code
+ * gl_sgraph_adjacency adj(g, {"weight"}, edge_dir_enum::OUT_EDGES);
+ *
+ * // breadth first search from vertex 0
+ * std::vector<size_t> dist(adj.num_vertices(), size_t(-1));
+ * std::vector<size_t> frontier{adj.index_of(0)};
+ * dist[frontier[0]] = 0;
+ * while (!frontier.empty()) {
+ *   std::vector<size_t> next;
+ *   for (size_t v: frontier) {
+ *     for (size_t u: adj.out_neighbors(v)) {
+ *       if (dist[u] == size_t(-1)) {
+ *         dist[u] = dist[v] + 1;
+ *         next.push_back(u);
+ *       }
+ *     }
+ *   }
+ *   frontier.swap(next);
+ * }
+ * \endcode
+ */
+class gl_sgraph_adjacency {
+ public:
+  /// Default memory budget of the index, in bytes.
+  static const size_t DEFAULT_MEMORY_BUDGET = size_t(4) << 30;
+
+  /**
+   * Builds the index of a graph.
+   *
+   * \param g The graph.
+   * \param edge_fields Edge fields kept in memory, in slot order.
+   * \param dir The neighbor lists built: OUT_EDGES for \ref out_neighbors,
+   *            IN_EDGES for \ref in_neighbors, ALL_EDGES for both.
+   * \param memory_budget Largest estimated memory usage in bytes.
+   */
+  gl_sgraph_adjacency(const gl_sgraph& g,
+                      const std::vector<std::string>& edge_fields = std::vector<std::string>(),
+                      edge_dir_enum dir = edge_dir_enum::ALL_EDGES,
+                      size_t memory_budget = DEFAULT_MEMORY_BUDGET) {
+    size_t required = estimate_memory(g.num_vertices(), g.num_edges(),
+                                      edge_fields.size(), dir);
+    if (required > memory_budget) {
+      log_and_throw("Adjacency index of the graph requires about " +
+                    std::to_string(required) + " bytes, over the memory budget of " +
+                    std::to_string(memory_budget) + " bytes");
+    }
+    m_vertices = gl_sgraph_impl::vertex_table(g.get_vertices(), {});
+    m_edges = gl_sgraph_impl::edge_table(g.get_edges(), m_vertices, edge_fields);
+    m_edge_fields = edge_fields;
+    if (gl_sgraph_impl::has_out_edges(dir)) {
+      m_out.build(num_vertices(), m_edges.source, m_edges.target);
+    }
+    if (gl_sgraph_impl::has_in_edges(dir)) {
+      m_in.build(num_vertices(), m_edges.target, m_edges.source);
+    }
+  }
+
+  /**
+   * Estimated memory usage in bytes of the index of a graph with the given
+   * number of vertices, edges and edge fields.
+   */
+  static size_t estimate_memory(size_t num_vertices, size_t num_edges,
+                                size_t num_edge_fields, edge_dir_enum dir) {
+    // vertex ids, and a hash table entry per vertex id
+    size_t ret = num_vertices * (2 * sizeof(flexible_type) + 4 * sizeof(size_t));
+    // endpoints and fields of each edge
+    ret += num_edges * (2 * gl_sgraph_impl::compact_id_array::value_size(num_vertices) +
+                        num_edge_fields * sizeof(flexible_type));
+    size_t ndirections = gl_sgraph_impl::has_in_edges(dir) + gl_sgraph_impl::has_out_edges(dir);
+    ret += ndirections * gl_sgraph_impl::adjacency_index::estimate_memory(num_vertices, num_edges);
+    return ret;
+  }
+
+  /// Number of vertices.
+  inline size_t num_vertices() const { return m_vertices.num_vertices(); }
+
+  /// Number of edges.
+  inline size_t num_edges() const { return m_edges.num_edges(); }
+
+  /// Returns the index of a vertex id. Throws if the vertex does not exist.
+  inline size_t index_of(const flexible_type& vid) const { return m_vertices.index_of(vid); }
+
+  /// Returns the id of a vertex index.
+  inline const flexible_type& vertex_id(size_t v) const { return m_vertices.ids()[v]; }
+
+  /// Out neighbors of a vertex index. Requires OUT_EDGES.
+  inline neighbor_range out_neighbors(size_t v) const {
+    if (m_out.empty()) log_and_throw("The adjacency index was built without out edges");
+    return range(m_out, v);
+  }
+
+  /// In neighbors of a vertex index. Requires IN_EDGES.
+  inline neighbor_range in_neighbors(size_t v) const {
+    if (m_in.empty()) log_and_throw("The adjacency index was built without in edges");
+    return range(m_in, v);
+  }
+
+  /// Number of out edges of a vertex index. Requires OUT_EDGES.
+  inline size_t out_degree(size_t v) const { return out_neighbors(v).size(); }
+
+  /// Number of in edges of a vertex index. Requires IN_EDGES.
+  inline size_t in_degree(size_t v) const { return in_neighbors(v).size(); }
+
+  /// Vertex index of the source of an edge.
+  inline size_t edge_source(size_t eid) const { return m_edges.source[eid]; }
+
+  /// Vertex index of the target of an edge.
+  inline size_t edge_target(size_t eid) const { return m_edges.target[eid]; }
+
+  /// Names of the edge fields kept in memory, in slot order.
+  inline const std::vector<std::string>& edge_fields() const { return m_edge_fields; }
+
+  /// Fields of an edge as a flat array addressed by slot.
+  inline const flexible_type* edge_data(size_t eid) const { return m_edges.row(eid); }
+
+ private:
+  static neighbor_range range(const gl_sgraph_impl::adjacency_index& index, size_t v) {
+    neighbor_range ret;
+    ret.neighbors = &index.neighbors;
+    ret.edges = &index.edge_ids;
+    ret.offset = index.offsets[v];
+    ret.length = index.offsets[v + 1] - ret.offset;
+    return ret;
+  }
+
+  gl_sgraph_impl::vertex_table m_vertices;
+  gl_sgraph_impl::edge_table m_edges;
+  gl_sgraph_impl::adjacency_index m_out, m_in;
+  std::vector<std::string> m_edge_fields;
+};
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,275 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SGRAPH_ENGINE_HPP
+#define GRAPHLAB_UNITY_GL_SGRAPH_ENGINE_HPP
+#include <string>
+#include <vector>
+#include <limits>
+#include <functional>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include "gl_sframe.hpp"
+#include "gl_sgraph.hpp"
+#include "gl_sgraph_adjacency.hpp"
+
+namespace graphlab {
+
+/**
+ * \ingroup group_glsdk
+ * The set of edges a phase of a \ref gas_vertex_program is applied to,
+ * relative to the vertex being updated.
+ */
+typedef edge_dir_enum gas_edge_dir_enum;
+
+/**
+ * \ingroup group_glsdk
+ * A Gather-Apply-Scatter vertex program executed by \ref gl_sgraph_engine.
+ *
+ * Vertex and edge data are flat arrays addressed by the slot of the field
+ * in the field lists the engine was created with.
+ *
+ * For each active vertex, in one iteration:
+ *  - gather is called on every edge in gather_edges. The results are
+ *    summed with flexible_type::operator+=.
+ *  - apply is called with the sum (UNDEFINED if no edge was gathered),
+ *    and updates the vertex. It returns true if the vertex changed enough
+ *    for its neighbors to be scheduled again.
+ *  - if apply returned true, scatter is called on every edge in
+ *    scatter_edges and the neighbor is activated for the next iteration
+ *    when it returns true. If scatter is not set, all neighbors are
+ *    activated.
+ *
+ * The engine is synchronous: all gathers of an iteration see the vertex
+ * data of the previous iteration. Edge data is read only.
+ */
+struct gas_vertex_program {
+  /// (vertex, edge, other vertex) -> contribution to the vertex.
+  typedef std::function<flexible_type(const flexible_type*, const flexible_type*,
+                                      const flexible_type*)> gather_fn_type;
+  /// (vertex, gathered sum) -> true if the vertex changed.
+  typedef std::function<bool(flexible_type*, const flexible_type&)> apply_fn_type;
+  /// (vertex, edge, other vertex) -> true to activate the other vertex.
+  typedef std::function<bool(const flexible_type*, const flexible_type*,
+                             const flexible_type*)> scatter_fn_type;
+
+  gas_edge_dir_enum gather_edges = gas_edge_dir_enum::IN_EDGES;
+  gather_fn_type gather;
+  apply_fn_type apply;
+  gas_edge_dir_enum scatter_edges = gas_edge_dir_enum::OUT_EDGES;
+  scatter_fn_type scatter;
+};
+
+/**
+ * \ingroup group_glsdk
+ * An in memory iterative graph engine over a \ref gl_sgraph.
+ *
+ * The engine loads the requested vertex and edge fields once, keeps the
+ * vertex data in memory across iterations and schedules vertices with
+ * an active set. Running many iterations therefore does not create any
+ * intermediate \ref gl_sframe or \ref gl_sgraph; the vertex data is
+ * written out only when \ref result is called.
+ *
+ * Memory usage is one flexible_type per requested vertex and edge field,
+ * plus about four words per edge and direction used by the program.
+ *
+ * For instance, the following code runs pagerank until no vertex changes
+ * by more than 1E-3.
+ * \code
+ * // vertex slots
+ * enum { PAGERANK = 0, OUT_DEGREE = 1 };
+ *
+ * gas_vertex_program pr;
+ * pr.gather_edges = gas_edge_dir_enum::IN_EDGES;
+ * pr.gather = [](const flexible_type* v, const flexible_type* e,
+ *                const flexible_type* src) -> flexible_type {
+ *   return src[PAGERANK].get<flex_float>() / src[OUT_DEGREE].get<flex_int>();
+ * };
+ * pr.apply = [](flexible_type* v, const flexible_type& total) {
+ *   double sum = total.get_type() == flex_type_enum::UNDEFINED ? 0.0 : (double)total;
+ *   double newval = 0.15 + 0.85 * sum;
+ *   bool changed = std::fabs(newval - v[PAGERANK].get<flex_float>()) > 1E-3;
+ *   v[PAGERANK] = newval;
+ *   return changed;
+ * };
+ * pr.scatter_edges = gas_edge_dir_enum::OUT_EDGES;
+ *
+ * gl_sgraph_engine engine(g, {"pagerank", "out_degree"});
+ * engine.run(pr, 50);
+ * gl_sgraph g2 = engine.result({"pagerank"});
+ * \endcode
+ */
+class gl_sgraph_engine {
+ public:
+  /**
+   * Loads "vertex_fields" and "edge_fields" of a graph.
+   * All vertices start active.
+   */
+  gl_sgraph_engine(const gl_sgraph& g,
+                   const std::vector<std::string>& vertex_fields,
+                   const std::vector<std::string>& edge_fields = std::vector<std::string>())
+      : m_graph(g),
+        m_vertices(g.get_vertices(), vertex_fields),
+        m_edges(g.get_edges(), m_vertices, edge_fields),
+        m_active(m_vertices.num_vertices()),
+        m_next_active(m_vertices.num_vertices()) {
+    m_active.fill();
+  }
+
+  /// Number of vertices in the graph.
+  size_t num_vertices() const { return m_vertices.num_vertices(); }
+
+  /// Number of edges in the graph.
+  size_t num_edges() const { return m_edges.num_edges(); }
+
+  /// Number of vertices scheduled for the next iteration.
+  size_t num_active_vertices() const { return m_active.popcount(); }
+
+  /// True when no vertex is scheduled.
+  bool converged() const { return m_active.empty(); }
+
+  /// Total number of iterations executed by \ref run.
+  size_t num_iterations() const { return m_num_iterations; }
+
+  /// Schedules all the vertices.
+  void signal_all() { m_active.fill(); }
+
+  /// Schedules one vertex. Throws if the vertex does not exist.
+  void signal(const flexible_type& vid) {
+    m_active.set_bit(m_vertices.index_of(vid));
+  }
+
+  /// Unschedules all the vertices.
+  void clear_signals() { m_active.clear(); }
+
+  /// Returns the in memory value of a vertex field.
+  const flexible_type& get_vertex_field(const flexible_type& vid,
+                                        const std::string& field) const {
+    size_t slot = gl_sgraph_impl::resolve_fields({field}, m_vertices.fields(), "Vertex")[0];
+    return m_vertices.row(m_vertices.index_of(vid))[slot];
+  }
+
+  /**
+   * Runs the vertex program until no vertex is active or max_iterations
+   * iterations have been executed. Returns the number of iterations
+   * executed.
+   */
+  size_t run(const gas_vertex_program& program,
+             size_t max_iterations = std::numeric_limits<size_t>::max()) {
+    if (!program.apply) log_and_throw("gas_vertex_program::apply must be set");
+    if (program.gather_edges != gas_edge_dir_enum::NO_EDGES && !program.gather) {
+      log_and_throw("gas_vertex_program::gather must be set to gather over edges");
+    }
+    prepare_adjacency(program.gather_edges);
+    prepare_adjacency(program.scatter_edges);
+
+    size_t nvertices = num_vertices();
+    std::vector<flexible_type> gathered(nvertices);
+    std::vector<size_t> active_list;
+    std::vector<char> changed(nvertices, 0);
+    size_t iter = 0;
+    for (; iter < max_iterations && !m_active.empty(); ++iter) {
+      active_list.assign(m_active.begin(), m_active.end());
+      size_t nactive = active_list.size();
+
+      // gather over the data of the previous iteration
+      if (program.gather_edges != gas_edge_dir_enum::NO_EDGES) {
+        parallel_for(0, nactive, [&](size_t i) {
+          size_t v = active_list[i];
+          flexible_type acc;
+          visit_edges(program.gather_edges, v,
+                      [&](size_t eid, size_t other) {
+                        flexible_type value = program.gather(m_vertices.row(v),
+                                                             m_edges.row(eid),
+                                                             m_vertices.row(other));
+                        if (acc.get_type() == flex_type_enum::UNDEFINED) acc = std::move(value);
+                        else acc += value;
+                      });
+          gathered[v] = std::move(acc);
+        });
+      }
+
+      parallel_for(0, nactive, [&](size_t i) {
+        size_t v = active_list[i];
+        changed[v] = program.apply(m_vertices.row(v), gathered[v]);
+        gathered[v] = FLEX_UNDEFINED;
+      });
+
+      m_next_active.clear();
+      if (program.scatter_edges != gas_edge_dir_enum::NO_EDGES) {
+        parallel_for(0, nactive, [&](size_t i) {
+          size_t v = active_list[i];
+          if (!changed[v]) return;
+          visit_edges(program.scatter_edges, v,
+                      [&](size_t eid, size_t other) {
+                        if (!program.scatter ||
+                            program.scatter(m_vertices.row(v), m_edges.row(eid),
+                                            m_vertices.row(other))) {
+                          m_next_active.set_bit(other);
+                        }
+                      });
+        });
+      }
+      m_active = m_next_active;
+    }
+    m_num_iterations += iter;
+    return iter;
+  }
+
+  /**
+   * Returns the graph with the in memory vertex data written out.
+   * If "fields" is empty all the loaded vertex fields are written.
+   */
+  gl_sgraph result(const std::vector<std::string>& fields = std::vector<std::string>()) const {
+    gl_sframe vertices = m_graph.get_vertices();
+    const auto& out_fields = fields.empty() ? m_vertices.fields() : fields;
+    for (size_t slot: gl_sgraph_impl::resolve_fields(out_fields, m_vertices.fields(), "Vertex")) {
+      vertices.replace_add_column(m_vertices.column(slot), m_vertices.fields()[slot]);
+    }
+    return gl_sgraph(vertices, m_graph.get_edges());
+  }
+
+ private:
+  void prepare_adjacency(gas_edge_dir_enum dir) {
+    if (gl_sgraph_impl::has_in_edges(dir) && m_in.empty()) {
+      m_in.build(num_vertices(), m_edges.target, m_edges.source);
+    }
+    if (gl_sgraph_impl::has_out_edges(dir) && m_out.empty()) {
+      m_out.build(num_vertices(), m_edges.source, m_edges.target);
+    }
+  }
+
+  /// Calls fn(edge id, neighbor) on the edges of v in the given direction.
+  template <typename Fn>
+  void visit_edges(gas_edge_dir_enum dir, size_t v, const Fn& fn) const {
+    if (gl_sgraph_impl::has_in_edges(dir)) {
+      for (size_t i = m_in.offsets[v]; i < m_in.offsets[v + 1]; ++i) {
+        fn(m_in.edge_ids[i], m_in.neighbors[i]);
+      }
+    }
+    if (gl_sgraph_impl::has_out_edges(dir)) {
+      for (size_t i = m_out.offsets[v]; i < m_out.offsets[v + 1]; ++i) {
+        fn(m_out.edge_ids[i], m_out.neighbors[i]);
+      }
+    }
+  }
+
+  gl_sgraph m_graph;
+  gl_sgraph_impl::vertex_table m_vertices;
+  gl_sgraph_impl::edge_table m_edges;
+  gl_sgraph_impl::adjacency_index m_in, m_out;
+  dense_bitset m_active, m_next_active;
+  size_t m_num_iterations = 0;
+};
+
+} // namespace graphlab
+
+#endif
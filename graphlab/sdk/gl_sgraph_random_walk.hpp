@@ -0,0 +1,352 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SGRAPH_RANDOM_WALK_HPP
+#define GRAPHLAB_UNITY_GL_SGRAPH_RANDOM_WALK_HPP
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <random>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include "gl_sarray.hpp"
+#include "gl_sgraph.hpp"
+#include "gl_sgraph_adjacency.hpp"
+
+namespace graphlab {
+
+/**
+ * \ingroup group_glsdk
+ * Parallel random walk and neighbor sampling over a \ref gl_sgraph.
+ *
+ * On construction the graph is loaded into an in memory adjacency (see
+ * \ref gl_sgraph_adjacency) where the neighbors of each vertex are sorted
+ * by vertex index. When a weight field is given, an alias table is built
+ * for every vertex over the weights of its edges, so drawing the next step
+ * of a walk is O(1) whatever the degree.
+ *
+ * Three kinds of walks are supported:
+ *  - uniform: no weight field, p = q = 1.
+ *  - edge weighted: a weight field, p = q = 1. The next vertex is drawn
+ *    with probability proportional to the weight of the edge.
+ *  - node2vec: p != 1 or q != 1. The weight of the edge to x is multiplied
+ *    by 1/p if x is the previous vertex, by 1 if x is a neighbor of the
+ *    previous vertex and by 1/q otherwise. Steps are drawn from the first
+ *    order distribution and accepted with probability bias / max(bias), so
+ *    no second order tables are built.
+ *
+ * Walks and samples are written into a \ref gl_sarray of lists of vertex ids
+ * through a \ref gl_sarray_writer, one segment per worker. A walk stops early
+ * at a vertex without neighbors.
+ *
+ * \code
+ * gl_sgraph_random_walker walker(g, "weight", edge_dir_enum::ALL_EDGES);
+ * // 10 walks of 80 vertices from every vertex, for embedding training
+ * gl_sarray walks = walker.random_walks(80, 10, 1.0, 0.5);
+ * // 25 neighbors of each vertex of a batch
+ * gl_sarray neighbors = walker.sample_neighbors(batch["__id"], 25);
+ * \endcode
+ *
+ * Each writer segment draws from its own std::mt19937_64, seeded with the
+ * seed plus the segment id, so results are reproducible for a given seed
+ * and number of writer segments, and the global random source is left
+ * untouched.
+ */
+class gl_sgraph_random_walker {
+ public:
+  /**
+   * Loads the adjacency of a graph.
+   *
+   * \param g The graph.
+   * \param weight_field An integer or float edge field holding non negative
+   *                     edge weights. Missing weights are 0. Empty for
+   *                     uniform walks.
+   * \param dir The edges followed from a vertex. ALL_EDGES walks the graph as
+   *            undirected.
+   * \param memory_budget Largest estimated memory usage in bytes of the
+   *                      adjacency (see \ref gl_sgraph_adjacency) and of the
+   *                      merged neighbor lists and alias tables, which are
+   *                      both held while the lists are merged.
+   */
+  gl_sgraph_random_walker(const gl_sgraph& g,
+                          const std::string& weight_field = "",
+                          edge_dir_enum dir = edge_dir_enum::OUT_EDGES,
+                          size_t memory_budget = gl_sgraph_adjacency::DEFAULT_MEMORY_BUDGET) {
+    if (dir == edge_dir_enum::NO_EDGES) log_and_throw("Walks must follow some edges");
+    std::vector<std::string> edge_fields;
+    if (!weight_field.empty()) edge_fields.push_back(weight_field);
+    size_t required = gl_sgraph_adjacency::estimate_memory(g.num_vertices(), g.num_edges(),
+                                                           edge_fields.size(), dir) +
+                      estimate_memory(g.num_vertices(), g.num_edges(), dir, !weight_field.empty());
+    if (required > memory_budget) {
+      log_and_throw("Random walks over the graph require about " +
+                    std::to_string(required) + " bytes, over the memory budget of " +
+                    std::to_string(memory_budget) + " bytes");
+    }
+    gl_sgraph_adjacency adj(g, edge_fields, dir, memory_budget);
+    m_ids.resize(adj.num_vertices());
+    for (size_t v = 0; v < adj.num_vertices(); ++v) {
+      m_ids[v] = adj.vertex_id(v);
+      m_index[m_ids[v]] = v;
+    }
+    build(adj, dir, !weight_field.empty());
+  }
+
+  /**
+   * Estimated memory usage in bytes of the walker of a graph with the given
+   * number of vertices and edges, besides the adjacency it is built from.
+   */
+  static size_t estimate_memory(size_t num_vertices, size_t num_edges,
+                                edge_dir_enum dir, bool weighted) {
+    // vertex ids, a hash table entry per vertex id, offsets and dead ends
+    size_t ret = num_vertices * (3 * sizeof(flexible_type) + 4 * sizeof(size_t) + 1);
+    // a neighbor, and its alias table entry when weighted, per edge and direction
+    size_t ndirections = gl_sgraph_impl::has_in_edges(dir) + gl_sgraph_impl::has_out_edges(dir);
+    ret += ndirections * num_edges *
+           (sizeof(size_t) + (weighted ? sizeof(double) + sizeof(size_t) : 0));
+    return ret;
+  }
+
+  /// Number of vertices.
+  inline size_t num_vertices() const { return m_ids.size(); }
+
+  /**
+   * Draws walks_per_vertex walks of (at most) walk_length vertices starting
+   * from each vertex. Returns a list typed \ref gl_sarray of walks, each a
+   * list of vertex ids starting with the start vertex.
+   *
+   * \param walk_length Number of vertices in a walk, including the start.
+   * \param walks_per_vertex Number of walks started from each vertex.
+   * \param p node2vec return parameter.
+   * \param q node2vec in-out parameter.
+   * \param seed Seed of the random number generators.
+   */
+  gl_sarray random_walks(size_t walk_length, size_t walks_per_vertex = 1,
+                         double p = 1.0, double q = 1.0, size_t seed = 0) {
+    if (p <= 0 || q <= 0) log_and_throw("node2vec parameters p and q must be positive");
+    bool biased = p != 1.0 || q != 1.0;
+    double max_bias = std::max(1.0, std::max(1.0 / p, 1.0 / q));
+    size_t nwalks = walks_per_vertex * num_vertices();
+
+    return write_lists(nwalks, seed, [&](size_t walkid, flex_list& walk, std::mt19937_64& gen) {
+      size_t v = walkid % num_vertices();
+      size_t prev = size_t(-1);
+      walk.push_back(m_ids[v]);
+      while (walk.size() < walk_length && can_step(v)) {
+        size_t next = draw_neighbor(v, gen);
+        if (biased && prev != size_t(-1)) {
+          while (true) {
+            double bias = next == prev ? 1.0 / p : (is_neighbor(prev, next) ? 1.0 : 1.0 / q);
+            if (rand01(gen) * max_bias < bias) break;
+            next = draw_neighbor(v, gen);
+          }
+        }
+        prev = v;
+        v = next;
+        walk.push_back(m_ids[v]);
+      }
+    });
+  }
+
+  /**
+   * Samples a fixed number of neighbors of each vertex of "vertices".
+   * Returns a list typed \ref gl_sarray aligned with "vertices".
+   *
+   * Without replacement, all the neighbors are returned when a vertex has
+   * at most fanout neighbors, and otherwise fanout distinct neighbors drawn
+   * uniformly (weights are ignored). With replacement, fanout neighbors are
+   * drawn with the walk distribution, or none for a vertex without neighbors.
+   *
+   * \param vertices Ids of the vertices.
+   * \param fanout Number of neighbors per vertex.
+   * \param with_replacement Whether a neighbor can be drawn more than once.
+   * \param seed Seed of the random number generators.
+   */
+  gl_sarray sample_neighbors(const gl_sarray& vertices, size_t fanout,
+                             bool with_replacement = false, size_t seed = 0) {
+    std::vector<size_t> sources;
+    sources.reserve(vertices.size());
+    for (const auto& vid: vertices.range_iterator()) sources.push_back(index_of(vid));
+
+    return write_lists(sources.size(), seed, [&](size_t i, flex_list& out, std::mt19937_64& gen) {
+      size_t v = sources[i];
+      size_t deg = degree(v);
+      if (with_replacement) {
+        if (!can_step(v)) return;
+        for (size_t k = 0; k < fanout; ++k) out.push_back(m_ids[draw_neighbor(v, gen)]);
+      } else if (deg <= fanout) {
+        for (size_t k = 0; k < deg; ++k) out.push_back(m_ids[m_neighbors[m_offsets[v] + k]]);
+      } else {
+        // Floyd's algorithm: fanout distinct positions in [0, deg)
+        std::vector<size_t> picked;
+        for (size_t j = deg - fanout; j < deg; ++j) {
+          size_t k = std::uniform_int_distribution<size_t>(0, j)(gen);
+          if (std::find(picked.begin(), picked.end(), k) != picked.end()) k = j;
+          picked.push_back(k);
+        }
+        for (size_t k: picked) out.push_back(m_ids[m_neighbors[m_offsets[v] + k]]);
+      }
+    });
+  }
+
+ private:
+  /**
+   * Merges the neighbor lists of "dir" into one list per vertex sorted by
+   * neighbor index, and builds the alias tables over the weights, aligned
+   * with the neighbor lists.
+   */
+  void build(const gl_sgraph_adjacency& adj, edge_dir_enum dir, bool weighted) {
+    size_t nvertices = adj.num_vertices();
+    bool in = gl_sgraph_impl::has_in_edges(dir);
+    bool out = gl_sgraph_impl::has_out_edges(dir);
+    m_offsets.assign(nvertices + 1, 0);
+    for (size_t v = 0; v < nvertices; ++v) {
+      m_offsets[v + 1] = m_offsets[v] + (out ? adj.out_degree(v) : 0) +
+                         (in ? adj.in_degree(v) : 0);
+    }
+    m_neighbors.resize(m_offsets[nvertices]);
+    if (weighted) {
+      m_alias_probability.resize(m_offsets[nvertices]);
+      m_alias.resize(m_offsets[nvertices]);
+      m_can_step.assign(nvertices, 0);
+    }
+
+    parallel_for(0, nvertices, [&](size_t v) {
+      std::vector<std::pair<size_t, double> > adjacent;
+      auto add = [&](const neighbor_range& range) {
+        for (size_t i = 0; i < range.size(); ++i) {
+          double w = 1.0;
+          if (weighted) {
+            w = gl_sgraph_impl::numeric_value(adj.edge_data(range.edge_id(i))[0]);
+            if (std::isnan(w)) w = 0;
+            if (w < 0) log_and_throw("Edge weights must be non negative");
+          }
+          adjacent.push_back({range[i], w});
+        }
+      };
+      if (out) add(adj.out_neighbors(v));
+      if (in) add(adj.in_neighbors(v));
+      std::sort(adjacent.begin(), adjacent.end());
+
+      size_t begin = m_offsets[v];
+      double total = 0;
+      for (size_t i = 0; i < adjacent.size(); ++i) {
+        m_neighbors[begin + i] = adjacent[i].first;
+        if (weighted) m_alias_probability[begin + i] = adjacent[i].second;
+        total += adjacent[i].second;
+      }
+      // a vertex whose edges all have a zero weight is a dead end
+      if (weighted && total > 0) {
+        build_alias_table(&m_alias_probability[begin], &m_alias[begin], adjacent.size(), total);
+        m_can_step[v] = 1;
+      }
+    });
+  }
+
+  /**
+   * Turns the n weights at "probability", of sum "total", into an alias
+   * table (Vose's method): outcome k is kept with probability[k], and
+   * replaced by alias[k] otherwise.
+   */
+  static void build_alias_table(double* probability, size_t* alias, size_t n, double total) {
+    std::vector<size_t> small, large;
+    for (size_t k = 0; k < n; ++k) {
+      probability[k] *= n / total;
+      alias[k] = k;
+      (probability[k] < 1.0 ? small : large).push_back(k);
+    }
+    while (!small.empty() && !large.empty()) {
+      size_t s = small.back(), l = large.back();
+      small.pop_back();
+      alias[s] = l;
+      probability[l] -= 1.0 - probability[s];
+      if (probability[l] < 1.0) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    // left over by rounding
+    for (size_t k: large) probability[k] = 1.0;
+    for (size_t k: small) probability[k] = 1.0;
+  }
+
+  static inline double rand01(std::mt19937_64& gen) {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+  }
+
+  inline size_t degree(size_t v) const {
+    return m_offsets[v + 1] - m_offsets[v];
+  }
+
+  /// True if a walk can leave v.
+  inline bool can_step(size_t v) const {
+    return m_can_step.empty() ? degree(v) > 0 : m_can_step[v] != 0;
+  }
+
+  inline size_t draw_neighbor(size_t v, std::mt19937_64& gen) const {
+    size_t begin = m_offsets[v];
+    size_t k = std::uniform_int_distribution<size_t>(0, degree(v) - 1)(gen);
+    if (!m_alias.empty() && rand01(gen) >= m_alias_probability[begin + k]) {
+      k = m_alias[begin + k];
+    }
+    return m_neighbors[begin + k];
+  }
+
+  /// True if x is a neighbor of t, by binary search in the sorted neighbors of t.
+  inline bool is_neighbor(size_t t, size_t x) const {
+    return std::binary_search(m_neighbors.begin() + m_offsets[t],
+                              m_neighbors.begin() + m_offsets[t + 1], x);
+  }
+
+  size_t index_of(const flexible_type& vid) const {
+    auto iter = m_index.find(vid);
+    if (iter == m_index.end()) {
+      log_and_throw("Vertex " + std::string(vid) + " does not exist");
+    }
+    return iter->second;
+  }
+
+  /**
+   * Writes n lists produced by fn(i, list, generator) into a list typed
+   * gl_sarray, one writer segment per worker, each with its own generator.
+   */
+  template <typename Fn>
+  gl_sarray write_lists(size_t n, size_t seed, const Fn& fn) {
+    gl_sarray_writer writer(flex_type_enum::LIST);
+    size_t nsegments = writer.num_segments();
+    parallel_for(0, nsegments, [&](size_t segmentid) {
+      std::mt19937_64 gen(seed + segmentid);
+      auto range = gl_sgraph_impl::segment_range(n, nsegments, segmentid);
+      flex_list out;
+      for (size_t i = range.first; i < range.second; ++i) {
+        out.clear();
+        fn(i, out, gen);
+        writer.write(out, segmentid);
+      }
+    });
+    return writer.close();
+  }
+
+  std::vector<flexible_type> m_ids;
+  std::unordered_map<flexible_type, size_t> m_index;
+  std::vector<size_t> m_offsets;
+  std::vector<size_t> m_neighbors;
+  /// Alias tables over the edge weights of each vertex, aligned with
+  /// m_neighbors, when weighted.
+  std::vector<double> m_alias_probability;
+  std::vector<size_t> m_alias;
+  /// Whether a vertex has an edge of non zero weight, when weighted.
+  std::vector<char> m_can_step;
+};
+
+} // namespace graphlab
+
+#endif
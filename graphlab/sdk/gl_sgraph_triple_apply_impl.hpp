@@ -0,0 +1,1102 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UNITY_GL_SGRAPH_TRIPLE_APPLY_IMPL_HPP
+#define GRAPHLAB_UNITY_GL_SGRAPH_TRIPLE_APPLY_IMPL_HPP
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <map>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/atomic_ops.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/lambda_omp.hpp>
+#include <graphlab/sgraph/sgraph_constants.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/unity/lib/sgraph_triple_apply_typedefs.hpp>
+#include "gl_sarray.hpp"
+#include "gl_sframe.hpp"
+#include "gl_sgraph.hpp"
+
+namespace graphlab {
+
+/**
+ * \internal
+ * Building blocks shared by the native (in process) graph computation
+ * paths of \ref gl_sgraph.
+ */
+namespace gl_sgraph_impl {
+
+/// Name of the vertex id column of the vertex data.
+static const char* const VID_COLUMN = "__id";
+/// Name of the source id column of the edge data.
+static const char* const SRC_COLUMN = "__src_id";
+/// Name of the target id column of the edge data.
+static const char* const DST_COLUMN = "__dst_id";
+
+/**
+ * Returns the position of each of "fields" in "available".
+ * Throws if a field does not exist.
+ */
+inline std::vector<size_t> resolve_fields(const std::vector<std::string>& fields,
+                                          const std::vector<std::string>& available,
+                                          const std::string& kind) {
+  std::vector<size_t> ret;
+  for (const auto& f: fields) {
+    auto iter = std::find(available.begin(), available.end(), f);
+    if (iter == available.end()) {
+      log_and_throw(kind + " field \"" + f + "\" does not exist");
+    }
+    ret.push_back(iter - available.begin());
+  }
+  return ret;
+}
+
+/**
+ * Splits [0, n) into num_segments contiguous ranges and returns the
+ * [begin, end) of the requested segment.
+ */
+inline std::pair<size_t, size_t> segment_range(size_t n, size_t num_segments,
+                                               size_t segmentid) {
+  return {n * segmentid / num_segments, n * (segmentid + 1) / num_segments};
+}
+
+/**
+ * Writes an in memory column into a gl_sarray of the given type, using one
+ * writer segment per worker.
+ */
+template <typename ValueFn>
+gl_sarray write_column(size_t n, flex_type_enum type, const ValueFn& value_fn) {
+  gl_sarray_writer writer(type);
+  size_t nsegments = writer.num_segments();
+  parallel_for(0, nsegments, [&](size_t segmentid) {
+    auto range = segment_range(n, nsegments, segmentid);
+    for (size_t i = range.first; i < range.second; ++i) {
+      writer.write(value_fn(i), segmentid);
+    }
+  });
+  return writer.close();
+}
+
+/**
+ * An in memory, row major table of a subset of the vertex fields of a graph.
+ *
+ * Vertices are addressed by a dense index in [0, num_vertices()) following
+ * the row order of the vertex \ref gl_sframe the table was loaded from,
+ * so columns can be written back with \ref gl_sframe::replace_add_column.
+ * Slot i of a row is fields[i].
+ */
+class vertex_table {
+ public:
+  vertex_table() = default;
+
+  /**
+   * Loads the "__id" column and the requested fields of "vertices".
+   */
+  vertex_table(const gl_sframe& vertices, const std::vector<std::string>& fields)
+      : m_fields(fields) {
+    auto all_names = vertices.column_names();
+    auto all_types = vertices.column_types();
+    resolve_fields({VID_COLUMN}, all_names, "Vertex");
+    for (size_t pos: resolve_fields(fields, all_names, "Vertex")) {
+      m_types.push_back(all_types[pos]);
+    }
+
+    std::vector<std::string> projection{VID_COLUMN};
+    projection.insert(projection.end(), fields.begin(), fields.end());
+    size_t nvertices = vertices.size();
+    m_ids.reserve(nvertices);
+    m_data.reserve(nvertices * fields.size());
+    m_index.reserve(nvertices);
+    for (const auto& row: vertices.select_columns(projection).range_iterator()) {
+      m_index[row[0]] = m_ids.size();
+      m_ids.push_back(row[0]);
+      for (size_t i = 1; i < row.size(); ++i) m_data.push_back(row[i]);
+    }
+  }
+
+  /// Number of vertices in the table.
+  inline size_t num_vertices() const { return m_ids.size(); }
+
+  /// Number of fields per vertex.
+  inline size_t num_fields() const { return m_fields.size(); }
+
+  /// Names of the fields, in slot order.
+  inline const std::vector<std::string>& fields() const { return m_fields; }
+
+  /// Types of the fields, in slot order.
+  inline const std::vector<flex_type_enum>& field_types() const { return m_types; }
+
+  /// Vertex ids, in index order.
+  inline const std::vector<flexible_type>& ids() const { return m_ids; }
+
+  /**
+   * Returns the index of a vertex id. Throws if the vertex does not exist.
+   */
+  inline size_t index_of(const flexible_type& vid) const {
+    auto iter = m_index.find(vid);
+    if (iter == m_index.end()) {
+      log_and_throw("Vertex " + std::string(vid) + " does not exist");
+    }
+    return iter->second;
+  }
+
+  /**
+   * Returns the fields of a vertex as a flat array addressed by slot.
+   * The array is empty, and must not be dereferenced, if the table has
+   * no fields.
+   */
+  inline flexible_type* row(size_t vindex) {
+    return m_data.data() + vindex * m_fields.size();
+  }
+
+  /// Const version of \ref row.
+  inline const flexible_type* row(size_t vindex) const {
+    return m_data.data() + vindex * m_fields.size();
+  }
+
+  /**
+   * Frees the field values, keeping only the vertex ids and their index.
+   */
+  void release_fields() {
+    std::vector<flexible_type>().swap(m_data);
+  }
+
+  /// Writes one field out as a gl_sarray aligned with the vertex row order.
+  gl_sarray column(size_t slot) const {
+    size_t nfields = m_fields.size();
+    return write_column(num_vertices(), m_types[slot],
+                        [&](size_t i) -> const flexible_type& {
+                          return m_data[i * nfields + slot];
+                        });
+  }
+
+ private:
+  std::vector<std::string> m_fields;
+  std::vector<flex_type_enum> m_types;
+  std::vector<flexible_type> m_ids;
+  std::unordered_map<flexible_type, size_t> m_index;
+  std::vector<flexible_type> m_data;
+};
+
+/**
+ * An array of vertex indices or edge ids, held in 32 bits when every value
+ * is below 2^32 and in 64 bits otherwise. The width is chosen by
+ * \ref assign from the largest value the array may hold.
+ */
+class compact_id_array {
+ public:
+  /**
+   * Resizes the array to n zeros, wide enough to hold values up to and
+   * including max_value.
+   */
+  void assign(size_t n, size_t max_value) {
+    m_wide = max_value > std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t>().swap(m_narrow);
+    std::vector<uint64_t>().swap(m_wide_values);
+    if (m_wide) m_wide_values.assign(n, 0);
+    else m_narrow.assign(n, 0);
+  }
+
+  inline size_t size() const { return m_wide ? m_wide_values.size() : m_narrow.size(); }
+
+  inline bool empty() const { return size() == 0; }
+
+  inline size_t operator[](size_t i) const { return m_wide ? m_wide_values[i] : m_narrow[i]; }
+
+  inline void set(size_t i, size_t value) {
+    if (m_wide) m_wide_values[i] = value;
+    else m_narrow[i] = uint32_t(value);
+  }
+
+  /// Bytes used per value.
+  inline size_t value_size() const { return m_wide ? sizeof(uint64_t) : sizeof(uint32_t); }
+
+  /// Bytes used per value by an array holding values up to max_value.
+  static size_t value_size(size_t max_value) {
+    return max_value > std::numeric_limits<uint32_t>::max() ?
+        sizeof(uint64_t) : sizeof(uint32_t);
+  }
+
+  void swap(compact_id_array& other) {
+    std::swap(m_wide, other.m_wide);
+    m_narrow.swap(other.m_narrow);
+    m_wide_values.swap(other.m_wide_values);
+  }
+
+ private:
+  bool m_wide = false;
+  std::vector<uint32_t> m_narrow;
+  std::vector<uint64_t> m_wide_values;
+};
+
+/**
+ * An in memory edge list: the dense vertex index of the endpoints of each
+ * edge, and the requested edge fields in row major order.
+ * Edge ids are positions in this list.
+ */
+struct edge_table {
+  compact_id_array source;
+  compact_id_array target;
+  std::vector<flexible_type> data;
+  size_t num_fields = 0;
+
+  edge_table() = default;
+
+  /**
+   * Loads the edges of a graph whose vertices are indexed by "vertices".
+   * Edge ids follow the row order of "edges".
+   *
+   * The edges are split into one contiguous row range per thread, and each
+   * thread packs its range directly at its position in the table, so no
+   * staging copy of the endpoints or fields is held.
+   */
+  edge_table(const gl_sframe& edges, const vertex_table& vertices,
+             const std::vector<std::string>& fields) : num_fields(fields.size()) {
+    resolve_fields(fields, edges.column_names(), "Edge");
+    std::vector<std::string> projection{SRC_COLUMN, DST_COLUMN};
+    projection.insert(projection.end(), fields.begin(), fields.end());
+    gl_sframe input = edges.select_columns(projection);
+    input.materialize();
+
+    size_t nedges = input.size();
+    size_t max_vertex = vertices.num_vertices() == 0 ? 0 : vertices.num_vertices() - 1;
+    source.assign(nedges, max_vertex);
+    target.assign(nedges, max_vertex);
+    data.resize(nedges * num_fields);
+    size_t nthreads = thread::cpu_count();
+    std::vector<gl_sframe_range> ranges;
+    for (size_t threadid = 0; threadid < nthreads; ++threadid) {
+      auto range = segment_range(nedges, nthreads, threadid);
+      ranges.push_back(input.range_iterator(range.first, range.second));
+    }
+    parallel_for(0, nthreads, [&](size_t threadid) {
+      size_t eid = segment_range(nedges, nthreads, threadid).first;
+      for (const auto& row: ranges[threadid]) {
+        source.set(eid, vertices.index_of(row[0]));
+        target.set(eid, vertices.index_of(row[1]));
+        for (size_t i = 0; i < num_fields; ++i) data[eid * num_fields + i] = row[2 + i];
+        ++eid;
+      }
+    });
+  }
+
+  inline size_t num_edges() const { return source.size(); }
+
+  /// Returns the fields of an edge as a flat array addressed by slot.
+  inline flexible_type* row(size_t eid) {
+    return data.data() + eid * num_fields;
+  }
+
+  /// Const version of \ref row.
+  inline const flexible_type* row(size_t eid) const {
+    return data.data() + eid * num_fields;
+  }
+
+  /// Writes one field out as a gl_sarray aligned with the edge row order.
+  gl_sarray column(size_t slot, flex_type_enum type) const {
+    return write_column(num_edges(), type,
+                        [&](size_t eid) -> const flexible_type& {
+                          return data[eid * num_fields + slot];
+                        });
+  }
+
+  void swap(edge_table& other) {
+    source.swap(other.source);
+    target.swap(other.target);
+    data.swap(other.data);
+    std::swap(num_fields, other.num_fields);
+  }
+};
+
+/**
+ * A fixed array of spinlocks striped over vertex indices.
+ * Pairs of locks are always acquired in index order to avoid deadlocks.
+ */
+class vertex_lock_array {
+ public:
+  explicit vertex_lock_array(size_t num_locks = SGRAPH_TRIPLE_APPLY_LOCK_ARRAY_SIZE)
+      : m_locks(std::max<size_t>(num_locks, 1)) { }
+
+  inline void lock_pair(size_t a, size_t b) const {
+    size_t la = a % m_locks.size(), lb = b % m_locks.size();
+    if (la > lb) std::swap(la, lb);
+    m_locks[la].lock();
+    if (la != lb) m_locks[lb].lock();
+  }
+
+  inline void unlock_pair(size_t a, size_t b) const {
+    size_t la = a % m_locks.size(), lb = b % m_locks.size();
+    m_locks[la].unlock();
+    if (la != lb) m_locks[lb].unlock();
+  }
+
+ private:
+  std::vector<simple_spinlock> m_locks;
+};
+
+/**
+ * Reads a numeric flexible_type as a double. Missing values are NaN.
+ */
+inline double numeric_value(const flexible_type& v) {
+  switch(v.get_type()) {
+   case flex_type_enum::INTEGER:
+     return v.get<flex_int>();
+   case flex_type_enum::FLOAT:
+     return v.get<flex_float>();
+   default:
+     return std::numeric_limits<double>::quiet_NaN();
+  }
+}
+
+/**
+ * Folds a value into an accumulator with a reduction.
+ */
+template <typename T>
+inline T reduce_value(triple_reduction_enum op, T acc, T value) {
+  switch(op) {
+   case triple_reduction_enum::SUM:
+     return acc + value;
+   case triple_reduction_enum::MIN:
+     return value < acc ? value : acc;
+   default:
+     return value > acc ? value : acc;
+  }
+}
+
+/**
+ * Atomically folds a value into an accumulator with a reduction.
+ */
+template <typename T>
+inline void atomic_reduce(volatile T& acc, triple_reduction_enum op, T value) {
+  T oldval = acc;
+  T newval = reduce_value(op, oldval, value);
+  while (newval != oldval && !atomic_compare_and_swap(acc, oldval, newval)) {
+    oldval = acc;
+    newval = reduce_value(op, oldval, value);
+  }
+}
+
+/**
+ * Elementwise reduction of numeric vectors. The accumulator takes the
+ * value if it is missing.
+ */
+inline void reduce_vector(flexible_type& acc, triple_reduction_enum op,
+                          const flexible_type& value) {
+  if (value.get_type() != flex_type_enum::VECTOR) return;
+  if (acc.get_type() != flex_type_enum::VECTOR) {
+    acc = value;
+    return;
+  }
+  flex_vec& a = acc.mutable_get<flex_vec>();
+  const flex_vec& v = value.get<flex_vec>();
+  if (a.size() != v.size()) {
+    log_and_throw("Vector reduction requires all values to have the same length");
+  }
+  for (size_t i = 0; i < a.size(); ++i) a[i] = reduce_value(op, a[i], v[i]);
+}
+
+/**
+ * Lock free accumulation of the mutated vertex fields of a schema-compiled
+ * triple apply, when every mutated vertex field is declared as a
+ * commutative reduction.
+ *
+ * Each edge works on private copies of its source and target rows (\ref
+ * private_row), kept per worker. The slots which are not reduced are read
+ * only, and are taken from the unmodified \ref vertex_table only when a
+ * copy moves to another vertex; only the reduced slots are reset for every
+ * edge. The contributions left in the reduced slots are folded into:
+ *  - a dense atomic accumulator for integer and float fields.
+ *  - a dense per thread partial buffer for vector fields.
+ * \ref finalize combines the accumulators with the values in the table.
+ */
+class vertex_reducer {
+ public:
+  vertex_reducer(vertex_table& table,
+                 const std::vector<size_t>& mutated_slots,
+                 const std::map<std::string, triple_reduction_enum>& reductions)
+      : m_table(table), m_partials(thread::cpu_count()) {
+    for (const auto& r: reductions) {
+      auto iter = std::find(table.fields().begin(), table.fields().end(), r.first);
+      if (iter == table.fields().end() ||
+          std::find(mutated_slots.begin(), mutated_slots.end(),
+                    size_t(iter - table.fields().begin())) == mutated_slots.end()) {
+        log_and_throw("Reduction field \"" + r.first + "\" must be a mutated vertex field");
+      }
+    }
+    size_t nvertices = table.num_vertices();
+    for (size_t slot: mutated_slots) {
+      const std::string& name = table.fields()[slot];
+      auto iter = reductions.find(name);
+      if (iter == reductions.end()) {
+        log_and_throw("Mutated vertex field \"" + name + "\" has no declared reduction");
+      }
+      reduced_field f;
+      f.slot = slot;
+      f.op = iter->second;
+      f.type = table.field_types()[slot];
+      if (f.type == flex_type_enum::INTEGER) {
+        f.int_acc.resize(nvertices, identity<flex_int>(f.op));
+      } else if (f.type == flex_type_enum::FLOAT) {
+        f.float_acc.resize(nvertices, identity<flex_float>(f.op));
+      } else if (f.type != flex_type_enum::VECTOR) {
+        log_and_throw("Reduction field \"" + name +
+                      "\" must be of integer, float or vector type");
+      }
+      m_fields.push_back(std::move(f));
+    }
+    m_reduced.resize(table.num_fields(), false);
+    for (const auto& f: m_fields) m_reduced[f.slot] = true;
+  }
+
+  /**
+   * A private copy of the row of one vertex.
+   */
+  struct private_row {
+    std::vector<flexible_type> values;
+    /// The vertex the slots which are not reduced were copied from.
+    size_t vindex = size_t(-1);
+  };
+
+  /**
+   * Prepares the private copy of the row of a vertex for one edge and
+   * returns it as a flat array addressed by slot. Slots which are not
+   * reduced are copied only if the copy held another vertex. Reduced slots
+   * start at 0 for SUM and at the table value for MIN and MAX; vector
+   * slots are overwritten in place when their length is unchanged.
+   */
+  flexible_type* load(size_t vindex, private_row& copy) const {
+    const flexible_type* row = m_table.row(vindex);
+    if (copy.vindex != vindex) {
+      copy.values.resize(m_table.num_fields());
+      for (size_t slot = 0; slot < m_table.num_fields(); ++slot) {
+        if (!m_reduced[slot]) copy.values[slot] = row[slot];
+      }
+      copy.vindex = vindex;
+    }
+    for (const auto& f: m_fields) {
+      flexible_type& v = copy.values[f.slot];
+      const flexible_type& original = row[f.slot];
+      bool sum = f.op == triple_reduction_enum::SUM;
+      if (f.type == flex_type_enum::INTEGER) {
+        if (sum) v = flex_int(0);
+        else v = original;
+      } else if (f.type == flex_type_enum::FLOAT) {
+        if (sum) v = flex_float(0);
+        else v = original;
+      } else if (original.get_type() != flex_type_enum::VECTOR) {
+        v = original;
+      } else {
+        const flex_vec& from = original.get<flex_vec>();
+        if (v.get_type() != flex_type_enum::VECTOR ||
+            v.get<flex_vec>().size() != from.size()) {
+          v = flex_vec(from.size());
+        }
+        flex_vec& to = v.mutable_get<flex_vec>();
+        if (sum) std::fill(to.begin(), to.end(), 0.0);
+        else std::copy(from.begin(), from.end(), to.begin());
+      }
+    }
+    return copy.values.data();
+  }
+
+  /**
+   * Folds the reduced slots of a private row copy into the accumulators
+   * of a vertex.
+   */
+  void fold(size_t vindex, const private_row& copy, size_t threadid) {
+    for (auto& f: m_fields) {
+      const flexible_type& v = copy.values[f.slot];
+      if (f.type == flex_type_enum::INTEGER) {
+        if (v.get_type() == flex_type_enum::UNDEFINED) continue;
+        atomic_reduce(f.int_acc[vindex], f.op, v.to<flex_int>());
+      } else if (f.type == flex_type_enum::FLOAT) {
+        double d = numeric_value(v);
+        if (std::isnan(d)) continue;
+        atomic_reduce(f.float_acc[vindex], f.op, d);
+      } else {
+        auto& partial = m_partials[threadid];
+        if (partial.empty()) partial.resize(m_fields.size());
+        auto& buffer = partial[&f - &m_fields[0]];
+        if (buffer.empty()) buffer.resize(m_table.num_vertices());
+        flexible_type& acc = buffer[vindex];
+        if (acc.get_type() != flex_type_enum::VECTOR && v.get_type() == flex_type_enum::VECTOR) {
+          // copied rather than shared, so that the private row can keep
+          // overwriting its vector in place
+          acc = flex_vec(v.get<flex_vec>());
+        } else {
+          reduce_vector(acc, f.op, v);
+        }
+      }
+    }
+  }
+
+  /**
+   * Combines the accumulators with the values in the vertex table.
+   * A vertex which received no contribution keeps its value.
+   */
+  void finalize() {
+    size_t nvertices = m_table.num_vertices();
+    for (size_t fid = 0; fid < m_fields.size(); ++fid) {
+      auto& f = m_fields[fid];
+      parallel_for(0, nvertices, [&](size_t i) {
+        flexible_type& value = m_table.row(i)[f.slot];
+        if (f.type == flex_type_enum::INTEGER) {
+          flex_int acc = f.int_acc[i];
+          if (acc == identity<flex_int>(f.op)) return;
+          if (value.get_type() == flex_type_enum::UNDEFINED) value = acc;
+          else value = reduce_value(f.op, value.to<flex_int>(), acc);
+        } else if (f.type == flex_type_enum::FLOAT) {
+          flex_float acc = f.float_acc[i];
+          if (acc == identity<flex_float>(f.op)) return;
+          if (value.get_type() == flex_type_enum::UNDEFINED) value = acc;
+          else value = reduce_value(f.op, numeric_value(value), acc);
+        } else {
+          for (const auto& partial: m_partials) {
+            if (partial.empty() || partial[fid].empty()) continue;
+            reduce_vector(value, f.op, partial[fid][i]);
+          }
+        }
+      });
+    }
+  }
+
+ private:
+  template <typename T>
+  static T identity(triple_reduction_enum op) {
+    switch(op) {
+     case triple_reduction_enum::SUM:
+       return T(0);
+     case triple_reduction_enum::MIN:
+       return std::numeric_limits<T>::has_infinity ?
+           std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+     default:
+       return std::numeric_limits<T>::has_infinity ?
+           -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+    }
+  }
+
+  struct reduced_field {
+    size_t slot = 0;
+    triple_reduction_enum op = triple_reduction_enum::SUM;
+    flex_type_enum type = flex_type_enum::FLOAT;
+    std::vector<flex_int> int_acc;
+    std::vector<flex_float> float_acc;
+  };
+
+  vertex_table& m_table;
+  std::vector<reduced_field> m_fields;
+  /// True for the slots of m_fields
+  std::vector<bool> m_reduced;
+  /// m_partials[thread][field id][vertex] for vector fields
+  std::vector<std::vector<std::vector<flexible_type> > > m_partials;
+};
+
+/**
+ * The field layout shared by the native triple apply variants: which slots
+ * are mutated, and the types of the edge fields.
+ */
+struct triple_apply_plan {
+  triple_apply_plan(const gl_sframe& edges,
+                    const std::vector<std::string>& mutated_fields,
+                    const std::vector<std::string>& vertex_fields,
+                    const std::vector<std::string>& edge_fields) {
+    // split mutated fields into vertex slots and edge slots
+    for (const auto& f: mutated_fields) {
+      auto viter = std::find(vertex_fields.begin(), vertex_fields.end(), f);
+      auto eiter = std::find(edge_fields.begin(), edge_fields.end(), f);
+      if (viter == vertex_fields.end() && eiter == edge_fields.end()) {
+        log_and_throw("Mutated field \"" + f +
+                      "\" must be one of the requested vertex or edge fields");
+      }
+      if (viter != vertex_fields.end()) {
+        mutated_vertex_slots.push_back(viter - vertex_fields.begin());
+      }
+      if (eiter != edge_fields.end()) {
+        mutated_edge_slots.push_back(eiter - edge_fields.begin());
+      }
+    }
+    rewrite_edges = !mutated_edge_slots.empty();
+    auto all_types = edges.column_types();
+    for (size_t pos: resolve_fields(edge_fields, edges.column_names(), "Edge")) {
+      edge_types.push_back(all_types[pos]);
+    }
+    resolve_fields({SRC_COLUMN, DST_COLUMN}, edges.column_names(), "Edge");
+  }
+
+  std::vector<size_t> mutated_vertex_slots;
+  std::vector<size_t> mutated_edge_slots;
+  bool rewrite_edges = false;
+  /// Types of the requested edge fields, in slot order.
+  std::vector<flex_type_enum> edge_types;
+};
+
+/**
+ * Returns |a - b| for numeric or vector values, the largest elementwise
+ * difference for vectors, and infinity if only one of them is missing.
+ */
+inline double value_distance(const flexible_type& a, const flexible_type& b) {
+  if (a.get_type() == flex_type_enum::VECTOR && b.get_type() == flex_type_enum::VECTOR) {
+    const flex_vec& va = a.get<flex_vec>();
+    const flex_vec& vb = b.get<flex_vec>();
+    if (va.size() != vb.size()) return std::numeric_limits<double>::infinity();
+    double ret = 0;
+    for (size_t i = 0; i < va.size(); ++i) ret = std::max(ret, std::fabs(va[i] - vb[i]));
+    return ret;
+  }
+  double da = numeric_value(a), db = numeric_value(b);
+  if (std::isnan(da) && std::isnan(db)) return 0;
+  if (std::isnan(da) || std::isnan(db)) return std::numeric_limits<double>::infinity();
+  return std::fabs(da - db);
+}
+
+/**
+ * The active vertices of a frontier triple apply, as a bitset over the
+ * rows of a \ref vertex_table.
+ */
+class frontier_set {
+ public:
+  /**
+   * Marks the vertices of the frontier. "delta_slot" and "reference_slot"
+   * are the slots of the compared fields in the table, for a delta frontier.
+   */
+  frontier_set(const triple_apply_frontier& frontier, const vertex_table& table,
+               size_t delta_slot, size_t reference_slot)
+      : m_edges(frontier.edges), m_active(table.num_vertices()) {
+    if (frontier.is_delta()) {
+      parallel_for(0, table.num_vertices(), [&](size_t i) {
+        const flexible_type* row = table.row(i);
+        if (value_distance(row[delta_slot], row[reference_slot]) > frontier.epsilon) {
+          m_active.set_bit(i);
+        }
+      });
+    } else {
+      for (const auto& vid: frontier.active_vertices) {
+        m_active.set_bit(table.index_of(vid));
+      }
+    }
+    m_num_active = m_active.popcount();
+  }
+
+  /// Number of active vertices.
+  inline size_t num_active() const { return m_num_active; }
+
+  /// True if the edge src -> dst is in the frontier.
+  inline bool contains(size_t src, size_t dst) const {
+    switch(m_edges) {
+     case frontier_edges_enum::SOURCE:
+       return m_active.get(src);
+     case frontier_edges_enum::TARGET:
+       return m_active.get(dst);
+     default:
+       return m_active.get(src) || m_active.get(dst);
+    }
+  }
+
+  inline bool is_active(size_t vindex) const { return m_active.get(vindex); }
+
+  inline frontier_edges_enum edges() const { return m_edges; }
+
+ private:
+  frontier_edges_enum m_edges;
+  dense_bitset m_active;
+  size_t m_num_active = 0;
+};
+
+/**
+ * Largest fraction of active vertices for which a frontier triple apply
+ * fetches its edges with vertex id queries instead of a full edge scan.
+ */
+static const double FRONTIER_QUERY_MAX_RATIO = 0.1;
+
+/**
+ * Implementation of the schema-compiled \ref gl_sgraph::triple_apply, and of
+ * \ref gl_sgraph::frontier_triple_apply when "frontier" is not NULL.
+ *
+ * The requested vertex fields are loaded into a \ref vertex_table, and the
+ * edges into an \ref edge_table which maps the source and target ids of
+ * every edge to vertex table rows once, as they are read. The edges are then
+ * visited in parallel over those indices, one contiguous range of edge ids
+ * per thread, and the lambda works on the table rows in place. Mutated edge
+ * fields are written back as columns aligned with the edge row order.
+ *
+ * With a small frontier and no mutated edge fields, the edges are fetched by
+ * two \ref gl_sgraph::get_edges queries: the out edges of the active vertices
+ * and the in edges of the active vertices. An edge returned by the second
+ * query whose source is also active was already returned by the first one
+ * and is skipped.
+ */
+inline gl_sgraph typed_triple_apply(const gl_sgraph& g,
+                                    const lambda_typed_triple_apply_fn& lambda,
+                                    const std::vector<std::string>& mutated_fields,
+                                    const std::vector<std::string>& vertex_fields,
+                                    const std::vector<std::string>& edge_fields,
+                                    const std::map<std::string, triple_reduction_enum>& reductions,
+                                    const triple_apply_frontier* frontier = NULL) {
+  gl_sframe vertices = g.get_vertices();
+  gl_sframe edges = g.get_edges();
+  triple_apply_plan plan(edges, mutated_fields, vertex_fields, edge_fields);
+
+  // the fields compared by a delta frontier are loaded after the lambda fields
+  std::vector<std::string> table_fields = vertex_fields;
+  std::vector<size_t> delta_slots;
+  if (frontier && frontier->is_delta()) {
+    for (const auto& f: {frontier->delta_field, frontier->reference_field}) {
+      auto iter = std::find(table_fields.begin(), table_fields.end(), f);
+      delta_slots.push_back(iter - table_fields.begin());
+      if (iter == table_fields.end()) table_fields.push_back(f);
+    }
+  }
+  vertex_table table(vertices, table_fields);
+
+  std::unique_ptr<frontier_set> active;
+  if (frontier) {
+    active.reset(new frontier_set(*frontier, table,
+                                  delta_slots.empty() ? 0 : delta_slots[0],
+                                  delta_slots.empty() ? 0 : delta_slots[1]));
+    if (active->num_active() == 0) return g;
+  }
+
+  std::unique_ptr<vertex_reducer> reducer;
+  if (!reductions.empty()) {
+    reducer.reset(new vertex_reducer(table, plan.mutated_vertex_slots, reductions));
+  }
+
+  // The edge frames visited. The flag marks the frame of in edges of a
+  // queried frontier, in which edges with an active source are skipped.
+  std::vector<std::pair<gl_sframe, bool> > inputs;
+  if (active && !plan.rewrite_edges &&
+      active->num_active() <= FRONTIER_QUERY_MAX_RATIO * table.num_vertices()) {
+    std::vector<gl_sgraph::vid_pair> out_query, in_query;
+    for (size_t i = 0; i < table.num_vertices(); ++i) {
+      if (!active->is_active(i)) continue;
+      out_query.push_back({table.ids()[i], FLEX_UNDEFINED});
+      in_query.push_back({FLEX_UNDEFINED, table.ids()[i]});
+    }
+    if (active->edges() != frontier_edges_enum::TARGET) {
+      inputs.push_back({g.get_edges(out_query), false});
+    }
+    if (active->edges() != frontier_edges_enum::SOURCE) {
+      inputs.push_back({g.get_edges(in_query), active->edges() == frontier_edges_enum::ANY});
+    }
+  } else {
+    inputs.push_back({edges, false});
+  }
+
+  size_t nthreads = thread::cpu_count();
+  // vertices are only locked when no reductions are declared
+  std::unique_ptr<vertex_lock_array> locks;
+  if (!reducer) locks.reset(new vertex_lock_array());
+  // private copies of the source and target of each worker in reduction mode
+  std::vector<vertex_reducer::private_row> source_copies(reducer ? nthreads : 0);
+  std::vector<vertex_reducer::private_row> target_copies(reducer ? nthreads : 0);
+  edge_table edge_data;
+  for (auto& input: inputs) {
+    bool skip_active_sources = input.second;
+    edge_table(input.first, table, edge_fields).swap(edge_data);
+    size_t nedges = edge_data.num_edges();
+    parallel_for(0, nthreads, [&](size_t threadid) {
+      auto range = segment_range(nedges, nthreads, threadid);
+      typed_edge_triple triple;
+      for (size_t eid = range.first; eid < range.second; ++eid) {
+        size_t src = edge_data.source[eid];
+        size_t dst = edge_data.target[eid];
+        if (active && (!active->contains(src, dst) ||
+                       (skip_active_sources && active->is_active(src)))) {
+          continue;
+        }
+        triple.edge = edge_data.row(eid);
+        if (reducer) {
+          auto& source_copy = source_copies[threadid];
+          auto& target_copy = target_copies[threadid];
+          triple.source = reducer->load(src, source_copy);
+          triple.target = reducer->load(dst, target_copy);
+          lambda(triple);
+          reducer->fold(src, source_copy, threadid);
+          reducer->fold(dst, target_copy, threadid);
+        } else {
+          triple.source = table.row(src);
+          triple.target = table.row(dst);
+          locks->lock_pair(src, dst);
+          try {
+            lambda(triple);
+          } catch (...) {
+            locks->unlock_pair(src, dst);
+            throw;
+          }
+          locks->unlock_pair(src, dst);
+        }
+      }
+    });
+  }
+
+  if (reducer) reducer->finalize();
+  for (size_t slot: plan.mutated_vertex_slots) {
+    vertices.replace_add_column(table.column(slot), vertex_fields[slot]);
+  }
+  for (size_t slot: plan.mutated_edge_slots) {
+    edges.replace_add_column(edge_data.column(slot, plan.edge_types[slot]),
+                             edge_fields[slot]);
+  }
+  return gl_sgraph(vertices, edges);
+}
+
+/**
+ * Converts back a value read by \ref numeric_value from "original", a value
+ * of a field of the given type. An unchanged value keeps the original, so
+ * integers above 2^53 are not rounded through double. Otherwise integer
+ * fields get an integer back, and a NaN is missing if the field is an
+ * integer or the original was missing.
+ */
+inline flexible_type numeric_result(double value, flex_type_enum type,
+                                    const flexible_type& original) {
+  if (std::isnan(value)) {
+    if (type == flex_type_enum::INTEGER ||
+        original.get_type() == flex_type_enum::UNDEFINED) {
+      return FLEX_UNDEFINED;
+    }
+    return value;
+  }
+  if (value == numeric_value(original)) return original;
+  if (type == flex_type_enum::INTEGER) return flex_int(std::llround(value));
+  return value;
+}
+
+/**
+ * Adds an accumulated double into the original value of a vertex field of
+ * the given type. Integer fields are added as integers, and a missing
+ * value stays missing.
+ */
+inline flexible_type accumulated_result(const flexible_type& original, flex_type_enum type,
+                                        double accumulator) {
+  if (original.get_type() == flex_type_enum::UNDEFINED) return FLEX_UNDEFINED;
+  if (type == flex_type_enum::INTEGER) {
+    if (std::isnan(accumulator)) return FLEX_UNDEFINED;
+    return original.to<flex_int>() + flex_int(std::llround(accumulator));
+  }
+  return numeric_value(original) + accumulator;
+}
+
+/**
+ * Renumbers the vertices of a batch of edges. "vertices" receives the
+ * sorted distinct vertex indices referenced by the batch, and the source
+ * and target of each edge are replaced by their position in it.
+ */
+inline void renumber_batch_vertices(std::vector<size_t>& source, std::vector<size_t>& target,
+                                    std::vector<size_t>& vertices) {
+  vertices.assign(source.begin(), source.end());
+  vertices.insert(vertices.end(), target.begin(), target.end());
+  std::sort(vertices.begin(), vertices.end());
+  vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+  auto local = [&](size_t v) {
+    return size_t(std::lower_bound(vertices.begin(), vertices.end(), v) - vertices.begin());
+  };
+  for (auto& v: source) v = local(v);
+  for (auto& v: target) v = local(v);
+}
+
+/**
+ * The buffers of the batches of one \ref batch_triple_apply worker. They
+ * are resized for each batch rather than reallocated, so that a worker only
+ * allocates when a batch is larger than the ones it has already seen.
+ */
+struct batch_buffers {
+  std::vector<size_t> source;
+  std::vector<size_t> target;
+  std::vector<size_t> vertices;
+  /// [edge slot][position in the batch]
+  std::vector<std::vector<double> > edge_columns;
+  /// [vertex slot][batch vertex index]
+  std::vector<std::vector<double> > local_fields;
+  std::vector<std::vector<double> > local_accumulators;
+  edge_triple_batch batch;
+};
+
+/**
+ * Throws unless every type is an integer or float.
+ */
+inline void check_numeric_fields(const std::vector<std::string>& fields,
+                                 const std::vector<flex_type_enum>& types,
+                                 const std::string& kind) {
+  for (size_t i = 0; i < fields.size(); ++i) {
+    if (types[i] != flex_type_enum::INTEGER && types[i] != flex_type_enum::FLOAT) {
+      log_and_throw(kind + " field \"" + fields[i] + "\" must be of integer or float type");
+    }
+  }
+}
+
+/**
+ * Implementation of \ref gl_sgraph::batch_triple_apply.
+ *
+ * Vertex fields are held as dense double columns, and the edges in an
+ * \ref edge_table whose source and target are mapped to vertex indices once.
+ * Each thread visits one contiguous range of edge ids in batches of
+ * SGRAPH_TRIPLE_APPLY_EDGE_BATCH_SIZE edges. A batch is converted into an
+ * \ref edge_triple_batch over the vertices it references, and handed to the
+ * lambda in one call. The batch accumulators are then added into one shared
+ * dense accumulator per mutated vertex field with atomic adds, which is
+ * added into the vertex fields once all edges have been visited.
+ */
+inline gl_sgraph batch_triple_apply(const gl_sgraph& g,
+                                    const lambda_batch_triple_apply_fn& lambda,
+                                    const std::vector<std::string>& mutated_fields,
+                                    const std::vector<std::string>& vertex_fields,
+                                    const std::vector<std::string>& edge_fields) {
+  gl_sframe vertices = g.get_vertices();
+  gl_sframe edges = g.get_edges();
+  triple_apply_plan plan(edges, mutated_fields, vertex_fields, edge_fields);
+  check_numeric_fields(edge_fields, plan.edge_types, "Edge");
+
+  // dense columns of the requested fields, and the original values of the
+  // mutated fields which the accumulators are added into
+  vertex_table index(vertices, vertex_fields);
+  check_numeric_fields(vertex_fields, index.field_types(), "Vertex");
+  std::vector<flex_type_enum> vertex_types = index.field_types();
+  size_t nvertices = index.num_vertices();
+  std::vector<std::vector<double> > vertex_columns(vertex_fields.size());
+  std::vector<std::vector<flexible_type> > original(vertex_fields.size());
+  for (size_t slot = 0; slot < vertex_fields.size(); ++slot) {
+    vertex_columns[slot].resize(nvertices);
+    for (size_t i = 0; i < nvertices; ++i) {
+      vertex_columns[slot][i] = numeric_value(index.row(i)[slot]);
+    }
+  }
+  for (size_t slot: plan.mutated_vertex_slots) {
+    original[slot].resize(nvertices);
+    for (size_t i = 0; i < nvertices; ++i) original[slot][i] = index.row(i)[slot];
+  }
+  index.release_fields();
+
+  edge_table edge_data(edges, index, edge_fields);
+  size_t nedges = edge_data.num_edges();
+  size_t nthreads = thread::cpu_count();
+  size_t batch_size = std::max<size_t>(SGRAPH_TRIPLE_APPLY_EDGE_BATCH_SIZE, 1);
+  std::vector<std::vector<double> > accumulators(vertex_fields.size());
+  for (size_t slot: plan.mutated_vertex_slots) accumulators[slot].resize(nvertices, 0.0);
+
+  // per thread batch buffers, kept across the batches of a thread
+  std::vector<batch_buffers> buffers(nthreads);
+  parallel_for(0, nthreads, [&](size_t threadid) {
+    batch_buffers& buf = buffers[threadid];
+    auto range = segment_range(nedges, nthreads, threadid);
+    for (size_t begin = range.first; begin < range.second; begin += batch_size) {
+      size_t nrows = std::min(batch_size, range.second - begin);
+      buf.source.resize(nrows);
+      buf.target.resize(nrows);
+      for (size_t i = 0; i < nrows; ++i) {
+        buf.source[i] = edge_data.source[begin + i];
+        buf.target[i] = edge_data.target[begin + i];
+      }
+      renumber_batch_vertices(buf.source, buf.target, buf.vertices);
+      size_t nlocal = buf.vertices.size();
+      buf.edge_columns.resize(edge_fields.size());
+      for (size_t slot = 0; slot < edge_fields.size(); ++slot) {
+        auto& values = buf.edge_columns[slot];
+        values.resize(nrows);
+        for (size_t i = 0; i < nrows; ++i) {
+          values[i] = numeric_value(edge_data.row(begin + i)[slot]);
+        }
+      }
+      buf.local_fields.resize(vertex_fields.size());
+      buf.local_accumulators.resize(vertex_fields.size());
+      for (size_t slot = 0; slot < vertex_fields.size(); ++slot) {
+        auto& values = buf.local_fields[slot];
+        values.resize(nlocal);
+        for (size_t j = 0; j < nlocal; ++j) {
+          values[j] = vertex_columns[slot][buf.vertices[j]];
+        }
+      }
+      for (size_t slot: plan.mutated_vertex_slots) {
+        buf.local_accumulators[slot].assign(nlocal, 0.0);
+      }
+
+      edge_triple_batch& batch = buf.batch;
+      batch.num_edges = nrows;
+      batch.num_vertices = nlocal;
+      batch.source = buf.source.data();
+      batch.target = buf.target.data();
+      batch.vertices = buf.vertices.data();
+      batch.vertex_fields.clear();
+      batch.vertex_accumulators.clear();
+      batch.edge_fields.clear();
+      for (size_t slot = 0; slot < vertex_fields.size(); ++slot) {
+        batch.vertex_fields.push_back(buf.local_fields[slot].data());
+        batch.vertex_accumulators.push_back(
+            buf.local_accumulators[slot].empty() ? NULL : buf.local_accumulators[slot].data());
+      }
+      for (auto& column: buf.edge_columns) batch.edge_fields.push_back(column.data());
+      lambda(batch);
+
+      for (size_t slot: plan.mutated_vertex_slots) {
+        auto& shared = accumulators[slot];
+        const auto& local = buf.local_accumulators[slot];
+        for (size_t j = 0; j < nlocal; ++j) {
+          atomic_reduce(shared[buf.vertices[j]], triple_reduction_enum::SUM, local[j]);
+        }
+      }
+      for (size_t slot: plan.mutated_edge_slots) {
+        const auto& values = buf.edge_columns[slot];
+        for (size_t i = 0; i < nrows; ++i) {
+          flexible_type& value = edge_data.row(begin + i)[slot];
+          value = numeric_result(values[i], plan.edge_types[slot], value);
+        }
+      }
+    }
+  });
+
+  for (size_t slot: plan.mutated_vertex_slots) {
+    const auto& accumulator = accumulators[slot];
+    const auto& values = original[slot];
+    gl_sarray column = write_column(nvertices, vertex_types[slot], [&](size_t i) {
+      return accumulated_result(values[i], vertex_types[slot], accumulator[i]);
+    });
+    std::vector<flexible_type>().swap(original[slot]);
+    vertices.replace_add_column(column, vertex_fields[slot]);
+  }
+  for (size_t slot: plan.mutated_edge_slots) {
+    edges.replace_add_column(edge_data.column(slot, plan.edge_types[slot]),
+                             edge_fields[slot]);
+  }
+  return gl_sgraph(vertices, edges);
+}
+
+} // namespace gl_sgraph_impl
+
+inline gl_sgraph gl_sgraph::triple_apply(const lambda_typed_triple_apply_fn& lambda,
+                                         const std::vector<std::string>& mutated_fields,
+                                         const std::vector<std::string>& vertex_fields,
+                                         const std::vector<std::string>& edge_fields,
+                                         const std::map<std::string, triple_reduction_enum>& reductions) const {
+  return gl_sgraph_impl::typed_triple_apply(*this, lambda, mutated_fields,
+                                            vertex_fields, edge_fields, reductions);
+}
+
+inline gl_sgraph gl_sgraph::frontier_triple_apply(const lambda_typed_triple_apply_fn& lambda,
+                                                 const std::vector<std::string>& mutated_fields,
+                                                 const std::vector<std::string>& vertex_fields,
+                                                 const std::vector<std::string>& edge_fields,
+                                                 const triple_apply_frontier& frontier) const {
+  return gl_sgraph_impl::typed_triple_apply(*this, lambda, mutated_fields, vertex_fields,
+                                            edge_fields, {}, &frontier);
+}
+
+inline gl_sgraph gl_sgraph::batch_triple_apply(const lambda_batch_triple_apply_fn& lambda,
+                                               const std::vector<std::string>& mutated_fields,
+                                               const std::vector<std::string>& vertex_fields,
+                                               const std::vector<std::string>& edge_fields) const {
+  return gl_sgraph_impl::batch_triple_apply(*this, lambda, mutated_fields,
+                                            vertex_fields, edge_fields);
+}
+
+} // namespace graphlab
+#endif
@@ -0,0 +1,813 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SFRAME_AVRO_READER_HPP
+#define GRAPHLAB_SFRAME_AVRO_READER_HPP
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/fileio/mapped_file.hpp>
+#include <graphlab/util/snappy.hpp>
+
+namespace graphlab {
+
+namespace avro_impl {
+
+inline void corrupt(const std::string& what) {
+  log_and_throw("Corrupt avro file: " + what);
+}
+
+/**
+ * A JSON value, as needed to read an Avro schema.
+ */
+struct json_value {
+  enum kind_type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+  kind_type kind = NUL;
+  bool boolean = false;
+  double number = 0;
+  std::string str;
+  std::vector<json_value> items;
+  std::vector<std::pair<std::string, json_value> > members;
+
+  const json_value* find(const std::string& key) const {
+    for (const auto& member: members) {
+      if (member.first == key) return &member.second;
+    }
+    return nullptr;
+  }
+
+  std::string string_member(const std::string& key) const {
+    const json_value* value = find(key);
+    return value != nullptr && value->kind == STRING ? value->str : std::string();
+  }
+
+  double number_member(const std::string& key, double default_value) const {
+    const json_value* value = find(key);
+    return value != nullptr && value->kind == NUMBER ? value->number : default_value;
+  }
+};
+
+class json_parser {
+ public:
+  json_parser(const std::string& text): m_p(text.data()), m_end(text.data() + text.size()) {}
+
+  json_value parse() {
+    json_value value = parse_value();
+    skip_space();
+    if (m_p != m_end) corrupt("trailing characters in schema");
+    return value;
+  }
+
+ private:
+  void skip_space() {
+    while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r')) ++m_p;
+  }
+
+  bool consume(char c) {
+    skip_space();
+    if (m_p < m_end && *m_p == c) {
+      ++m_p;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(char c) {
+    if (!consume(c)) corrupt(std::string("expected '") + c + "' in schema");
+  }
+
+  bool consume_word(const char* word) {
+    size_t length = std::strlen(word);
+    if (size_t(m_end - m_p) >= length && std::memcmp(m_p, word, length) == 0) {
+      m_p += length;
+      return true;
+    }
+    return false;
+  }
+
+  std::string parse_string() {
+    expect('"');
+    std::string ret;
+    while (true) {
+      if (m_p >= m_end) corrupt("unterminated string in schema");
+      char c = *m_p++;
+      if (c == '"') break;
+      if (c != '\\') {
+        ret.push_back(c);
+        continue;
+      }
+      if (m_p >= m_end) corrupt("unterminated string in schema");
+      c = *m_p++;
+      switch (c) {
+        case 'b': ret.push_back('\b'); break;
+        case 'f': ret.push_back('\f'); break;
+        case 'n': ret.push_back('\n'); break;
+        case 'r': ret.push_back('\r'); break;
+        case 't': ret.push_back('\t'); break;
+        case 'u': {
+          if (m_end - m_p < 4) corrupt("bad escape in schema");
+          unsigned code = std::strtoul(std::string(m_p, 4).c_str(), nullptr, 16);
+          m_p += 4;
+          // names and symbols are ascii; other characters are kept as utf-8
+          if (code < 0x80) {
+            ret.push_back(char(code));
+          } else if (code < 0x800) {
+            ret.push_back(char(0xc0 | (code >> 6)));
+            ret.push_back(char(0x80 | (code & 0x3f)));
+          } else {
+            ret.push_back(char(0xe0 | (code >> 12)));
+            ret.push_back(char(0x80 | ((code >> 6) & 0x3f)));
+            ret.push_back(char(0x80 | (code & 0x3f)));
+          }
+          break;
+        }
+        default: ret.push_back(c);
+      }
+    }
+    return ret;
+  }
+
+  json_value parse_value() {
+    json_value value;
+    skip_space();
+    if (m_p >= m_end) corrupt("truncated schema");
+    if (*m_p == '"') {
+      value.kind = json_value::STRING;
+      value.str = parse_string();
+    } else if (consume('{')) {
+      value.kind = json_value::OBJECT;
+      if (!consume('}')) {
+        do {
+          skip_space();
+          std::string key = parse_string();
+          expect(':');
+          value.members.emplace_back(key, parse_value());
+        } while (consume(','));
+        expect('}');
+      }
+    } else if (consume('[')) {
+      value.kind = json_value::ARRAY;
+      if (!consume(']')) {
+        do {
+          value.items.push_back(parse_value());
+        } while (consume(','));
+        expect(']');
+      }
+    } else if (consume_word("true")) {
+      value.kind = json_value::BOOLEAN;
+      value.boolean = true;
+    } else if (consume_word("false")) {
+      value.kind = json_value::BOOLEAN;
+    } else if (consume_word("null")) {
+      value.kind = json_value::NUL;
+    } else {
+      char* number_end = nullptr;
+      std::string rest(m_p, std::min<size_t>(m_end - m_p, 64));
+      value.kind = json_value::NUMBER;
+      value.number = std::strtod(rest.c_str(), &number_end);
+      if (number_end == rest.c_str()) corrupt("bad value in schema");
+      m_p += number_end - rest.c_str();
+    }
+    return value;
+  }
+
+  const char* m_p;
+  const char* m_end;
+};
+
+inline int64_t read_long(const uint8_t*& p, const uint8_t* end) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p >= end) corrupt("truncated value");
+    uint8_t byte = *p++;
+    value |= uint64_t(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return int64_t(value >> 1) ^ -int64_t(value & 1);
+  }
+  corrupt("bad varint");
+  return 0;
+}
+
+} // namespace avro_impl
+
+/**
+ * A node of a parsed Avro schema. Children refer to other nodes of the
+ * schema by index, so that named types can be referred to, recursively.
+ */
+struct avro_schema_node {
+  enum kind_type {
+    NUL, BOOLEAN, INT, LONG, FLOAT, DOUBLE, BYTES, STRING,
+    RECORD, ENUM, ARRAY, MAP, UNION, FIXED
+  };
+  enum logical_type {
+    NONE, DATE, TIMESTAMP_MILLIS, TIMESTAMP_MICROS,
+    LOCAL_TIMESTAMP_MILLIS, LOCAL_TIMESTAMP_MICROS, DECIMAL
+  };
+  kind_type kind = NUL;
+  logical_type logical = NONE;
+  int scale = 0;
+  /// Length of a fixed
+  size_t size = 0;
+  /// Field names of a record, symbols of an enum
+  std::vector<std::string> names;
+  /// Field types of a record, item or value type of an array or a map,
+  /// branches of a union
+  std::vector<size_t> children;
+  /// The type of the values in a gl_sframe, or UNDEFINED if they have no
+  /// single type (e.g. unions of strings and numbers)
+  flex_type_enum type = flex_type_enum::UNDEFINED;
+};
+
+/**
+ * A local Avro object container file, mapped into memory.
+ *
+ * The file is a header, holding the schema, the codec and a 16 byte sync
+ * marker, followed by blocks of objects, each ending with the sync
+ * marker. Blocks are found from any position in the file by searching
+ * for the sync marker, so ranges of the file can be decoded in parallel
+ * (see block_range()).
+ *
+ * The objects of the "null" and "snappy" codecs are decoded straight into
+ * flexible_types, typed by the schema:
+ *
+ * - boolean, int and long to INTEGER; the date and timestamp logical types
+ *   to DATETIME.
+ * - float and double to FLOAT; the decimal logical type to FLOAT.
+ * - string, bytes, enum and fixed to STRING.
+ * - arrays of numbers to VECTOR, other arrays to LIST.
+ * - maps and records to DICT.
+ * - unions of null and one type to that type, with null as missing value;
+ *   the values of other unions keep the types of their branches.
+ */
+class avro_file {
+ public:
+  explicit avro_file(const std::string& path): m_file(path) {
+    const uint8_t* p = begin();
+    const uint8_t* file_end = end();
+    if (m_file.size() < 4 || std::memcmp(p, "Obj\x01", 4) != 0) {
+      log_and_throw(path + " is not an avro object container file");
+    }
+    p += 4;
+    std::string schema;
+    // the metadata map
+    while (true) {
+      int64_t count = avro_impl::read_long(p, file_end);
+      if (count == 0) break;
+      if (count < 0) {
+        count = -count;
+        avro_impl::read_long(p, file_end);
+      }
+      for (int64_t i = 0; i < count; ++i) {
+        std::string key = read_bytes(p, file_end);
+        std::string value = read_bytes(p, file_end);
+        if (key == "avro.schema") schema = value;
+        else if (key == "avro.codec") m_codec = value;
+      }
+    }
+    if (file_end - p < 16) avro_impl::corrupt("truncated header");
+    std::memcpy(m_sync, p, 16);
+    m_header_end = (p + 16) - begin();
+    if (m_codec.empty()) m_codec = "null";
+    if (schema.empty()) avro_impl::corrupt("no schema");
+    parse_schema(schema);
+  }
+
+  const std::string& codec() const { return m_codec; }
+
+  /// Returns true if the blocks of the codec can be decoded.
+  bool codec_supported() const { return m_codec == "null" || m_codec == "snappy"; }
+
+  const std::vector<avro_schema_node>& schema() const { return m_nodes; }
+
+  /// The root of the schema
+  const avro_schema_node& root() const { return m_nodes[0]; }
+
+  /// The size of the file
+  size_t size() const { return m_file.size(); }
+
+  /**
+   * The type of the column of a field: the type of its node, or STRING for
+   * nulls and unions of mixed types, whose values have no single type.
+   */
+  flex_type_enum column_type(size_t node_index) const {
+    flex_type_enum type = m_nodes[node_index].type;
+    return type == flex_type_enum::UNDEFINED ? flex_type_enum::STRING : type;
+  }
+
+  /**
+   * Converts a decoded value of a field to its column_type(): the values
+   * of mixed unions are written as strings.
+   */
+  static flexible_type column_value(const std::vector<avro_schema_node>& schema,
+                                    size_t node_index, const flexible_type& value) {
+    if (schema[node_index].type != flex_type_enum::UNDEFINED ||
+        value.get_type() == flex_type_enum::UNDEFINED ||
+        value.get_type() == flex_type_enum::STRING) {
+      return value;
+    }
+    return value.to<flex_string>();
+  }
+
+  /**
+   * Converts a value of a node as gl_sarray::from_avro reads it, with the
+   * plain types of the schema (days and time units as integers, decimals
+   * as bytes, arrays as lists), to the value decoded by for_each_record.
+   * Values of other forms are returned unchanged.
+   */
+  static flexible_type convert(const std::vector<avro_schema_node>& schema, size_t node_index,
+                               const flexible_type& value) {
+    const avro_schema_node& node = schema[node_index];
+    flex_type_enum type = value.get_type();
+    if (type == flex_type_enum::UNDEFINED) return value;
+    switch (node.kind) {
+      case avro_schema_node::NUL:
+        return FLEX_UNDEFINED;
+      case avro_schema_node::BOOLEAN:
+      case avro_schema_node::INT:
+      case avro_schema_node::LONG:
+        if (type == flex_type_enum::INTEGER) return integer(node, value.get<flex_int>());
+        break;
+      case avro_schema_node::FLOAT:
+      case avro_schema_node::DOUBLE:
+        if (type == flex_type_enum::INTEGER) return flex_float(value.get<flex_int>());
+        break;
+      case avro_schema_node::BYTES:
+      case avro_schema_node::FIXED:
+        if (node.logical == avro_schema_node::DECIMAL && type == flex_type_enum::STRING) {
+          const flex_string& bytes = value.get<flex_string>();
+          return decimal(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(), node.scale);
+        }
+        break;
+      case avro_schema_node::UNION: {
+        // the branch is not known, unless there is one besides null
+        if (node.type == flex_type_enum::UNDEFINED) break;
+        for (size_t child: node.children) {
+          if (schema[child].kind == avro_schema_node::NUL) continue;
+          flexible_type ret = convert(schema, child, value);
+          if (node.type == flex_type_enum::FLOAT && ret.get_type() == flex_type_enum::INTEGER) {
+            return flex_float(ret.get<flex_int>());
+          }
+          return ret;
+        }
+        break;
+      }
+      case avro_schema_node::RECORD:
+      case avro_schema_node::MAP:
+        if (type == flex_type_enum::DICT) {
+          flex_dict ret = value.get<flex_dict>();
+          for (auto& item: ret) {
+            size_t child = node.children.empty() ? 0 : node.children[0];
+            if (node.kind == avro_schema_node::RECORD) {
+              if (item.first.get_type() != flex_type_enum::STRING) continue;
+              auto field = std::find(node.names.begin(), node.names.end(),
+                                     item.first.get<flex_string>());
+              if (field == node.names.end()) continue;
+              child = node.children[field - node.names.begin()];
+            }
+            item.second = convert(schema, child, item.second);
+          }
+          return ret;
+        }
+        break;
+      case avro_schema_node::ARRAY:
+        if (type == flex_type_enum::LIST && node.type == flex_type_enum::VECTOR) {
+          const flex_list& list = value.get<flex_list>();
+          flex_vec ret;
+          ret.reserve(list.size());
+          for (const auto& item: list) {
+            if (item.get_type() == flex_type_enum::INTEGER) ret.push_back(item.get<flex_int>());
+            else if (item.get_type() == flex_type_enum::FLOAT) ret.push_back(item.get<flex_float>());
+            else return value;
+          }
+          return ret;
+        } else if (type == flex_type_enum::LIST) {
+          flex_list ret = value.get<flex_list>();
+          for (auto& item: ret) item = convert(schema, node.children[0], item);
+          return ret;
+        }
+        break;
+      default:
+        break;
+    }
+    return value;
+  }
+
+  /**
+   * Returns the offsets of the first block starting at or after begin, and
+   * of the first block starting at or after end: the blocks which start
+   * in [begin, end). Blocks start after the header and after each sync
+   * marker; a candidate sync marker inside the data of a block is
+   * rejected by checking that the block it would start is followed by
+   * the sync marker.
+   */
+  std::pair<size_t, size_t> block_range(size_t begin, size_t end) const {
+    return {next_block(begin), next_block(end)};
+  }
+
+  /**
+   * Decodes the blocks in [begin, end) (offsets from block_range()),
+   * calling fn(row) with the fields of each top level record.
+   */
+  template <typename Fn>
+  void for_each_record(size_t begin, size_t end, Fn fn) const {
+    std::string buffer;
+    std::vector<flexible_type> row(root().children.size());
+    const uint8_t* p = this->begin() + begin;
+    while (size_t(p - this->begin()) < end) {
+      int64_t count = avro_impl::read_long(p, this->end());
+      int64_t length = avro_impl::read_long(p, this->end());
+      if (count < 0 || length < 0 || length > this->end() - p ||
+          this->end() - p - length < 16 || std::memcmp(p + length, m_sync, 16) != 0) {
+        avro_impl::corrupt("bad block");
+      }
+      const uint8_t* data = p;
+      const uint8_t* data_end = p + length;
+      p = data_end + 16;
+      if (m_codec == "snappy") {
+        // a snappy block followed by the big endian crc32 of its data
+        if (length < 4 || !snappy_decompress(data, data_end - 4, buffer)) {
+          avro_impl::corrupt("bad snappy block");
+        }
+        data = reinterpret_cast<const uint8_t*>(buffer.data());
+        data_end = data + buffer.size();
+      } else if (m_codec != "null") {
+        log_and_throw("Unsupported avro codec " + m_codec);
+      }
+      for (int64_t i = 0; i < count; ++i) {
+        for (size_t f = 0; f < row.size(); ++f) {
+          row[f] = decode(root().children[f], data, data_end);
+        }
+        fn(row);
+      }
+      if (data != data_end) avro_impl::corrupt("bad block length");
+    }
+  }
+
+ private:
+  const uint8_t* begin() const { return reinterpret_cast<const uint8_t*>(m_file.data()); }
+  const uint8_t* end() const { return begin() + m_file.size(); }
+
+  static std::string read_bytes(const uint8_t*& p, const uint8_t* end) {
+    int64_t length = avro_impl::read_long(p, end);
+    if (length < 0 || length > end - p) avro_impl::corrupt("truncated value");
+    std::string ret(reinterpret_cast<const char*>(p), length);
+    p += length;
+    return ret;
+  }
+
+  /// Returns true if a valid block starts at offset.
+  bool is_block(size_t offset) const {
+    try {
+      const uint8_t* p = begin() + offset;
+      int64_t count = avro_impl::read_long(p, end());
+      int64_t length = avro_impl::read_long(p, end());
+      return count >= 0 && length >= 0 && length <= end() - p && end() - p - length >= 16 &&
+             std::memcmp(p + length, m_sync, 16) == 0;
+    } catch (...) {
+      return false;
+    }
+  }
+
+  size_t next_block(size_t offset) const {
+    if (offset <= m_header_end) return m_header_end;
+    // a block starting at offset follows a sync marker at offset - 16
+    size_t position = offset - 16;
+    while (position + 16 < m_file.size()) {
+      const void* found = memmem(begin() + position, m_file.size() - position, m_sync, 16);
+      if (found == nullptr) break;
+      size_t start = (static_cast<const uint8_t*>(found) - begin()) + 16;
+      if (start >= m_file.size() || is_block(start)) return std::min(start, m_file.size());
+      position = start - 15;
+    }
+    return m_file.size();
+  }
+
+  flexible_type decode(size_t node_index, const uint8_t*& p, const uint8_t* end) const {
+    const avro_schema_node& node = m_nodes[node_index];
+    switch (node.kind) {
+      case avro_schema_node::NUL:
+        return FLEX_UNDEFINED;
+      case avro_schema_node::BOOLEAN:
+        if (p >= end) avro_impl::corrupt("truncated value");
+        return flex_int(*p++ != 0);
+      case avro_schema_node::INT:
+      case avro_schema_node::LONG:
+        return integer(node, avro_impl::read_long(p, end));
+      case avro_schema_node::FLOAT: {
+        if (end - p < 4) avro_impl::corrupt("truncated value");
+        float value;
+        std::memcpy(&value, p, 4);
+        p += 4;
+        return flex_float(value);
+      }
+      case avro_schema_node::DOUBLE: {
+        if (end - p < 8) avro_impl::corrupt("truncated value");
+        double value;
+        std::memcpy(&value, p, 8);
+        p += 8;
+        return flex_float(value);
+      }
+      case avro_schema_node::BYTES:
+      case avro_schema_node::STRING:
+      case avro_schema_node::FIXED: {
+        size_t length = node.size;
+        if (node.kind != avro_schema_node::FIXED) {
+          int64_t value = avro_impl::read_long(p, end);
+          if (value < 0) avro_impl::corrupt("negative length");
+          length = value;
+        }
+        if (length > size_t(end - p)) avro_impl::corrupt("truncated value");
+        const uint8_t* bytes = p;
+        p += length;
+        if (node.logical == avro_schema_node::DECIMAL) return decimal(bytes, length, node.scale);
+        return flex_string(reinterpret_cast<const char*>(bytes), length);
+      }
+      case avro_schema_node::ENUM: {
+        int64_t index = avro_impl::read_long(p, end);
+        if (index < 0 || size_t(index) >= node.names.size()) avro_impl::corrupt("bad enum symbol");
+        return flex_string(node.names[index]);
+      }
+      case avro_schema_node::UNION: {
+        int64_t branch = avro_impl::read_long(p, end);
+        if (branch < 0 || size_t(branch) >= node.children.size()) avro_impl::corrupt("bad union branch");
+        flexible_type value = decode(node.children[branch], p, end);
+        // unions of int and float types are all floats
+        if (node.type == flex_type_enum::FLOAT && value.get_type() == flex_type_enum::INTEGER) {
+          return flex_float(value.get<flex_int>());
+        }
+        return value;
+      }
+      case avro_schema_node::RECORD: {
+        flex_dict ret;
+        ret.reserve(node.children.size());
+        for (size_t i = 0; i < node.children.size(); ++i) {
+          ret.emplace_back(flex_string(node.names[i]), decode(node.children[i], p, end));
+        }
+        return ret;
+      }
+      case avro_schema_node::ARRAY:
+      case avro_schema_node::MAP: {
+        flex_vec vec;
+        flex_list list;
+        flex_dict dict;
+        // blocks of items, ending with an empty block
+        while (true) {
+          int64_t count = avro_impl::read_long(p, end);
+          if (count == 0) break;
+          if (count < 0) {
+            count = -count;
+            avro_impl::read_long(p, end);
+          }
+          for (int64_t i = 0; i < count; ++i) {
+            if (node.kind == avro_schema_node::MAP) {
+              int64_t length = avro_impl::read_long(p, end);
+              if (length < 0 || length > end - p) avro_impl::corrupt("truncated value");
+              flex_string key(reinterpret_cast<const char*>(p), length);
+              p += length;
+              dict.emplace_back(std::move(key), decode(node.children[0], p, end));
+            } else if (node.type == flex_type_enum::VECTOR) {
+              flexible_type item = decode(node.children[0], p, end);
+              vec.push_back(item.get_type() == flex_type_enum::INTEGER ?
+                            double(item.get<flex_int>()) : item.get<flex_float>());
+            } else {
+              list.push_back(decode(node.children[0], p, end));
+            }
+          }
+        }
+        if (node.kind == avro_schema_node::MAP) return dict;
+        if (node.type == flex_type_enum::VECTOR) return vec;
+        return list;
+      }
+    }
+    return FLEX_UNDEFINED;
+  }
+
+  /// An int or a long, with its date or timestamp logical type
+  static flexible_type integer(const avro_schema_node& node, int64_t value) {
+    switch (node.logical) {
+      case avro_schema_node::DATE:
+        return flex_date_time(value * 86400);
+      case avro_schema_node::TIMESTAMP_MILLIS:
+      case avro_schema_node::LOCAL_TIMESTAMP_MILLIS:
+        return timestamp(value, 1000, node.logical == avro_schema_node::TIMESTAMP_MILLIS);
+      case avro_schema_node::TIMESTAMP_MICROS:
+      case avro_schema_node::LOCAL_TIMESTAMP_MICROS:
+        return timestamp(value, 1000000, node.logical == avro_schema_node::TIMESTAMP_MICROS);
+      default:
+        return flex_int(value);
+    }
+  }
+
+  static flexible_type timestamp(int64_t value, int64_t per_second, bool utc) {
+    int64_t seconds = value / per_second;
+    int64_t fraction = value % per_second;
+    if (fraction < 0) {
+      fraction += per_second;
+      --seconds;
+    }
+    return flex_date_time(seconds, utc ? 0 : flex_date_time::EMPTY_TIMEZONE,
+                          int32_t(fraction * (1000000 / per_second)));
+  }
+
+  static flexible_type decimal(const uint8_t* p, size_t length, int scale) {
+    // big endian two's complement unscaled value
+    double value = 0;
+    for (size_t i = 0; i < length; ++i) value = value * 256 + p[i];
+    if (length > 0 && (p[0] & 0x80)) value -= std::pow(2.0, 8.0 * length);
+    return flex_float(value / std::pow(10.0, scale));
+  }
+
+  void parse_schema(const std::string& text) {
+    avro_impl::json_value schema = avro_impl::json_parser(text).parse();
+    std::map<std::string, size_t> named;
+    parse_node(schema, "", named);
+    for (size_t i = 0; i < m_nodes.size(); ++i) resolve_type(i);
+  }
+
+  static std::string full_name(const avro_impl::json_value& json, const std::string& space) {
+    std::string name = json.string_member("name");
+    if (name.find('.') != std::string::npos) return name;
+    std::string name_space = json.find("namespace") ? json.string_member("namespace") : space;
+    return name_space.empty() ? name : name_space + "." + name;
+  }
+
+  size_t parse_node(const avro_impl::json_value& json, const std::string& space,
+                    std::map<std::string, size_t>& named) {
+    using avro_impl::json_value;
+    size_t index = m_nodes.size();
+    m_nodes.emplace_back();
+    if (json.kind == json_value::ARRAY) {
+      m_nodes[index].kind = avro_schema_node::UNION;
+      for (const auto& branch: json.items) {
+        size_t child = parse_node(branch, space, named);
+        m_nodes[index].children.push_back(child);
+      }
+      return index;
+    }
+    std::string type_name = json.kind == json_value::STRING ? json.str :
+                            json.kind == json_value::OBJECT ? json.string_member("type") : "";
+    if (json.kind == json_value::OBJECT && json.find("type") &&
+        json.find("type")->kind != json_value::STRING) {
+      // {"type": {...}} wraps another schema
+      m_nodes.pop_back();
+      return parse_node(*json.find("type"), space, named);
+    }
+    static const std::vector<std::string> kinds{
+      "null", "boolean", "int", "long", "float", "double", "bytes", "string",
+      "record", "enum", "array", "map", "union", "fixed"};
+    auto kind = std::find(kinds.begin(), kinds.end(), type_name);
+    if (kind == kinds.end() || *kind == "union") {
+      // a reference to a named type
+      auto found = named.find(type_name);
+      if (found == named.end() && !space.empty()) found = named.find(space + "." + type_name);
+      if (found == named.end()) log_and_throw("Unknown avro type " + type_name);
+      m_nodes.pop_back();
+      return found->second;
+    }
+    m_nodes[index].kind = avro_schema_node::kind_type(kind - kinds.begin());
+    if (json.kind != json_value::OBJECT) return index;
+
+    std::string logical = json.string_member("logicalType");
+    auto kind_value = m_nodes[index].kind;
+    bool is_int = kind_value == avro_schema_node::INT;
+    bool is_long = kind_value == avro_schema_node::LONG;
+    if (logical == "date" && is_int) m_nodes[index].logical = avro_schema_node::DATE;
+    else if (logical == "timestamp-millis" && is_long) m_nodes[index].logical = avro_schema_node::TIMESTAMP_MILLIS;
+    else if (logical == "timestamp-micros" && is_long) m_nodes[index].logical = avro_schema_node::TIMESTAMP_MICROS;
+    else if (logical == "local-timestamp-millis" && is_long) m_nodes[index].logical = avro_schema_node::LOCAL_TIMESTAMP_MILLIS;
+    else if (logical == "local-timestamp-micros" && is_long) m_nodes[index].logical = avro_schema_node::LOCAL_TIMESTAMP_MICROS;
+    else if (logical == "decimal" && (kind_value == avro_schema_node::BYTES ||
+                                      kind_value == avro_schema_node::FIXED)) {
+      m_nodes[index].logical = avro_schema_node::DECIMAL;
+      m_nodes[index].scale = int(json.number_member("scale", 0));
+    }
+
+    std::string name_space = space;
+    if (kind_value == avro_schema_node::RECORD || kind_value == avro_schema_node::ENUM ||
+        kind_value == avro_schema_node::FIXED) {
+      std::string name = full_name(json, space);
+      named[name] = index;
+      size_t dot = name.rfind('.');
+      name_space = dot == std::string::npos ? "" : name.substr(0, dot);
+    }
+    switch (kind_value) {
+      case avro_schema_node::RECORD: {
+        const json_value* fields = json.find("fields");
+        if (fields == nullptr || fields->kind != json_value::ARRAY) avro_impl::corrupt("record without fields");
+        for (const auto& field: fields->items) {
+          const json_value* field_type = field.find("type");
+          if (field_type == nullptr) avro_impl::corrupt("field without type");
+          size_t child = parse_node(*field_type, name_space, named);
+          m_nodes[index].names.push_back(field.string_member("name"));
+          m_nodes[index].children.push_back(child);
+        }
+        break;
+      }
+      case avro_schema_node::ENUM: {
+        const json_value* symbols = json.find("symbols");
+        if (symbols == nullptr) avro_impl::corrupt("enum without symbols");
+        for (const auto& symbol: symbols->items) m_nodes[index].names.push_back(symbol.str);
+        break;
+      }
+      case avro_schema_node::FIXED:
+        m_nodes[index].size = size_t(json.number_member("size", 0));
+        break;
+      case avro_schema_node::ARRAY:
+      case avro_schema_node::MAP: {
+        const json_value* child = json.find(kind_value == avro_schema_node::ARRAY ? "items" : "values");
+        if (child == nullptr) avro_impl::corrupt("array or map without item type");
+        size_t child_index = parse_node(*child, name_space, named);
+        m_nodes[index].children.push_back(child_index);
+        break;
+      }
+      default:
+        break;
+    }
+    return index;
+  }
+
+  /// Sets the gl_sframe type of a node, from the types of its children.
+  void resolve_type(size_t index) {
+    avro_schema_node& node = m_nodes[index];
+    switch (node.kind) {
+      case avro_schema_node::NUL:
+        node.type = flex_type_enum::UNDEFINED;
+        break;
+      case avro_schema_node::BOOLEAN:
+      case avro_schema_node::INT:
+      case avro_schema_node::LONG:
+        node.type = node.logical == avro_schema_node::NONE ? flex_type_enum::INTEGER
+                                                           : flex_type_enum::DATETIME;
+        break;
+      case avro_schema_node::FLOAT:
+      case avro_schema_node::DOUBLE:
+        node.type = flex_type_enum::FLOAT;
+        break;
+      case avro_schema_node::BYTES:
+      case avro_schema_node::FIXED:
+        node.type = node.logical == avro_schema_node::DECIMAL ? flex_type_enum::FLOAT
+                                                              : flex_type_enum::STRING;
+        break;
+      case avro_schema_node::STRING:
+      case avro_schema_node::ENUM:
+        node.type = flex_type_enum::STRING;
+        break;
+      case avro_schema_node::RECORD:
+      case avro_schema_node::MAP:
+        node.type = flex_type_enum::DICT;
+        break;
+      case avro_schema_node::ARRAY: {
+        const avro_schema_node& item = m_nodes[node.children[0]];
+        bool numeric = item.logical == avro_schema_node::NONE &&
+                       (item.kind == avro_schema_node::INT || item.kind == avro_schema_node::LONG ||
+                        item.kind == avro_schema_node::FLOAT || item.kind == avro_schema_node::DOUBLE);
+        node.type = numeric ? flex_type_enum::VECTOR : flex_type_enum::LIST;
+        break;
+      }
+      case avro_schema_node::UNION: {
+        // the branches are resolved first; named types are never unions
+        flex_type_enum type = flex_type_enum::UNDEFINED;
+        bool mixed = false;
+        for (size_t child: node.children) {
+          if (m_nodes[child].kind != avro_schema_node::UNION) resolve_type(child);
+          flex_type_enum child_type = m_nodes[child].type;
+          if (m_nodes[child].kind == avro_schema_node::NUL) continue;
+          if (type == flex_type_enum::UNDEFINED && !mixed) {
+            type = child_type;
+          } else if (type != child_type) {
+            bool numbers = (type == flex_type_enum::INTEGER || type == flex_type_enum::FLOAT) &&
+                           (child_type == flex_type_enum::INTEGER || child_type == flex_type_enum::FLOAT);
+            if (numbers) {
+              type = flex_type_enum::FLOAT;
+            } else {
+              type = flex_type_enum::UNDEFINED;
+              mixed = true;
+            }
+          }
+        }
+        node.type = type;
+        break;
+      }
+    }
+  }
+
+  mapped_file m_file;
+  std::string m_codec;
+  char m_sync[16];
+  size_t m_header_end = 0;
+  std::vector<avro_schema_node> m_nodes;
+};
+
+} // namespace graphlab
+#endif
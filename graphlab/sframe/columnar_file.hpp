@@ -0,0 +1,1356 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SFRAME_COLUMNAR_FILE_HPP
+#define GRAPHLAB_SFRAME_COLUMNAR_FILE_HPP
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/fileio/mapped_file.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+/**
+ * \ingroup sframe_physical
+ * A columnar file is an Arrow IPC file (the format of Feather V2 files):
+ * a schema, then batches of rows holding each column as a few flat little
+ * endian buffers, which a reader mapping the file uses in place. Every
+ * buffer starts at a multiple of 64 bytes, and nothing is compressed.
+ *
+ * Columns are written as these Arrow types, and buffer 0 of every column
+ * is its validity bitmap, empty if no value of the column is missing:
+ *
+ * - Integers are Int64 (buffer 1), floats are Double (buffer 1).
+ * - Datetimes are Timestamp microseconds in UTC (buffer 1). Each is
+ *   followed by an Int8 field of the time zone offsets of its values in
+ *   15 minute units, null where a value has no time zone, and tagged with
+ *   the custom metadata "graphlab.time_zone_offsets" whose value is the
+ *   name of the datetime column.
+ * - Strings are LargeUtf8, int64 offsets (buffer 1) into their bytes
+ *   (buffer 2), or dictionary encoded: Int64 indices (buffer 1) into a
+ *   LargeUtf8 dictionary. Each batch appends its distinct strings to the
+ *   dictionary as a delta dictionary batch, and indexes those.
+ * - Vectors are LargeList of Double, int64 offsets (buffer 1) into the
+ *   doubles of the child field (buffer 2).
+ *
+ * Whether a string column is dictionary encoded is decided by its first
+ * batch. Files written by other Arrow writers are read if their columns
+ * have these types, and the indices of each batch of a dictionary encoded
+ * column fall in a single dictionary batch.
+ */
+enum class columnar_encoding: uint8_t {
+  PLAIN = 0,
+  DICTIONARY = 1
+};
+
+/**
+ * The buffers of one column of one batch, encoded in memory. A dictionary
+ * encoded column holds its indices (buffer 1) into the offsets (buffer 2)
+ * and bytes (buffer 3) of the distinct strings of the batch, and a
+ * datetime column with a time zone holds the int8 time zone offsets of its
+ * values (buffer 2), flex_date_time::EMPTY_TIMEZONE for none.
+ */
+struct columnar_encoded_chunk {
+  columnar_encoding encoding = columnar_encoding::PLAIN;
+  size_t null_count = 0;
+  std::vector<std::string> buffers;
+};
+
+inline bool columnar_type_supported(flex_type_enum type) {
+  return type == flex_type_enum::INTEGER || type == flex_type_enum::FLOAT ||
+      type == flex_type_enum::DATETIME || type == flex_type_enum::STRING ||
+      type == flex_type_enum::VECTOR;
+}
+
+namespace columnar_impl {
+
+inline void invalid(const std::string& what) {
+  log_and_throw("Invalid Arrow file: " + what);
+}
+
+template <typename T>
+inline void store(std::string& buffer, size_t index, const T& value) {
+  std::memcpy(&buffer[index * sizeof(T)], &value, sizeof(T));
+}
+
+template <typename T>
+inline T load(const char* data, size_t index = 0) {
+  T value;
+  std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+  return value;
+}
+
+/**
+ * Encodes a column of strings, with a dictionary if there are fewer than
+ * max_dictionary_ratio distinct values per value.
+ */
+inline void encode_strings(const std::vector<flexible_type>& values,
+                           double max_dictionary_ratio, columnar_encoded_chunk& chunk) {
+  size_t n = values.size();
+  size_t max_dictionary_size = size_t(n * max_dictionary_ratio);
+  std::unordered_map<flex_string, int64_t> dictionary;
+  std::string indices(n * sizeof(int64_t), 0);
+  bool use_dictionary = true;
+  for (size_t i = 0; i < n && use_dictionary; ++i) {
+    if (values[i].get_type() == flex_type_enum::UNDEFINED) continue;
+    auto ins = dictionary.insert({values[i].get<flex_string>(), int64_t(dictionary.size())});
+    store(indices, i, ins.first->second);
+    use_dictionary = dictionary.size() <= max_dictionary_size;
+  }
+  if (use_dictionary) {
+    std::vector<const flex_string*> entries(dictionary.size());
+    size_t total = 0;
+    for (const auto& entry: dictionary) {
+      entries[entry.second] = &entry.first;
+      total += entry.first.size();
+    }
+    std::string offsets((entries.size() + 1) * sizeof(int64_t), 0);
+    std::string data;
+    data.reserve(total);
+    for (size_t i = 0; i < entries.size(); ++i) {
+      store(offsets, i, int64_t(data.size()));
+      data.append(*entries[i]);
+    }
+    store(offsets, entries.size(), int64_t(data.size()));
+    chunk.encoding = columnar_encoding::DICTIONARY;
+    chunk.buffers.push_back(std::move(indices));
+    chunk.buffers.push_back(std::move(offsets));
+    chunk.buffers.push_back(std::move(data));
+  } else {
+    std::string offsets((n + 1) * sizeof(int64_t), 0);
+    std::string data;
+    for (size_t i = 0; i < n; ++i) {
+      store(offsets, i, int64_t(data.size()));
+      if (values[i].get_type() != flex_type_enum::UNDEFINED) {
+        data.append(values[i].get<flex_string>());
+      }
+    }
+    store(offsets, n, int64_t(data.size()));
+    chunk.buffers.push_back(std::move(offsets));
+    chunk.buffers.push_back(std::move(data));
+  }
+}
+
+/**
+ * A flatbuffer object being built: a table, a string, a vector of objects,
+ * or a vector of structs. Table fields are scalars, or offsets to other
+ * objects.
+ */
+struct fb_object {
+  enum kind_enum { TABLE, STRING, VECTOR, STRUCTS };
+  struct field {
+    uint16_t id;
+    /// 1, 2, 4 or 8 for a scalar, 0 for an offset to "child".
+    uint8_t size;
+    uint64_t value;
+    std::shared_ptr<fb_object> child;
+  };
+
+  kind_enum kind = TABLE;
+  std::vector<field> fields;
+  /// The bytes of a string, or the structs of a vector.
+  std::string bytes;
+  uint32_t count = 0;
+  std::vector<std::shared_ptr<fb_object> > elements;
+
+  template <typename T>
+  fb_object& add(uint16_t id, T value) {
+    field f{id, uint8_t(sizeof(T)), 0, nullptr};
+    std::memcpy(&f.value, &value, sizeof(T));
+    fields.push_back(f);
+    return *this;
+  }
+  fb_object& add(uint16_t id, std::shared_ptr<fb_object> child) {
+    fields.push_back({id, 0, 0, child});
+    return *this;
+  }
+};
+
+typedef std::shared_ptr<fb_object> fb_ref;
+
+inline fb_ref fb_table() { return std::make_shared<fb_object>(); }
+
+inline fb_ref fb_string(const std::string& value) {
+  auto ret = std::make_shared<fb_object>();
+  ret->kind = fb_object::STRING;
+  ret->bytes = value;
+  return ret;
+}
+
+inline fb_ref fb_vector(const std::vector<fb_ref>& elements) {
+  auto ret = std::make_shared<fb_object>();
+  ret->kind = fb_object::VECTOR;
+  ret->elements = elements;
+  return ret;
+}
+
+/// A vector of structs of 8 byte aligned fields.
+template <typename T>
+inline fb_ref fb_structs(const std::vector<T>& structs) {
+  auto ret = std::make_shared<fb_object>();
+  ret->kind = fb_object::STRUCTS;
+  ret->count = uint32_t(structs.size());
+  ret->bytes.assign(reinterpret_cast<const char*>(structs.data()), structs.size() * sizeof(T));
+  return ret;
+}
+
+inline void fb_align(std::string& out, size_t alignment) {
+  out.append((alignment - out.size() % alignment) % alignment, '\0');
+}
+
+template <typename T>
+inline void fb_append(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/**
+ * Writes an object, then the objects it refers to, so that every offset
+ * points forward. Returns the position of the object.
+ */
+inline size_t fb_write(std::string& out, const fb_object& object) {
+  std::vector<std::pair<size_t, const fb_object*> > references;
+  size_t pos = 0;
+  switch (object.kind) {
+    case fb_object::STRING:
+      fb_align(out, 4);
+      pos = out.size();
+      fb_append(out, uint32_t(object.bytes.size()));
+      out += object.bytes;
+      out += '\0';
+      break;
+    case fb_object::STRUCTS:
+      // the structs after the length are 8 byte aligned
+      out.append((12 - out.size() % 8) % 8, '\0');
+      pos = out.size();
+      fb_append(out, object.count);
+      out += object.bytes;
+      break;
+    case fb_object::VECTOR:
+      fb_align(out, 4);
+      pos = out.size();
+      fb_append(out, uint32_t(object.elements.size()));
+      for (const auto& element: object.elements) {
+        references.push_back({out.size(), element.get()});
+        fb_append(out, uint32_t(0));
+      }
+      break;
+    case fb_object::TABLE: {
+      // the vtable, then the table with its largest fields first
+      std::vector<const fb_object::field*> fields;
+      size_t nslots = 0;
+      for (const auto& f: object.fields) {
+        fields.push_back(&f);
+        nslots = std::max<size_t>(nslots, f.id + 1);
+      }
+      auto field_size = [](const fb_object::field* f) { return f->size ? f->size : 4; };
+      std::stable_sort(fields.begin(), fields.end(),
+                       [&](const fb_object::field* a, const fb_object::field* b) {
+                         return field_size(a) > field_size(b);
+                       });
+      fb_align(out, 2);
+      size_t vtable = out.size();
+      out.append(4 + 2 * nslots, '\0');
+      fb_align(out, 8);
+      pos = out.size();
+      fb_append(out, int32_t(pos - vtable));
+      for (const auto* f: fields) {
+        fb_align(out, field_size(f));
+        uint16_t slot = uint16_t(out.size() - pos);
+        std::memcpy(&out[vtable + 4 + 2 * f->id], &slot, sizeof(slot));
+        if (f->child) {
+          references.push_back({out.size(), f->child.get()});
+          fb_append(out, uint32_t(0));
+        } else {
+          out.append(reinterpret_cast<const char*>(&f->value), f->size);
+        }
+      }
+      uint16_t vtable_size = uint16_t(4 + 2 * nslots), table_size = uint16_t(out.size() - pos);
+      std::memcpy(&out[vtable], &vtable_size, sizeof(vtable_size));
+      std::memcpy(&out[vtable + 2], &table_size, sizeof(table_size));
+      break;
+    }
+  }
+  for (const auto& reference: references) {
+    uint32_t offset = uint32_t(fb_write(out, *reference.second) - reference.first);
+    std::memcpy(&out[reference.first], &offset, sizeof(offset));
+  }
+  return pos;
+}
+
+/// A flatbuffer whose root is "root", padded to a multiple of 8 bytes.
+inline std::string fb_finish(const fb_object& root) {
+  std::string out(4, '\0');
+  uint32_t pos = uint32_t(fb_write(out, root));
+  std::memcpy(&out[0], &pos, sizeof(pos));
+  fb_align(out, 8);
+  return out;
+}
+
+/**
+ * A table of a flatbuffer in memory. Every access is checked against the
+ * bounds of the buffer, and throws if it leads out of them.
+ */
+class fb_table_view {
+ public:
+  fb_table_view() { }
+
+  /// The root table of the flatbuffer of "length" bytes at "data".
+  fb_table_view(const char* data, size_t length): m_data(data), m_length(length) {
+    check(0, 4);
+    set_position(load<uint32_t>(data));
+  }
+
+  bool valid() const { return m_data != nullptr; }
+
+  template <typename T>
+  T get(size_t id, T default_value = T()) const {
+    size_t offset = field_offset(id);
+    if (offset == 0) return default_value;
+    check(m_pos + offset, sizeof(T));
+    return load<T>(m_data + m_pos + offset);
+  }
+
+  /// A child table, not valid if absent.
+  fb_table_view table(size_t id) const {
+    size_t pos = 0;
+    if (!follow(id, pos)) return fb_table_view();
+    return fb_table_view(m_data, m_length, pos);
+  }
+
+  std::string string(size_t id) const {
+    size_t pos = 0, count = 0;
+    if (!follow(id, pos)) return std::string();
+    count = vector_length(pos, 1);
+    return std::string(m_data + pos + 4, count);
+  }
+
+  /// The number of elements of a vector, 0 if absent.
+  size_t vector_size(size_t id) const {
+    size_t pos = 0;
+    if (!follow(id, pos)) return 0;
+    return vector_length(pos, 4);
+  }
+
+  /// Element i of a vector of tables.
+  fb_table_view table_at(size_t id, size_t i) const {
+    size_t pos = 0;
+    if (!follow(id, pos) || i >= vector_length(pos, 4)) invalid("vector index out of range");
+    size_t element = pos + 4 + 4 * i;
+    return fb_table_view(m_data, m_length, element + load<uint32_t>(m_data + element));
+  }
+
+  /// The structs of a vector of structs of struct_size bytes.
+  const char* structs(size_t id, size_t struct_size, size_t& count) const {
+    size_t pos = 0;
+    count = 0;
+    if (!follow(id, pos)) return nullptr;
+    count = vector_length(pos, struct_size);
+    return m_data + pos + 4;
+  }
+
+ private:
+  fb_table_view(const char* data, size_t length, size_t pos): m_data(data), m_length(length) {
+    set_position(pos);
+  }
+
+  void check(size_t pos, size_t size) const {
+    if (pos > m_length || size > m_length - pos) invalid("metadata out of bounds");
+  }
+
+  void set_position(size_t pos) {
+    check(pos, 4);
+    m_pos = pos;
+    int64_t vtable = int64_t(pos) - load<int32_t>(m_data + pos);
+    if (vtable < 0) invalid("metadata out of bounds");
+    m_vtable = size_t(vtable);
+    check(m_vtable, 4);
+    m_vtable_size = load<uint16_t>(m_data + m_vtable);
+    check(m_vtable, m_vtable_size);
+  }
+
+  size_t field_offset(size_t id) const {
+    if (4 + 2 * id + 2 > m_vtable_size) return 0;
+    return load<uint16_t>(m_data + m_vtable + 4 + 2 * id);
+  }
+
+  bool follow(size_t id, size_t& pos) const {
+    size_t offset = field_offset(id);
+    if (offset == 0) return false;
+    check(m_pos + offset, 4);
+    pos = m_pos + offset + load<uint32_t>(m_data + m_pos + offset);
+    return true;
+  }
+
+  /// The length of the vector at pos, of elements of element_size bytes.
+  size_t vector_length(size_t pos, size_t element_size) const {
+    check(pos, 4);
+    size_t count = load<uint32_t>(m_data + pos);
+    if (count > (m_length - pos - 4) / element_size) invalid("metadata out of bounds");
+    return count;
+  }
+
+  const char* m_data = nullptr;
+  size_t m_length = 0;
+  size_t m_pos = 0;
+  size_t m_vtable = 0;
+  size_t m_vtable_size = 0;
+};
+
+/// The numbers of the Arrow flatbuffer schema used here.
+namespace arrow {
+enum message_header { SCHEMA = 1, DICTIONARY_BATCH = 2, RECORD_BATCH = 3 };
+enum type { INT = 2, FLOATING_POINT = 3, TIMESTAMP = 10, LARGE_UTF8 = 20, LARGE_LIST = 21 };
+enum { METADATA_V5 = 4, DOUBLE = 2, MICROSECOND = 2 };
+
+struct field_node { int64_t length; int64_t null_count; };
+struct buffer { int64_t offset; int64_t length; };
+struct block { int64_t offset; int32_t metadata_length; int32_t padding; int64_t body_length; };
+
+/// The custom metadata key of the time zone offsets of a datetime column.
+inline const char* time_zone_offsets_key() { return "graphlab.time_zone_offsets"; }
+} // namespace arrow
+
+} // namespace columnar_impl
+
+/**
+ * Encodes the values of one column of a batch, of the given column type.
+ */
+inline columnar_encoded_chunk encode_columnar_chunk(const std::vector<flexible_type>& values,
+                                                    flex_type_enum type,
+                                                    double max_dictionary_ratio = 0.5) {
+  using columnar_impl::store;
+  size_t n = values.size();
+  columnar_encoded_chunk chunk;
+  std::string validity((n + 7) / 8, 0);
+  for (size_t i = 0; i < n; ++i) {
+    if (values[i].get_type() == flex_type_enum::UNDEFINED) {
+      ++chunk.null_count;
+    } else {
+      validity[i >> 3] |= char(1 << (i & 7));
+    }
+  }
+  chunk.buffers.push_back(chunk.null_count > 0 ? std::move(validity) : std::string());
+  auto is_missing = [&](size_t i) {
+    return values[i].get_type() == flex_type_enum::UNDEFINED;
+  };
+  switch (type) {
+    case flex_type_enum::INTEGER: {
+      std::string buffer(n * sizeof(int64_t), 0);
+      for (size_t i = 0; i < n; ++i) {
+        if (!is_missing(i)) store(buffer, i, int64_t(values[i].get<flex_int>()));
+      }
+      chunk.buffers.push_back(std::move(buffer));
+      break;
+    }
+    case flex_type_enum::FLOAT: {
+      std::string buffer(n * sizeof(double), 0);
+      for (size_t i = 0; i < n; ++i) {
+        if (!is_missing(i)) store(buffer, i, double(values[i].get<flex_float>()));
+      }
+      chunk.buffers.push_back(std::move(buffer));
+      break;
+    }
+    case flex_type_enum::DATETIME: {
+      std::string buffer(n * sizeof(int64_t), 0);
+      std::string timezones(n, char(flex_date_time::EMPTY_TIMEZONE));
+      bool any_timezone = false;
+      for (size_t i = 0; i < n; ++i) {
+        if (is_missing(i)) continue;
+        const auto& dt = values[i].get<flex_date_time>();
+        store(buffer, i, int64_t(dt.posix_timestamp() * flex_date_time::MICROSECONDS_PER_SECOND +
+                                 dt.microsecond()));
+        if (dt.time_zone_offset() != flex_date_time::EMPTY_TIMEZONE) {
+          timezones[i] = char(dt.time_zone_offset());
+          any_timezone = true;
+        }
+      }
+      chunk.buffers.push_back(std::move(buffer));
+      if (any_timezone) chunk.buffers.push_back(std::move(timezones));
+      break;
+    }
+    case flex_type_enum::STRING:
+      columnar_impl::encode_strings(values, max_dictionary_ratio, chunk);
+      break;
+    case flex_type_enum::VECTOR: {
+      std::string offsets((n + 1) * sizeof(int64_t), 0);
+      size_t total = 0;
+      for (size_t i = 0; i < n; ++i) {
+        store(offsets, i, int64_t(total));
+        if (!is_missing(i)) total += values[i].get<flex_vec>().size();
+      }
+      store(offsets, n, int64_t(total));
+      std::string data(total * sizeof(double), 0);
+      size_t position = 0;
+      for (size_t i = 0; i < n; ++i) {
+        if (is_missing(i)) continue;
+        const auto& vec = values[i].get<flex_vec>();
+        if (!vec.empty()) std::memcpy(&data[position], vec.data(), vec.size() * sizeof(double));
+        position += vec.size() * sizeof(double);
+      }
+      chunk.buffers.push_back(std::move(offsets));
+      chunk.buffers.push_back(std::move(data));
+      break;
+    }
+    default:
+      log_and_throw("Columnar files cannot hold a column of type " +
+                    std::string(flex_type_enum_to_name(type)));
+  }
+  return chunk;
+}
+
+/**
+ * Writes a columnar file, one batch at a time.
+ */
+class columnar_file_writer {
+ public:
+  columnar_file_writer(const std::string& path,
+                       const std::vector<std::string>& column_names,
+                       const std::vector<flex_type_enum>& column_types)
+      : m_path(path), m_column_names(column_names), m_column_types(column_types),
+        m_dictionary(column_names.size(), false),
+        m_dictionary_size(column_names.size(), 0),
+        m_dictionary_written(column_names.size(), false),
+        m_fout(path, std::ios::binary) {
+    if (!m_fout.good()) log_and_throw("Unable to open " + path + " for writing");
+    for (auto type: column_types) {
+      if (!columnar_type_supported(type)) {
+        log_and_throw("Columnar files cannot hold a column of type " +
+                      std::string(flex_type_enum_to_name(type)));
+      }
+    }
+    m_fout.write(magic(), 6);
+    m_fout.write("\0\0", 2);
+    m_position = 8;
+  }
+
+  /**
+   * Appends a batch of num_rows rows, with one chunk per column.
+   */
+  void write_batch(size_t num_rows, const std::vector<columnar_encoded_chunk>& chunks) {
+    using namespace columnar_impl;
+    ASSERT_EQ(chunks.size(), m_column_names.size());
+    if (!m_schema_written) {
+      for (size_t c = 0; c < chunks.size(); ++c) {
+        m_dictionary[c] = chunks[c].encoding == columnar_encoding::DICTIONARY;
+      }
+      write_schema();
+    }
+    body b;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+      const columnar_encoded_chunk& chunk = chunks[c];
+      const auto& buffers = chunk.buffers;
+      b.nodes.push_back({int64_t(num_rows), int64_t(chunk.null_count)});
+      b.buffers.push_back(&buffers[0]);
+      switch (m_column_types[c]) {
+        case flex_type_enum::DATETIME:
+          b.buffers.push_back(&buffers[1]);
+          add_time_zones(num_rows, chunk, b);
+          break;
+        case flex_type_enum::STRING:
+          if (m_dictionary[c]) add_dictionary_indices(c, num_rows, chunk, b);
+          else add_strings(num_rows, chunk, b);
+          break;
+        case flex_type_enum::VECTOR: {
+          // the doubles are a child field without missing values
+          int64_t total = int64_t(buffers[2].size() / sizeof(double));
+          b.buffers.push_back(&buffers[1]);
+          b.nodes.push_back({total, 0});
+          b.buffers.push_back(&m_empty);
+          b.buffers.push_back(&buffers[2]);
+          break;
+        }
+        default:
+          b.buffers.push_back(&buffers[1]);
+          break;
+      }
+    }
+    m_batches.push_back(write_record_batch(arrow::RECORD_BATCH, -1, num_rows, b));
+    if (!m_fout.good()) log_and_throw("Error writing " + m_path);
+  }
+
+  /**
+   * Writes the footer and closes the file.
+   */
+  void close() {
+    using namespace columnar_impl;
+    if (!m_schema_written) write_schema();
+    // the end of the stream of messages
+    int32_t end_of_stream[2] = {-1, 0};
+    m_fout.write(reinterpret_cast<const char*>(end_of_stream), sizeof(end_of_stream));
+    auto footer = fb_table();
+    footer->add(0, int16_t(arrow::METADATA_V5))
+        .add(1, schema())
+        .add(2, fb_structs(m_dictionaries))
+        .add(3, fb_structs(m_batches));
+    std::string metadata = fb_finish(*footer);
+    int32_t footer_length = int32_t(metadata.size());
+    m_fout.write(metadata.data(), metadata.size());
+    m_fout.write(reinterpret_cast<const char*>(&footer_length), sizeof(footer_length));
+    m_fout.write(magic(), 6);
+    m_fout.close();
+    if (m_fout.fail()) log_and_throw("Error writing " + m_path);
+  }
+
+  /// The 6 bytes at the start and at the end of an Arrow file.
+  static const char* magic() { return "ARROW1"; }
+
+ private:
+  typedef columnar_impl::fb_ref fb_ref;
+
+  /// The field nodes and buffers of the body of a message.
+  struct body {
+    std::vector<columnar_impl::arrow::field_node> nodes;
+    std::vector<const std::string*> buffers;
+  };
+
+  static fb_ref int_type(int32_t bit_width) {
+    auto ret = columnar_impl::fb_table();
+    ret->add(0, bit_width).add(1, true);
+    return ret;
+  }
+
+  static fb_ref field(const std::string& name, bool nullable, uint8_t type_type, fb_ref type) {
+    auto ret = columnar_impl::fb_table();
+    ret->add(0, columnar_impl::fb_string(name)).add(1, nullable).add(2, type_type).add(3, type);
+    return ret;
+  }
+
+  fb_ref schema() const {
+    using namespace columnar_impl;
+    std::vector<fb_ref> fields;
+    for (size_t c = 0; c < m_column_names.size(); ++c) {
+      const std::string& name = m_column_names[c];
+      switch (m_column_types[c]) {
+        case flex_type_enum::INTEGER:
+          fields.push_back(field(name, true, arrow::INT, int_type(64)));
+          break;
+        case flex_type_enum::FLOAT: {
+          auto type = fb_table();
+          type->add(0, int16_t(arrow::DOUBLE));
+          fields.push_back(field(name, true, arrow::FLOATING_POINT, type));
+          break;
+        }
+        case flex_type_enum::DATETIME: {
+          auto type = fb_table();
+          type->add(0, int16_t(arrow::MICROSECOND)).add(1, fb_string("UTC"));
+          fields.push_back(field(name, true, arrow::TIMESTAMP, type));
+          auto key_value = fb_table();
+          key_value->add(0, fb_string(arrow::time_zone_offsets_key())).add(1, fb_string(name));
+          auto offsets = field(name + ".time_zone_offset", true, arrow::INT, int_type(8));
+          offsets->add(6, fb_vector({key_value}));
+          fields.push_back(offsets);
+          break;
+        }
+        case flex_type_enum::STRING: {
+          auto f = field(name, true, arrow::LARGE_UTF8, fb_table());
+          if (m_dictionary[c]) {
+            auto encoding = fb_table();
+            encoding->add(0, int64_t(c)).add(1, int_type(64)).add(2, false);
+            f->add(4, encoding);
+          }
+          fields.push_back(f);
+          break;
+        }
+        case flex_type_enum::VECTOR: {
+          auto type = fb_table();
+          type->add(0, int16_t(arrow::DOUBLE));
+          auto f = field(name, true, arrow::LARGE_LIST, fb_table());
+          f->add(5, fb_vector({field("item", false, arrow::FLOATING_POINT, type)}));
+          fields.push_back(f);
+          break;
+        }
+        default:
+          break;
+      }
+    }
+    auto ret = fb_table();
+    ret->add(0, int16_t(0)).add(1, fb_vector(fields));
+    return ret;
+  }
+
+  void write_schema() {
+    write_message(columnar_impl::arrow::SCHEMA, schema(), body());
+    m_schema_written = true;
+  }
+
+  /**
+   * The time zone offsets field of a datetime column: null where a value
+   * is missing or has no time zone.
+   */
+  void add_time_zones(size_t num_rows, const columnar_encoded_chunk& chunk, body& b) {
+    std::string validity((num_rows + 7) / 8, 0);
+    std::string offsets(num_rows, 0);
+    size_t null_count = num_rows;
+    if (chunk.buffers.size() > 2) {
+      const std::string& present = chunk.buffers[0];
+      const std::string& timezones = chunk.buffers[2];
+      for (size_t i = 0; i < num_rows; ++i) {
+        bool valid = present.empty() || ((present[i >> 3] >> (i & 7)) & 1);
+        if (valid && timezones[i] != char(flex_date_time::EMPTY_TIMEZONE)) {
+          validity[i >> 3] |= char(1 << (i & 7));
+          offsets[i] = timezones[i];
+          --null_count;
+        }
+      }
+    }
+    if (null_count == 0) validity.clear();
+    b.nodes.push_back({int64_t(num_rows), int64_t(null_count)});
+    b.buffers.push_back(keep(std::move(validity)));
+    b.buffers.push_back(keep(std::move(offsets)));
+  }
+
+  /// Plain strings, decoded from a chunk which came dictionary encoded.
+  void add_strings(size_t num_rows, const columnar_encoded_chunk& chunk, body& b) {
+    using columnar_impl::load;
+    using columnar_impl::store;
+    if (chunk.encoding == columnar_encoding::PLAIN) {
+      b.buffers.push_back(&chunk.buffers[1]);
+      b.buffers.push_back(&chunk.buffers[2]);
+      return;
+    }
+    const std::string& validity = chunk.buffers[0];
+    const char* indices = chunk.buffers[1].data();
+    const char* dictionary_offsets = chunk.buffers[2].data();
+    std::string offsets((num_rows + 1) * sizeof(int64_t), 0);
+    std::string data;
+    for (size_t i = 0; i < num_rows; ++i) {
+      store(offsets, i, int64_t(data.size()));
+      if (validity.empty() || ((validity[i >> 3] >> (i & 7)) & 1)) {
+        int64_t index = load<int64_t>(indices, i);
+        int64_t begin = load<int64_t>(dictionary_offsets, index);
+        int64_t end = load<int64_t>(dictionary_offsets, index + 1);
+        data.append(chunk.buffers[3], begin, end - begin);
+      }
+    }
+    store(offsets, num_rows, int64_t(data.size()));
+    b.buffers.push_back(keep(std::move(offsets)));
+    b.buffers.push_back(keep(std::move(data)));
+  }
+
+  /**
+   * Writes the distinct strings of a chunk as a dictionary batch of column
+   * c, the first one or a delta, and adds the indices of the chunk into the
+   * whole dictionary. A chunk which came plain has each row as an entry.
+   */
+  void add_dictionary_indices(size_t c, size_t num_rows, const columnar_encoded_chunk& chunk,
+                              body& b) {
+    using namespace columnar_impl;
+    bool plain = chunk.encoding == columnar_encoding::PLAIN;
+    const std::string& offsets = chunk.buffers[plain ? 1 : 2];
+    const std::string& data = chunk.buffers[plain ? 2 : 3];
+    size_t entries = offsets.size() / sizeof(int64_t) - 1;
+    int64_t base = m_dictionary_size[c];
+    if (entries > 0 || base == 0) {
+      body dictionary;
+      dictionary.nodes.push_back({int64_t(entries), 0});
+      dictionary.buffers = {&m_empty, &offsets, &data};
+      m_dictionaries.push_back(write_record_batch(arrow::DICTIONARY_BATCH, int64_t(c),
+                                                  entries, dictionary, m_dictionary_written[c]));
+      m_dictionary_written[c] = true;
+    }
+    std::string indices(num_rows * sizeof(int64_t), 0);
+    for (size_t i = 0; i < num_rows; ++i) {
+      int64_t index = plain ? int64_t(i) : load<int64_t>(chunk.buffers[1].data(), i);
+      store(indices, i, base + index);
+    }
+    m_dictionary_size[c] += entries;
+    b.buffers.push_back(keep(std::move(indices)));
+  }
+
+  const std::string* keep(std::string&& buffer) {
+    m_scratch.push_back(std::move(buffer));
+    return &m_scratch.back();
+  }
+
+  /**
+   * Writes a record batch of num_rows rows, or the dictionary batch of id
+   * dictionary_id whose data it is, and releases the buffers kept for it.
+   */
+  columnar_impl::arrow::block write_record_batch(uint8_t header_type, int64_t dictionary_id,
+                                                 size_t num_rows, const body& b,
+                                                 bool is_delta = false) {
+    using namespace columnar_impl;
+    std::vector<arrow::buffer> buffers;
+    int64_t offset = 0;
+    for (const std::string* buffer: b.buffers) {
+      buffers.push_back({offset, int64_t(buffer->size())});
+      offset += (buffer->size() + 63) / 64 * 64;
+    }
+    auto batch = fb_table();
+    batch->add(0, int64_t(num_rows)).add(1, fb_structs(b.nodes)).add(2, fb_structs(buffers));
+    fb_ref header = batch;
+    if (header_type == arrow::DICTIONARY_BATCH) {
+      header = fb_table();
+      header->add(0, dictionary_id).add(1, batch).add(2, is_delta);
+    }
+    auto ret = write_message(header_type, header, b);
+    if (header_type == arrow::RECORD_BATCH) m_scratch.clear();
+    return ret;
+  }
+
+  /**
+   * Writes an encapsulated message with the buffers of b as its body. The
+   * metadata is padded so that the body starts at a multiple of 64 bytes.
+   */
+  columnar_impl::arrow::block write_message(uint8_t header_type, fb_ref header, const body& b) {
+    using namespace columnar_impl;
+    int64_t body_length = 0;
+    for (const std::string* buffer: b.buffers) body_length += (buffer->size() + 63) / 64 * 64;
+    auto message = fb_table();
+    message->add(0, int16_t(arrow::METADATA_V5)).add(1, header_type).add(2, header)
+        .add(3, body_length);
+    std::string metadata = fb_finish(*message);
+    metadata.append((64 - (m_position + 8 + metadata.size()) % 64) % 64, '\0');
+    arrow::block ret{int64_t(m_position), int32_t(8 + metadata.size()), 0, body_length};
+    int32_t prefix[2] = {-1, int32_t(metadata.size())};
+    m_fout.write(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+    m_fout.write(metadata.data(), metadata.size());
+    m_position += 8 + metadata.size();
+    for (const std::string* buffer: b.buffers) {
+      m_fout.write(buffer->data(), buffer->size());
+      m_position += buffer->size();
+      pad();
+    }
+    return ret;
+  }
+
+  void pad() {
+    static const char zeros[64] = {0};
+    size_t padding = (64 - m_position % 64) % 64;
+    m_fout.write(zeros, padding);
+    m_position += padding;
+  }
+
+  std::string m_path;
+  std::vector<std::string> m_column_names;
+  std::vector<flex_type_enum> m_column_types;
+  /// Whether each string column is dictionary encoded, and the number of
+  /// entries of its dictionary.
+  std::vector<bool> m_dictionary;
+  std::vector<int64_t> m_dictionary_size;
+  std::vector<bool> m_dictionary_written;
+  std::ofstream m_fout;
+  size_t m_position = 0;
+  bool m_schema_written = false;
+  std::vector<columnar_impl::arrow::block> m_dictionaries;
+  std::vector<columnar_impl::arrow::block> m_batches;
+  /// Buffers made by the writer for the batch being written.
+  std::deque<std::string> m_scratch;
+  const std::string m_empty;
+};
+
+/**
+ * The buffers of one column of one batch of a mapped columnar file.
+ *
+ * A datetime column with time zones has their offsets in buffer 2, and
+ * their validity bitmap in buffer 3 (empty if every value has one). The
+ * indices of a dictionary encoded column are into the whole dictionary of
+ * the file: this batch uses the part of it starting at dictionary_base,
+ * whose offsets and bytes are buffers 2 and 3.
+ */
+struct columnar_column_view {
+  flex_type_enum type;
+  columnar_encoding encoding;
+  size_t num_rows;
+  size_t null_count;
+  int64_t dictionary_base = 0;
+  const uint8_t* validity;
+  const char* buffers[4];
+  size_t lengths[4];
+
+  inline bool is_valid(size_t row) const {
+    return validity == nullptr || ((validity[row >> 3] >> (row & 7)) & 1);
+  }
+
+  template <typename T>
+  inline const T* data(size_t buffer) const {
+    return reinterpret_cast<const T*>(buffers[buffer]);
+  }
+
+  /**
+   * Decodes one value.
+   */
+  inline flexible_type value(size_t row) const {
+    if (!is_valid(row)) return FLEX_UNDEFINED;
+    switch (type) {
+      case flex_type_enum::INTEGER:
+        return flex_int(data<int64_t>(1)[row]);
+      case flex_type_enum::FLOAT:
+        return flex_float(data<double>(1)[row]);
+      case flex_type_enum::DATETIME: {
+        int64_t us = data<int64_t>(1)[row];
+        int64_t seconds = us / flex_date_time::MICROSECONDS_PER_SECOND;
+        int64_t microsecond = us % flex_date_time::MICROSECONDS_PER_SECOND;
+        if (microsecond < 0) {
+          microsecond += flex_date_time::MICROSECONDS_PER_SECOND;
+          --seconds;
+        }
+        int32_t timezone = flex_date_time::EMPTY_TIMEZONE;
+        if (lengths[2] > 0 && (buffers[3] == nullptr || ((data<uint8_t>(3)[row >> 3] >> (row & 7)) & 1))) {
+          timezone = data<int8_t>(2)[row];
+        }
+        return flex_date_time(seconds, timezone, int32_t(microsecond));
+      }
+      case flex_type_enum::STRING: {
+        if (encoding == columnar_encoding::DICTIONARY) {
+          int64_t index = data<int64_t>(1)[row] - dictionary_base;
+          const int64_t* offsets = data<int64_t>(2);
+          return flex_string(buffers[3] + offsets[index], offsets[index + 1] - offsets[index]);
+        }
+        const int64_t* offsets = data<int64_t>(1);
+        return flex_string(buffers[2] + offsets[row], offsets[row + 1] - offsets[row]);
+      }
+      case flex_type_enum::VECTOR: {
+        const int64_t* offsets = data<int64_t>(1);
+        const double* values = data<double>(2);
+        return flex_vec(values + offsets[row], values + offsets[row + 1]);
+      }
+      default:
+        return FLEX_UNDEFINED;
+    }
+  }
+};
+
+/**
+ * A read only columnar file, mapped into memory. Columns are read in
+ * place through columnar_column_view, with no copy and no decoding.
+ */
+class columnar_file_reader {
+ public:
+  explicit columnar_file_reader(const std::string& path): m_file(path), m_path(path) {
+    using namespace columnar_impl;
+    m_data = m_file.data();
+    m_length = m_file.size();
+    const char* magic = columnar_file_writer::magic();
+    int32_t footer_length = 0;
+    if (m_length >= 8 + 10) {
+      footer_length = load<int32_t>(m_data + m_length - 10);
+    }
+    if (m_length < 8 + 10 ||
+        std::memcmp(m_data, magic, 6) != 0 ||
+        std::memcmp(m_data + m_length - 6, magic, 6) != 0 ||
+        footer_length < 0 || size_t(footer_length) > m_length - 18) {
+      log_and_throw(path + " is not an Arrow file");
+    }
+    fb_table_view footer(m_data + m_length - 10 - footer_length, footer_length);
+    read_schema(footer.table(1));
+    size_t count = 0;
+    const char* blocks = footer.structs(2, sizeof(arrow::block), count);
+    for (size_t i = 0; i < count; ++i) {
+      read_dictionary(load<arrow::block>(blocks, i));
+    }
+    blocks = footer.structs(3, sizeof(arrow::block), count);
+    for (size_t i = 0; i < count; ++i) {
+      m_batches.push_back(read_record_batch(load<arrow::block>(blocks, i), arrow::RECORD_BATCH));
+      m_num_rows += m_batches.back().num_rows;
+    }
+  }
+
+  columnar_file_reader(const columnar_file_reader&) = delete;
+  columnar_file_reader& operator=(const columnar_file_reader&) = delete;
+
+  size_t num_rows() const { return m_num_rows; }
+  size_t num_columns() const { return m_column_names.size(); }
+  const std::vector<std::string>& column_names() const { return m_column_names; }
+  const std::vector<flex_type_enum>& column_types() const { return m_column_types; }
+  size_t num_batches() const { return m_batches.size(); }
+  size_t batch_num_rows(size_t batch) const { return m_batches[batch].num_rows; }
+
+  /**
+   * Returns the buffers of a column of a batch, pointing into the mapping.
+   *
+   * Throws if their content would lead columnar_column_view::value out of
+   * them: buffers too short for the rows, offsets which decrease or point
+   * past their data buffer, and dictionary indices past the dictionary.
+   */
+  columnar_column_view column(size_t batch, size_t column) const {
+    const record_batch& b = m_batches[batch];
+    const column_layout& layout = m_layout[column];
+    const auto& node = b.nodes[layout.node];
+    columnar_column_view view;
+    view.type = m_column_types[column];
+    view.encoding = layout.dictionary ? columnar_encoding::DICTIONARY : columnar_encoding::PLAIN;
+    view.num_rows = b.num_rows;
+    view.null_count = node.null_count;
+    for (size_t i = 0; i < 4; ++i) {
+      view.buffers[i] = nullptr;
+      view.lengths[i] = 0;
+    }
+    auto set = [&](size_t i, size_t buffer) {
+      const auto& location = b.buffers[buffer];
+      if (location.length > 0) {
+        view.buffers[i] = b.body + location.offset;
+        view.lengths[i] = location.length;
+      }
+    };
+    if (node.null_count > 0) {
+      set(0, layout.buffer);
+      if (view.lengths[0] < (b.num_rows + 7) / 8) {
+        log_and_throw(m_path + " is not a valid columnar file");
+      }
+    }
+    view.validity = reinterpret_cast<const uint8_t*>(view.buffers[0]);
+    set(1, layout.buffer + 1);
+    switch (view.type) {
+      case flex_type_enum::DATETIME:
+        if (layout.time_zones) {
+          const auto& tz_node = b.nodes[layout.node + 1];
+          if (tz_node.length != node.length) columnar_impl::invalid("field lengths differ");
+          if (size_t(tz_node.null_count) < b.num_rows) {
+            set(2, layout.buffer + 3);
+            if (tz_node.null_count > 0) set(3, layout.buffer + 2);
+          }
+        }
+        break;
+      case flex_type_enum::STRING:
+        if (layout.dictionary) set_dictionary(layout, view);
+        else set(2, layout.buffer + 2);
+        break;
+      case flex_type_enum::VECTOR:
+        if (b.nodes[layout.node + 1].null_count > 0) {
+          log_and_throw(m_path + ": missing values in a vector are not supported");
+        }
+        set(2, layout.buffer + 3);
+        break;
+      default:
+        break;
+    }
+    check_view(view);
+    return view;
+  }
+
+ private:
+  /// The field nodes and buffers of a record batch or a dictionary.
+  struct record_batch {
+    size_t num_rows = 0;
+    const char* body = nullptr;
+    std::vector<columnar_impl::arrow::field_node> nodes;
+    std::vector<columnar_impl::arrow::buffer> buffers;
+  };
+
+  /// The position of a column in the field nodes and buffers of a batch.
+  struct column_layout {
+    size_t node = 0;
+    size_t buffer = 0;
+    bool dictionary = false;
+    int64_t dictionary_id = 0;
+    bool time_zones = false;
+  };
+
+  /// A part of the dictionary of a column, from one dictionary batch.
+  struct dictionary_part {
+    int64_t base;
+    size_t size;
+    const char* offsets;
+    const char* data;
+    size_t data_length;
+  };
+
+  void read_schema(const columnar_impl::fb_table_view& schema) {
+    using namespace columnar_impl;
+    if (!schema.valid()) invalid("no schema");
+    if (schema.get<int16_t>(0) != 0) log_and_throw(m_path + " is big endian");
+    size_t node = 0, buffer = 0;
+    for (size_t f = 0; f < schema.vector_size(1); ++f) {
+      fb_table_view field = schema.table_at(1, f);
+      std::string name = field.string(0);
+      uint8_t type_type = field.get<uint8_t>(2);
+      fb_table_view type = field.table(3);
+      if (!type.valid()) invalid("no type for column " + name);
+      auto is_int = [](const fb_table_view& t, int32_t width) {
+        return t.valid() && t.get<int32_t>(0) == width && t.get<uint8_t>(1) != 0;
+      };
+      auto is_double = [](uint8_t tt, const fb_table_view& t) {
+        return tt == arrow::FLOATING_POINT && t.get<int16_t>(0) == arrow::DOUBLE;
+      };
+      // the time zone offsets of the previous column
+      if (type_type == arrow::INT && is_int(type, 8) && !m_layout.empty() &&
+          m_column_types.back() == flex_type_enum::DATETIME && !m_layout.back().time_zones &&
+          time_zone_offsets_of(field) == m_column_names.back()) {
+        m_layout.back().time_zones = true;
+        node += 1;
+        buffer += 2;
+        continue;
+      }
+      column_layout layout;
+      layout.node = node;
+      layout.buffer = buffer;
+      flex_type_enum column_type = flex_type_enum::UNDEFINED;
+      // the field nodes and buffers of the column
+      size_t num_nodes = 1, num_buffers = 2;
+      fb_table_view dictionary = field.table(4);
+      if (dictionary.valid()) {
+        if (type_type == arrow::LARGE_UTF8 && is_int(dictionary.table(1), 64)) {
+          column_type = flex_type_enum::STRING;
+          layout.dictionary = true;
+          layout.dictionary_id = dictionary.get<int64_t>(0);
+        }
+      } else if (type_type == arrow::INT && is_int(type, 64)) {
+        column_type = flex_type_enum::INTEGER;
+      } else if (is_double(type_type, type)) {
+        column_type = flex_type_enum::FLOAT;
+      } else if (type_type == arrow::TIMESTAMP && type.get<int16_t>(0) == arrow::MICROSECOND) {
+        column_type = flex_type_enum::DATETIME;
+      } else if (type_type == arrow::LARGE_UTF8) {
+        column_type = flex_type_enum::STRING;
+        num_buffers = 3;
+      } else if (type_type == arrow::LARGE_LIST && field.vector_size(5) == 1) {
+        fb_table_view child = field.table_at(5, 0);
+        if (is_double(child.get<uint8_t>(2), child.table(3)) && !child.table(4).valid()) {
+          column_type = flex_type_enum::VECTOR;
+          num_nodes = 2;
+          num_buffers = 4;
+        }
+      }
+      if (column_type == flex_type_enum::UNDEFINED) {
+        log_and_throw("Column " + name + " of " + m_path + " has an unsupported Arrow type");
+      }
+      node += num_nodes;
+      buffer += num_buffers;
+      m_column_names.push_back(name);
+      m_column_types.push_back(column_type);
+      m_layout.push_back(layout);
+    }
+    m_num_nodes = node;
+    m_num_buffers = buffer;
+  }
+
+  static std::string time_zone_offsets_of(const columnar_impl::fb_table_view& field) {
+    for (size_t i = 0; i < field.vector_size(6); ++i) {
+      auto key_value = field.table_at(6, i);
+      if (key_value.string(0) == columnar_impl::arrow::time_zone_offsets_key()) {
+        return key_value.string(1);
+      }
+    }
+    return std::string();
+  }
+
+  /**
+   * Reads the record batch of the message at "block", or the record batch
+   * of a dictionary batch. Checks the buffers are within the body.
+   */
+  record_batch read_record_batch(const columnar_impl::arrow::block& block, uint8_t header_type,
+                                 int64_t* dictionary_id = nullptr,
+                                 bool* is_delta = nullptr) const {
+    using namespace columnar_impl;
+    if (block.offset < 0 || block.metadata_length < 8 || block.body_length < 0 ||
+        uint64_t(block.offset) > m_length ||
+        uint64_t(block.metadata_length) > m_length - block.offset ||
+        uint64_t(block.body_length) > m_length - block.offset - block.metadata_length) {
+      invalid("message out of bounds");
+    }
+    if ((block.offset + block.metadata_length) % 8 != 0) invalid("misaligned message body");
+    const char* message_data = m_data + block.offset;
+    size_t prefix = load<int32_t>(message_data) == -1 ? 8 : 4;
+    fb_table_view message(message_data + prefix, block.metadata_length - prefix);
+    if (message.get<uint8_t>(1) != header_type) invalid("unexpected message");
+    fb_table_view header = message.table(2);
+    if (!header.valid()) invalid("no message header");
+    if (header_type == arrow::DICTIONARY_BATCH) {
+      *dictionary_id = header.get<int64_t>(0);
+      *is_delta = header.get<uint8_t>(2) != 0;
+      header = header.table(1);
+      if (!header.valid()) invalid("no dictionary data");
+    }
+    if (header.table(3).valid()) log_and_throw(m_path + " is compressed");
+    record_batch ret;
+    int64_t length = header.get<int64_t>(0);
+    if (length < 0) invalid("negative batch length");
+    ret.num_rows = size_t(length);
+    ret.body = message_data + block.metadata_length;
+    size_t count = 0;
+    const char* nodes = header.structs(1, sizeof(arrow::field_node), count);
+    for (size_t i = 0; i < count; ++i) ret.nodes.push_back(load<arrow::field_node>(nodes, i));
+    const char* buffers = header.structs(2, sizeof(arrow::buffer), count);
+    for (size_t i = 0; i < count; ++i) {
+      auto buffer = load<arrow::buffer>(buffers, i);
+      if (buffer.offset < 0 || buffer.length < 0 || buffer.offset > block.body_length ||
+          buffer.length > block.body_length - buffer.offset) {
+        invalid("buffer out of bounds");
+      }
+      if (buffer.offset % 8 != 0) invalid("misaligned buffer");
+      ret.buffers.push_back(buffer);
+    }
+    if (header_type == arrow::RECORD_BATCH) {
+      if (ret.nodes.size() != m_num_nodes || ret.buffers.size() != m_num_buffers) {
+        invalid("record batch does not match the schema");
+      }
+      for (const auto& layout: m_layout) {
+        const auto& node = ret.nodes[layout.node];
+        if (node.length != length || node.null_count < 0 || node.null_count > length) {
+          invalid("field lengths differ");
+        }
+      }
+    }
+    return ret;
+  }
+
+  /**
+   * Reads a dictionary batch, the first one of its column or a delta which
+   * extends its dictionary.
+   */
+  void read_dictionary(const columnar_impl::arrow::block& block) {
+    using namespace columnar_impl;
+    int64_t id = 0;
+    bool is_delta = false;
+    record_batch batch = read_record_batch(block, arrow::DICTIONARY_BATCH, &id, &is_delta);
+    if (batch.nodes.size() != 1 || batch.buffers.size() != 3 ||
+        batch.nodes[0].length != int64_t(batch.num_rows)) {
+      invalid("dictionary is not a column of strings");
+    }
+    if (batch.nodes[0].null_count != 0) {
+      log_and_throw(m_path + ": missing values in a dictionary are not supported");
+    }
+    auto& parts = m_dictionaries[id];
+    if (!parts.empty() && !is_delta) invalid("dictionary replaced");
+    dictionary_part part;
+    part.base = parts.empty() ? 0 : parts.back().base + int64_t(parts.back().size);
+    part.size = batch.num_rows;
+    part.offsets = batch.body + batch.buffers[1].offset;
+    part.data = batch.body + batch.buffers[2].offset;
+    part.data_length = batch.buffers[2].length;
+    if (part.size > 0) {
+      if (size_t(batch.buffers[1].length) / sizeof(int64_t) < part.size + 1) {
+        invalid("dictionary offsets too short");
+      }
+      int64_t previous = 0;
+      for (size_t i = 0; i <= part.size; ++i) {
+        int64_t offset = load<int64_t>(part.offsets, i);
+        if (offset < previous) invalid("dictionary offsets decrease");
+        previous = offset;
+      }
+      if (uint64_t(previous) > part.data_length) invalid("dictionary offsets past the data");
+    }
+    parts.push_back(part);
+  }
+
+  /**
+   * Points the view at the part of the dictionary holding its indices, if
+   * they are all in one part.
+   */
+  void set_dictionary(const column_layout& layout, columnar_column_view& view) const {
+    if (view.num_rows == 0 || view.null_count == view.num_rows) return;
+    if (view.lengths[1] / sizeof(int64_t) < view.num_rows) {
+      log_and_throw(m_path + " is not a valid columnar file");
+    }
+    size_t first = 0;
+    while (!view.is_valid(first)) ++first;
+    int64_t index = columnar_impl::load<int64_t>(view.buffers[1], first);
+    auto parts = m_dictionaries.find(layout.dictionary_id);
+    if (parts == m_dictionaries.end()) columnar_impl::invalid("no dictionary");
+    for (const auto& part: parts->second) {
+      if (index >= part.base && index < part.base + int64_t(part.size)) {
+        view.dictionary_base = part.base;
+        view.buffers[2] = part.offsets;
+        view.lengths[2] = (part.size + 1) * sizeof(int64_t);
+        view.buffers[3] = part.data;
+        view.lengths[3] = part.data_length;
+        return;
+      }
+    }
+    log_and_throw(m_path + " is not a valid columnar file");
+  }
+
+  /**
+   * Checks that every value of a view can be decoded within its buffers.
+   */
+  void check_view(const columnar_column_view& view) const {
+    size_t n = view.num_rows;
+    if (n == 0) return;
+    auto fail = [&]() {
+      log_and_throw(m_path + " is not a valid columnar file");
+    };
+    // buffer i holds at least count values of the given size
+    auto require = [&](size_t i, size_t count, size_t size) {
+      if (count > 0 && view.lengths[i] / size < count) fail();
+    };
+    // offsets[0 .. count] are non decreasing, within [0, data_length]
+    auto check_offsets = [&](const int64_t* offsets, size_t count, size_t data_length) {
+      int64_t previous = 0;
+      for (size_t i = 0; i <= count; ++i) {
+        if (offsets[i] < previous) fail();
+        previous = offsets[i];
+      }
+      if (uint64_t(previous) > data_length) fail();
+    };
+    if (view.null_count > 0) require(0, (n + 7) / 8, 1);
+    switch (view.type) {
+      case flex_type_enum::INTEGER:
+      case flex_type_enum::FLOAT:
+        require(1, n, 8);
+        break;
+      case flex_type_enum::DATETIME:
+        require(1, n, 8);
+        if (view.lengths[2] > 0) {
+          require(2, n, 1);
+          if (view.buffers[3] != nullptr) require(3, (n + 7) / 8, 1);
+          for (size_t row = 0; row < n; ++row) {
+            int8_t timezone = view.data<int8_t>(2)[row];
+            bool present = view.buffers[3] == nullptr ||
+                ((view.data<uint8_t>(3)[row >> 3] >> (row & 7)) & 1);
+            if (present && (timezone < flex_date_time::TIMEZONE_LOW ||
+                            timezone > flex_date_time::TIMEZONE_HIGH)) {
+              fail();
+            }
+          }
+        }
+        break;
+      case flex_type_enum::STRING:
+        if (view.encoding == columnar_encoding::DICTIONARY) {
+          if (view.null_count == n) break;
+          require(1, n, sizeof(int64_t));
+          // set_dictionary picked the part of the dictionary, whose offsets
+          // were checked when the file was opened
+          size_t dictionary_size = view.lengths[2] / sizeof(int64_t) - 1;
+          const int64_t* indices = view.data<int64_t>(1);
+          for (size_t row = 0; row < n; ++row) {
+            if (view.is_valid(row) &&
+                (indices[row] < view.dictionary_base ||
+                 uint64_t(indices[row] - view.dictionary_base) >= dictionary_size)) {
+              fail();
+            }
+          }
+        } else {
+          require(1, n + 1, sizeof(int64_t));
+          check_offsets(view.data<int64_t>(1), n, view.lengths[2]);
+        }
+        break;
+      case flex_type_enum::VECTOR:
+        require(1, n + 1, sizeof(int64_t));
+        check_offsets(view.data<int64_t>(1), n, view.lengths[2] / sizeof(double));
+        break;
+      default:
+        break;
+    }
+  }
+
+  mapped_file m_file;
+  std::string m_path;
+  const char* m_data = nullptr;
+  size_t m_length = 0;
+  size_t m_num_rows = 0;
+  std::vector<std::string> m_column_names;
+  std::vector<flex_type_enum> m_column_types;
+  std::vector<column_layout> m_layout;
+  size_t m_num_nodes = 0;
+  size_t m_num_buffers = 0;
+  std::unordered_map<int64_t, std::vector<dictionary_part> > m_dictionaries;
+  std::vector<record_batch> m_batches;
+};
+
+} // namespace graphlab
+#endif
@@ -0,0 +1,282 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SFRAME_CSV_TOKENIZER_HPP
+#define GRAPHLAB_SFRAME_CSV_TOKENIZER_HPP
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <graphlab/flexible_type/string_escape.hpp>
+
+namespace graphlab {
+
+/**
+ * The characters which give a csv file its structure.
+ * A character of 0 is not used (no quoting, no escapes, no comments).
+ */
+struct csv_dialect {
+  char delimiter = ',';
+  char quote_char = '\"';
+  char escape_char = '\\';
+  /// Whether a doubled quote inside a quoted field is a single quote.
+  bool double_quote = true;
+  /// The remainder of a line after this character is ignored.
+  char comment_char = 0;
+  /// Whether spaces at the start of a field are skipped.
+  bool skip_initial_space = true;
+};
+
+/**
+ * Finds the next occurrence of any of up to 4 characters in a byte range.
+ *
+ * With SSE2 the range is compared 16 bytes at a time against each of the
+ * characters, and the comparison masks are combined into one bitmask, so
+ * that a run of ordinary bytes costs a few instructions per 16 bytes
+ * instead of a test per byte.
+ */
+class csv_char_finder {
+ public:
+  explicit csv_char_finder(const std::vector<char>& chars = std::vector<char>()) {
+    std::memset(m_table, 0, sizeof(m_table));
+    for (size_t i = 0; i < 4; ++i) {
+      m_chars[i] = chars.empty() ? 0 : chars[i < chars.size() ? i : 0];
+    }
+    for (char c: chars) m_table[(unsigned char)c] = true;
+    m_empty = chars.empty();
+  }
+
+  /**
+   * Returns a pointer to the first of the characters in [p, end), or end.
+   */
+  inline const char* find(const char* p, const char* end) const {
+    if (m_empty) return end;
+#ifdef __SSE2__
+    const __m128i c0 = _mm_set1_epi8(m_chars[0]);
+    const __m128i c1 = _mm_set1_epi8(m_chars[1]);
+    const __m128i c2 = _mm_set1_epi8(m_chars[2]);
+    const __m128i c3 = _mm_set1_epi8(m_chars[3]);
+    while (end - p >= 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      __m128i hits = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(block, c0), _mm_cmpeq_epi8(block, c1)),
+          _mm_or_si128(_mm_cmpeq_epi8(block, c2), _mm_cmpeq_epi8(block, c3)));
+      int mask = _mm_movemask_epi8(hits);
+      if (mask != 0) return p + __builtin_ctz(mask);
+      p += 16;
+    }
+#endif
+    while (p < end && !m_table[(unsigned char)(*p)]) ++p;
+    return p;
+  }
+
+ private:
+  char m_chars[4];
+  bool m_table[256];
+  bool m_empty;
+};
+
+/**
+ * The quote parity of a byte range of a csv file, accumulated by
+ * csv_tokenizer::scan_quotes over consecutive pieces of the range.
+ *
+ * A newline is a record boundary if the number of quotes before it in the
+ * file is even. Knowing the number of quotes in the range, and the first
+ * newline after an even and after an odd number of quotes in the range,
+ * the first record boundary in each range follows from a prefix sum over
+ * the ranges before it.
+ */
+struct csv_quote_scan {
+  static constexpr size_t NONE = size_t(-1);
+  size_t num_quotes = 0;
+  /// Offset in the range of the first newline after an even (0) or odd (1)
+  /// number of quotes, or NONE.
+  size_t first_newline[2] = {NONE, NONE};
+  /// Whether the last piece ended with an escape character.
+  bool pending_escape = false;
+};
+
+/**
+ * Splits csv text into records and fields.
+ *
+ * A quote character only opens a quoted field at the start of a field.
+ * Inside a quoted field, delimiters and newlines are ordinary characters,
+ * an escape character escapes the next character, and with double_quote a
+ * doubled quote is a quote. Outside of quoted fields the escape character
+ * is an ordinary character, and trailing spaces are trimmed, as in
+ * the string_parser of construct_from_csvs.
+ *
+ * Fields are copied in runs between special characters, found with a
+ * csv_char_finder, into reused strings.
+ */
+class csv_tokenizer {
+ public:
+  enum class status {
+    RECORD,       ///< A record was read.
+    EMPTY,        ///< A blank or comment line was read.
+    INCOMPLETE,   ///< The range ends before the end of the record.
+    UNTERMINATED  ///< The range is final and ends inside a quoted field.
+  };
+
+  explicit csv_tokenizer(const csv_dialect& dialect = csv_dialect()): m_dialect(dialect) {
+    std::vector<char> field_chars{m_dialect.delimiter, '\n', '\r'};
+    if (m_dialect.comment_char) field_chars.push_back(m_dialect.comment_char);
+    m_field_finder = csv_char_finder(field_chars);
+    std::vector<char> quoted_chars;
+    if (m_dialect.quote_char) quoted_chars.push_back(m_dialect.quote_char);
+    if (m_dialect.escape_char) quoted_chars.push_back(m_dialect.escape_char);
+    m_quoted_finder = csv_char_finder(quoted_chars);
+    quoted_chars.push_back('\n');
+    m_scan_finder = csv_char_finder(quoted_chars);
+  }
+
+  const csv_dialect& dialect() const { return m_dialect; }
+
+  /**
+   * Reads one record starting at p. On RECORD and EMPTY, p is moved past
+   * the end of the line, and the first nfields entries of fields hold the
+   * fields of the record. If end_is_final is false and the record may
+   * continue past end, returns INCOMPLETE and leaves p unchanged.
+   */
+  inline status tokenize(const char*& p, const char* end, bool end_is_final,
+                         std::vector<std::string>& fields, size_t& nfields) const {
+    const char quote = m_dialect.quote_char;
+    const char escape = m_dialect.escape_char;
+    const char* cur = p;
+    bool content = false;
+    nfields = 0;
+    while (true) {
+      if (nfields == fields.size()) fields.emplace_back();
+      std::string& field = fields[nfields++];
+      field.clear();
+      if (m_dialect.skip_initial_space && m_dialect.delimiter != ' ') {
+        while (cur < end && *cur == ' ') ++cur;
+      }
+      bool quoted = false;
+      if (quote && cur < end && *cur == quote) {
+        quoted = content = true;
+        bool escaped = false;
+        ++cur;
+        while (true) {
+          const char* s = m_quoted_finder.find(cur, end);
+          field.append(cur, s);
+          if (s == end || (s + 1 == end && (*s == escape || m_dialect.double_quote))) {
+            if (!end_is_final) return status::INCOMPLETE;
+            if (s == end || *s == escape) {
+              p = end;
+              return status::UNTERMINATED;
+            }
+          }
+          if (*s == escape) {
+            field.append(s, 2);
+            escaped = true;
+            cur = s + 2;
+          } else if (m_dialect.double_quote && s + 1 < end && s[1] == quote) {
+            field.push_back(quote);
+            cur = s + 2;
+          } else {
+            cur = s + 1;
+            break;
+          }
+        }
+        if (escaped) unescape_string(field, escape, quote, false);
+      }
+      // the unquoted field, or anything between a closing quote and the delimiter
+      const char* s = m_field_finder.find(cur, end);
+      if (s != cur) {
+        field.append(cur, s);
+        content = true;
+        if (!quoted) {
+          size_t len = field.size();
+          while (len > 0 && (field[len - 1] == ' ' || field[len - 1] == '\t')) --len;
+          field.resize(len);
+        }
+      }
+      cur = s;
+      if (cur == end) {
+        if (!end_is_final) return status::INCOMPLETE;
+        p = end;
+        return content ? status::RECORD : status::EMPTY;
+      }
+      char c = *cur++;
+      if (c == m_dialect.delimiter) {
+        content = true;
+        continue;
+      } else if (c == '\r') {
+        if (cur < end && *cur == '\n') {
+          ++cur;
+        } else if (cur == end && !end_is_final) {
+          return status::INCOMPLETE;
+        }
+      } else if (c != '\n') {
+        // comment: skip to the end of the line
+        const char* eol = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+        if (eol == nullptr) {
+          if (!end_is_final) return status::INCOMPLETE;
+          cur = end;
+        } else {
+          cur = eol + 1;
+        }
+      }
+      p = cur;
+      return content ? status::RECORD : status::EMPTY;
+    }
+  }
+
+  /**
+   * Accumulates into scan the quote parity of the piece [begin, end) of a
+   * byte range, where offset is the offset of begin in the range.
+   *
+   * Every unescaped quote character counts, so the parity is exact as long
+   * as quotes only appear around fields (and doubled inside them), as in
+   * files written by gl_sframe::save.
+   */
+  inline void scan_quotes(const char* begin, const char* end, size_t offset,
+                          csv_quote_scan& scan) const {
+    const char* p = begin;
+    if (scan.pending_escape && p < end) {
+      ++p;
+      scan.pending_escape = false;
+    }
+    const csv_char_finder* finder = &m_scan_finder;
+    while (true) {
+      if (scan.first_newline[0] != csv_quote_scan::NONE &&
+          scan.first_newline[1] != csv_quote_scan::NONE) {
+        // only the quotes are left to count
+        finder = &m_quoted_finder;
+      }
+      p = finder->find(p, end);
+      if (p == end) break;
+      char c = *p++;
+      if (c == '\n') {
+        size_t& first = scan.first_newline[scan.num_quotes & 1];
+        if (first == csv_quote_scan::NONE) first = offset + (p - 1 - begin);
+      } else if (c == m_dialect.escape_char) {
+        if (p == end) {
+          scan.pending_escape = true;
+          break;
+        }
+        ++p;
+      } else {
+        ++scan.num_quotes;
+      }
+    }
+  }
+
+ private:
+  csv_dialect m_dialect;
+  csv_char_finder m_field_finder;
+  csv_char_finder m_quoted_finder;
+  csv_char_finder m_scan_finder;
+};
+
+} // namespace graphlab
+#endif
@@ -0,0 +1,959 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SFRAME_PARQUET_READER_HPP
+#define GRAPHLAB_SFRAME_PARQUET_READER_HPP
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/fileio/mapped_file.hpp>
+#include <graphlab/util/snappy.hpp>
+
+namespace graphlab {
+
+namespace parquet_impl {
+
+inline void corrupt(const std::string& what) {
+  log_and_throw("Corrupt parquet file: " + what);
+}
+
+/**
+ * A reader of the Thrift compact protocol, in which the metadata and the
+ * page headers of a Parquet file are written.
+ */
+class thrift_compact_reader {
+ public:
+  enum field_type {
+    STOP = 0, BOOL_TRUE = 1, BOOL_FALSE = 2, BYTE = 3, I16 = 4, I32 = 5,
+    I64 = 6, DOUBLE = 7, BINARY = 8, LIST = 9, SET = 10, MAP = 11, STRUCT = 12
+  };
+
+  thrift_compact_reader(const uint8_t* begin, const uint8_t* end): m_p(begin), m_end(end) {}
+
+  const uint8_t* position() const { return m_p; }
+
+  uint8_t read_byte() {
+    if (m_p >= m_end) corrupt("truncated metadata");
+    return *m_p++;
+  }
+
+  uint64_t read_varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte = read_byte();
+      value |= uint64_t(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    corrupt("bad varint");
+    return 0;
+  }
+
+  int64_t read_i64() {
+    uint64_t value = read_varint();
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+  }
+
+  int32_t read_i32() { return int32_t(read_i64()); }
+
+  std::string read_binary() {
+    uint64_t length = read_varint();
+    if (length > uint64_t(m_end - m_p)) corrupt("truncated metadata");
+    std::string ret(reinterpret_cast<const char*>(m_p), length);
+    m_p += length;
+    return ret;
+  }
+
+  void begin_struct() {
+    m_field_ids.push_back(m_last_field_id);
+    m_last_field_id = 0;
+  }
+
+  void end_struct() {
+    m_last_field_id = m_field_ids.back();
+    m_field_ids.pop_back();
+  }
+
+  /**
+   * Reads the header of the next field of the current struct. Returns
+   * false at the end of the struct. The value of a bool field is in its
+   * type, see field_bool().
+   */
+  bool read_field(int& type, int& id) {
+    uint8_t byte = read_byte();
+    if (byte == STOP) return false;
+    type = byte & 0x0f;
+    int delta = byte >> 4;
+    id = delta != 0 ? m_last_field_id + delta : int(int16_t(read_i64()));
+    m_last_field_id = id;
+    return true;
+  }
+
+  static bool field_bool(int type) { return type == BOOL_TRUE; }
+
+  void read_list(int& element_type, size_t& size) {
+    uint8_t byte = read_byte();
+    element_type = byte & 0x0f;
+    size = byte >> 4;
+    if (size == 15) size = read_varint();
+  }
+
+  void skip(int type) {
+    switch (type) {
+      case BOOL_TRUE: case BOOL_FALSE: break;
+      case BYTE: read_byte(); break;
+      case I16: case I32: case I64: read_varint(); break;
+      case DOUBLE:
+        if (m_end - m_p < 8) corrupt("truncated metadata");
+        m_p += 8;
+        break;
+      case BINARY: read_binary(); break;
+      case LIST: case SET: {
+        int element_type;
+        size_t size;
+        read_list(element_type, size);
+        for (size_t i = 0; i < size; ++i) skip_element(element_type);
+        break;
+      }
+      case MAP: {
+        size_t size = read_varint();
+        if (size > 0) {
+          uint8_t types = read_byte();
+          for (size_t i = 0; i < size; ++i) {
+            skip_element(types >> 4);
+            skip_element(types & 0x0f);
+          }
+        }
+        break;
+      }
+      case STRUCT: {
+        begin_struct();
+        int field_type, id;
+        while (read_field(field_type, id)) skip(field_type);
+        end_struct();
+        break;
+      }
+      default:
+        corrupt("unknown thrift type");
+    }
+  }
+
+  /// Skips an element of a list, in which bools take a byte.
+  void skip_element(int type) {
+    if (type == BOOL_TRUE || type == BOOL_FALSE) read_byte();
+    else skip(type);
+  }
+
+  /// Reads a list of structs, calling read_element() for each one.
+  template <typename Fn>
+  void read_struct_list(Fn read_element) {
+    int element_type;
+    size_t size;
+    read_list(element_type, size);
+    for (size_t i = 0; i < size; ++i) {
+      if (element_type != STRUCT) corrupt("expected a list of structs");
+      begin_struct();
+      read_element();
+      end_struct();
+    }
+  }
+
+ private:
+  const uint8_t* m_p;
+  const uint8_t* m_end;
+  int m_last_field_id = 0;
+  std::vector<int> m_field_ids;
+};
+
+/**
+ * A decoder of the RLE / bit packed hybrid encoding of Parquet, in which
+ * definition levels, dictionary indices and booleans are written.
+ */
+class rle_bit_packed_decoder {
+ public:
+  rle_bit_packed_decoder(const uint8_t* begin, const uint8_t* end, int bit_width)
+      : m_p(begin), m_end(end), m_bit_width(bit_width) {
+    if (bit_width < 0 || bit_width > 32) corrupt("bad bit width");
+  }
+
+  /**
+   * Decodes n values into out.
+   */
+  void decode(size_t n, uint32_t* out) {
+    while (n > 0) {
+      if (m_run_remaining == 0 && m_packed_remaining == 0) next_run();
+      if (m_run_remaining > 0) {
+        size_t count = std::min(n, m_run_remaining);
+        std::fill(out, out + count, m_run_value);
+        out += count;
+        n -= count;
+        m_run_remaining -= count;
+      } else {
+        size_t count = std::min(n, m_packed_remaining);
+        for (size_t i = 0; i < count; ++i) {
+          uint64_t bit = m_packed_bit;
+          uint64_t word = 0;
+          size_t first_byte = bit >> 3;
+          size_t nbytes = ((bit & 7) + m_bit_width + 7) >> 3;
+          for (size_t j = 0; j < nbytes; ++j) word |= uint64_t(m_packed[first_byte + j]) << (8 * j);
+          out[i] = uint32_t((word >> (bit & 7)) & ((uint64_t(1) << m_bit_width) - 1));
+          m_packed_bit += m_bit_width;
+        }
+        out += count;
+        n -= count;
+        m_packed_remaining -= count;
+      }
+    }
+  }
+
+ private:
+  void next_run() {
+    uint64_t header = 0;
+    for (int shift = 0; ; shift += 7) {
+      if (m_p >= m_end || shift > 35) corrupt("truncated levels or indices");
+      uint8_t byte = *m_p++;
+      header |= uint64_t(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) break;
+    }
+    if (header & 1) {
+      size_t ngroups = header >> 1;
+      size_t nbytes = ngroups * m_bit_width;
+      // the last group may be cut short at the end of the data
+      m_packed = m_p;
+      m_packed_bit = 0;
+      m_packed_remaining = std::min(ngroups * 8, size_t(m_end - m_p) * 8 / std::max(m_bit_width, 1));
+      if (m_bit_width == 0) m_packed_remaining = ngroups * 8;
+      m_p += std::min(nbytes, size_t(m_end - m_p));
+      if (m_packed_remaining == 0) corrupt("empty bit packed run");
+    } else {
+      m_run_remaining = header >> 1;
+      size_t nbytes = (m_bit_width + 7) / 8;
+      if (size_t(m_end - m_p) < nbytes) corrupt("truncated run");
+      m_run_value = 0;
+      for (size_t i = 0; i < nbytes; ++i) m_run_value |= uint32_t(m_p[i]) << (8 * i);
+      m_p += nbytes;
+      if (m_run_remaining == 0) corrupt("empty run");
+    }
+  }
+
+  const uint8_t* m_p;
+  const uint8_t* m_end;
+  int m_bit_width;
+  size_t m_run_remaining = 0;
+  uint32_t m_run_value = 0;
+  const uint8_t* m_packed = nullptr;
+  uint64_t m_packed_bit = 0;
+  size_t m_packed_remaining = 0;
+};
+
+template <typename T>
+inline T load_le(const uint8_t* p) {
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+} // namespace parquet_impl
+
+/**
+ * The parts of the schema of a Parquet file read by parquet_file.
+ */
+struct parquet_schema_element {
+  enum physical_type {
+    BOOLEAN = 0, INT32 = 1, INT64 = 2, INT96 = 3, FLOAT = 4, DOUBLE = 5,
+    BYTE_ARRAY = 6, FIXED_LEN_BYTE_ARRAY = 7
+  };
+  enum converted_type {
+    UTF8 = 0, DECIMAL = 5, DATE = 6, TIMESTAMP_MILLIS = 9, TIMESTAMP_MICROS = 10,
+    UINT_8 = 11, UINT_16 = 12, UINT_32 = 13, UINT_64 = 14
+  };
+  enum time_unit { MILLIS = 1, MICROS = 2, NANOS = 3 };
+
+  int type = -1;
+  int type_length = 0;
+  int repetition = 0;  ///< 0 required, 1 optional, 2 repeated
+  std::string name;
+  int num_children = 0;
+  int converted = -1;
+  int scale = 0;
+  /// Field id of the LogicalType union, or -1.
+  int logical = -1;
+  int timestamp_unit = -1;
+  bool timestamp_utc = false;
+};
+
+struct parquet_statistics {
+  bool has_min = false;
+  bool has_max = false;
+  /// True if min or max is a legacy statistic, ordered by signed value
+  bool legacy = false;
+  std::string min;
+  std::string max;
+  int64_t null_count = -1;
+};
+
+struct parquet_column_metadata {
+  int type = -1;
+  int codec = 0;
+  int64_t num_values = 0;
+  int64_t data_page_offset = 0;
+  int64_t dictionary_page_offset = -1;
+  int64_t total_compressed_size = 0;
+  parquet_statistics statistics;
+};
+
+struct parquet_row_group {
+  int64_t num_rows = 0;
+  std::vector<parquet_column_metadata> columns;
+};
+
+/**
+ * A flat leaf column of a Parquet file.
+ */
+struct parquet_column {
+  std::string name;
+  /// Index of the column in the column chunks of a row group.
+  size_t chunk_index = 0;
+  parquet_schema_element element;
+  /// 0 for a required column, 1 for an optional one.
+  int max_definition_level = 0;
+  flex_type_enum type = flex_type_enum::UNDEFINED;
+};
+
+/**
+ * A local Parquet file, mapped into memory.
+ *
+ * Reads the flat columns (required or optional leaves of the root) of the
+ * file, one column chunk of one row group at a time, converting values
+ * straight from their physical type:
+ *
+ * - BOOLEAN, INT32 and INT64 to INTEGER; DATE, TIMESTAMP and INT96 to
+ *   DATETIME; DECIMAL to FLOAT.
+ * - FLOAT and DOUBLE to FLOAT.
+ * - BYTE_ARRAY and FIXED_LEN_BYTE_ARRAY to STRING.
+ *
+ * Pages can be uncompressed or snappy compressed, version 1 or 2 data
+ * pages, with PLAIN or dictionary encoded values. Columns inside groups,
+ * repeated columns, and other codecs and encodings are not supported.
+ */
+class parquet_file {
+ public:
+  explicit parquet_file(const std::string& path): m_file(path) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(m_file.data());
+    size_t size = m_file.size();
+    if (size < 12 || std::memcmp(data, "PAR1", 4) != 0 ||
+        std::memcmp(data + size - 4, "PAR1", 4) != 0) {
+      log_and_throw(path + " is not a parquet file");
+    }
+    uint32_t footer_length = parquet_impl::load_le<uint32_t>(data + size - 8);
+    if (footer_length > size - 12) parquet_impl::corrupt("bad footer length");
+    parquet_impl::thrift_compact_reader reader(data + size - 8 - footer_length, data + size - 8);
+    read_file_metadata(reader);
+    find_columns();
+  }
+
+  int64_t num_rows() const { return m_num_rows; }
+  const std::vector<parquet_column>& columns() const { return m_columns; }
+  const std::vector<parquet_row_group>& row_groups() const { return m_row_groups; }
+
+  /**
+   * Returns the index in columns() of the column with the given name, or
+   * -1 if there is no such flat column.
+   */
+  int find_column(const std::string& name) const {
+    for (size_t i = 0; i < m_columns.size(); ++i) {
+      if (m_columns[i].name == name) return int(i);
+    }
+    return -1;
+  }
+
+  /**
+   * Returns the minimum and maximum of a column in a row group, from its
+   * statistics. Returns false if there are no usable statistics.
+   */
+  bool column_bounds(size_t row_group, size_t column,
+                     flexible_type& min, flexible_type& max) const {
+    const parquet_column& col = m_columns[column];
+    const auto& statistics = m_row_groups[row_group].columns[col.chunk_index].statistics;
+    if (!statistics.has_min || !statistics.has_max) return false;
+    // unsigned 64 bit integers do not fit a flex_int, and the legacy
+    // statistics of the other unsigned integers are signed comparisons of
+    // their physical values
+    int converted = col.element.converted;
+    if (converted == parquet_schema_element::UINT_64) return false;
+    if (statistics.legacy && (converted == parquet_schema_element::UINT_8 ||
+                              converted == parquet_schema_element::UINT_16 ||
+                              converted == parquet_schema_element::UINT_32)) {
+      return false;
+    }
+    if (!statistic_value(col, statistics.min, min) || !statistic_value(col, statistics.max, max)) {
+      return false;
+    }
+    if (min.get_type() == flex_type_enum::FLOAT &&
+        (std::isnan(min.get<flex_float>()) || std::isnan(max.get<flex_float>()))) {
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Returns the number of missing values of a column in a row group from
+   * its statistics, or -1 if unknown.
+   */
+  int64_t column_null_count(size_t row_group, size_t column) const {
+    return m_row_groups[row_group].columns[m_columns[column].chunk_index].statistics.null_count;
+  }
+
+  /**
+   * Reads the values of a column in a row group into out, one per row of
+   * the row group. Throws if the column chunk is corrupt, or does not
+   * decode to exactly one value per row.
+   */
+  void read_column(size_t row_group, size_t column, std::vector<flexible_type>& out) const {
+    const parquet_column& col = m_columns[column];
+    const parquet_column_metadata& meta = m_row_groups[row_group].columns[col.chunk_index];
+    // flat columns hold one value per row
+    if (meta.num_values != m_row_groups[row_group].num_rows) {
+      parquet_impl::corrupt("column chunk of " + col.name + " does not have one value per row");
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(m_file.data());
+    const uint8_t* file_end = data + m_file.size();
+    out.clear();
+    out.reserve(meta.num_values);
+    int64_t start = meta.data_page_offset;
+    if (meta.dictionary_page_offset > 0 && meta.dictionary_page_offset < start) {
+      start = meta.dictionary_page_offset;
+    }
+    if (start < 0 || size_t(start) >= m_file.size()) parquet_impl::corrupt("bad page offset");
+    const uint8_t* p = data + start;
+    std::vector<flexible_type> dictionary;
+    std::string buffer, values_buffer;
+    std::vector<uint32_t> levels, indices;
+    while (int64_t(out.size()) < meta.num_values) {
+      parquet_impl::thrift_compact_reader reader(p, file_end);
+      page_header header = read_page_header(reader);
+      const uint8_t* body = reader.position();
+      if (header.compressed_size < 0 || header.compressed_size > file_end - body ||
+          header.uncompressed_size < 0 || header.num_values < 0) {
+        parquet_impl::corrupt("bad page size");
+      }
+      const uint8_t* body_end = body + header.compressed_size;
+      p = body_end;
+      if (header.type == DICTIONARY_PAGE) {
+        const uint8_t* page = decompress(meta.codec, body, body_end, header.uncompressed_size, buffer);
+        dictionary.clear();
+        decode_plain(col, page, page + header.uncompressed_size, header.num_values, dictionary);
+      } else if (header.type == DATA_PAGE || header.type == DATA_PAGE_V2) {
+        size_t n = header.num_values;
+        const uint8_t* values = nullptr;
+        const uint8_t* values_end = nullptr;
+        levels.assign(n, col.max_definition_level);
+        if (header.type == DATA_PAGE) {
+          values = decompress(meta.codec, body, body_end, header.uncompressed_size, buffer);
+          values_end = values + header.uncompressed_size;
+          if (col.max_definition_level > 0) {
+            if (values_end - values < 4) parquet_impl::corrupt("truncated levels");
+            uint32_t length = parquet_impl::load_le<uint32_t>(values);
+            if (length > size_t(values_end - values - 4)) parquet_impl::corrupt("truncated levels");
+            parquet_impl::rle_bit_packed_decoder(values + 4, values + 4 + length, 1)
+                .decode(n, levels.data());
+            values += 4 + length;
+          }
+        } else {
+          if (header.definition_levels_length < 0 || header.repetition_levels_length < 0) {
+            parquet_impl::corrupt("bad levels length");
+          }
+          size_t levels_length = size_t(header.definition_levels_length) +
+                                 size_t(header.repetition_levels_length);
+          // the levels are not compressed, and count in both page sizes
+          if (levels_length > size_t(body_end - body) ||
+              levels_length > size_t(header.uncompressed_size)) {
+            parquet_impl::corrupt("truncated levels");
+          }
+          if (col.max_definition_level > 0) {
+            parquet_impl::rle_bit_packed_decoder(
+                body + header.repetition_levels_length, body + levels_length, 1)
+                .decode(n, levels.data());
+          }
+          if (header.is_compressed && meta.codec != 0) {
+            values = decompress(meta.codec, body + levels_length, body_end,
+                                header.uncompressed_size - levels_length, values_buffer);
+            values_end = values + (header.uncompressed_size - levels_length);
+          } else {
+            values = body + levels_length;
+            values_end = body_end;
+          }
+        }
+        size_t num_present = 0;
+        for (size_t i = 0; i < n; ++i) num_present += (levels[i] == uint32_t(col.max_definition_level));
+        size_t first = out.size();
+        if (header.encoding == PLAIN) {
+          decode_plain(col, values, values_end, num_present, out);
+        } else if (header.encoding == PLAIN_DICTIONARY || header.encoding == RLE_DICTIONARY) {
+          if (num_present > 0) {
+            if (values >= values_end) parquet_impl::corrupt("missing dictionary indices");
+            int bit_width = *values;
+            indices.resize(num_present);
+            parquet_impl::rle_bit_packed_decoder(values + 1, values_end, bit_width)
+                .decode(num_present, indices.data());
+            for (uint32_t index: indices) {
+              if (index >= dictionary.size()) parquet_impl::corrupt("bad dictionary index");
+              out.push_back(dictionary[index]);
+            }
+          }
+        } else if (header.encoding == RLE && col.element.type == parquet_schema_element::BOOLEAN) {
+          if (values_end - values < 4) parquet_impl::corrupt("truncated booleans");
+          indices.resize(num_present);
+          parquet_impl::rle_bit_packed_decoder(values + 4, values_end, 1)
+              .decode(num_present, indices.data());
+          for (uint32_t value: indices) out.push_back(flex_int(value));
+        } else {
+          log_and_throw("Unsupported parquet encoding " + std::to_string(header.encoding) +
+                        " in column " + col.name);
+        }
+        // spread the present values over the rows, leaving the others missing
+        if (num_present < n) {
+          out.resize(first + n);
+          size_t source = first + num_present;
+          for (size_t i = n; i > 0; --i) {
+            if (levels[i - 1] == uint32_t(col.max_definition_level)) {
+              out[first + i - 1] = std::move(out[--source]);
+            } else {
+              out[first + i - 1] = FLEX_UNDEFINED;
+            }
+          }
+        }
+      }
+      if (p >= file_end) break;
+    }
+    if (int64_t(out.size()) != meta.num_values) {
+      parquet_impl::corrupt("column chunk of " + col.name + " does not have one value per row");
+    }
+  }
+
+ private:
+  enum page_type { DATA_PAGE = 0, INDEX_PAGE = 1, DICTIONARY_PAGE = 2, DATA_PAGE_V2 = 3 };
+  enum encoding { PLAIN = 0, PLAIN_DICTIONARY = 2, RLE = 3, RLE_DICTIONARY = 8 };
+
+  struct page_header {
+    int type = -1;
+    int32_t uncompressed_size = 0;
+    int32_t compressed_size = 0;
+    int32_t num_values = 0;
+    int encoding = PLAIN;
+    int32_t definition_levels_length = 0;
+    int32_t repetition_levels_length = 0;
+    bool is_compressed = true;
+  };
+
+  static page_header read_page_header(parquet_impl::thrift_compact_reader& reader) {
+    page_header header;
+    int type, id;
+    reader.begin_struct();
+    while (reader.read_field(type, id)) {
+      if (id == 1) header.type = reader.read_i32();
+      else if (id == 2) header.uncompressed_size = reader.read_i32();
+      else if (id == 3) header.compressed_size = reader.read_i32();
+      else if (id == 5 || id == 7 || id == 8) {
+        // data, dictionary and v2 data page headers
+        int page = id;
+        reader.begin_struct();
+        while (reader.read_field(type, id)) {
+          if (id == 1) header.num_values = reader.read_i32();
+          else if (page != 8 && id == 2) header.encoding = reader.read_i32();
+          else if (page == 8 && id == 4) header.encoding = reader.read_i32();
+          else if (page == 8 && id == 5) header.definition_levels_length = reader.read_i32();
+          else if (page == 8 && id == 6) header.repetition_levels_length = reader.read_i32();
+          else if (page == 8 && id == 7) header.is_compressed = reader.field_bool(type);
+          else reader.skip(type);
+        }
+        reader.end_struct();
+      } else {
+        reader.skip(type);
+      }
+    }
+    reader.end_struct();
+    return header;
+  }
+
+  static const uint8_t* decompress(int codec, const uint8_t* begin, const uint8_t* end,
+                                   int32_t uncompressed_size, std::string& buffer) {
+    if (codec == 0) {
+      if (end - begin < uncompressed_size) parquet_impl::corrupt("truncated page");
+      return begin;
+    }
+    if (codec != 1) {
+      log_and_throw("Unsupported parquet compression codec " + std::to_string(codec) +
+                    " (only uncompressed and snappy pages can be read)");
+    }
+    if (!snappy_decompress(begin, end, buffer)) parquet_impl::corrupt("bad snappy page");
+    if (buffer.size() != size_t(uncompressed_size)) parquet_impl::corrupt("bad page size");
+    return reinterpret_cast<const uint8_t*>(buffer.data());
+  }
+
+  /**
+   * Converts a physical value to the type of the column.
+   */
+  static flexible_type convert_int64(const parquet_column& col, int64_t value) {
+    const auto& e = col.element;
+    if (col.type == flex_type_enum::DATETIME) {
+      int64_t per_second = e.timestamp_unit == parquet_schema_element::MILLIS ? 1000 :
+                           e.timestamp_unit == parquet_schema_element::NANOS ? 1000000000 : 1000000;
+      int64_t seconds = value / per_second;
+      int64_t fraction = value % per_second;
+      if (fraction < 0) {
+        fraction += per_second;
+        --seconds;
+      }
+      int32_t microsecond = int32_t(fraction * 1000000 / per_second);
+      return flex_date_time(seconds, e.timestamp_utc ? 0 : flex_date_time::EMPTY_TIMEZONE,
+                            microsecond);
+    }
+    if (col.type == flex_type_enum::FLOAT) return flex_float(value / std::pow(10.0, e.scale));
+    return flex_int(value);
+  }
+
+  static flexible_type convert_bytes(const parquet_column& col, const uint8_t* p, size_t length) {
+    if (col.type == flex_type_enum::FLOAT) {
+      // big endian two's complement unscaled decimal
+      double value = 0;
+      for (size_t i = 0; i < length; ++i) value = value * 256 + p[i];
+      if (length > 0 && (p[0] & 0x80)) value -= std::pow(2.0, 8.0 * length);
+      return flex_float(value / std::pow(10.0, col.element.scale));
+    }
+    return flex_string(reinterpret_cast<const char*>(p), length);
+  }
+
+  /**
+   * Appends n PLAIN encoded values of a column to out.
+   */
+  static void decode_plain(const parquet_column& col, const uint8_t* p, const uint8_t* end,
+                           size_t n, std::vector<flexible_type>& out) {
+    auto need = [&](size_t bytes) {
+      if (size_t(end - p) < bytes) parquet_impl::corrupt("truncated values in column " + col.name);
+    };
+    switch (col.element.type) {
+      case parquet_schema_element::BOOLEAN:
+        need((n + 7) / 8);
+        for (size_t i = 0; i < n; ++i) out.push_back(flex_int((p[i >> 3] >> (i & 7)) & 1));
+        break;
+      case parquet_schema_element::INT32:
+        need(4 * n);
+        for (size_t i = 0; i < n; ++i) {
+          int32_t value = parquet_impl::load_le<int32_t>(p + 4 * i);
+          if (col.type == flex_type_enum::DATETIME) {
+            out.push_back(flex_date_time(int64_t(value) * 86400));
+          } else if (col.type == flex_type_enum::FLOAT) {
+            out.push_back(flex_float(value / std::pow(10.0, col.element.scale)));
+          } else if (col.element.converted == parquet_schema_element::UINT_32) {
+            out.push_back(flex_int(uint32_t(value)));
+          } else {
+            out.push_back(flex_int(value));
+          }
+        }
+        break;
+      case parquet_schema_element::INT64:
+        need(8 * n);
+        for (size_t i = 0; i < n; ++i) {
+          out.push_back(convert_int64(col, parquet_impl::load_le<int64_t>(p + 8 * i)));
+        }
+        break;
+      case parquet_schema_element::INT96:
+        need(12 * n);
+        for (size_t i = 0; i < n; ++i) {
+          int64_t nanoseconds = parquet_impl::load_le<int64_t>(p + 12 * i);
+          int64_t julian_day = parquet_impl::load_le<int32_t>(p + 12 * i + 8);
+          int64_t seconds = (julian_day - 2440588) * 86400 + nanoseconds / 1000000000;
+          out.push_back(flex_date_time(seconds, flex_date_time::EMPTY_TIMEZONE,
+                                       int32_t((nanoseconds % 1000000000) / 1000)));
+        }
+        break;
+      case parquet_schema_element::FLOAT:
+        need(4 * n);
+        for (size_t i = 0; i < n; ++i) out.push_back(flex_float(parquet_impl::load_le<float>(p + 4 * i)));
+        break;
+      case parquet_schema_element::DOUBLE:
+        need(8 * n);
+        for (size_t i = 0; i < n; ++i) out.push_back(flex_float(parquet_impl::load_le<double>(p + 8 * i)));
+        break;
+      case parquet_schema_element::BYTE_ARRAY:
+        for (size_t i = 0; i < n; ++i) {
+          need(4);
+          uint32_t length = parquet_impl::load_le<uint32_t>(p);
+          p += 4;
+          need(length);
+          out.push_back(convert_bytes(col, p, length));
+          p += length;
+        }
+        break;
+      case parquet_schema_element::FIXED_LEN_BYTE_ARRAY: {
+        size_t length = col.element.type_length;
+        need(length * n);
+        for (size_t i = 0; i < n; ++i) out.push_back(convert_bytes(col, p + length * i, length));
+        break;
+      }
+      default:
+        parquet_impl::corrupt("bad physical type");
+    }
+  }
+
+  /**
+   * Decodes a min or max statistic, a PLAIN value without the length
+   * prefix of byte arrays.
+   */
+  static bool statistic_value(const parquet_column& col, const std::string& bytes,
+                              flexible_type& out) {
+    std::vector<flexible_type> values;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(bytes.data());
+    if (col.element.type == parquet_schema_element::BYTE_ARRAY ||
+        col.element.type == parquet_schema_element::FIXED_LEN_BYTE_ARRAY) {
+      out = convert_bytes(col, p, bytes.size());
+      return true;
+    }
+    if (col.element.type == parquet_schema_element::INT96) return false;
+    size_t width = col.element.type == parquet_schema_element::BOOLEAN ? 1 :
+                   (col.element.type == parquet_schema_element::INT32 ||
+                    col.element.type == parquet_schema_element::FLOAT) ? 4 : 8;
+    if (bytes.size() != width) return false;
+    decode_plain(col, p, p + width, 1, values);
+    out = values[0];
+    return true;
+  }
+
+  void read_file_metadata(parquet_impl::thrift_compact_reader& reader) {
+    int type, id;
+    reader.begin_struct();
+    while (reader.read_field(type, id)) {
+      if (id == 2) {
+        reader.read_struct_list([&]() { m_schema.push_back(read_schema_element(reader)); });
+      } else if (id == 3) {
+        m_num_rows = reader.read_i64();
+      } else if (id == 4) {
+        reader.read_struct_list([&]() { m_row_groups.push_back(read_row_group(reader)); });
+      } else {
+        reader.skip(type);
+      }
+    }
+    reader.end_struct();
+  }
+
+  static parquet_schema_element read_schema_element(parquet_impl::thrift_compact_reader& reader) {
+    parquet_schema_element element;
+    int type, id;
+    while (reader.read_field(type, id)) {
+      switch (id) {
+        case 1: element.type = reader.read_i32(); break;
+        case 2: element.type_length = reader.read_i32(); break;
+        case 3: element.repetition = reader.read_i32(); break;
+        case 4: element.name = reader.read_binary(); break;
+        case 5: element.num_children = reader.read_i32(); break;
+        case 6: element.converted = reader.read_i32(); break;
+        case 7: element.scale = reader.read_i32(); break;
+        case 10: {
+          // LogicalType: a union of structs
+          reader.begin_struct();
+          int member_type, member;
+          while (reader.read_field(member_type, member)) {
+            element.logical = member;
+            if (member == 8) {
+              // TimestampType: isAdjustedToUTC, unit
+              reader.begin_struct();
+              int field_type, field;
+              while (reader.read_field(field_type, field)) {
+                if (field == 1) {
+                  element.timestamp_utc = reader.field_bool(field_type);
+                } else if (field == 2) {
+                  reader.begin_struct();
+                  int unit_type, unit;
+                  while (reader.read_field(unit_type, unit)) {
+                    element.timestamp_unit = unit;
+                    reader.skip(unit_type);
+                  }
+                  reader.end_struct();
+                } else {
+                  reader.skip(field_type);
+                }
+              }
+              reader.end_struct();
+            } else {
+              reader.skip(member_type);
+            }
+          }
+          reader.end_struct();
+          break;
+        }
+        default: reader.skip(type);
+      }
+    }
+    if (element.logical != 8) {
+      // files of older writers (parquet-mr before 1.11, Hive) only have
+      // the converted type, whose timestamps are UTC instants
+      if (element.converted == parquet_schema_element::TIMESTAMP_MILLIS) {
+        element.timestamp_unit = parquet_schema_element::MILLIS;
+        element.timestamp_utc = true;
+      } else if (element.converted == parquet_schema_element::TIMESTAMP_MICROS) {
+        element.timestamp_unit = parquet_schema_element::MICROS;
+        element.timestamp_utc = true;
+      }
+    }
+    return element;
+  }
+
+  static parquet_row_group read_row_group(parquet_impl::thrift_compact_reader& reader) {
+    parquet_row_group group;
+    int type, id;
+    while (reader.read_field(type, id)) {
+      if (id == 1) {
+        reader.read_struct_list([&]() {
+          parquet_column_metadata meta;
+          int chunk_type, chunk_field;
+          while (reader.read_field(chunk_type, chunk_field)) {
+            if (chunk_field == 3) {
+              reader.begin_struct();
+              meta = read_column_metadata(reader);
+              reader.end_struct();
+            } else {
+              reader.skip(chunk_type);
+            }
+          }
+          group.columns.push_back(meta);
+        });
+      } else if (id == 3) {
+        group.num_rows = reader.read_i64();
+        if (group.num_rows < 0) parquet_impl::corrupt("negative row count");
+      } else {
+        reader.skip(type);
+      }
+    }
+    return group;
+  }
+
+  static parquet_column_metadata read_column_metadata(parquet_impl::thrift_compact_reader& reader) {
+    parquet_column_metadata meta;
+    int type, id;
+    while (reader.read_field(type, id)) {
+      switch (id) {
+        case 1: meta.type = reader.read_i32(); break;
+        case 4: meta.codec = reader.read_i32(); break;
+        case 5: meta.num_values = reader.read_i64(); break;
+        case 7: meta.total_compressed_size = reader.read_i64(); break;
+        case 9: meta.data_page_offset = reader.read_i64(); break;
+        case 11: meta.dictionary_page_offset = reader.read_i64(); break;
+        case 12: {
+          // Statistics. min_value and max_value (5, 6) are in the sort
+          // order of the logical type; the legacy min and max (1, 2) are
+          // only kept for numbers, where they are signed comparisons.
+          bool numeric = meta.type == parquet_schema_element::INT32 ||
+                         meta.type == parquet_schema_element::INT64 ||
+                         meta.type == parquet_schema_element::FLOAT ||
+                         meta.type == parquet_schema_element::DOUBLE;
+          auto& s = meta.statistics;
+          reader.begin_struct();
+          int stat_type, stat;
+          while (reader.read_field(stat_type, stat)) {
+            if (stat == 6 || (stat == 2 && numeric && !s.has_min)) {
+              s.min = reader.read_binary();
+              s.has_min = true;
+              s.legacy = s.legacy || stat == 2;
+            } else if (stat == 5 || (stat == 1 && numeric && !s.has_max)) {
+              s.max = reader.read_binary();
+              s.has_max = true;
+              s.legacy = s.legacy || stat == 1;
+            } else if (stat == 3) {
+              s.null_count = reader.read_i64();
+            } else {
+              reader.skip(stat_type);
+            }
+          }
+          reader.end_struct();
+          break;
+        }
+        default: reader.skip(type);
+      }
+    }
+    return meta;
+  }
+
+  /**
+   * Finds the flat leaf columns: the leaves which are children of the root.
+   * Leaves inside groups still take their place in the column chunks.
+   */
+  void find_columns() {
+    if (m_schema.empty()) parquet_impl::corrupt("empty schema");
+    size_t position = 1;
+    size_t chunk_index = 0;
+    // walks a subtree, counting its leaves
+    std::function<void(size_t)> skip_subtree = [&](size_t children) {
+      for (size_t i = 0; i < children; ++i) {
+        if (position >= m_schema.size()) parquet_impl::corrupt("bad schema");
+        const auto& element = m_schema[position++];
+        if (element.num_children > 0) skip_subtree(element.num_children);
+        else ++chunk_index;
+      }
+    };
+    for (int i = 0; i < m_schema[0].num_children; ++i) {
+      if (position >= m_schema.size()) parquet_impl::corrupt("bad schema");
+      const auto& element = m_schema[position++];
+      if (element.num_children > 0) {
+        skip_subtree(element.num_children);
+        continue;
+      }
+      if (element.repetition != 2) {
+        parquet_column col;
+        col.name = element.name;
+        col.chunk_index = chunk_index;
+        col.element = element;
+        col.max_definition_level = element.repetition == 1 ? 1 : 0;
+        col.type = column_type(element);
+        m_columns.push_back(col);
+      }
+      ++chunk_index;
+    }
+    for (const auto& group: m_row_groups) {
+      if (group.columns.size() != chunk_index) parquet_impl::corrupt("bad number of column chunks");
+    }
+  }
+
+  static flex_type_enum column_type(const parquet_schema_element& e) {
+    bool decimal = e.converted == parquet_schema_element::DECIMAL || e.logical == 5;
+    switch (e.type) {
+      case parquet_schema_element::BOOLEAN:
+        return flex_type_enum::INTEGER;
+      case parquet_schema_element::INT32:
+        if (e.converted == parquet_schema_element::DATE || e.logical == 6) return flex_type_enum::DATETIME;
+        return decimal ? flex_type_enum::FLOAT : flex_type_enum::INTEGER;
+      case parquet_schema_element::INT64:
+        if (e.converted == parquet_schema_element::TIMESTAMP_MILLIS ||
+            e.converted == parquet_schema_element::TIMESTAMP_MICROS || e.logical == 8) {
+          return flex_type_enum::DATETIME;
+        }
+        return decimal ? flex_type_enum::FLOAT : flex_type_enum::INTEGER;
+      case parquet_schema_element::INT96:
+        return flex_type_enum::DATETIME;
+      case parquet_schema_element::FLOAT:
+      case parquet_schema_element::DOUBLE:
+        return flex_type_enum::FLOAT;
+      default:
+        return decimal ? flex_type_enum::FLOAT : flex_type_enum::STRING;
+    }
+  }
+
+  mapped_file m_file;
+  int64_t m_num_rows = 0;
+  std::vector<parquet_schema_element> m_schema;
+  std::vector<parquet_row_group> m_row_groups;
+  std::vector<parquet_column> m_columns;
+};
+
+} // namespace graphlab
+#endif
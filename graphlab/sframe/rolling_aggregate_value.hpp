@@ -0,0 +1,523 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SFRAME_ROLLING_AGGREGATE_VALUE_HPP
+#define GRAPHLAB_SFRAME_ROLLING_AGGREGATE_VALUE_HPP
+
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/sframe/group_aggregate_value.hpp>
+
+namespace graphlab {
+
+/**
+ * A group_aggregate_value from which elements can also be removed, making
+ * the aggregate invertible. Sliding window aggregations detect it with a
+ * dynamic_cast, and update a window in O(1) when a row leaves it instead of
+ * re-aggregating the whole window.
+ *
+ * Removal is defined here rather than in group_aggregate_value, whose
+ * virtual table is fixed by the builtin aggregators compiled into the
+ * library.
+ */
+class invertible_aggregate_value: public group_aggregate_value {
+ public:
+  /**
+   * Removes an element from the aggregate. Elements are removed in the
+   * order they were added (first in, first out), and only elements which
+   * have been added and not yet removed may be removed.
+   *
+   * Operator that expects more than one input values need to overwrite
+   * this function
+   */
+  virtual void remove_element(const std::vector<flexible_type>& values) {
+    DASSERT_TRUE(values.size() == 1);
+    remove_element_simple(values[0]);
+  }
+
+  /**
+   * Removes an element from the aggregate. Simple version of remove_element
+   * where there is only one input value for the operator
+   */
+  virtual void remove_element_simple(const flexible_type& flex) = 0;
+
+  /**
+   * True if elements may still be added after combine(), so that a running
+   * aggregate can be extended one element at a time from a combined
+   * prefix. False by default.
+   */
+  virtual bool add_after_combine() const { return false; }
+};
+
+/**
+ * True if "aggregator" is an invertible_aggregate_value which accepts
+ * add_element_simple() after combine().
+ */
+inline bool accepts_add_after_combine(const group_aggregate_value& aggregator) {
+  auto invertible = dynamic_cast<const invertible_aggregate_value*>(&aggregator);
+  return invertible != nullptr && invertible->add_after_combine();
+}
+
+/**
+ * Sets "to" to the state of "from" by save() and load(), through "buffer"
+ * whose storage is reused across copies. Both must be instances of the
+ * same aggregator.
+ */
+inline void copy_aggregate(const group_aggregate_value& from, group_aggregate_value& to,
+                           std::vector<char>& buffer) {
+  oarchive oarc(buffer);
+  from.save(oarc);
+  iarchive iarc(buffer.data(), oarc.off);
+  to.load(iarc);
+}
+
+/**
+ * Invertible aggregators (see invertible_aggregate_value) for
+ * sliding window aggregations. Each update, addition or removal, is O(1)
+ * (amortized O(1) for min and max), whatever the width of the window.
+ *
+ * Missing values are ignored.
+ */
+namespace rolling_operators {
+
+/**
+ * Sum of numeric values. Integer sums are exact; float sums are
+ * compensated (Neumaier) so that removals do not accumulate rounding
+ * error over long streams.
+ */
+class sum: public invertible_aggregate_value {
+ public:
+  group_aggregate_value* new_instance() const {
+    auto ret = new sum;
+    ret->m_type = m_type;
+    return ret;
+  }
+
+  void add_element_simple(const flexible_type& flex) {
+    if (flex.get_type() == flex_type_enum::UNDEFINED) return;
+    if (m_type == flex_type_enum::INTEGER) m_int_sum += flex.to<flex_int>();
+    else add_float(flex.to<flex_float>());
+  }
+
+  void remove_element_simple(const flexible_type& flex) {
+    if (flex.get_type() == flex_type_enum::UNDEFINED) return;
+    if (m_type == flex_type_enum::INTEGER) m_int_sum -= flex.to<flex_int>();
+    else add_float(-flex.to<flex_float>());
+  }
+
+  void combine(const group_aggregate_value& other) {
+    const auto& o = dynamic_cast<const sum&>(other);
+    m_int_sum += o.m_int_sum;
+    add_float(o.m_float_sum);
+    add_float(o.m_compensation);
+  }
+
+  flexible_type emit() const {
+    if (m_type == flex_type_enum::INTEGER) return m_int_sum;
+    return m_float_sum + m_compensation;
+  }
+
+  bool support_type(flex_type_enum type) const {
+    return type == flex_type_enum::INTEGER || type == flex_type_enum::FLOAT;
+  }
+
+  flex_type_enum set_input_type(flex_type_enum type) {
+    m_type = type;
+    return type;
+  }
+
+  std::string name() const { return "sum"; }
+
+  bool add_after_combine() const { return true; }
+
+  void save(oarchive& oarc) const {
+    oarc << m_type << m_int_sum << m_float_sum << m_compensation;
+  }
+
+  void load(iarchive& iarc) {
+    iarc >> m_type >> m_int_sum >> m_float_sum >> m_compensation;
+  }
+
+ private:
+  void add_float(double x) {
+    double t = m_float_sum + x;
+    if (std::fabs(m_float_sum) >= std::fabs(x)) m_compensation += (m_float_sum - t) + x;
+    else m_compensation += (x - t) + m_float_sum;
+    m_float_sum = t;
+  }
+
+  flex_type_enum m_type = flex_type_enum::FLOAT;
+  flex_int m_int_sum = 0;
+  double m_float_sum = 0;
+  double m_compensation = 0;
+};
+
+/**
+ * Count of the non missing values.
+ */
+class count: public invertible_aggregate_value {
+ public:
+  group_aggregate_value* new_instance() const { return new count; }
+  void add_element_simple(const flexible_type& flex) {
+    if (flex.get_type() != flex_type_enum::UNDEFINED) ++m_count;
+  }
+  void remove_element_simple(const flexible_type& flex) {
+    if (flex.get_type() != flex_type_enum::UNDEFINED) --m_count;
+  }
+  void combine(const group_aggregate_value& other) {
+    m_count += dynamic_cast<const count&>(other).m_count;
+  }
+  flexible_type emit() const { return (flex_int)m_count; }
+  bool support_type(flex_type_enum) const { return true; }
+  flex_type_enum set_input_type(flex_type_enum) { return flex_type_enum::INTEGER; }
+  std::string name() const { return "count"; }
+  bool add_after_combine() const { return true; }
+  void save(oarchive& oarc) const { oarc << m_count; }
+  void load(iarchive& iarc) { iarc >> m_count; }
+ private:
+  size_t m_count = 0;
+};
+
+/**
+ * Mean and variance by Welford's update, with its inverse for removal.
+ * Emits the mean, the population variance or the population standard
+ * deviation depending on the output mode.
+ */
+class moments: public invertible_aggregate_value {
+ public:
+  enum class output_mode { MEAN, VARIANCE, STDV };
+
+  explicit moments(output_mode mode = output_mode::MEAN): m_mode(mode) { }
+
+  group_aggregate_value* new_instance() const { return new moments(m_mode); }
+
+  void add_element_simple(const flexible_type& flex) {
+    if (flex.get_type() == flex_type_enum::UNDEFINED) return;
+    double x = flex.to<flex_float>();
+    ++m_count;
+    double delta = x - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (x - m_mean);
+  }
+
+  void remove_element_simple(const flexible_type& flex) {
+    if (flex.get_type() == flex_type_enum::UNDEFINED) return;
+    double x = flex.to<flex_float>();
+    if (m_count <= 1) {
+      m_count = 0; m_mean = 0; m_m2 = 0;
+      return;
+    }
+    double delta = x - m_mean;
+    --m_count;
+    m_mean -= delta / m_count;
+    m_m2 -= delta * (x - m_mean);
+    if (m_m2 < 0) m_m2 = 0;
+  }
+
+  void combine(const group_aggregate_value& other) {
+    const auto& o = dynamic_cast<const moments&>(other);
+    if (o.m_count == 0) return;
+    size_t n = m_count + o.m_count;
+    double delta = o.m_mean - m_mean;
+    m_mean += delta * o.m_count / n;
+    m_m2 += o.m_m2 + delta * delta * m_count * o.m_count / n;
+    m_count = n;
+  }
+
+  flexible_type emit() const {
+    if (m_count == 0) return FLEX_UNDEFINED;
+    switch(m_mode) {
+     case output_mode::MEAN: return m_mean;
+     case output_mode::VARIANCE: return m_m2 / m_count;
+     default: return std::sqrt(m_m2 / m_count);
+    }
+  }
+
+  bool support_type(flex_type_enum type) const {
+    return type == flex_type_enum::INTEGER || type == flex_type_enum::FLOAT;
+  }
+
+  flex_type_enum set_input_type(flex_type_enum) { return flex_type_enum::FLOAT; }
+
+  std::string name() const {
+    switch(m_mode) {
+     case output_mode::MEAN: return "avg";
+     case output_mode::VARIANCE: return "var";
+     default: return "stdv";
+    }
+  }
+
+  bool add_after_combine() const { return true; }
+
+  void save(oarchive& oarc) const { oarc << m_count << m_mean << m_m2; }
+  void load(iarchive& iarc) { iarc >> m_count >> m_mean >> m_m2; }
+
+ private:
+  output_mode m_mode;
+  size_t m_count = 0;
+  double m_mean = 0;
+  double m_m2 = 0;
+};
+
+/**
+ * Minimum (or maximum if IsMax) by a monotonic deque: the deque holds the
+ * elements which may still become the extremum, in insertion order, with
+ * increasing (decreasing) values. Adding an element pops the back entries
+ * it dominates, and removing the oldest element pops the front entry if
+ * it is that element. Each element is pushed and popped at most once.
+ */
+template <bool IsMax>
+class extremum: public invertible_aggregate_value {
+ public:
+  group_aggregate_value* new_instance() const {
+    auto ret = new extremum;
+    ret->m_type = m_type;
+    return ret;
+  }
+
+  void add_element_simple(const flexible_type& flex) {
+    if (flex.get_type() == flex_type_enum::UNDEFINED) return;
+    push(flex, m_num_added++);
+  }
+
+  void remove_element_simple(const flexible_type& flex) {
+    if (flex.get_type() == flex_type_enum::UNDEFINED) return;
+    if (!m_deque.empty() && m_deque.front().second == m_num_removed) {
+      m_deque.pop_front();
+    }
+    ++m_num_removed;
+  }
+
+  /**
+   * The elements of "other" are taken to follow the elements of this
+   * aggregate.
+   */
+  void combine(const group_aggregate_value& other) {
+    const auto& o = dynamic_cast<const extremum&>(other);
+    for (const auto& entry: o.m_deque) {
+      push(entry.first, m_num_added + entry.second - o.m_num_removed);
+    }
+    m_num_added += o.m_num_added - o.m_num_removed;
+  }
+
+  flexible_type emit() const {
+    if (m_deque.empty()) return FLEX_UNDEFINED;
+    return m_deque.front().first;
+  }
+
+  bool support_type(flex_type_enum type) const {
+    return type == flex_type_enum::INTEGER || type == flex_type_enum::FLOAT ||
+        type == flex_type_enum::DATETIME || type == flex_type_enum::STRING;
+  }
+
+  flex_type_enum set_input_type(flex_type_enum type) {
+    m_type = type;
+    return type;
+  }
+
+  std::string name() const { return IsMax ? "max" : "min"; }
+
+  bool add_after_combine() const { return true; }
+
+  void save(oarchive& oarc) const {
+    oarc << m_type << m_num_added << m_num_removed << m_deque.size();
+    for (const auto& entry: m_deque) oarc << entry.first << entry.second;
+  }
+
+  void load(iarchive& iarc) {
+    size_t n = 0;
+    iarc >> m_type >> m_num_added >> m_num_removed >> n;
+    m_deque.resize(n);
+    for (auto& entry: m_deque) iarc >> entry.first >> entry.second;
+  }
+
+ private:
+  void push(const flexible_type& value, size_t seq) {
+    while (!m_deque.empty() &&
+           (IsMax ? !(value < m_deque.back().first) : !(m_deque.back().first < value))) {
+      m_deque.pop_back();
+    }
+    m_deque.emplace_back(value, seq);
+  }
+
+  flex_type_enum m_type = flex_type_enum::FLOAT;
+  size_t m_num_added = 0;
+  size_t m_num_removed = 0;
+  /// (value, sequence number of the element)
+  std::deque<std::pair<flexible_type, size_t> > m_deque;
+};
+
+typedef moments average;
+typedef extremum<false> min;
+typedef extremum<true> max;
+
+/**
+ * Returns a new invertible aggregator for the name of a builtin rolling
+ * aggregate ("__builtin__sum__", "__builtin__avg__", "__builtin__var__",
+ * "__builtin__stdv__", "__builtin__min__", "__builtin__max__",
+ * "__builtin__count__"), or nullptr if there is none.
+ */
+inline std::shared_ptr<group_aggregate_value> get_builtin_rolling_aggregator(
+    const std::string& name) {
+  if (name == "__builtin__sum__") return std::make_shared<sum>();
+  if (name == "__builtin__avg__") return std::make_shared<moments>(moments::output_mode::MEAN);
+  if (name == "__builtin__var__") return std::make_shared<moments>(moments::output_mode::VARIANCE);
+  if (name == "__builtin__stdv__") return std::make_shared<moments>(moments::output_mode::STDV);
+  if (name == "__builtin__min__") return std::make_shared<min>();
+  if (name == "__builtin__max__") return std::make_shared<max>();
+  if (name == "__builtin__count__") return std::make_shared<count>();
+  return nullptr;
+}
+
+/**
+ * Returns a new aggregator for the name of a builtin aggregate: the rolling
+ * aggregator of \ref get_builtin_rolling_aggregator if there is one, and
+ * the builtin groupby aggregator otherwise. Throws if neither exists.
+ */
+inline std::shared_ptr<group_aggregate_value> get_builtin_aggregator(
+    const std::string& name) {
+  auto aggregator = get_builtin_rolling_aggregator(name);
+  if (aggregator == nullptr) aggregator = get_builtin_group_aggregator(name);
+  if (aggregator == nullptr) log_and_throw("Unknown aggregator " + name);
+  return aggregator;
+}
+
+} // namespace rolling_operators
+
+
+/**
+ * A first in, first out window of values over a group_aggregate_value.
+ *
+ * If the aggregator is an invertible_aggregate_value, the window holds one
+ * aggregate, updated by add_element_simple() and remove_element_simple().
+ * Otherwise it uses two stacks: a back aggregate of the recently pushed
+ * values, and a front stack of suffix aggregates of the older values,
+ * rebuilt from the back values when it runs empty. Any aggregator with a
+ * combine() is thus maintained with amortized O(1) combines per value,
+ * instead of re-aggregating the window.
+ *
+ * The two stacks follow the group_aggregate_value contract: an aggregate
+ * is partial_finalize()d once its elements are added and before it is
+ * combined, and no element is added after that. Front stack entries are
+ * finalized as they are built. emit() finalizes a copy of the back
+ * aggregate, made by save() and load() into a scratch aggregate, and
+ * combines it into a copy of the top of the front stack; the scratch
+ * aggregates are allocated once with the window.
+ */
+class sliding_window_aggregate {
+ public:
+  /**
+   * Creates an empty window. "prototype" must have its input type set;
+   * the window aggregates are obtained from its new_instance().
+   */
+  explicit sliding_window_aggregate(const group_aggregate_value& prototype)
+      : m_prototype(prototype.new_instance()),
+        m_scratch(prototype.new_instance()),
+        m_scratch_back(prototype.new_instance()) {
+    reset_back();
+  }
+
+  /// Adds a value at the back of the window
+  void push_back(const flexible_type& value) {
+    m_values.push_back(value);
+    if (value.get_type() == flex_type_enum::UNDEFINED) return;
+    ++m_num_non_null;
+    m_back->add_element_simple(value);
+  }
+
+  /// Removes the value at the front of the window
+  void pop_front() {
+    DASSERT_FALSE(m_values.empty());
+    const flexible_type& value = m_values.front();
+    if (value.get_type() != flex_type_enum::UNDEFINED) --m_num_non_null;
+    if (m_invertible_back) {
+      m_invertible_back->remove_element_simple(value);
+    } else {
+      if (m_front.empty()) flip();
+      m_front.pop_back();
+    }
+    m_values.pop_front();
+  }
+
+  /// Removes all the values
+  void clear() {
+    m_values.clear();
+    m_front.clear();
+    reset_back();
+    m_num_non_null = 0;
+  }
+
+  /// Number of values in the window, missing values included
+  size_t size() const { return m_values.size(); }
+
+  /// Number of non missing values in the window
+  size_t num_non_null() const { return m_num_non_null; }
+
+  /// Emits the aggregate of the values of the window
+  flexible_type emit() const {
+    if (m_invertible_back) return m_back->emit();
+    copy_aggregate(*m_back, *m_scratch_back, m_copy_buffer);
+    m_scratch_back->partial_finalize();
+    if (m_front.empty()) return m_scratch_back->emit();
+    copy_aggregate(*m_front.back(), *m_scratch, m_copy_buffer);
+    m_scratch->combine(*m_scratch_back);
+    return m_scratch->emit();
+  }
+
+ private:
+  /**
+   * Replaces the back aggregate with a new instance of the prototype, and
+   * remembers whether it can remove values.
+   */
+  void reset_back() {
+    m_back.reset(m_prototype->new_instance());
+    m_invertible_back = dynamic_cast<invertible_aggregate_value*>(m_back.get());
+  }
+
+  /**
+   * Moves the back values into the front stack. The top of the stack
+   * aggregates all the values, and each entry below it the same values but
+   * the oldest one, so that removing the oldest value pops the top.
+   */
+  void flip() {
+    size_t nvalues = m_values.size();
+    size_t nback = nvalues - m_front.size();
+    std::vector<std::unique_ptr<group_aggregate_value> > front;
+    front.reserve(nback);
+    for (size_t i = nvalues; i > nvalues - nback; --i) {
+      std::unique_ptr<group_aggregate_value> agg(m_prototype->new_instance());
+      const flexible_type& value = m_values[i - 1];
+      if (value.get_type() != flex_type_enum::UNDEFINED) agg->add_element_simple(value);
+      agg->partial_finalize();
+      if (!front.empty()) agg->combine(*front.back());
+      front.push_back(std::move(agg));
+    }
+    m_front = std::move(front);
+    reset_back();
+  }
+
+  std::unique_ptr<group_aggregate_value> m_prototype;
+  std::deque<flexible_type> m_values;
+  std::unique_ptr<group_aggregate_value> m_back;
+  /// m_back if it is an invertible_aggregate_value, NULL otherwise
+  invertible_aggregate_value* m_invertible_back = NULL;
+  std::vector<std::unique_ptr<group_aggregate_value> > m_front;
+  size_t m_num_non_null = 0;
+  /// Copies of the front top and of the back aggregate made by emit()
+  std::unique_ptr<group_aggregate_value> m_scratch, m_scratch_back;
+  mutable std::vector<char> m_copy_buffer;
+};
+
+} // namespace graphlab
+#endif // GRAPHLAB_SFRAME_ROLLING_AGGREGATE_VALUE_HPP
@@ -9,10 +9,102 @@
 #define GRAPHLAB_SFRAME_sframe_rows_HPP
 #include <vector>
 #include <map>
+#include <cstdint>
+#include <type_traits>
 #include <graphlab/flexible_type/flexible_type.hpp>
 namespace graphlab {
 class oarchive;
 class iarchive;
+/**
+ * A column of an \ref sframe_rows block presented as a contiguous array of
+ * a single numeric type plus a validity bitmap, instead of an array of
+ * flexible_type.
+ *
+ * T is flex_int or flex_float. A flex_float view also accepts integer
+ * values, which are converted. \ref assign fails if the column holds any
+ * other type. Missing values are stored as T() in \ref data and have their
+ * bit cleared in \ref validity. The buffers are kept across calls to
+ * \ref assign, so a view reused for every block of a stream allocates only
+ * once.
+ *
+ * \code
+ * typed_column_view<flex_float> view;
+ * if (view.assign(*rows.cget_columns()[0])) {
+ *   const double* values = view.data();
+ *   double sum = 0;
+ *   if (view.null_count() == 0) {
+ *     for (size_t i = 0; i < view.size(); ++i) sum += values[i];
+ *   }
+ * }
+ * \endcode
+ */
+template <typename T>
+class typed_column_view {
+  static_assert(std::is_same<T, flex_int>::value || std::is_same<T, flex_float>::value,
+                "typed_column_view supports flex_int and flex_float");
+ public:
+  /**
+   * Unboxes a decoded column. Returns false, leaving the view empty, if
+   * the column holds a value which is neither T, an accepted conversion,
+   * nor missing.
+   */
+  bool assign(const std::vector<flexible_type>& column) {
+    size_t n = column.size();
+    m_values.resize(n);
+    m_validity.assign((n + 63) / 64, 0);
+    m_null_count = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const flexible_type& v = column[i];
+      switch(v.get_type()) {
+       case flex_type_enum::INTEGER:
+         m_values[i] = (T)v.get<flex_int>();
+         break;
+       case flex_type_enum::FLOAT:
+         if (!std::is_same<T, flex_float>::value) return fail();
+         m_values[i] = (T)v.get<flex_float>();
+         break;
+       case flex_type_enum::UNDEFINED:
+         m_values[i] = T();
+         ++m_null_count;
+         continue;
+       default:
+         return fail();
+      }
+      m_validity[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    return true;
+  }
+
+  /// Number of values.
+  inline size_t size() const { return m_values.size(); }
+
+  /// The values. Missing values are T().
+  inline const T* data() const { return m_values.data(); }
+
+  /// Bit i % 64 of word i / 64 is set if value i is present.
+  inline const uint64_t* validity() const { return m_validity.data(); }
+
+  /// True if value i is present.
+  inline bool is_valid(size_t i) const {
+    return (m_validity[i / 64] >> (i % 64)) & 1;
+  }
+
+  /// Number of missing values.
+  inline size_t null_count() const { return m_null_count; }
+
+ private:
+  bool fail() {
+    m_values.clear();
+    m_validity.clear();
+    m_null_count = 0;
+    return false;
+  }
+
+  std::vector<T> m_values;
+  std::vector<uint64_t> m_validity;
+  size_t m_null_count = 0;
+};
+
 /**
  *
  * sframe-rows is a semi-opaque wrapper around a collection of columns of
@@ -504,6 +596,16 @@ class sframe_rows {
    */
   sframe_rows type_check(const std::vector<flex_type_enum>& typelist) const;
 
+  /**
+   * Presents column i as a contiguous typed array with a validity bitmap.
+   * Returns false if the column does not hold T values.
+   * \see typed_column_view
+   */
+  template <typename T>
+  inline bool get_typed_column(size_t i, typed_column_view<T>& view) const {
+    return view.assign(*m_decoded_columns[i]);
+  }
+
    private:
     std::vector<ptr_to_decoded_column_type> m_decoded_columns;
     mutable bool m_is_unique = true;
@@ -0,0 +1,178 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SFRAME_SKETCH_AGGREGATE_VALUE_HPP
+#define GRAPHLAB_SFRAME_SKETCH_AGGREGATE_VALUE_HPP
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <graphlab/flexible_type/flexible_type.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/util/cityhash_gl.hpp>
+#include <graphlab/sframe/group_aggregate_value.hpp>
+#include <graphlab/sketches/hyperloglog.hpp>
+#include <graphlab/sketches/quantile_sketch.hpp>
+#include <graphlab/sketches/space_saving.hpp>
+
+namespace graphlab {
+
+/**
+ * Approximate aggregators backed by mergeable sketches. Each one holds a
+ * fixed amount of memory per group, however many values the group has,
+ * and combines exactly with other partial aggregates; so they can be
+ * spilled and merged by a parallel groupby like any other aggregator.
+ *
+ * Missing values are ignored.
+ */
+namespace sketch_operators {
+
+/**
+ * Approximate number of distinct values, by a HyperLogLog sketch of
+ * 2^register_bits registers (one byte each). The relative standard error
+ * is 1.04 / sqrt(2^register_bits): about 1.6% for the default of 12.
+ */
+class approx_count_distinct: public group_aggregate_value {
+ public:
+  explicit approx_count_distinct(size_t register_bits = 12): m_sketch(register_bits),
+                                                             m_register_bits(register_bits) { }
+
+  group_aggregate_value* new_instance() const {
+    return new approx_count_distinct(m_register_bits);
+  }
+
+  void add_element_simple(const flexible_type& flex) {
+    if (flex.get_type() == flex_type_enum::UNDEFINED) return;
+    m_sketch.add(hash64(flex.hash128()));
+  }
+
+  void combine(const group_aggregate_value& other) {
+    m_sketch.combine(dynamic_cast<const approx_count_distinct&>(other).m_sketch);
+  }
+
+  flexible_type emit() const { return (flex_int)std::llround(m_sketch.estimate()); }
+  bool support_type(flex_type_enum) const { return true; }
+  flex_type_enum set_input_type(flex_type_enum) { return flex_type_enum::INTEGER; }
+  std::string name() const { return "approx_count_distinct"; }
+
+  void save(oarchive& oarc) const { oarc << m_register_bits << m_sketch; }
+  void load(iarchive& iarc) { iarc >> m_register_bits >> m_sketch; }
+
+ private:
+  sdk_sketches::hyperloglog m_sketch;
+  size_t m_register_bits;
+};
+
+/**
+ * Approximate quantiles of numeric values, by a KLL sketch of parameter k.
+ * The rank error is about 1.7 / k of the group size: under 1% for the
+ * default of 200. Emits a float when a single quantile is requested, and
+ * an array otherwise. Groups with no values emit a missing value.
+ */
+class approx_quantile: public group_aggregate_value {
+ public:
+  approx_quantile(const std::vector<double>& quantiles = {0.5},
+                  bool emit_array = false, size_t k = 200)
+      : m_quantiles(quantiles), m_emit_array(emit_array), m_k(k), m_sketch(k) { }
+
+  group_aggregate_value* new_instance() const {
+    return new approx_quantile(m_quantiles, m_emit_array, m_k);
+  }
+
+  void add_element_simple(const flexible_type& flex) {
+    if (flex.get_type() == flex_type_enum::UNDEFINED) return;
+    m_sketch.add(flex.to<flex_float>());
+  }
+
+  void combine(const group_aggregate_value& other) {
+    m_sketch.combine(dynamic_cast<const approx_quantile&>(other).m_sketch);
+  }
+
+  flexible_type emit() const {
+    if (m_sketch.size() == 0) return FLEX_UNDEFINED;
+    auto values = m_sketch.query(m_quantiles);
+    if (m_emit_array) return flex_vec(values.begin(), values.end());
+    return values[0];
+  }
+
+  bool support_type(flex_type_enum type) const {
+    return type == flex_type_enum::INTEGER || type == flex_type_enum::FLOAT;
+  }
+
+  flex_type_enum set_input_type(flex_type_enum) {
+    return m_emit_array ? flex_type_enum::VECTOR : flex_type_enum::FLOAT;
+  }
+
+  std::string name() const { return "approx_quantile"; }
+
+  void save(oarchive& oarc) const { oarc << m_quantiles << m_emit_array << m_k << m_sketch; }
+  void load(iarchive& iarc) { iarc >> m_quantiles >> m_emit_array >> m_k >> m_sketch; }
+
+ private:
+  std::vector<double> m_quantiles;
+  bool m_emit_array;
+  size_t m_k;
+  sdk_sketches::quantile_sketch m_sketch;
+};
+
+/**
+ * The approximately most frequent values, by a space saving sketch
+ * monitoring "capacity" values. Emits a dictionary of at most k values to
+ * their estimated counts; every value occuring in more than
+ * 1 / capacity of the group is reported, and each count overestimates the
+ * true count by at most group size / capacity.
+ */
+class frequent_items: public group_aggregate_value {
+ public:
+  explicit frequent_items(size_t k = 10, size_t capacity = 0)
+      : m_k(k), m_capacity(std::max(capacity, 4 * k)), m_sketch(m_capacity) { }
+
+  group_aggregate_value* new_instance() const {
+    return new frequent_items(m_k, m_capacity);
+  }
+
+  void add_element_simple(const flexible_type& flex) {
+    if (flex.get_type() == flex_type_enum::UNDEFINED) return;
+    m_sketch.add(flex);
+  }
+
+  void combine(const group_aggregate_value& other) {
+    m_sketch.combine(dynamic_cast<const frequent_items&>(other).m_sketch);
+  }
+
+  flexible_type emit() const {
+    flex_dict ret;
+    for (const auto& entry: m_sketch.frequent_items()) {
+      if (ret.size() == m_k) break;
+      ret.push_back({entry.value, (flex_int)entry.count});
+    }
+    return ret;
+  }
+
+  bool support_type(flex_type_enum type) const {
+    return type != flex_type_enum::DICT && type != flex_type_enum::LIST &&
+           type != flex_type_enum::VECTOR;
+  }
+
+  flex_type_enum set_input_type(flex_type_enum) { return flex_type_enum::DICT; }
+  std::string name() const { return "frequent_items"; }
+
+  void save(oarchive& oarc) const { oarc << m_k << m_capacity << m_sketch; }
+  void load(iarchive& iarc) { iarc >> m_k >> m_capacity >> m_sketch; }
+
+ private:
+  size_t m_k;
+  size_t m_capacity;
+  sdk_sketches::space_saving<flexible_type> m_sketch;
+};
+
+} // namespace sketch_operators
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SDK_SKETCHES_BLOOM_FILTER_HPP
+#define GRAPHLAB_SDK_SKETCHES_BLOOM_FILTER_HPP
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/util/cityhash_gl.hpp>
+
+namespace graphlab {
+namespace sdk_sketches {
+
+/**
+ * \ingroup sketching
+ * A bloom filter of 128 bit hashes.
+ *
+ * The filter is sized for an expected number of elements at
+ * bits_per_element bits each (rounded up to a power of two), and probes
+ * num_probes bits derived from the two halves of the hash (Kirsch and
+ * Mitzenmacher, 2006). At 10 bits per element and 5 probes the false
+ * positive rate is about 1%.
+ *
+ * Threads can fill one filter together with concurrent_add(), or each
+ * fill their own and combine them.
+ */
+class bloom_filter {
+ public:
+  explicit bloom_filter(size_t expected_elements = 0,
+                        size_t bits_per_element = 10,
+                        size_t num_probes = 5): m_num_probes(num_probes) {
+    size_t nbits = 64;
+    while (nbits < expected_elements * bits_per_element) nbits *= 2;
+    m_words.resize(nbits / 64, 0);
+    m_mask = nbits - 1;
+  }
+
+  inline void add(uint128_t hash) {
+    uint64_t h1 = (uint64_t)hash, h2 = (uint64_t)(hash >> 64) | 1;
+    for (size_t i = 0; i < m_num_probes; ++i) {
+      uint64_t bit = (h1 + i * h2) & m_mask;
+      m_words[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+  }
+
+  /**
+   * Same as add(), safe to call from several threads at once.
+   */
+  inline void concurrent_add(uint128_t hash) {
+    uint64_t h1 = (uint64_t)hash, h2 = (uint64_t)(hash >> 64) | 1;
+    for (size_t i = 0; i < m_num_probes; ++i) {
+      uint64_t bit = (h1 + i * h2) & m_mask;
+      uint64_t mask = uint64_t(1) << (bit & 63);
+      if ((m_words[bit >> 6] & mask) == 0) __sync_fetch_and_or(&m_words[bit >> 6], mask);
+    }
+  }
+
+  /**
+   * Returns false if the hash was certainly never added.
+   */
+  inline bool may_contain(uint128_t hash) const {
+    uint64_t h1 = (uint64_t)hash, h2 = (uint64_t)(hash >> 64) | 1;
+    for (size_t i = 0; i < m_num_probes; ++i) {
+      uint64_t bit = (h1 + i * h2) & m_mask;
+      if ((m_words[bit >> 6] & (uint64_t(1) << (bit & 63))) == 0) return false;
+    }
+    return true;
+  }
+
+  /**
+   * Merges a filter of the same size and number of probes into this one.
+   */
+  void combine(const bloom_filter& other) {
+    ASSERT_EQ(m_words.size(), other.m_words.size());
+    for (size_t i = 0; i < m_words.size(); ++i) m_words[i] |= other.m_words[i];
+  }
+
+ private:
+  size_t m_num_probes;
+  uint64_t m_mask;
+  std::vector<uint64_t> m_words;
+};
+
+} // namespace sdk_sketches
+} // namespace graphlab
+#endif
@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SDK_SKETCHES_HYPERLOGLOG_HPP
+#define GRAPHLAB_SDK_SKETCHES_HYPERLOGLOG_HPP
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+namespace sdk_sketches {
+
+/**
+ * \ingroup sketching
+ * An implementation of the HyperLogLog sketch for estimating the number of
+ * distinct elements of a stream (Flajolet, Fusy, Gandouet and Meunier,
+ * 2007), with the small range correction by linear counting.
+ *
+ * The sketch holds 2^b one byte registers; the standard error of the
+ * estimate is about 1.04 / sqrt(2^b). Two sketches with the same b can be
+ * combined, and the result is the sketch of the union of the two streams.
+ *
+ * \code
+ * hyperloglog hll(12);
+ * for (const auto& value: values) hll.add(value.hash128());
+ * std::cout << hll.estimate();
+ * \endcode
+ */
+class hyperloglog {
+ public:
+  /**
+   * Constructs a sketch with 2^b registers, 4 <= b <= 16.
+   */
+  explicit hyperloglog(size_t b = 12): m_b(b), m_registers(size_t(1) << b, 0) {
+    ASSERT_MSG(b >= 4 && b <= 16, "hyperloglog register bits must be in [4, 16]");
+  }
+
+  /**
+   * Adds an element, given a 64 bit hash of it. The hash must be uniformly
+   * distributed.
+   */
+  inline void add(uint64_t hash) {
+    size_t index = hash >> (64 - m_b);
+    uint64_t rest = (hash << m_b) | (uint64_t(1) << (m_b - 1));
+    uint8_t rank = __builtin_clzll(rest) + 1;
+    if (rank > m_registers[index]) m_registers[index] = rank;
+  }
+
+  /**
+   * Merges another sketch with the same number of registers into this one.
+   */
+  void combine(const hyperloglog& other) {
+    ASSERT_EQ(m_b, other.m_b);
+    for (size_t i = 0; i < m_registers.size(); ++i) {
+      m_registers[i] = std::max(m_registers[i], other.m_registers[i]);
+    }
+  }
+
+  /**
+   * Returns the estimated number of distinct elements.
+   */
+  double estimate() const {
+    double m = m_registers.size();
+    double sum = 0;
+    size_t num_zeros = 0;
+    for (uint8_t r: m_registers) {
+      sum += std::ldexp(1.0, -int(r));
+      num_zeros += (r == 0);
+    }
+    double alpha = 0.7213 / (1 + 1.079 / m);
+    double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && num_zeros > 0) e = m * std::log(m / num_zeros);
+    return e;
+  }
+
+  /**
+   * Returns the standard error of the estimate, relative to the true count.
+   */
+  double relative_error() const {
+    return 1.04 / std::sqrt(double(m_registers.size()));
+  }
+
+  void save(oarchive& oarc) const {
+    oarc << m_b << m_registers;
+  }
+
+  void load(iarchive& iarc) {
+    iarc >> m_b >> m_registers;
+  }
+
+ private:
+  size_t m_b;
+  std::vector<uint8_t> m_registers;
+};
+
+} // namespace sdk_sketches
+} // namespace graphlab
+#endif
@@ -0,0 +1,176 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SDK_SKETCHES_QUANTILE_SKETCH_HPP
+#define GRAPHLAB_SDK_SKETCHES_QUANTILE_SKETCH_HPP
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+namespace sdk_sketches {
+
+/**
+ * \ingroup sketching
+ * A mergeable quantile sketch of a stream of numbers, after Karnin, Lang
+ * and Liberty, "Optimal Quantile Approximation in Streams" (2016).
+ *
+ * The sketch is a stack of compactors. An element of level h stands for
+ * 2^h elements of the stream. When the sketch is full, the lowest level
+ * over its capacity is sorted, and every other element of it (starting at
+ * a random offset) is promoted to the next level. Capacities decrease
+ * geometrically from the top level down, so the sketch holds O(k)
+ * elements, and the rank error of a query is about 1.7 / k of the stream
+ * size.
+ *
+ * Sketches with the same k can be combined; the result is a sketch of the
+ * concatenation of the two streams.
+ */
+class quantile_sketch {
+ public:
+  explicit quantile_sketch(size_t k = 200): m_k(std::max<size_t>(k, 8)) {
+    m_levels.resize(1);
+  }
+
+  /**
+   * Adds an element to the sketch.
+   */
+  void add(double value) {
+    m_levels[0].push_back(value);
+    ++m_size;
+    ++m_num_retained;
+    if (m_num_retained >= max_retained()) compress();
+  }
+
+  /**
+   * Merges another sketch with the same k into this one.
+   */
+  void combine(const quantile_sketch& other) {
+    if (other.m_levels.size() > m_levels.size()) m_levels.resize(other.m_levels.size());
+    for (size_t h = 0; h < other.m_levels.size(); ++h) {
+      m_levels[h].insert(m_levels[h].end(),
+                         other.m_levels[h].begin(), other.m_levels[h].end());
+    }
+    m_size += other.m_size;
+    m_num_retained += other.m_num_retained;
+    // partials often share a state (every sketch starts from the same
+    // seed), so the states are mixed rather than xored, which would zero
+    // them and stop the coin
+    m_rng_state = mix(m_rng_state + other.m_rng_state + m_size);
+    if (m_rng_state == 0) m_rng_state = seed();
+    while (m_num_retained >= max_retained()) compress();
+  }
+
+  /**
+   * Returns the number of elements added to the sketch.
+   */
+  size_t size() const { return m_size; }
+
+  /**
+   * Returns the approximate quantile of each of the fractions in
+   * "quantiles", each in [0, 1]. The sketch must not be empty.
+   */
+  std::vector<double> query(const std::vector<double>& quantiles) const {
+    std::vector<std::pair<double, uint64_t> > weighted;
+    weighted.reserve(m_num_retained);
+    for (size_t h = 0; h < m_levels.size(); ++h) {
+      for (double value: m_levels[h]) weighted.push_back({value, uint64_t(1) << h});
+    }
+    std::sort(weighted.begin(), weighted.end());
+    std::vector<double> ret;
+    for (double q: quantiles) {
+      double target = std::min(std::max(q, 0.0), 1.0) * double(m_size);
+      uint64_t cumulative = 0;
+      double value = weighted.empty() ? NAN : weighted.back().first;
+      for (const auto& w: weighted) {
+        cumulative += w.second;
+        if (double(cumulative) > target) {
+          value = w.first;
+          break;
+        }
+      }
+      ret.push_back(value);
+    }
+    return ret;
+  }
+
+  void save(oarchive& oarc) const {
+    oarc << m_k << m_size << m_num_retained << m_rng_state << m_levels;
+  }
+
+  void load(iarchive& iarc) {
+    iarc >> m_k >> m_size >> m_num_retained >> m_rng_state >> m_levels;
+  }
+
+ private:
+  /// The capacity of level h
+  size_t capacity(size_t h) const {
+    size_t depth = m_levels.size() - h - 1;
+    return std::max<size_t>(2, std::ceil(m_k * std::pow(2.0 / 3.0, depth)));
+  }
+
+  size_t max_retained() const {
+    size_t ret = 0;
+    for (size_t h = 0; h < m_levels.size(); ++h) ret += capacity(h);
+    return ret;
+  }
+
+  static uint64_t seed() { return 0x9e3779b97f4a7c15ULL; }
+
+  /// splitmix64
+  static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  /// A xorshift coin, so that sketches are reproducible
+  bool flip_coin() {
+    m_rng_state ^= m_rng_state << 13;
+    m_rng_state ^= m_rng_state >> 7;
+    m_rng_state ^= m_rng_state << 17;
+    return m_rng_state & 1;
+  }
+
+  /// Compacts the lowest level which is over its capacity
+  void compress() {
+    for (size_t h = 0; h < m_levels.size(); ++h) {
+      if (m_levels[h].size() < capacity(h)) continue;
+      if (h + 1 == m_levels.size()) m_levels.emplace_back();
+      auto& level = m_levels[h];
+      std::sort(level.begin(), level.end());
+      // an odd element out stays at this level
+      size_t npairs = level.size() / 2;
+      size_t offset = flip_coin() ? 1 : 0;
+      auto& next = m_levels[h + 1];
+      for (size_t i = 0; i < npairs; ++i) next.push_back(level[2 * i + offset]);
+      if (level.size() % 2) {
+        level[0] = level.back();
+        level.resize(1);
+      } else {
+        level.clear();
+      }
+      m_num_retained -= npairs;
+      return;
+    }
+  }
+
+  size_t m_k;
+  size_t m_size = 0;
+  size_t m_num_retained = 0;
+  uint64_t m_rng_state = seed();
+  std::vector<std::vector<double> > m_levels;
+};
+
+} // namespace sdk_sketches
+} // namespace graphlab
+#endif
@@ -0,0 +1,182 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_SDK_SKETCHES_SPACE_SAVING_HPP
+#define GRAPHLAB_SDK_SKETCHES_SPACE_SAVING_HPP
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+namespace sdk_sketches {
+
+/**
+ * \ingroup sketching
+ * The space saving sketch of the most frequent elements of a stream
+ * (Metwally, Agrawal and El Abbadi, 2005).
+ *
+ * The sketch monitors at most "capacity" elements. An element which is
+ * not monitored replaces the monitored element of least count, inheriting
+ * that count as its error. Every element occurring more than
+ * N / capacity times in a stream of N elements is monitored, and the
+ * count of a monitored element overestimates its true count by at most its
+ * error.
+ *
+ * Counters are kept in an indexed binary min heap, so that each update is
+ * O(log capacity). Sketches are merged as in Agarwal et al., "Mergeable
+ * summaries" (2012).
+ *
+ * T must be hashable by std::hash and serializable.
+ */
+template <typename T>
+class space_saving {
+ public:
+  /// A monitored element
+  struct entry {
+    T value;
+    size_t count;
+    size_t error;
+  };
+
+  explicit space_saving(size_t capacity = 100): m_capacity(std::max<size_t>(capacity, 1)) { }
+
+  /**
+   * Adds "count" occurences of an element.
+   */
+  void add(const T& value, size_t count = 1) {
+    auto iter = m_index.find(value);
+    if (iter != m_index.end()) {
+      size_t pos = iter->second;
+      m_heap[pos].count += count;
+      sift_down(pos);
+    } else if (m_heap.size() < m_capacity) {
+      m_heap.push_back(entry{value, count, 0});
+      m_index[value] = m_heap.size() - 1;
+      sift_up(m_heap.size() - 1);
+    } else {
+      // replace the minimum, at the root of the heap
+      m_index.erase(m_heap[0].value);
+      size_t min_count = m_heap[0].count;
+      m_heap[0] = entry{value, min_count + count, min_count};
+      m_index[value] = 0;
+      sift_down(0);
+    }
+  }
+
+  /**
+   * Merges another sketch into this one. An element monitored by one sketch
+   * only may have occured up to the minimum count of the other, which is
+   * added to its count and error.
+   */
+  void combine(const space_saving& other) {
+    size_t this_min = (m_heap.size() < m_capacity || m_heap.empty()) ? 0 : m_heap[0].count;
+    size_t other_min = (other.m_heap.size() < other.m_capacity || other.m_heap.empty())
+                       ? 0 : other.m_heap[0].count;
+    std::unordered_map<T, entry> merged;
+    for (const auto& e: m_heap) {
+      auto& m = merged[e.value];
+      m.value = e.value;
+      m.count = e.count + other_min;
+      m.error = e.error + other_min;
+    }
+    for (const auto& e: other.m_heap) {
+      auto iter = merged.find(e.value);
+      if (iter == merged.end()) {
+        merged[e.value] = entry{e.value, e.count + this_min, e.error + this_min};
+      } else {
+        iter->second.count += e.count - other_min;
+        iter->second.error += e.error - other_min;
+      }
+    }
+    std::vector<entry> entries;
+    entries.reserve(merged.size());
+    for (auto& kv: merged) entries.push_back(std::move(kv.second));
+    if (entries.size() > m_capacity) {
+      std::nth_element(entries.begin(), entries.begin() + m_capacity, entries.end(),
+                       [](const entry& a, const entry& b) { return a.count > b.count; });
+      entries.resize(m_capacity);
+    }
+    rebuild(std::move(entries));
+  }
+
+  /**
+   * Returns the monitored elements whose count is at least "min_count",
+   * in descending order of count.
+   */
+  std::vector<entry> frequent_items(size_t min_count = 0) const {
+    std::vector<entry> ret;
+    for (const auto& e: m_heap) if (e.count >= min_count) ret.push_back(e);
+    std::sort(ret.begin(), ret.end(),
+              [](const entry& a, const entry& b) { return a.count > b.count; });
+    return ret;
+  }
+
+  size_t capacity() const { return m_capacity; }
+
+  void save(oarchive& oarc) const {
+    oarc << m_capacity << m_heap.size();
+    for (const auto& e: m_heap) oarc << e.value << e.count << e.error;
+  }
+
+  void load(iarchive& iarc) {
+    size_t n = 0;
+    iarc >> m_capacity >> n;
+    std::vector<entry> entries(n);
+    for (auto& e: entries) iarc >> e.value >> e.count >> e.error;
+    rebuild(std::move(entries));
+  }
+
+ private:
+  void rebuild(std::vector<entry>&& entries) {
+    m_heap = std::move(entries);
+    std::make_heap(m_heap.begin(), m_heap.end(),
+                   [](const entry& a, const entry& b) { return a.count > b.count; });
+    m_index.clear();
+    for (size_t i = 0; i < m_heap.size(); ++i) m_index[m_heap[i].value] = i;
+  }
+
+  void swap_entries(size_t i, size_t j) {
+    std::swap(m_heap[i], m_heap[j]);
+    m_index[m_heap[i].value] = i;
+    m_index[m_heap[j].value] = j;
+  }
+
+  void sift_up(size_t pos) {
+    while (pos > 0) {
+      size_t parent = (pos - 1) / 2;
+      if (m_heap[parent].count <= m_heap[pos].count) break;
+      swap_entries(pos, parent);
+      pos = parent;
+    }
+  }
+
+  void sift_down(size_t pos) {
+    size_t n = m_heap.size();
+    while (true) {
+      size_t smallest = pos;
+      size_t left = 2 * pos + 1, right = left + 1;
+      if (left < n && m_heap[left].count < m_heap[smallest].count) smallest = left;
+      if (right < n && m_heap[right].count < m_heap[smallest].count) smallest = right;
+      if (smallest == pos) break;
+      swap_entries(pos, smallest);
+      pos = smallest;
+    }
+  }
+
+  size_t m_capacity;
+  /// min heap on count
+  std::vector<entry> m_heap;
+  /// position of each monitored element in the heap
+  std::unordered_map<T, size_t> m_index;
+};
+
+} // namespace sdk_sketches
+} // namespace graphlab
+#endif
@@ -10,6 +10,9 @@
 #define GRAPHLAB_UNITY_SGRAPH_TRIPLE_APPLY_TYPEDEFS_HPP
 
 #include<map>
+#include <string>
+#include <vector>
+#include <functional>
 #include <graphlab/flexible_type/flexible_type.hpp>
 
 namespace graphlab {
@@ -28,6 +31,191 @@ struct edge_triple {
  */
 typedef std::function<void(edge_triple&)> lambda_triple_apply_fn;
 
+/**
+ * Argument type for the schema-compiled sgraph triple apply.
+ *
+ * Field names are resolved to integer slots once, before any edge is visited.
+ * Slot i of \ref source and \ref target is the i-th requested vertex field,
+ * and slot j of \ref edge is the j-th requested edge field. Each side of the
+ * triple is a flat array of flexible_type, so accessing a field is a pointer
+ * offset instead of a string keyed map lookup.
+ *
+ * \code
+ * // vertex fields {"pagerank", "pagerank_prev"}, edge fields {"weight"}
+ * enum { PAGERANK = 0, PAGERANK_PREV = 1 };
+ * auto fn = [](typed_edge_triple& triple) {
+ *   triple.target_as<flex_float>(PAGERANK) +=
+ *       triple.source_as<flex_float>(PAGERANK_PREV) * triple.edge_as<flex_float>(0);
+ * };
+ * \endcode
+ */
+struct typed_edge_triple {
+  /// Vertex fields of the source vertex, addressed by vertex field slot.
+  flexible_type* source = NULL;
+  /// Edge fields, addressed by edge field slot.
+  flexible_type* edge = NULL;
+  /// Vertex fields of the target vertex, addressed by vertex field slot.
+  flexible_type* target = NULL;
+
+  /**
+   * Typed reference to a source vertex field. T must be one of the
+   * flexible_type types and match the type of the stored value.
+   */
+  template <typename T>
+  inline T& source_as(size_t slot) { return source[slot].mutable_get<T>(); }
+
+  /// Typed reference to an edge field. \see source_as
+  template <typename T>
+  inline T& edge_as(size_t slot) { return edge[slot].mutable_get<T>(); }
+
+  /// Typed reference to a target vertex field. \see source_as
+  template <typename T>
+  inline T& target_as(size_t slot) { return target[slot].mutable_get<T>(); }
+};
+
+/**
+ * Type of the schema-compiled triple apply lambda function.
+ */
+typedef std::function<void(typed_edge_triple&)> lambda_typed_triple_apply_fn;
+
+/**
+ * Commutative reductions which can be declared on the mutated vertex fields
+ * of a schema-compiled triple apply. A field declared with a reduction is
+ * only ever combined into the vertex with that operator, so the triple apply
+ * does not need to lock the source and target vertices.
+ */
+enum class triple_reduction_enum: char {
+  SUM = 0,  /**< The contributions of all edges are added to the vertex value. */
+  MIN = 1,  /**< The vertex value becomes the minimum of all contributions. */
+  MAX = 2   /**< The vertex value becomes the maximum of all contributions. */
+};
+
+/**
+ * The edges visited by a frontier triple apply, relative to the active
+ * vertices.
+ */
+enum class frontier_edges_enum: char {
+  SOURCE = 0, /**< Edges whose source is active. */
+  TARGET = 1, /**< Edges whose target is active. */
+  ANY = 2     /**< Edges with at least one active endpoint. */
+};
+
+/**
+ * The set of active vertices of a frontier triple apply.
+ *
+ * The set is either given explicitly as a list of vertex ids, or built from
+ * the vertex data as the vertices for which a field differs from a
+ * reference field by more than epsilon, for instance "pagerank" and
+ * "pagerank_prev". Compared fields must be integer, float or vector values;
+ * vectors are compared by their largest elementwise difference.
+ */
+struct triple_apply_frontier {
+  /// Ids of the active vertices, when built with \ref vertices.
+  std::vector<flexible_type> active_vertices;
+  /// Field compared, when built with \ref changed.
+  std::string delta_field;
+  /// Field delta_field is compared against, when built with \ref changed.
+  std::string reference_field;
+  /// Smallest difference for which a vertex is active.
+  double epsilon = 0;
+  /// Edges visited.
+  frontier_edges_enum edges = frontier_edges_enum::ANY;
+
+  /// Returns the frontier made of the given vertices.
+  static triple_apply_frontier vertices(const std::vector<flexible_type>& ids,
+                                        frontier_edges_enum edges = frontier_edges_enum::ANY) {
+    triple_apply_frontier ret;
+    ret.active_vertices = ids;
+    ret.edges = edges;
+    return ret;
+  }
+
+  /**
+   * Returns the frontier made of the vertices for which
+   * |field - reference_field| > epsilon.
+   */
+  static triple_apply_frontier changed(const std::string& field,
+                                       const std::string& reference_field,
+                                       double epsilon,
+                                       frontier_edges_enum edges = frontier_edges_enum::ANY) {
+    triple_apply_frontier ret;
+    ret.delta_field = field;
+    ret.reference_field = reference_field;
+    ret.epsilon = epsilon;
+    ret.edges = edges;
+    return ret;
+  }
+
+  /// True if the frontier is built from the vertex data.
+  bool is_delta() const { return !delta_field.empty(); }
+};
+
+/**
+ * Argument type for the block mode sgraph triple apply.
+ *
+ * Describes a contiguous batch of edges in columnar form. Edge i of the
+ * batch goes from vertex source[i] to vertex target[i], where the vertices
+ * referenced by the batch are addressed by a dense index in
+ * [0, num_vertices); vertices[j] is the index in the graph of vertex j of
+ * the batch. All fields are numeric and presented as arrays of double:
+ *  - \ref vertex_field(slot) is indexed by batch vertex index and is a read
+ *    only snapshot of the vertex field taken before any edge is visited.
+ *  - \ref edge_field(slot) is indexed by the position of the edge in the
+ *    batch. Writes to mutated edge fields are kept.
+ *  - \ref vertex_accumulator(slot) is indexed by batch vertex index and is
+ *    private to the batch. Every batch starts from 0, and the accumulators
+ *    of all batches are summed into the mutated vertex field once all edges
+ *    have been visited.
+ *
+ * Missing values are presented as NaN.
+ *
+ * \code
+ * // vertex fields {"pagerank", "pagerank_prev"}, edge fields {"weight"}
+ * enum { PAGERANK = 0, PAGERANK_PREV = 1 };
+ * auto fn = [](edge_triple_batch& batch) {
+ *   const double* prev = batch.vertex_field(PAGERANK_PREV);
+ *   const double* weight = batch.edge_field(0);
+ *   double* pagerank = batch.vertex_accumulator(PAGERANK);
+ *   for (size_t i = 0; i < batch.num_edges; ++i) {
+ *     pagerank[batch.target[i]] += prev[batch.source[i]] * weight[i];
+ *   }
+ * };
+ * \endcode
+ */
+struct edge_triple_batch {
+  /// Number of edges in the batch.
+  size_t num_edges = 0;
+  /// Number of vertices referenced by the batch.
+  size_t num_vertices = 0;
+  /// Source vertex index of each edge in the batch.
+  const size_t* source = NULL;
+  /// Target vertex index of each edge in the batch.
+  const size_t* target = NULL;
+  /// Index in the graph of each vertex of the batch, in increasing order.
+  const size_t* vertices = NULL;
+
+  /// Values of a vertex field, indexed by batch vertex index.
+  inline const double* vertex_field(size_t slot) const { return vertex_fields[slot]; }
+
+  /// Values of an edge field, indexed by position in the batch.
+  inline double* edge_field(size_t slot) { return edge_fields[slot]; }
+
+  /**
+   * Batch local accumulator of a mutated vertex field, indexed by batch
+   * vertex index. NULL if the vertex field is not mutated.
+   */
+  inline double* vertex_accumulator(size_t slot) { return vertex_accumulators[slot]; }
+
+  std::vector<const double*> vertex_fields;
+  std::vector<double*> edge_fields;
+  std::vector<double*> vertex_accumulators;
+};
+
+/**
+ * Type of the block mode triple apply lambda function.
+ */
+typedef std::function<void(edge_triple_batch&)> lambda_batch_triple_apply_fn;
+
 }
 
 #endif
@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UTIL_BITOPS_HPP
+#define GRAPHLAB_UTIL_BITOPS_HPP
+
+#include <cstdint>
+#include <type_traits>
+#include <graphlab/util/code_optimization.hpp>
+
+/// The number of bits in a type.
+#define bitsizeof(T) (8 * sizeof(T))
+
+namespace graphlab {
+
+/**
+ * Returns the number of bits set in an unsigned integer.
+ */
+template <typename T>
+static inline unsigned int num_bits_on(T v) {
+  static_assert(std::is_unsigned<T>::value, "num_bits_on requires an unsigned type");
+  return (unsigned int)(__builtin_popcountll((unsigned long long)(v)));
+}
+
+/**
+ * Returns the number of trailing zero bits of a non-zero unsigned integer.
+ */
+template <typename T>
+static inline unsigned int n_trailing_zeros(T v) {
+  static_assert(std::is_unsigned<T>::value, "n_trailing_zeros requires an unsigned type");
+  return (unsigned int)(__builtin_ctzll((unsigned long long)(v)));
+}
+
+/**
+ * Returns the number of leading zero bits of a non-zero unsigned integer.
+ */
+template <typename T>
+static inline unsigned int n_leading_zeros(T v) {
+  static_assert(std::is_unsigned<T>::value, "n_leading_zeros requires an unsigned type");
+  return (unsigned int)(__builtin_clzll((unsigned long long)(v))
+                        - 8 * (sizeof(unsigned long long) - sizeof(T)));
+}
+
+/**
+ * Returns true if v is a power of 2.
+ */
+template <typename T>
+static inline bool is_power_of_2(T v) {
+  return v != 0 && (v & (v - 1)) == 0;
+}
+
+/**
+ * Returns floor(log2(v)) for v > 0.
+ */
+template <typename T>
+static inline unsigned int bitwise_log2_floor(T v) {
+  return 8 * sizeof(unsigned long long) - 1
+      - (unsigned int)(__builtin_clzll((unsigned long long)(v)));
+}
+
+/**
+ * Returns ceil(log2(v)) for v > 0.
+ */
+template <typename T>
+static inline unsigned int bitwise_log2_ceil(T v) {
+  return bitwise_log2_floor(v) + (is_power_of_2(v) ? 0 : 1);
+}
+
+/**
+ * Returns v mod 2^bits.
+ */
+template <typename T>
+static inline T bitwise_pow2_mod(T v, unsigned int bits) {
+  return bits >= 8 * sizeof(T) ? v : (v & ((T(1) << bits) - 1));
+}
+
+}
+
+#endif
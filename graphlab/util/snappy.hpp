@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#ifndef GRAPHLAB_UTIL_SNAPPY_HPP
+#define GRAPHLAB_UTIL_SNAPPY_HPP
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+namespace graphlab {
+
+/**
+ * Decompresses a raw snappy block (without the framing format) into out.
+ * Returns false if the block is malformed.
+ */
+inline bool snappy_decompress(const uint8_t* p, const uint8_t* end, std::string& out) {
+  uint64_t length = 0;
+  for (int shift = 0; ; shift += 7) {
+    if (p >= end || shift > 35) return false;
+    uint8_t byte = *p++;
+    length |= uint64_t(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) break;
+  }
+  out.resize(length);
+  char* dst = &out[0];
+  size_t position = 0;
+  while (p < end) {
+    uint8_t tag = *p++;
+    size_t len = 0, offset = 0;
+    if ((tag & 3) == 0) {
+      len = tag >> 2;
+      if (len >= 60) {
+        size_t nbytes = len - 59;
+        if (size_t(end - p) < nbytes) return false;
+        len = 0;
+        for (size_t i = 0; i < nbytes; ++i) len |= size_t(p[i]) << (8 * i);
+        p += nbytes;
+      }
+      len += 1;
+      if (size_t(end - p) < len || position + len > length) return false;
+      std::memcpy(dst + position, p, len);
+      p += len;
+      position += len;
+      continue;
+    } else if ((tag & 3) == 1) {
+      if (p >= end) return false;
+      len = ((tag >> 2) & 7) + 4;
+      offset = (size_t(tag >> 5) << 8) | *p++;
+    } else if ((tag & 3) == 2) {
+      if (end - p < 2) return false;
+      len = (tag >> 2) + 1;
+      offset = size_t(p[0]) | (size_t(p[1]) << 8);
+      p += 2;
+    } else {
+      if (end - p < 4) return false;
+      len = (tag >> 2) + 1;
+      offset = size_t(p[0]) | (size_t(p[1]) << 8) | (size_t(p[2]) << 16) | (size_t(p[3]) << 24);
+      p += 4;
+    }
+    if (offset == 0 || offset > position || position + len > length) return false;
+    if (offset >= len) {
+      std::memcpy(dst + position, dst + position - offset, len);
+    } else {
+      for (size_t i = 0; i < len; ++i) dst[position + i] = dst[position + i - offset];
+    }
+    position += len;
+  }
+  return position == length;
+}
+
+} // namespace graphlab
+#endif
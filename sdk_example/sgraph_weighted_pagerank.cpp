@@ -98,10 +98,13 @@ gl_sgraph weighted_pagerank(const gl_sgraph& g, size_t iters, const std::string&
   // We can update the vertex data by adding the same vertex.
   gl_sgraph g2 = g_min.add_vertices(outgoing_weight, "__src_id");
 
-  // Lambda function for triple_apply
-  auto pr_update = [&weight_field](edge_triple& triple)->void {
-    double weight = triple.edge[weight_field];
-    triple.target["pagerank"] += triple.source["pagerank_prev"] * weight / triple.source["total_weight"];
+  // Lambda function for triple_apply. Fields are addressed by slot in the
+  // order they are requested in the triple_apply call below.
+  enum { PAGERANK = 0, PAGERANK_PREV = 1, TOTAL_WEIGHT = 2 };
+  enum { WEIGHT = 0 };
+  auto pr_update = [](typed_edge_triple& triple)->void {
+    double weight = triple.edge[WEIGHT];
+    triple.target[PAGERANK] += triple.source[PAGERANK_PREV] * weight / triple.source[TOTAL_WEIGHT];
   };
 
   // Initialize pagerank value
@@ -113,7 +116,9 @@ gl_sgraph weighted_pagerank(const gl_sgraph& g, size_t iters, const std::string&
     g2.vertices()["pagerank"] = 0.0;
 
     logprogress_stream << "Iteration " << (i+1) << std::endl;
-    g2 = g2.triple_apply(pr_update, {"pagerank"});
+    g2 = g2.triple_apply(pr_update, {"pagerank"},
+                         {"pagerank", "pagerank_prev", "total_weight"},
+                         {weight_field});
 
     g2.vertices()["pagerank"] = RESET_PROB + (1-RESET_PROB) * g2.vertices()["pagerank"];
     g2.vertices()["pagerank_prev"] = g2.vertices()["pagerank"];
@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sframe/avro_reader.hpp>
+
+using namespace graphlab;
+
+// the files are written by test/data/make_avro_fixtures.py
+static const std::string DATA = "test/data/";
+static const flex_int N = 1000;
+
+enum { I, F, TS, D, DEC, MIXED, VEC };
+
+/**
+ * Checks a row of the columns of the fixtures against the values the
+ * generator wrote, with the mixed union converted to its string column.
+ */
+static void check_row(const avro_file& file, const std::vector<flexible_type>& row, flex_int i) {
+  const std::vector<size_t>& fields = file.root().children;
+  ASSERT_EQ(row[I].get<flex_int>(), i * 1000003 - 500000000);
+  if (i % 5 == 0) {
+    ASSERT_TRUE(row[F].get_type() == flex_type_enum::UNDEFINED);
+  } else {
+    ASSERT_EQ(row[F].get<flex_float>(), i * 0.25);
+  }
+  int64_t millis = 1400000000000 + i * 1001;
+  const flex_date_time& ts = row[TS].get<flex_date_time>();
+  ASSERT_EQ(ts.posix_timestamp(), millis / 1000);
+  ASSERT_EQ(ts.microsecond(), (millis % 1000) * 1000);
+  ASSERT_EQ(ts.time_zone_offset(), 0);
+  ASSERT_EQ(row[D].get<flex_date_time>().posix_timestamp(), (17000 + i) * 86400);
+  ASSERT_LT(std::abs(row[DEC].get<flex_float>() - (i * 101 - 50000) / 100.0), 1e-9);
+
+  ASSERT_TRUE(file.column_type(fields[MIXED]) == flex_type_enum::STRING);
+  flexible_type mixed = avro_file::column_value(file.schema(), fields[MIXED], row[MIXED]);
+  if (i % 3 == 0) {
+    ASSERT_TRUE(mixed.get_type() == flex_type_enum::UNDEFINED);
+  } else {
+    ASSERT_EQ(mixed.get<flex_string>(), i % 3 == 1 ? std::to_string(i) : "k" + std::to_string(i));
+  }
+  flex_vec vec{double(i), i * 0.5};
+  vec.resize(i % 3);
+  ASSERT_TRUE(row[VEC].get<flex_vec>() == vec);
+}
+
+/**
+ * Decodes a file in byte ranges, as construct_from_avro does, and checks
+ * each record is read once.
+ */
+static void check_file(const std::string& name, size_t nranges) {
+  avro_file file(DATA + name);
+  ASSERT_TRUE(file.codec_supported());
+  std::vector<std::string> names{"i", "f", "ts", "d", "dec", "mixed", "vec"};
+  ASSERT_TRUE(file.root().names == names);
+  std::vector<flex_int> seen(N, 0);
+  for (size_t r = 0; r < nranges; ++r) {
+    auto blocks = file.block_range(file.size() * r / nranges, file.size() * (r + 1) / nranges);
+    file.for_each_record(blocks.first, blocks.second, [&](const std::vector<flexible_type>& row) {
+      flex_int i = (row[I].get<flex_int>() + 500000000) / 1000003;
+      ASSERT_TRUE(i >= 0 && i < N);
+      ++seen[i];
+      check_row(file, row, i);
+    });
+  }
+  for (flex_int count: seen) ASSERT_EQ(count, 1);
+}
+
+void test_null_codec() { check_file("avro_null.avro", 7); }
+
+void test_snappy_codec() { check_file("avro_snappy.avro", 5); }
+
+/**
+ * The deflate codec is read by from_avro, whose values have the plain avro
+ * types; convert() gives them the values decoded from the other codecs.
+ */
+void test_convert() {
+  avro_file file(DATA + "avro_deflate.avro");
+  ASSERT_FALSE(file.codec_supported());
+  const std::vector<size_t>& fields = file.root().children;
+  for (flex_int i = 0; i < N; i += 7) {
+    std::vector<flexible_type> raw(fields.size(), FLEX_UNDEFINED);
+    raw[I] = i * 1000003 - 500000000;
+    if (i % 5 != 0) raw[F] = i * 0.25;
+    raw[TS] = 1400000000000 + i * 1001;
+    raw[D] = 17000 + i;
+    // the big endian two's complement unscaled decimal
+    int32_t unscaled = int32_t(i * 101 - 50000);
+    std::string bytes;
+    for (int shift = 24; shift >= 0; shift -= 8) bytes.push_back(char((unscaled >> shift) & 0xff));
+    raw[DEC] = bytes;
+    if (i % 3 == 1) raw[MIXED] = i;
+    else if (i % 3 == 2) raw[MIXED] = "k" + std::to_string(i);
+    flex_list list{flex_float(i), i * 0.5};
+    list.resize(i % 3);
+    raw[VEC] = list;
+
+    std::vector<flexible_type> row(fields.size());
+    for (size_t f = 0; f < fields.size(); ++f) {
+      row[f] = avro_file::convert(file.schema(), fields[f], raw[f]);
+    }
+    check_row(file, row, i);
+  }
+}
+
+int main() {
+  test_null_codec();
+  test_snappy_codec();
+  test_convert();
+  return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cstdint>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/util/bitops.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+
+using namespace graphlab;
+
+/**
+ * The bit operations, against loops over the bits, for the widths the
+ * leading zero count depends on.
+ */
+void test_bitops() {
+  for (uint64_t v = 1; v < (uint64_t(1) << 40); v = v * 3 + 1) {
+    unsigned int ones = 0, trailing = 0, floor_log2 = 0;
+    for (uint64_t x = v; x != 0; x >>= 1) ones += x & 1;
+    while (((v >> trailing) & 1) == 0) ++trailing;
+    while ((v >> floor_log2) > 1) ++floor_log2;
+    ASSERT_EQ(num_bits_on(v), ones);
+    ASSERT_EQ(n_trailing_zeros(v), trailing);
+    ASSERT_EQ(n_leading_zeros(v), 63 - floor_log2);
+    ASSERT_EQ(bitwise_log2_floor(v), floor_log2);
+    ASSERT_EQ(bitwise_log2_ceil(v), floor_log2 + ((uint64_t(1) << floor_log2) == v ? 0 : 1));
+    ASSERT_EQ(is_power_of_2(v), ones == 1);
+    ASSERT_EQ(bitwise_pow2_mod(v, 5), v % 32);
+  }
+  ASSERT_EQ(n_leading_zeros(uint32_t(1)), 31);
+  ASSERT_EQ(n_leading_zeros(uint16_t(0x80)), 8);
+  ASSERT_EQ(n_leading_zeros(uint8_t(0xff)), 0);
+  ASSERT_EQ(bitwise_pow2_mod(uint32_t(0xdeadbeef), 32), 0xdeadbeef);
+  ASSERT_FALSE(is_power_of_2(0));
+  ASSERT_EQ(bitsizeof(uint16_t), 16);
+}
+
+/**
+ * The frontier of the gather-apply-scatter engine is a dense_bitset, which
+ * counts and iterates its bits with these operations.
+ */
+void test_dense_bitset() {
+  dense_bitset bits(1000);
+  bits.clear();
+  for (size_t i = 3; i < 1000; i += 7) bits.set_bit(i);
+  ASSERT_EQ(bits.popcount(), (1000 - 3 + 6) / 7);
+  size_t count = 0, expected = 3;
+  for (size_t i: bits) {
+    ASSERT_EQ(i, expected);
+    expected += 7;
+    ++count;
+  }
+  ASSERT_EQ(count, bits.popcount());
+}
+
+int main() {
+  test_bitops();
+  test_dense_bitset();
+  return 0;
+}
@@ -0,0 +1,310 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sframe/columnar_file.hpp>
+#include <graphlab/sdk/gl_sframe_columnar.hpp>
+
+using namespace graphlab;
+
+static const std::string FILENAME = "columnar_file_test.arrow";
+
+static const std::vector<std::string> NAMES{"i", "f", "dt", "utc", "s", "label", "v"};
+static const std::vector<flex_type_enum> TYPES{
+  flex_type_enum::INTEGER, flex_type_enum::FLOAT, flex_type_enum::DATETIME,
+  flex_type_enum::DATETIME, flex_type_enum::STRING, flex_type_enum::STRING,
+  flex_type_enum::VECTOR};
+
+/**
+ * Row i of the test table, column by column. Datetimes are before and
+ * after the epoch; "label" has few distinct values and is dictionary
+ * encoded. Every column but "utc" has missing values.
+ */
+static std::vector<flexible_type> make_row(flex_int i) {
+  std::vector<flexible_type> row(NAMES.size(), FLEX_UNDEFINED);
+  bool missing = i % 7 == 3;
+  if (!missing) {
+    row[0] = i * 1000003 - 5000000;
+    row[1] = i * 0.125 - 3;
+    row[2] = flex_date_time(i * 86399 - 100000, int32_t(i % 9) - 4, int32_t((i * 37) % 1000000));
+    row[4] = "value " + std::to_string(i * i);
+    row[5] = i % 3 == 0 ? "red" : (i % 3 == 1 ? "green" : "");
+    flex_vec v;
+    for (flex_int k = 0; k < i % 4; ++k) v.push_back(i + k * 0.5);
+    row[6] = v;
+  }
+  row[3] = flex_date_time(i * 1001 - 50000, flex_date_time::EMPTY_TIMEZONE, 0);
+  return row;
+}
+
+static void check_value(const flexible_type& actual, const flexible_type& expected) {
+  ASSERT_TRUE(actual.get_type() == expected.get_type());
+  if (expected.get_type() == flex_type_enum::DATETIME) {
+    const auto& a = actual.get<flex_date_time>();
+    const auto& e = expected.get<flex_date_time>();
+    ASSERT_EQ(a.posix_timestamp(), e.posix_timestamp());
+    ASSERT_EQ(a.microsecond(), e.microsecond());
+    ASSERT_EQ(a.time_zone_offset(), e.time_zone_offset());
+  } else if (expected.get_type() == flex_type_enum::VECTOR) {
+    ASSERT_TRUE(actual.get<flex_vec>() == expected.get<flex_vec>());
+  } else if (expected.get_type() != flex_type_enum::UNDEFINED) {
+    ASSERT_TRUE(actual == expected);
+  }
+}
+
+/**
+ * Batches written by columnar_file_writer are read back in place, with
+ * 64 byte aligned buffers.
+ */
+void test_roundtrip() {
+  std::vector<size_t> batch_sizes{1000, 1, 0, 333};
+  {
+    columnar_file_writer writer(FILENAME, NAMES, TYPES);
+    flex_int row = 0;
+    for (size_t batch_size: batch_sizes) {
+      std::vector<std::vector<flexible_type> > columns(NAMES.size());
+      for (size_t r = 0; r < batch_size; ++r, ++row) {
+        auto values = make_row(row);
+        for (size_t c = 0; c < NAMES.size(); ++c) columns[c].push_back(values[c]);
+      }
+      std::vector<columnar_encoded_chunk> chunks;
+      for (size_t c = 0; c < NAMES.size(); ++c) {
+        chunks.push_back(encode_columnar_chunk(columns[c], TYPES[c]));
+      }
+      writer.write_batch(batch_size, chunks);
+    }
+    writer.close();
+  }
+
+  columnar_file_reader reader(FILENAME);
+  ASSERT_TRUE(reader.column_names() == NAMES);
+  ASSERT_TRUE(reader.column_types() == TYPES);
+  ASSERT_EQ(reader.num_rows(), 1334);
+  ASSERT_EQ(reader.num_batches(), batch_sizes.size());
+  flex_int row = 0;
+  for (size_t b = 0; b < reader.num_batches(); ++b) {
+    ASSERT_EQ(reader.batch_num_rows(b), batch_sizes[b]);
+    for (size_t r = 0; r < reader.batch_num_rows(b); ++r, ++row) {
+      auto expected = make_row(row);
+      for (size_t c = 0; c < NAMES.size(); ++c) {
+        check_value(reader.column(b, c).value(r), expected[c]);
+      }
+    }
+    for (size_t c = 0; c < NAMES.size(); ++c) {
+      auto view = reader.column(b, c);
+      for (size_t i = 0; i < 4; ++i) {
+        // the mapping is page aligned
+        if (view.buffers[i]) ASSERT_EQ(reinterpret_cast<uintptr_t>(view.buffers[i]) % 64, 0);
+      }
+    }
+  }
+  auto first = reader.column(0, 0);
+  ASSERT_EQ(first.null_count, 143);
+  ASSERT_EQ(first.data<int64_t>(1)[11], 11 * 1000003 - 5000000);
+  ASSERT_TRUE(reader.column(0, 5).encoding == columnar_encoding::DICTIONARY);
+  ASSERT_TRUE(reader.column(0, 4).encoding == columnar_encoding::PLAIN);
+  ASSERT_TRUE(reader.column(0, 3).validity == nullptr);
+  ASSERT_EQ(reader.column(0, 3).lengths[2], 0);
+  std::remove(FILENAME.c_str());
+}
+
+/**
+ * Files which are not columnar files, or are cut, are rejected.
+ */
+void test_invalid_files() {
+  {
+    std::ofstream fout(FILENAME, std::ios::binary);
+    static const char bytes[] = "ARROW1\0\0 this is not an Arrow file ARROW1";
+    fout.write(bytes, sizeof(bytes) - 1);
+  }
+  bool thrown = false;
+  try {
+    columnar_file_reader reader(FILENAME);
+  } catch (...) {
+    thrown = true;
+  }
+  ASSERT_TRUE(thrown);
+
+  thrown = false;
+  try {
+    columnar_file_writer writer(FILENAME, {"l"}, {flex_type_enum::LIST});
+  } catch (...) {
+    thrown = true;
+  }
+  ASSERT_TRUE(thrown);
+  std::remove(FILENAME.c_str());
+}
+
+/**
+ * A string column is dictionary encoded in every batch if its first batch
+ * is, with each batch indexing its own dictionary batch, and plain in every
+ * batch otherwise.
+ */
+void test_string_encodings() {
+  std::vector<flexible_type> batches[2] = {{"a", FLEX_UNDEFINED, "b", "a"}, {"c", "c", "a", FLEX_UNDEFINED}};
+  for (bool first_dictionary: {true, false}) {
+    {
+      columnar_file_writer writer(FILENAME, {"c"}, {flex_type_enum::STRING});
+      for (size_t b = 0; b < 2; ++b) {
+        bool dictionary = (b == 0) == first_dictionary;
+        writer.write_batch(4, {encode_columnar_chunk(batches[b], flex_type_enum::STRING,
+                                                     dictionary ? 1.0 : 0.0)});
+      }
+      writer.close();
+    }
+    columnar_file_reader reader(FILENAME);
+    for (size_t b = 0; b < 2; ++b) {
+      auto view = reader.column(b, 0);
+      ASSERT_TRUE(view.encoding == (first_dictionary ? columnar_encoding::DICTIONARY
+                                                     : columnar_encoding::PLAIN));
+      for (size_t r = 0; r < 4; ++r) check_value(view.value(r), batches[b][r]);
+    }
+    ASSERT_EQ(reader.column(1, 0).dictionary_base, first_dictionary ? 2 : 0);
+  }
+  std::remove(FILENAME.c_str());
+}
+
+/**
+ * Writes one column of one batch, encoded from "values" and then altered
+ * by "corrupt", and returns true if reading the column throws.
+ */
+template <typename Corrupt>
+static bool column_rejected(const std::vector<flexible_type>& values, flex_type_enum type,
+                            double max_dictionary_ratio, const Corrupt& corrupt) {
+  auto chunk = encode_columnar_chunk(values, type, max_dictionary_ratio);
+  corrupt(chunk);
+  {
+    columnar_file_writer writer(FILENAME, {"c"}, {type});
+    writer.write_batch(values.size(), {chunk});
+    writer.close();
+  }
+  bool thrown = false;
+  try {
+    columnar_file_reader reader(FILENAME);
+    reader.column(0, 0);
+  } catch (...) {
+    thrown = true;
+  }
+  std::remove(FILENAME.c_str());
+  return thrown;
+}
+
+/**
+ * Columns whose offsets, dictionary indices or buffer lengths would lead
+ * outside their buffers are rejected.
+ */
+void test_corrupt_columns() {
+  std::vector<flexible_type> strings{"a", "bc", FLEX_UNDEFINED, "def"};
+  std::vector<flexible_type> labels{"x", "y", "x", "x", "y", "x"};
+  std::vector<flexible_type> vectors{flex_vec{1, 2}, flex_vec{}, flex_vec{3}};
+  auto set_int64 = [](std::string& buffer, size_t index, int64_t value) {
+    std::memcpy(&buffer[index * sizeof(int64_t)], &value, sizeof(value));
+  };
+  auto unchanged = [](columnar_encoded_chunk&) { };
+  ASSERT_FALSE(column_rejected(strings, flex_type_enum::STRING, 0, unchanged));
+  ASSERT_FALSE(column_rejected(labels, flex_type_enum::STRING, 0.5, unchanged));
+  ASSERT_FALSE(column_rejected(vectors, flex_type_enum::VECTOR, 0, unchanged));
+
+  // decreasing offsets
+  ASSERT_TRUE(column_rejected(strings, flex_type_enum::STRING, 0,
+                              [&](columnar_encoded_chunk& c) { set_int64(c.buffers[1], 2, 0); }));
+  // offsets past the data
+  ASSERT_TRUE(column_rejected(strings, flex_type_enum::STRING, 0,
+                              [&](columnar_encoded_chunk& c) { set_int64(c.buffers[1], 4, 100); }));
+  ASSERT_TRUE(column_rejected(vectors, flex_type_enum::VECTOR, 0,
+                              [&](columnar_encoded_chunk& c) { set_int64(c.buffers[1], 3, 4); }));
+  // a dictionary index past the dictionary
+  ASSERT_TRUE(column_rejected(labels, flex_type_enum::STRING, 0.5,
+                              [&](columnar_encoded_chunk& c) {
+                                ASSERT_TRUE(c.encoding == columnar_encoding::DICTIONARY);
+                                set_int64(c.buffers[1], 4, 2);
+                              }));
+  // a negative dictionary offset
+  ASSERT_TRUE(column_rejected(labels, flex_type_enum::STRING, 0.5,
+                              [&](columnar_encoded_chunk& c) { set_int64(c.buffers[2], 1, -1); }));
+  // an offsets buffer shorter than the rows
+  ASSERT_TRUE(column_rejected(strings, flex_type_enum::STRING, 0,
+                              [&](columnar_encoded_chunk& c) { c.buffers[1].resize(16); }));
+  ASSERT_TRUE(column_rejected({flex_int(1), flex_int(2)}, flex_type_enum::INTEGER, 0,
+                              [&](columnar_encoded_chunk& c) { c.buffers[1].resize(8); }));
+}
+
+/**
+ * An Arrow file written by pyarrow (test/data/make_arrow_fixtures.py),
+ * with 8 byte aligned buffers and one dictionary for both batches.
+ */
+void test_pyarrow_file() {
+  columnar_file_reader reader("test/data/arrow_pyarrow.arrow");
+  ASSERT_TRUE(reader.column_names() == std::vector<std::string>({"i", "f", "ts", "s", "label", "v"}));
+  ASSERT_TRUE(reader.column_types() == std::vector<flex_type_enum>({
+      flex_type_enum::INTEGER, flex_type_enum::FLOAT, flex_type_enum::DATETIME,
+      flex_type_enum::STRING, flex_type_enum::STRING, flex_type_enum::VECTOR}));
+  ASSERT_EQ(reader.num_rows(), 300);
+  ASSERT_EQ(reader.num_batches(), 2);
+  flex_int i = 0;
+  for (size_t b = 0; b < reader.num_batches(); ++b) {
+    ASSERT_TRUE(reader.column(b, 4).encoding == columnar_encoding::DICTIONARY);
+    for (size_t r = 0; r < reader.batch_num_rows(b); ++r, ++i) {
+      flex_vec v;
+      for (flex_int k = 0; k < i % 3; ++k) v.push_back(i + k * 0.5);
+      std::vector<flexible_type> expected{
+        i % 7 == 3 ? FLEX_UNDEFINED : flexible_type(i * 1000003 - 500000000),
+        i * 0.25,
+        flex_date_time(1500000000 + (i * 1234567) / 1000000, flex_date_time::EMPTY_TIMEZONE,
+                       int32_t((i * 1234567) % 1000000)),
+        i % 11 == 0 ? FLEX_UNDEFINED : flexible_type("k" + std::to_string(i)),
+        std::string(1, char('a' + i % 3)),
+        v};
+      for (size_t c = 0; c < expected.size(); ++c) {
+        check_value(reader.column(b, c).value(r), expected[c]);
+      }
+    }
+  }
+}
+
+/**
+ * An SFrame saved as a columnar file in several batches loads back equal.
+ */
+void test_gl_sframe_roundtrip() {
+  std::vector<std::vector<flexible_type> > columns(NAMES.size());
+  for (flex_int i = 0; i < 5000; ++i) {
+    auto values = make_row(i);
+    for (size_t c = 0; c < NAMES.size(); ++c) columns[c].push_back(values[c]);
+  }
+  std::map<std::string, gl_sarray> data;
+  for (size_t c = 0; c < NAMES.size(); ++c) data[NAMES[c]] = gl_sarray(columns[c], TYPES[c]);
+  gl_sframe sf(data);
+  sf = sf.select_columns(NAMES);
+  sf.save_columnar(FILENAME, 1024);
+  gl_sframe loaded;
+  loaded.construct_from_columnar(FILENAME);
+  ASSERT_TRUE(loaded.column_names() == NAMES);
+  ASSERT_EQ(loaded.size(), 5000);
+  flex_int i = 0;
+  for (const auto& row: loaded.range_iterator()) {
+    for (size_t c = 0; c < NAMES.size(); ++c) check_value(row[c], columns[c][i]);
+    ++i;
+  }
+  std::remove(FILENAME.c_str());
+}
+
+int main() {
+  test_roundtrip();
+  test_invalid_files();
+  test_string_encodings();
+  test_corrupt_columns();
+  test_pyarrow_file();
+  test_gl_sframe_roundtrip();
+  return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe_csv.hpp>
+
+using namespace graphlab;
+
+typedef std::vector<std::vector<std::string> > records;
+
+static std::string write_file(const std::string& contents) {
+  std::string filename = "csv_parallel_test.csv";
+  std::ofstream fout(filename, std::ios::binary);
+  fout << contents;
+  return filename;
+}
+
+/**
+ * Reads the records of each range as construct_from_csvs_parallel does,
+ * with the ranges starting at the given offsets.
+ */
+static std::vector<gl_sframe_impl::csv_range_status>
+read_ranges(const std::string& contents, std::vector<size_t> range_begin, records& out) {
+  std::string filename = write_file(contents);
+  range_begin.push_back(contents.size());
+  csv_tokenizer tokenizer((csv_dialect()));
+  std::vector<size_t> record_begin =
+      gl_sframe_impl::csv_record_begins(filename, range_begin, tokenizer);
+  std::vector<gl_sframe_impl::csv_range_status> status;
+  for (size_t r = 0; r + 1 < range_begin.size(); ++r) {
+    status.push_back(gl_sframe_impl::for_each_csv_record(
+        filename, record_begin[r], record_begin[r + 1], contents.size(), tokenizer,
+        [&](const std::vector<std::string>& fields, size_t nfields, const char*, const char*) {
+          out.emplace_back(fields.begin(), fields.begin() + nfields);
+          return true;
+        }));
+  }
+  std::remove(filename.c_str());
+  return status;
+}
+
+static size_t offset_of(const std::string& contents, const std::string& text) {
+  size_t offset = contents.find(text);
+  ASSERT_TRUE(offset != std::string::npos);
+  return offset;
+}
+
+/**
+ * A quoted field with a line break which crosses the boundary between two
+ * ranges is read whole.
+ */
+void test_quoted_newline_across_ranges() {
+  std::string contents = "1,a\n2,\"multi\nline, \"\"quoted\"\"\nfield\"\n3,b\n4,c\n";
+  records out;
+  auto status = read_ranges(contents, {0, offset_of(contents, "line,"), offset_of(contents, "4,")},
+                            out);
+  for (auto s: status) ASSERT_TRUE(s == gl_sframe_impl::csv_range_status::COMPLETE);
+  records expected{{"1", "a"}, {"2", "multi\nline, \"quoted\"\nfield"}, {"3", "b"}, {"4", "c"}};
+  ASSERT_TRUE(out == expected);
+}
+
+/**
+ * A quote inside an unquoted field flips the quote parity of every range
+ * after it, so a later range starts inside a quoted field. The range before
+ * it then ends inside a record, which sends the file to the sequential
+ * parser.
+ */
+void test_stray_quote() {
+  std::string contents = "1,27\" monitor\n2,a\n3,\"two\nlines\"\n4,b\n";
+  records out;
+  auto status = read_ranges(contents, {0, offset_of(contents, "2,a")}, out);
+  ASSERT_TRUE(status[0] == gl_sframe_impl::csv_range_status::MISALIGNED);
+
+  // without a later quoted line break, the first range takes the whole file
+  contents = "1,27\" monitor\n2,a\n3,b\n";
+  out.clear();
+  status = read_ranges(contents, {0, offset_of(contents, "2,a")}, out);
+  for (auto s: status) ASSERT_TRUE(s == gl_sframe_impl::csv_range_status::COMPLETE);
+  records expected{{"1", "27\" monitor"}, {"2", "a"}, {"3", "b"}};
+  ASSERT_TRUE(out == expected);
+}
+
+/**
+ * A file ending inside a quoted field, and fn stopping at a record.
+ */
+void test_unterminated_and_stop() {
+  std::string contents = "1,a\n2,\"b\n";
+  std::string filename = write_file(contents);
+  csv_tokenizer tokenizer((csv_dialect()));
+  auto keep = [](const std::vector<std::string>&, size_t, const char*, const char*) {
+    return true;
+  };
+  ASSERT_TRUE(gl_sframe_impl::for_each_csv_record(filename, 0, contents.size(), contents.size(),
+                                                  tokenizer, keep) ==
+              gl_sframe_impl::csv_range_status::UNTERMINATED);
+
+  std::string line;
+  auto stop = [&](const std::vector<std::string>&, size_t, const char* begin, const char* end) {
+    line.assign(begin, end);
+    return false;
+  };
+  ASSERT_TRUE(gl_sframe_impl::for_each_csv_record(filename, 0, contents.size(), contents.size(),
+                                                  tokenizer, stop) ==
+              gl_sframe_impl::csv_range_status::STOPPED);
+  ASSERT_EQ(line, "1,a\n");
+  std::remove(filename.c_str());
+}
+
+int main() {
+  test_quoted_newline_across_ranges();
+  test_stray_quote();
+  test_unterminated_and_stop();
+  return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sarray.hpp>
+
+using namespace graphlab;
+
+static const std::vector<std::string> NAMES{
+  "__builtin__sum__", "__builtin__avg__", "__builtin__var__", "__builtin__stdv__",
+  "__builtin__min__", "__builtin__max__", "__builtin__count__"};
+
+static std::vector<flexible_type> make_values(size_t n) {
+  std::vector<flexible_type> values;
+  for (size_t i = 0; i < n; ++i) {
+    if (i % 6 == 1) values.push_back(FLEX_UNDEFINED);
+    else values.push_back(flex_float((i * 7919) % 1013) * 0.5 - 200);
+  }
+  return values;
+}
+
+/// The running aggregates of the values, adding each to one aggregate.
+static std::vector<flexible_type> sequential(const group_aggregate_value& prototype,
+                                             const std::vector<flexible_type>& values) {
+  std::unique_ptr<group_aggregate_value> value(prototype.new_instance());
+  std::vector<flexible_type> out;
+  bool seen = false;
+  for (const auto& element: values) {
+    if (element.get_type() != flex_type_enum::UNDEFINED) {
+      value->add_element_simple(element);
+      seen = true;
+    }
+    out.push_back(seen ? value->emit() : FLEX_UNDEFINED);
+  }
+  return out;
+}
+
+/**
+ * The two passes of parallel_cumulative_aggregate over nsegments segments:
+ * partial aggregates, their exclusive prefixes, then each segment scanned
+ * from its prefix by gl_sarray_impl::scan_segment.
+ */
+static std::vector<flexible_type> segmented(const group_aggregate_value& prototype,
+                                            const std::vector<flexible_type>& values,
+                                            size_t nsegments) {
+  size_t n = values.size();
+  std::unique_ptr<group_aggregate_value> prefix(prototype.new_instance());
+  prefix->partial_finalize();
+  bool seen = false;
+  std::vector<flexible_type> out;
+  for (size_t s = 0; s < nsegments; ++s) {
+    std::vector<flexible_type> segment(values.begin() + n * s / nsegments,
+                                       values.begin() + n * (s + 1) / nsegments);
+    std::unique_ptr<group_aggregate_value> partial(prototype.new_instance());
+    bool partial_seen = false;
+    for (const auto& value: segment) {
+      if (value.get_type() == flex_type_enum::UNDEFINED) continue;
+      partial->add_element_simple(value);
+      partial_seen = true;
+    }
+    partial->partial_finalize();
+
+    std::unique_ptr<group_aggregate_value> value(prototype.new_instance());
+    value->partial_finalize();
+    value->combine(*prefix);
+    gl_sarray_impl::scan_segment(*value, seen, segment,
+                                 [&](const flexible_type& v) { out.push_back(v); });
+    prefix->combine(*partial);
+    seen = seen || partial_seen;
+  }
+  return out;
+}
+
+/**
+ * A user defined aggregator which does not accept adds after a combine.
+ * Emits the sum of the values with the number of values added, and checks
+ * it is used as add_element, partial_finalize, then combine.
+ */
+class tagged_sum: public group_aggregate_value {
+ public:
+  group_aggregate_value* new_instance() const { return new tagged_sum; }
+  void add_element_simple(const flexible_type& flex) {
+    ASSERT_FALSE(m_finalized);
+    m_sum += flex.to<flex_float>();
+    ++m_count;
+  }
+  void partial_finalize() { m_finalized = true; }
+  void combine(const group_aggregate_value& other) {
+    const auto& o = dynamic_cast<const tagged_sum&>(other);
+    ASSERT_TRUE(m_finalized && o.m_finalized);
+    m_sum += o.m_sum;
+    m_count += o.m_count;
+  }
+  flexible_type emit() const { return flex_vec{m_sum, double(m_count)}; }
+  bool support_type(flex_type_enum type) const { return type == flex_type_enum::FLOAT; }
+  flex_type_enum set_input_type(flex_type_enum) { return flex_type_enum::VECTOR; }
+  std::string name() const { return "tagged_sum"; }
+  void save(oarchive& oarc) const { oarc << m_sum << m_count << m_finalized; }
+  void load(iarchive& iarc) { iarc >> m_sum >> m_count >> m_finalized; }
+ private:
+  double m_sum = 0;
+  size_t m_count = 0;
+  bool m_finalized = false;
+};
+
+static void check_equal(const std::vector<flexible_type>& actual,
+                        const std::vector<flexible_type>& expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    ASSERT_TRUE(actual[i].get_type() == expected[i].get_type());
+    if (expected[i].get_type() == flex_type_enum::FLOAT) {
+      double x = actual[i].get<flex_float>(), y = expected[i].get<flex_float>();
+      ASSERT_LE(std::fabs(x - y), 1e-6 * std::max(1.0, std::fabs(y)));
+    } else if (expected[i].get_type() != flex_type_enum::UNDEFINED) {
+      ASSERT_TRUE(actual[i] == expected[i]);
+    }
+  }
+}
+
+/**
+ * Scanning segments from their prefixes gives the running aggregates, for
+ * every builtin rolling aggregator (the count and order dependent min and
+ * max in particular), and for an aggregator scanned through copies.
+ */
+void test_segmented_scan() {
+  auto values = make_values(1000);
+  // a leading run of missing values
+  for (size_t i = 0; i < 20; ++i) values[i] = FLEX_UNDEFINED;
+  for (const auto& name: NAMES) {
+    auto aggregator = rolling_operators::get_builtin_rolling_aggregator(name);
+    aggregator->set_input_types({flex_type_enum::FLOAT});
+    ASSERT_TRUE(accepts_add_after_combine(*aggregator));
+    auto expected = sequential(*aggregator, values);
+    for (size_t nsegments: {1, 3, 16, 1000}) {
+      check_equal(segmented(*aggregator, values, nsegments), expected);
+    }
+  }
+
+  // combined copies of the prefix and of a local aggregate otherwise
+  tagged_sum aggregator;
+  ASSERT_FALSE(accepts_add_after_combine(aggregator));
+  auto expected = sequential(aggregator, values);
+  for (size_t nsegments: {1, 3, 16, 1000}) {
+    check_equal(segmented(aggregator, values, nsegments), expected);
+  }
+}
+
+/**
+ * parallel_cumulative_aggregate gives the running aggregates, and rejects
+ * unknown aggregators.
+ */
+void test_parallel_cumulative_aggregate() {
+  auto values = make_values(100000);
+  gl_sarray sa(values, flex_type_enum::FLOAT);
+  for (const auto& name: NAMES) {
+    auto aggregator = rolling_operators::get_builtin_rolling_aggregator(name);
+    aggregator->set_input_types({flex_type_enum::FLOAT});
+    auto expected = sequential(*aggregator, values);
+    std::vector<flexible_type> actual;
+    for (const auto& value: sa.parallel_cumulative_aggregate(name).range_iterator()) {
+      actual.push_back(value);
+    }
+    check_equal(actual, expected);
+  }
+
+  // and so does an aggregator without adds after a combine
+  auto aggregator = std::make_shared<tagged_sum>();
+  auto expected = sequential(*aggregator, values);
+  size_t i = 0;
+  for (const auto& value: sa.parallel_cumulative_aggregate(aggregator).range_iterator()) {
+    ASSERT_TRUE(value == expected[i]);
+    ++i;
+  }
+  ASSERT_EQ(i, values.size());
+
+  bool thrown = false;
+  try {
+    sa.parallel_cumulative_aggregate("__builtin__nope__");
+  } catch (...) {
+    thrown = true;
+  }
+  ASSERT_TRUE(thrown);
+}
+
+int main() {
+  test_segmented_scan();
+  test_parallel_cumulative_aggregate();
+  return 0;
+}
@@ -0,0 +1,39 @@
+#!/usr/bin/env python
+"""
+Writes the Arrow file read by test/columnar_file_test.cpp, with pyarrow,
+in two batches sharing one string dictionary. The values are functions of
+the row number, which the test recomputes.
+
+Needs pyarrow.
+"""
+import os
+
+import pyarrow as pa
+import pyarrow.ipc as ipc
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+N = 300
+
+
+def table():
+    rows = range(N)
+    labels = pa.array(['a', 'b', 'c'], pa.large_string())
+    return pa.table({
+        'i': pa.array([None if i % 7 == 3 else i * 1000003 - 500000000 for i in rows], pa.int64()),
+        'f': pa.array([i * 0.25 for i in rows], pa.float64()),
+        'ts': pa.array([1500000000000000 + i * 1234567 for i in rows], pa.timestamp('us', tz='UTC')),
+        's': pa.array([None if i % 11 == 0 else 'k%d' % i for i in rows], pa.large_string()),
+        'label': pa.DictionaryArray.from_arrays(pa.array([i % 3 for i in rows], pa.int64()), labels),
+        'v': pa.array([[i + k * 0.5 for k in range(i % 3)] for i in rows], pa.large_list(pa.float64())),
+    })
+
+
+def main():
+    t = table()
+    with ipc.new_file(os.path.join(HERE, 'arrow_pyarrow.arrow'), t.schema) as writer:
+        for batch in t.to_batches(max_chunksize=N // 2):
+            writer.write_batch(batch)
+
+
+if __name__ == '__main__':
+    main()
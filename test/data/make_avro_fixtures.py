@@ -0,0 +1,72 @@
+#!/usr/bin/env python
+"""
+Writes the avro files read by test/avro_reader_test.cpp. The values are
+functions of the row number, which the test recomputes.
+
+Needs fastavro, and pyarrow for the snappy codec: fastavro's own snappy
+writer needs python-snappy or cramjam.
+"""
+import binascii
+import datetime
+import decimal
+import os
+import struct
+
+import fastavro._write_py as avro_write
+import pyarrow as pa
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+N = 1000
+
+SCHEMA = {
+    'type': 'record',
+    'name': 'event',
+    'fields': [
+        {'name': 'i', 'type': 'long'},
+        {'name': 'f', 'type': ['null', 'double']},
+        {'name': 'ts', 'type': {'type': 'long', 'logicalType': 'timestamp-millis'}},
+        {'name': 'd', 'type': {'type': 'int', 'logicalType': 'date'}},
+        {'name': 'dec', 'type': {'type': 'bytes', 'logicalType': 'decimal',
+                                 'precision': 9, 'scale': 2}},
+        {'name': 'mixed', 'type': ['null', 'long', 'string']},
+        {'name': 'vec', 'type': {'type': 'array', 'items': 'double'}},
+    ],
+}
+
+
+def records():
+    epoch = datetime.datetime(1970, 1, 1, tzinfo=datetime.timezone.utc)
+    for i in range(N):
+        yield {
+            'i': i * 1000003 - 500000000,
+            'f': None if i % 5 == 0 else i * 0.25,
+            'ts': epoch + datetime.timedelta(milliseconds=1400000000000 + i * 1001),
+            'd': datetime.date(1970, 1, 1) + datetime.timedelta(days=17000 + i),
+            'dec': decimal.Decimal(i * 101 - 50000) / 100,
+            'mixed': None if i % 3 == 0 else i if i % 3 == 1 else 'k%d' % i,
+            'vec': [float(i), i * 0.5][:i % 3],
+        }
+
+
+def snappy_write_block(encoder, block_bytes, compression_level):
+    # a raw snappy block followed by the big endian crc32 of the data
+    data = pa.compress(block_bytes, codec='snappy', asbytes=True)
+    encoder.write_long(len(data) + 4)
+    encoder._fo.write(data)
+    encoder._fo.write(struct.pack('>I', binascii.crc32(block_bytes) & 0xffffffff))
+
+
+def write(name, codec):
+    with open(os.path.join(HERE, name), 'wb') as f:
+        avro_write.writer(f, SCHEMA, records(), codec=codec, sync_interval=2048)
+
+
+def main():
+    avro_write.BLOCK_WRITERS['snappy'] = snappy_write_block
+    write('avro_null.avro', 'null')
+    write('avro_snappy.avro', 'snappy')
+    write('avro_deflate.avro', 'deflate')
+
+
+if __name__ == '__main__':
+    main()
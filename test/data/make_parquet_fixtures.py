@@ -0,0 +1,219 @@
+#!/usr/bin/env python
+"""
+Writes the parquet files read by test/parquet_reader_test.cpp. The values
+are functions of the row number, which the test recomputes.
+
+Needs pyarrow. parquet_legacy_timestamp.parquet is written by hand, since
+pyarrow always writes the LogicalType of a column: its columns only have
+the converted types TIMESTAMP_MILLIS and TIMESTAMP_MICROS, as parquet-mr
+before 1.11 and Hive write them. So are the files with legacy statistics
+and the corrupt files.
+"""
+import datetime
+import decimal
+import os
+import struct
+
+import pyarrow as pa
+import pyarrow.parquet as pq
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+N = 300
+
+
+def table():
+    rows = range(N)
+    epoch = datetime.datetime(1970, 1, 1)
+    return pa.table({
+        'i64': pa.array([None if i % 7 == 3 else i * 1000003 - 500000000 for i in rows], pa.int64()),
+        'i32': pa.array([(i * 37) % 200 - 100 for i in rows], pa.int32()),
+        'f': pa.array([None if i % 5 == 0 else i * 0.25 for i in rows], pa.float64()),
+        's': pa.array([None if i % 11 == 0 else 'k%d' % (i % 13) for i in rows], pa.string()),
+        'b': pa.array([i % 3 == 0 for i in rows], pa.bool_()),
+        'ts': pa.array([epoch + datetime.timedelta(microseconds=1500000000000000 + i * 1234567)
+                        for i in rows], pa.timestamp('us')),
+        'tsu': pa.array([1400000000000 + i * 1001 for i in rows], pa.timestamp('ms', tz='UTC')),
+        'd': pa.array([17000 + i for i in rows], pa.date32()),
+        'dec': pa.array([decimal.Decimal(i * 101 - 5000) / 100 for i in rows], pa.decimal128(9, 2)),
+        'nested': pa.array([{'x': i} for i in rows]),
+    })
+
+
+# thrift compact protocol, for the legacy file
+def varint(n):
+    out = b''
+    while True:
+        b = n & 0x7f
+        n >>= 7
+        if n:
+            out += bytes([b | 0x80])
+        else:
+            return out + bytes([b])
+
+
+def zigzag(n):
+    return varint((n << 1) ^ (n >> 63))
+
+
+class Struct(object):
+    def __init__(self):
+        self.out = b''
+        self.last = 0
+
+    def header(self, fid, ftype):
+        delta = fid - self.last
+        self.last = fid
+        if 0 < delta <= 15:
+            self.out += bytes([(delta << 4) | ftype])
+        else:
+            self.out += bytes([ftype]) + zigzag(fid)
+
+    def i32(self, fid, v):
+        self.header(fid, 5)
+        self.out += zigzag(v)
+        return self
+
+    def i64(self, fid, v):
+        self.header(fid, 6)
+        self.out += zigzag(v)
+        return self
+
+    def binary(self, fid, v):
+        self.header(fid, 8)
+        self.out += varint(len(v)) + v
+        return self
+
+    def struct(self, fid, s):
+        self.header(fid, 12)
+        self.out += s.end()
+        return self
+
+    def list(self, fid, etype, items):
+        self.header(fid, 9)
+        self.out += bytes([(len(items) << 4) | etype]) if len(items) < 15 else \
+            bytes([0xf0 | etype]) + varint(len(items))
+        for item in items:
+            if etype == 12:
+                self.out += item.end()
+            elif etype == 8:
+                self.out += varint(len(item)) + item
+            else:
+                self.out += zigzag(item)
+        return self
+
+    def end(self):
+        return self.out + b'\x00'
+
+
+class Column(object):
+    """
+    A column of a hand written file. physical is 1 (INT32) or 2 (INT64),
+    and converted the converted type or None.
+    legacy_stats writes the values of the legacy signed min and max.
+    page_size overrides the uncompressed size of the data page, and
+    num_values the number of values of the column chunk.
+    """
+    def __init__(self, name, physical, converted, values, legacy_stats=False,
+                 page_size=None, num_values=None):
+        self.name = name
+        self.physical = physical
+        self.converted = converted
+        self.values = values
+        self.legacy_stats = legacy_stats
+        self.page_size = page_size
+        self.num_values = num_values
+
+
+def hand_written_file(path, columns):
+    """
+    Writes a file of one row group, with one uncompressed PLAIN data page
+    per column.
+    """
+    out = b'PAR1'
+    chunks = []
+    for c in columns:
+        fmt = '<q' if c.physical == 2 else '<i'
+        optional = any(v is None for v in c.values)
+        body = b''
+        if optional:
+            # definition levels, as runs of one
+            levels = b''.join(varint(2) + bytes([0 if v is None else 1]) for v in c.values)
+            body += struct.pack('<I', len(levels)) + levels
+        present = [v for v in c.values if v is not None]
+        body += b''.join(struct.pack(fmt, v) for v in present)
+        page_size = len(body) if c.page_size is None else c.page_size
+        page = Struct().i32(1, 0).i32(2, page_size).i32(3, len(body)).struct(
+            5, Struct().i32(1, len(c.values)).i32(2, 0).i32(3, 3).i32(4, 3)).end()
+        offset = len(out)
+        out += page + body
+        num_values = len(c.values) if c.num_values is None else c.num_values
+        meta = Struct().i32(1, c.physical).list(2, 5, [0, 3]).list(3, 8, [c.name.encode()]) \
+            .i32(4, 0).i64(5, num_values).i64(6, len(page + body)).i64(7, len(page + body)) \
+            .i64(9, offset)
+        if c.legacy_stats:
+            meta.struct(12, Struct().binary(1, struct.pack(fmt, max(present)))
+                        .binary(2, struct.pack(fmt, min(present))))
+        chunks.append(Struct().i64(2, offset).struct(3, meta))
+        schema_element = Struct().i32(1, c.physical).i32(3, 1 if optional else 0) \
+            .binary(4, c.name.encode())
+        if c.converted is not None:
+            schema_element.i32(6, c.converted)
+        chunks[-1].schema = schema_element
+    num_rows = len(columns[0].values)
+    root = Struct().binary(4, b'schema').i32(5, len(chunks))
+    row_group = Struct().list(1, 12, chunks).i64(2, len(out)).i64(3, num_rows)
+    footer = Struct().i32(1, 1).list(2, 12, [root] + [c.schema for c in chunks]) \
+        .i64(3, num_rows).list(4, 12, [row_group]).end()
+    out += footer + struct.pack('<I', len(footer)) + b'PAR1'
+    with open(path, 'wb') as f:
+        f.write(out)
+
+
+def legacy_timestamp_file(path):
+    rows = range(N)
+    ms = [1400000000000 + i * 1001 for i in rows]
+    us = [None if i % 4 == 1 else 1500000000000000 + i * 1234567 for i in rows]
+    hand_written_file(path, [Column('ts_ms', 2, 9, ms), Column('ts_us', 2, 10, us)])
+
+
+def legacy_unsigned_file(path):
+    """
+    UINT_32 values on both sides of 2^31, stored as INT32, with the legacy
+    statistics of the signed physical values: their min is 2^31 and their
+    max is 2^31 - 1.
+    """
+    values = [(1 << 31) - 150 + i for i in range(N)]
+    signed = [v - (1 << 32) if v >= 1 << 31 else v for v in values]
+    hand_written_file(path, [Column('u32', 1, 13, signed, legacy_stats=True)])
+
+
+def corrupt_files(path):
+    """
+    Files whose data page has a negative uncompressed size, and whose
+    column chunk has fewer values than the row group has rows.
+    """
+    values = list(range(N))
+    hand_written_file(path('parquet_negative_page_size.parquet'),
+                      [Column('i', 2, None, values, page_size=-8)])
+    hand_written_file(path('parquet_short_chunk.parquet'),
+                      [Column('i', 2, None, values), Column('j', 2, None, values, num_values=N - 1)])
+
+
+def main():
+    t = table()
+    path = lambda name: os.path.join(HERE, name)
+    pq.write_table(t, path('parquet_snappy_v1.parquet'), row_group_size=100,
+                   compression='snappy', data_page_version='1.0', data_page_size=512)
+    pq.write_table(t, path('parquet_none_v2.parquet'), row_group_size=128,
+                   compression='none', data_page_version='2.0')
+    pq.write_table(t, path('parquet_snappy_v2_plain.parquet'), row_group_size=300,
+                   compression='snappy', data_page_version='2.0', use_dictionary=False)
+    pq.write_table(t, path('parquet_int96.parquet'), row_group_size=100,
+                   compression='snappy', use_deprecated_int96_timestamps=True)
+    legacy_timestamp_file(path('parquet_legacy_timestamp.parquet'))
+    legacy_unsigned_file(path('parquet_legacy_unsigned.parquet'))
+    corrupt_files(path)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+
+using namespace graphlab;
+using gl_sframe_impl::sort_record;
+
+static std::vector<sort_record> make_run(std::mt19937& rng, size_t n, flex_int tag) {
+  std::vector<sort_record> run(n);
+  for (size_t i = 0; i < n; ++i) {
+    run[i].values = {flex_int(rng() % 100000), tag};
+    run[i].key.clear();
+    gl_sframe_impl::encode_sort_value(run[i].values[0], flex_type_enum::INTEGER, true,
+                                      run[i].key);
+    gl_sframe_impl::append_big_endian(run[i].key, tag * 1000000 + i);
+  }
+  gl_sframe_impl::sort_records(run);
+  return run;
+}
+
+/**
+ * Merges more runs on disk than the fan-in, with runs in memory, and checks
+ * the order, the records, and that no intermediate run is left behind.
+ */
+void test_multi_pass_merge() {
+  std::mt19937 rng(3);
+  std::vector<std::string> splitters;
+  {
+    std::string splitter;
+    gl_sframe_impl::encode_sort_value(flex_int(50000), flex_type_enum::INTEGER, true, splitter);
+    splitters.push_back(splitter);
+  }
+  std::deque<gl_sframe_impl::sort_run_file> files;
+  std::vector<std::string> filenames;
+  size_t total = 0;
+  for (flex_int tag = 0; tag < 11; ++tag) {
+    auto run = make_run(rng, 100 + 7 * tag, tag);
+    total += run.size();
+    files.push_back(gl_sframe_impl::spill_sort_run(run, splitters));
+    filenames.push_back(files.back().filename);
+  }
+  auto memory_run = make_run(rng, 50, 99);
+  total += memory_run.size();
+  auto bounds = gl_sframe_impl::sort_run_bounds(memory_run, splitters);
+
+  size_t merged = 0;
+  for (size_t partition = 0; partition < 2; ++partition) {
+    std::vector<gl_sframe_impl::sort_run_slice> slices;
+    for (auto& file: files) slices.push_back({&file, partition, false});
+    std::vector<std::unique_ptr<gl_sframe_impl::sort_run_cursor> > memory_cursors;
+    memory_cursors.emplace_back(new gl_sframe_impl::sort_run_cursor(
+        memory_run, bounds[partition], bounds[partition + 1]));
+    std::string last;
+    gl_sframe_impl::merge_sort_partition(
+        slices, std::move(memory_cursors), 3, [&](const sort_record& record) {
+          ASSERT_TRUE(last < record.key);
+          last = record.key;
+          flex_int value = record.values[0].get<flex_int>();
+          ASSERT_EQ(value < 50000, partition == 0);
+          ++merged;
+        });
+  }
+  ASSERT_EQ(merged, total);
+
+  // only the input runs are left, until they go
+  std::string prefix = filenames[0].substr(0, filenames[0].rfind('_') + 1);
+  size_t counter_max = 0;
+  for (const auto& filename: filenames) {
+    counter_max = std::max<size_t>(counter_max, std::stoul(filename.substr(prefix.size())));
+  }
+  for (size_t i = 1; i < counter_max + 64; ++i) {
+    std::string filename = prefix + std::to_string(i);
+    bool is_input = std::find(filenames.begin(), filenames.end(), filename) != filenames.end();
+    ASSERT_EQ(access(filename.c_str(), F_OK) == 0, is_input);
+  }
+  files.clear();
+  for (const auto& filename: filenames) ASSERT_TRUE(access(filename.c_str(), F_OK) != 0);
+}
+
+int main() {
+  test_multi_pass_merge();
+  return 0;
+}
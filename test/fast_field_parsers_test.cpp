@@ -0,0 +1,164 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/flexible_type/fast_field_parsers.hpp>
+#include <graphlab/sdk/gl_sarray.hpp>
+
+using namespace graphlab;
+
+static bool parse_int(const std::string& s, flex_int& out) {
+  return fast_parse_int(s.data(), s.data() + s.size(), out);
+}
+
+static bool parse_float(const std::string& s, flex_float& out) {
+  return fast_parse_float(s.data(), s.data() + s.size(), out);
+}
+
+void test_parse_int() {
+  flex_int value = 0;
+  ASSERT_TRUE(parse_int("0", value));
+  ASSERT_EQ(value, 0);
+  ASSERT_TRUE(parse_int("-42", value));
+  ASSERT_EQ(value, -42);
+  ASSERT_TRUE(parse_int("+17", value));
+  ASSERT_EQ(value, 17);
+  ASSERT_TRUE(parse_int("9223372036854775807", value));
+  ASSERT_EQ(value, INT64_MAX);
+  ASSERT_TRUE(parse_int("-9223372036854775808", value));
+  ASSERT_EQ(value, INT64_MIN);
+  for (std::string bad: {"", "-", "+", "9223372036854775808", "-9223372036854775809",
+                         "99999999999999999999999", "12a", " 1", "1.0", "1e3"}) {
+    ASSERT_FALSE(parse_int(bad, value));
+  }
+}
+
+/**
+ * The fast path and the fallback give the doubles strtod gives, to the
+ * bit, over random decimals of both sides of the fast path limits.
+ */
+void test_parse_float() {
+  std::mt19937_64 gen(11);
+  char buffer[64];
+  for (size_t i = 0; i < 200000; ++i) {
+    size_t ndigits = 1 + gen() % 22;
+    std::string digits;
+    for (size_t d = 0; d < ndigits; ++d) digits.push_back('0' + gen() % 10);
+    size_t point = gen() % (ndigits + 1);
+    std::string s = (gen() % 2 ? "-" : "") + digits.substr(0, point) +
+                    (point < ndigits ? "." + digits.substr(point) : "");
+    if (gen() % 3 == 0) {
+      snprintf(buffer, sizeof(buffer), "e%d", int(gen() % 61) - 30);
+      s += buffer;
+    }
+    flex_float value = 0;
+    ASSERT_TRUE(parse_float(s, value));
+    double expected = std::strtod(s.c_str(), nullptr);
+    ASSERT_EQ(std::memcmp(&value, &expected, sizeof(double)), 0);
+  }
+  flex_float value = 0;
+  ASSERT_TRUE(parse_float("1e-400", value));
+  ASSERT_EQ(value, 0.0);
+  ASSERT_TRUE(parse_float("inf", value));
+  ASSERT_TRUE(std::isinf(value));
+  ASSERT_TRUE(parse_float("nan", value));
+  ASSERT_TRUE(std::isnan(value));
+  ASSERT_TRUE(parse_float(".5", value));
+  ASSERT_EQ(value, 0.5);
+  for (std::string bad: {"", "-", ".", "1e", "1e+", "1.2.3", "12x", "e5"}) {
+    ASSERT_FALSE(parse_float(bad, value));
+  }
+}
+
+/**
+ * Datetimes of random instants, formatted in several layouts and time
+ * zones, parse back to the instant.
+ */
+void test_datetime_format_parser() {
+  std::mt19937_64 gen(5);
+  const char* months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                          "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  datetime_format_parser iso, us("%m/%d/%Y %H:%M:%S.%f"), named("%d-%b-%Y %H:%M:%S %ZP");
+  ASSERT_TRUE(iso.compiled() && us.compiled() && named.compiled());
+  char buffer[128];
+  for (size_t i = 0; i < 20000; ++i) {
+    time_t t = time_t(gen() % 8000000000ull) - 2000000000;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    int offset = (int(gen() % 49) - 24) * 15;
+    time_t local = t + offset * 60;
+    struct tm ltm;
+    gmtime_r(&local, &ltm);
+    flex_date_time dt;
+
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d%c%02d:%02d",
+             ltm.tm_year + 1900, ltm.tm_mon + 1, ltm.tm_mday, ltm.tm_hour, ltm.tm_min,
+             ltm.tm_sec, offset < 0 ? '-' : '+', std::abs(offset) / 60, std::abs(offset) % 60);
+    ASSERT_TRUE(iso.parse(std::string(buffer), dt));
+    ASSERT_EQ(dt.posix_timestamp(), t);
+    ASSERT_EQ(dt.time_zone_offset() * flex_date_time::TIMEZONE_RESOLUTION_IN_MINUTES, offset);
+
+    int microsecond = gen() % 1000000;
+    snprintf(buffer, sizeof(buffer), "%02d/%02d/%04d %02d:%02d:%02d.%06d",
+             tm.tm_mon + 1, tm.tm_mday, tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec,
+             microsecond);
+    ASSERT_TRUE(us.parse(std::string(buffer), dt));
+    ASSERT_EQ(dt.posix_timestamp(), t);
+    ASSERT_EQ(dt.microsecond(), microsecond);
+    ASSERT_EQ(dt.time_zone_offset(), flex_date_time::EMPTY_TIMEZONE);
+
+    snprintf(buffer, sizeof(buffer), "%02d-%s-%04d %02d:%02d:%02d GMT%c%02d%02d",
+             ltm.tm_mday, months[ltm.tm_mon], ltm.tm_year + 1900, ltm.tm_hour, ltm.tm_min,
+             ltm.tm_sec, offset < 0 ? '-' : '+', std::abs(offset) / 60, std::abs(offset) % 60);
+    ASSERT_TRUE(named.parse(std::string(buffer), dt));
+    ASSERT_EQ(dt.posix_timestamp(), t);
+  }
+
+  flex_date_time dt;
+  ASSERT_TRUE(iso.parse(std::string("2016-02-29T23:59:59Z"), dt));
+  ASSERT_EQ(dt.posix_timestamp(), 1456790399);
+  for (std::string bad: {"2015-02-29T00:00:00", "2016-13-01T00:00:00", "2016-1-01T00:00:00",
+                         "2016-01-01T24:00:00", "2016-01-01T00:00:00+05:10",
+                         "2016-01-01T00:00:00 EST", "2016-01-01T00:00:00.5"}) {
+    ASSERT_FALSE(iso.parse(bad, dt));
+  }
+  ASSERT_FALSE(datetime_format_parser("%Y-%j").compiled());
+}
+
+/**
+ * The fast conversion of an array agrees with str_to_datetime.
+ */
+void test_fast_str_to_datetime() {
+  std::vector<flexible_type> values{"2011-10-20T09:30:10Z", "2011-10-20T09:30:10-05:30",
+                                    FLEX_UNDEFINED, "2011-10-20T09:30:10-0500"};
+  gl_sarray sa(values, flex_type_enum::STRING);
+  gl_sarray fast = sa.fast_str_to_datetime();
+  gl_sarray slow = sa.str_to_datetime();
+  ASSERT_EQ(fast.size(), values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_TRUE(fast[i].get_type() == slow[i].get_type());
+    if (slow[i].get_type() == flex_type_enum::DATETIME) {
+      ASSERT_TRUE(fast[i].get<flex_date_time>() == slow[i].get<flex_date_time>());
+    }
+  }
+}
+
+int main() {
+  test_parse_int();
+  test_parse_float();
+  test_datetime_format_parser();
+  test_fast_str_to_datetime();
+  return 0;
+}
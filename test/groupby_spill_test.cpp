@@ -0,0 +1,211 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+
+using namespace graphlab;
+using gl_sframe_impl::groupby_hash_table;
+using gl_sframe_impl::groupby_spill;
+using gl_sframe_impl::groupby_run;
+using gl_sframe_impl::groupby_resident_group;
+
+/**
+ * A sum which checks that every state reaching a combine was partially
+ * finalized, as the group_aggregate_value contract requires.
+ */
+class checked_sum: public group_aggregate_value {
+ public:
+  group_aggregate_value* new_instance() const { return new checked_sum; }
+  void add_element_simple(const flexible_type& flex) {
+    ASSERT_TRUE(!m_finalized);
+    m_value += flex.get<flex_int>();
+  }
+  void partial_finalize() { m_finalized = true; }
+  void combine(const group_aggregate_value& other) {
+    const checked_sum& o = dynamic_cast<const checked_sum&>(other);
+    ASSERT_TRUE(o.m_finalized);
+    m_value += o.m_value;
+  }
+  flexible_type emit() const { return m_value; }
+  bool support_type(flex_type_enum type) const { return type == flex_type_enum::INTEGER; }
+  std::string name() const { return "checked_sum"; }
+  void save(oarchive& oarc) const { oarc << m_value << m_finalized; }
+  void load(iarchive& iarc) { iarc >> m_value >> m_finalized; }
+
+ private:
+  flex_int m_value = 0;
+  bool m_finalized = false;
+};
+
+/**
+ * Concatenates its integer elements, so its state grows with every element.
+ */
+class concat: public group_aggregate_value {
+ public:
+  group_aggregate_value* new_instance() const { return new concat; }
+  void add_element_simple(const flexible_type& flex) { m_values.push_back(flex); }
+  void combine(const group_aggregate_value& other) {
+    const auto& o = dynamic_cast<const concat&>(other);
+    m_values.insert(m_values.end(), o.m_values.begin(), o.m_values.end());
+  }
+  flexible_type emit() const { return m_values; }
+  bool support_type(flex_type_enum type) const { return type == flex_type_enum::INTEGER; }
+  std::string name() const { return "concat"; }
+  void save(oarchive& oarc) const { oarc << m_values; }
+  void load(iarchive& iarc) { iarc >> m_values; }
+
+ private:
+  flex_list m_values;
+};
+
+static void add(groupby_hash_table& table,
+                const std::vector<std::unique_ptr<group_aggregate_value> >& prototypes,
+                flex_int key, flex_int value) {
+  std::vector<flexible_type> k{key};
+  size_t group = table.find_or_insert(gl_sframe_impl::hash_group_key(k), k, prototypes);
+  table.value(group, 0).add_element_simple(value);
+}
+
+/**
+ * Spills two tables, keeps a third in memory, and merges one partition with
+ * a budget small enough to split it, checking the sums against a reference.
+ */
+void test_merge_over_budget() {
+  std::vector<std::unique_ptr<group_aggregate_value> > prototypes;
+  prototypes.emplace_back(new checked_sum);
+  const size_t nbuckets = 4;
+  const flex_int ngroups = 5000;
+  std::map<flex_int, flex_int> expected;
+  std::vector<groupby_spill> spills;
+  std::vector<std::string> filenames;
+  for (int t = 0; t < 2; ++t) {
+    groupby_hash_table table(1);
+    for (flex_int i = 0; i < ngroups; ++i) {
+      add(table, prototypes, i, i * (t + 1));
+      expected[i] += i * (t + 1);
+    }
+    spills.push_back(gl_sframe_impl::spill_groupby_table(table, 1, nbuckets));
+    ASSERT_EQ(table.num_groups(), 0);
+    filenames.push_back(spills.back().filename);
+  }
+  groupby_hash_table resident_table(1);
+  for (flex_int i = 0; i < ngroups; i += 3) {
+    add(resident_table, prototypes, i, 7);
+    expected[i] += 7;
+  }
+  for (size_t group = 0; group < resident_table.num_groups(); ++group) {
+    resident_table.value(group, 0).partial_finalize();
+  }
+
+  std::map<flex_int, flex_int> actual;
+  size_t num_merges = 0;
+  auto emit = [&](groupby_hash_table& merged) {
+    ++num_merges;
+    for (size_t group = 0; group < merged.num_groups(); ++group) {
+      flex_int key = merged.key(group)[0].get<flex_int>();
+      ASSERT_EQ(actual.count(key), 0);
+      actual[key] = merged.value(group, 0).emit().get<flex_int>();
+    }
+  };
+  for (size_t b = 0; b < nbuckets; ++b) {
+    std::vector<groupby_run> runs;
+    for (const auto& spill: spills) runs.push_back({&spill, b});
+    std::vector<groupby_resident_group> resident;
+    for (size_t group = 0; group < resident_table.num_groups(); ++group) {
+      if (gl_sframe_impl::groupby_partition(resident_table.hash(group), nbuckets) == b) {
+        resident.push_back({&resident_table, group});
+      }
+    }
+    // a budget of a few groups splits the partition down to the last level
+    gl_sframe_impl::merge_groupby_partition(runs, resident, prototypes, 256, 0, emit);
+  }
+  ASSERT_TRUE(actual == expected);
+  ASSERT_GE(num_merges, 4 * nbuckets);
+  // the resident states were moved into the merge
+  for (size_t group = 0; group < resident_table.num_groups(); ++group) {
+    ASSERT_TRUE(resident_table.state(group, 0) == nullptr);
+  }
+
+  // the spill files go with the spills
+  for (const auto& filename: filenames) ASSERT_EQ(access(filename.c_str(), F_OK), 0);
+  spills.clear();
+  for (const auto& filename: filenames) ASSERT_TRUE(access(filename.c_str(), F_OK) != 0);
+}
+
+/**
+ * A merge within the budget is not split.
+ */
+void test_merge_within_budget() {
+  std::vector<std::unique_ptr<group_aggregate_value> > prototypes;
+  prototypes.emplace_back(new checked_sum);
+  groupby_hash_table table(1);
+  for (flex_int i = 0; i < 100; ++i) add(table, prototypes, i % 10, i);
+  groupby_spill spill = gl_sframe_impl::spill_groupby_table(table, 1, 1);
+  size_t num_merges = 0;
+  flex_int total = 0;
+  auto emit = [&](groupby_hash_table& merged) {
+    ++num_merges;
+    ASSERT_EQ(merged.num_groups(), 10);
+    for (size_t group = 0; group < merged.num_groups(); ++group) {
+      total += merged.value(group, 0).emit().get<flex_int>();
+    }
+  };
+  std::vector<groupby_run> runs{{&spill, 0}};
+  gl_sframe_impl::merge_groupby_partition(runs, {}, prototypes, 1 << 20, 0, emit);
+  ASSERT_EQ(num_merges, 1);
+  ASSERT_EQ(total, 99 * 100 / 2);
+}
+
+/**
+ * The memory of a table follows the size of its keys, and of its states
+ * once they are sampled again.
+ */
+void test_table_bytes() {
+  std::vector<std::unique_ptr<group_aggregate_value> > prototypes;
+  prototypes.emplace_back(new concat);
+  groupby_hash_table table(1);
+  ASSERT_EQ(table.bytes(), 0);
+  add(table, prototypes, 0, 1);
+  ASSERT_TRUE(table.needs_sample());
+  table.sample_state_bytes(16);
+  ASSERT_FALSE(table.needs_sample());
+  size_t one_group = table.bytes();
+  ASSERT_GT(one_group, 0);
+
+  // a longer key costs more than a short one
+  groupby_hash_table strings(1);
+  std::vector<flexible_type> short_key{flex_string("a")};
+  std::vector<flexible_type> long_key{flex_string(1000, 'x')};
+  strings.find_or_insert(gl_sframe_impl::hash_group_key(short_key), short_key, prototypes);
+  size_t short_bytes = strings.bytes();
+  strings.find_or_insert(gl_sframe_impl::hash_group_key(long_key), long_key, prototypes);
+  ASSERT_GE(strings.bytes() - short_bytes, short_bytes + 1000 - 1);
+
+  // a growing state is seen at the next sample
+  for (flex_int i = 0; i < 1000; ++i) add(table, prototypes, 0, i);
+  ASSERT_EQ(table.bytes(), one_group);
+  table.sample_state_bytes(16);
+  ASSERT_GT(table.bytes(), one_group + 1000);
+
+  table.clear();
+  ASSERT_EQ(table.num_groups(), 0);
+  add(table, prototypes, 1, 1);
+  ASSERT_TRUE(table.needs_sample());
+}
+
+int main() {
+  test_table_bytes();
+  test_merge_over_budget();
+  test_merge_within_budget();
+  return 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sketches/bloom_filter.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+
+using namespace graphlab;
+
+static uint128_t key_hash(flex_int key) {
+  return gl_sframe_impl::hash_group_key({flexible_type(key)});
+}
+
+/**
+ * No false negatives, about 1% false positives at the default sizing, and
+ * filters filled by several threads or combined match one filled alone.
+ */
+void test_bloom_filter() {
+  const size_t n = 20000;
+  sdk_sketches::bloom_filter filter(n), concurrent(n), left(n), right(n);
+  for (flex_int i = 0; i < flex_int(n); ++i) {
+    filter.add(key_hash(i));
+    (i % 2 ? left : right).add(key_hash(i));
+  }
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&concurrent, t, n]() {
+      for (flex_int i = t; i < flex_int(n); i += 4) concurrent.concurrent_add(key_hash(i));
+    });
+  }
+  for (auto& thread: threads) thread.join();
+  left.combine(right);
+
+  for (flex_int i = 0; i < flex_int(n); ++i) {
+    ASSERT_TRUE(filter.may_contain(key_hash(i)));
+    ASSERT_TRUE(concurrent.may_contain(key_hash(i)));
+    ASSERT_TRUE(left.may_contain(key_hash(i)));
+  }
+  size_t false_positives = 0;
+  for (flex_int i = n; i < flex_int(11 * n); ++i) {
+    bool found = filter.may_contain(key_hash(i));
+    ASSERT_EQ(concurrent.may_contain(key_hash(i)), found);
+    ASSERT_EQ(left.may_contain(key_hash(i)), found);
+    false_positives += found;
+  }
+  ASSERT_LT(false_positives, 10 * n / 50);
+}
+
+/**
+ * The index finds every row of a hash, duplicates included, and no other.
+ */
+void test_join_hash_index() {
+  std::vector<gl_sframe_impl::join_row> rows;
+  for (flex_int i = 0; i < 1000; ++i) {
+    flex_int key = i % 300;
+    rows.push_back({key_hash(key), {key, i}});
+  }
+  gl_sframe_impl::join_hash_index index(rows);
+  for (flex_int key = 0; key < 400; ++key) {
+    std::set<flex_int> found;
+    index.find(key_hash(key), [&](size_t i) {
+      ASSERT_EQ(rows[i].values[0].get<flex_int>(), key);
+      found.insert(rows[i].values[1].get<flex_int>());
+    });
+    std::set<flex_int> expected;
+    for (flex_int i = key; key < 300 && i < 1000; i += 300) expected.insert(i);
+    ASSERT_TRUE(found == expected);
+  }
+  gl_sframe_impl::join_hash_index empty(std::vector<gl_sframe_impl::join_row>{});
+  empty.find(key_hash(1), [](size_t) { ASSERT_TRUE(false); });
+
+  std::vector<flexible_type> a{1, "x", 2.5}, b{"x", 1};
+  ASSERT_TRUE(gl_sframe_impl::join_keys_equal(a, {0, 1}, b, {1, 0}));
+  ASSERT_FALSE(gl_sframe_impl::join_keys_equal(a, {0}, b, {0}));
+}
+
+/**
+ * The four join types against a nested loop join, with a budget small
+ * enough to partition the rows.
+ */
+void test_hash_join() {
+  std::vector<flexible_type> left_key, left_value, right_key, right_value;
+  for (flex_int i = 0; i < 3000; ++i) {
+    left_key.push_back(i % 700);
+    left_value.push_back(i);
+  }
+  for (flex_int i = 0; i < 1000; ++i) {
+    right_key.push_back(400 + i % 500);
+    right_value.push_back(-i);
+  }
+  gl_sframe left({{"k", left_key}, {"v", left_value}});
+  gl_sframe right({{"k", right_key}, {"v", right_value}});
+
+  typedef std::tuple<flex_int, flex_int, flex_int> triple;
+  std::multiset<triple> inner;
+  std::set<flex_int> left_keys, right_keys;
+  for (size_t i = 0; i < left_key.size(); ++i) {
+    for (size_t j = 0; j < right_key.size(); ++j) {
+      if (left_key[i] == right_key[j]) {
+        inner.insert(triple(left_key[i], left_value[i], right_value[j]));
+      }
+    }
+    left_keys.insert(left_key[i].get<flex_int>());
+  }
+  for (const auto& key: right_key) right_keys.insert(key.get<flex_int>());
+
+  const flex_int MISSING = -1000000;
+  for (const std::string how: {"inner", "left", "right", "outer"}) {
+    std::multiset<triple> expected = inner;
+    if (how == "left" || how == "outer") {
+      for (size_t i = 0; i < left_key.size(); ++i) {
+        if (!right_keys.count(left_key[i].get<flex_int>())) {
+          expected.insert(triple(left_key[i], left_value[i], MISSING));
+        }
+      }
+    }
+    if (how == "right" || how == "outer") {
+      for (size_t j = 0; j < right_key.size(); ++j) {
+        if (!left_keys.count(right_key[j].get<flex_int>())) {
+          expected.insert(triple(right_key[j], MISSING, right_value[j]));
+        }
+      }
+    }
+
+    join_statistics statistics;
+    gl_sframe joined = left.hash_join(right, {"k"}, how, 64 * 1024, &statistics);
+    ASSERT_TRUE(joined.column_names() == std::vector<std::string>({"k", "v", "v.1"}));
+    std::multiset<triple> actual;
+    for (const auto& row: joined.range_iterator()) {
+      actual.insert(triple(row[0].get<flex_int>(),
+                           row[1].get_type() == flex_type_enum::UNDEFINED ? MISSING : row[1].get<flex_int>(),
+                           row[2].get_type() == flex_type_enum::UNDEFINED ? MISSING : row[2].get<flex_int>()));
+    }
+    ASSERT_TRUE(actual == expected);
+    ASSERT_EQ(statistics.num_output_rows, expected.size());
+  }
+}
+
+int main() {
+  test_bloom_filter();
+  test_join_hash_index();
+  test_hash_join();
+  return 0;
+}
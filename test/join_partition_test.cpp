@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <map>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+
+using namespace graphlab;
+using gl_sframe_impl::join_partitioned_rows;
+
+static uint128_t key_hash(flex_int key) {
+  return gl_sframe_impl::hash_group_key({flexible_type(key)});
+}
+
+/**
+ * Joins rows (key, value) through one partition with a budget small enough
+ * to spill and split it, in an outer join, and checks the output against
+ * the counts of a nested loop join.
+ */
+void test_join_partition_over_budget() {
+  const size_t budget = 4096;
+  join_partitioned_rows build_rows(2, 0, budget), probe_rows(2, 0, budget);
+  std::map<flex_int, size_t> build_count, probe_count;
+  for (flex_int i = 0; i < 3000; ++i) {
+    flex_int key = i % 1000;
+    build_rows.add(i % 2, key_hash(key), {key, i});
+    ++build_count[key];
+  }
+  for (flex_int i = 0; i < 2000; ++i) {
+    flex_int key = 500 + i % 1000;
+    probe_rows.add(i % 2, key_hash(key), {key, -i});
+    ++probe_count[key];
+  }
+  ASSERT_GE(build_rows.num_spills(), 1);
+  ASSERT_GE(build_rows.partition_memory(0), 10 * budget);
+
+  std::map<flex_int, size_t> joined_count, build_only_count, probe_only_count;
+  auto joined = [&](const std::vector<flexible_type>& build,
+                    const std::vector<flexible_type>& probe) {
+    ASSERT_EQ(build[0].get<flex_int>(), probe[0].get<flex_int>());
+    ++joined_count[build[0].get<flex_int>()];
+  };
+  auto build_only = [&](const std::vector<flexible_type>& build) {
+    ++build_only_count[build[0].get<flex_int>()];
+  };
+  auto probe_only = [&](const std::vector<flexible_type>& probe) {
+    ++probe_only_count[probe[0].get<flex_int>()];
+  };
+  std::vector<size_t> key_positions{0};
+  gl_sframe_impl::join_partition(build_rows, probe_rows, 0, key_positions, key_positions,
+                                 true, true, budget, 0, joined, build_only, probe_only);
+
+  for (flex_int key = 0; key < 1500; ++key) {
+    size_t nbuild = build_count[key], nprobe = probe_count[key];
+    ASSERT_EQ(joined_count[key], nbuild * nprobe);
+    ASSERT_EQ(build_only_count[key], nprobe == 0 ? nbuild : 0);
+    ASSERT_EQ(probe_only_count[key], nbuild == 0 ? nprobe : 0);
+  }
+  ASSERT_EQ(build_rows.partition_size(0), 3000);
+}
+
+/**
+ * Partitions on different bits of the hash are independent.
+ */
+void test_partition_shift() {
+  join_partitioned_rows top(1, 4, 1 << 20), low(1, 4, 1 << 20, 64);
+  std::vector<std::vector<size_t> > counts(16, std::vector<size_t>(16, 0));
+  for (flex_int key = 0; key < 16000; ++key) {
+    uint128_t hash = key_hash(key);
+    ++counts[top.partition_of(hash)][low.partition_of(hash)];
+  }
+  for (const auto& row: counts) {
+    for (size_t count: row) ASSERT_GE(count, 20);
+  }
+  ASSERT_EQ(gl_sframe_impl::join_radix_bits(100, 1000, 4, 10), 2);
+  ASSERT_EQ(gl_sframe_impl::join_radix_bits(100000, 1000, 4, 10), 7);
+  ASSERT_EQ(gl_sframe_impl::join_radix_bits(size_t(1) << 40, 1000, 4, 10), 10);
+}
+
+int main() {
+  test_join_partition_over_budget();
+  test_partition_shift();
+  return 0;
+}
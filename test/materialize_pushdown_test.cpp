@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+
+using namespace graphlab;
+
+static gl_sframe make_sframe() {
+  std::vector<flexible_type> user, score, payload;
+  for (flex_int i = 0; i < 20000; ++i) {
+    user.push_back(i);
+    score.push_back(i % 10);
+    payload.push_back(std::string(16, 'a' + i % 26));
+  }
+  return gl_sframe({{"user", user}, {"score", score}, {"payload", payload}});
+}
+
+/**
+ * The callback receives the requested columns, in the requested order, of
+ * the rows passing the predicate and no others.
+ */
+void test_projection_and_predicate() {
+  gl_sframe sf = make_sframe();
+  std::mutex lock;
+  std::set<flex_int> users;
+  sf.materialize_to_callback({"score", "user"}, sf["score"] > 6,
+      [&](size_t, const std::shared_ptr<sframe_rows>& rows) {
+        ASSERT_EQ(rows->num_columns(), 2);
+        std::lock_guard<std::mutex> guard(lock);
+        for (const auto& row: *rows) {
+          ASSERT_GT(row[0].get<flex_int>(), 6);
+          ASSERT_EQ(row[1].get<flex_int>() % 10, row[0].get<flex_int>());
+          ASSERT_TRUE(users.insert(row[1].get<flex_int>()).second);
+        }
+        return false;
+      });
+  ASSERT_EQ(users.size(), 6000);
+
+  std::atomic<size_t> nrows(0);
+  sf.materialize_to_callback({"payload"},
+      [&](size_t, const std::shared_ptr<sframe_rows>& rows) {
+        ASSERT_EQ(rows->num_columns(), 1);
+        nrows += rows->num_rows();
+        return false;
+      });
+  ASSERT_EQ(nrows.load(), 20000);
+}
+
+/**
+ * The typed filtered version sums the selected rows only.
+ */
+void test_typed_predicate() {
+  gl_sframe sf = make_sframe();
+  std::vector<flex_int> sums(4, 0);
+  sf.materialize_to_callback<flex_int>({"user"}, sf["score"] == 3,
+      [&](size_t threadid, const std::vector<typed_column_view<flex_int> >& cols) {
+        for (size_t i = 0; i < cols[0].size(); ++i) sums[threadid] += cols[0].data()[i];
+        return false;
+      }, 4);
+  // users 3, 13, ..., 19993
+  ASSERT_EQ(sums[0] + sums[1] + sums[2] + sums[3], 2000 * 3 + 10 * (1999 * 2000 / 2));
+}
+
+int main() {
+  test_projection_and_predicate();
+  test_typed_predicate();
+  return 0;
+}
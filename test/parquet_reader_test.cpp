@@ -0,0 +1,191 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sframe/parquet_reader.hpp>
+#include <graphlab/sdk/gl_sframe_parquet.hpp>
+
+using namespace graphlab;
+
+// The fixtures are written by test/data/make_parquet_fixtures.py
+static const size_t N = 300;
+
+static std::string fixture(const std::string& name) {
+  return "test/data/" + name;
+}
+
+static std::vector<flexible_type> read_all(const parquet_file& file, const std::string& name) {
+  int column = file.find_column(name);
+  ASSERT_GE(column, 0);
+  std::vector<flexible_type> ret, values;
+  for (size_t g = 0; g < file.row_groups().size(); ++g) {
+    file.read_column(g, column, values);
+    ret.insert(ret.end(), values.begin(), values.end());
+  }
+  ASSERT_EQ(ret.size(), N);
+  return ret;
+}
+
+static void check_datetime(const flexible_type& value, int64_t unit_value, int64_t per_second,
+                           int32_t time_zone) {
+  ASSERT_TRUE(value.get_type() == flex_type_enum::DATETIME);
+  const flex_date_time& dt = value.get<flex_date_time>();
+  ASSERT_EQ(dt.posix_timestamp(), unit_value / per_second);
+  ASSERT_EQ(dt.microsecond(), int32_t(unit_value % per_second * (1000000 / per_second)));
+  ASSERT_EQ(dt.time_zone_offset(), time_zone);
+}
+
+/**
+ * Reads every column of a fixture, whatever its pages, encodings and
+ * codec, and checks the values.
+ */
+void test_read_fixture(const std::string& name, size_t num_row_groups, bool int96) {
+  parquet_file file(fixture(name));
+  ASSERT_EQ(file.num_rows(), N);
+  ASSERT_EQ(file.row_groups().size(), num_row_groups);
+
+  // the struct column is left out
+  std::vector<std::string> names;
+  for (const auto& column: file.columns()) names.push_back(column.name);
+  ASSERT_TRUE(names == std::vector<std::string>({"i64", "i32", "f", "s", "b", "ts", "tsu", "d", "dec"}));
+  ASSERT_TRUE(file.columns()[5].type == flex_type_enum::DATETIME);
+  ASSERT_TRUE(file.columns()[8].type == flex_type_enum::FLOAT);
+
+  auto i64 = read_all(file, "i64");
+  auto i32 = read_all(file, "i32");
+  auto f = read_all(file, "f");
+  auto s = read_all(file, "s");
+  auto b = read_all(file, "b");
+  auto ts = read_all(file, "ts");
+  auto tsu = read_all(file, "tsu");
+  auto d = read_all(file, "d");
+  auto dec = read_all(file, "dec");
+  const int32_t empty = flex_date_time::EMPTY_TIMEZONE;
+  for (size_t i = 0; i < N; ++i) {
+    if (i % 7 == 3) ASSERT_TRUE(i64[i].get_type() == flex_type_enum::UNDEFINED);
+    else ASSERT_EQ(i64[i].get<flex_int>(), flex_int(i) * 1000003 - 500000000);
+    ASSERT_EQ(i32[i].get<flex_int>(), flex_int(i * 37 % 200) - 100);
+    if (i % 5 == 0) ASSERT_TRUE(f[i].get_type() == flex_type_enum::UNDEFINED);
+    else ASSERT_EQ(f[i].get<flex_float>(), i * 0.25);
+    if (i % 11 == 0) ASSERT_TRUE(s[i].get_type() == flex_type_enum::UNDEFINED);
+    else ASSERT_EQ(s[i].get<flex_string>(), "k" + std::to_string(i % 13));
+    ASSERT_EQ(b[i].get<flex_int>(), i % 3 == 0);
+    check_datetime(ts[i], 1500000000000000LL + int64_t(i) * 1234567, 1000000, empty);
+    // int96 timestamps have no time zone
+    check_datetime(tsu[i], 1400000000000LL + int64_t(i) * 1001, 1000, int96 ? empty : 0);
+    check_datetime(d[i], (17000 + int64_t(i)) * 86400, 1, empty);
+    ASSERT_DELTA(dec[i].get<flex_float>(), (int64_t(i) * 101 - 5000) / 100.0, 1e-9);
+  }
+}
+
+/**
+ * Files of older writers only have the converted type of timestamps.
+ */
+void test_legacy_timestamp() {
+  parquet_file file(fixture("parquet_legacy_timestamp.parquet"));
+  ASSERT_EQ(file.columns().size(), 2);
+  auto ms = read_all(file, "ts_ms");
+  auto us = read_all(file, "ts_us");
+  for (size_t i = 0; i < N; ++i) {
+    check_datetime(ms[i], 1400000000000LL + int64_t(i) * 1001, 1000, 0);
+    if (i % 4 == 1) ASSERT_TRUE(us[i].get_type() == flex_type_enum::UNDEFINED);
+    else check_datetime(us[i], 1500000000000000LL + int64_t(i) * 1234567, 1000000, 0);
+  }
+}
+
+/**
+ * Row groups are pruned by their statistics, never wrongly.
+ */
+void test_statistics_pruning() {
+  parquet_file file(fixture("parquet_snappy_v1.parquet"));
+  int i64 = file.find_column("i64");
+  int s = file.find_column("s");
+  flexible_type min, max;
+  ASSERT_TRUE(file.column_bounds(0, i64, min, max));
+  ASSERT_EQ(min.get<flex_int>(), -500000000);
+  ASSERT_EQ(max.get<flex_int>(), 99 * 1000003 - 500000000);
+  ASSERT_TRUE(file.column_bounds(0, s, min, max));
+  ASSERT_EQ(min.get<flex_string>(), "k0");
+  ASSERT_EQ(max.get<flex_string>(), "k9");
+  ASSERT_EQ(file.column_null_count(0, s), 10);
+
+  struct test_case {
+    parquet_predicate predicate;
+    std::vector<bool> pruned;
+  };
+  std::vector<test_case> cases{
+    {{"i64", "<", flex_int(-400000000)}, {false, true, true}},
+    {{"i64", ">=", flex_int(250 * 1000003 - 500000000)}, {true, true, false}},
+    {{"i64", "==", flex_int(150 * 1000003 - 500000000)}, {true, false, true}},
+    {{"f", ">", 100.0}, {true, true, true}},
+    {{"s", "==", "zzz"}, {true, true, true}},
+    {{"s", "!=", "k1"}, {false, false, false}},
+    {{"ts", "<", flex_date_time(1500000100)}, {false, true, true}},
+  };
+  for (const auto& c: cases) {
+    auto filter = gl_sframe_impl::resolve_parquet_predicate(file, c.predicate);
+    for (size_t g = 0; g < file.row_groups().size(); ++g) {
+      bool pruned = file.column_bounds(g, filter.column, min, max) && filter.excludes(min, max);
+      ASSERT_EQ(pruned, c.pruned[g]);
+      // a pruned row group has no matching row
+      std::vector<flexible_type> values;
+      file.read_column(g, filter.column, values);
+      size_t num_matching = 0;
+      for (const auto& value: values) num_matching += filter.matches(value);
+      if (pruned) ASSERT_EQ(num_matching, 0);
+    }
+  }
+}
+
+/**
+ * The legacy statistics of unsigned integers are signed comparisons of
+ * their physical values, and are not used to prune row groups.
+ */
+void test_legacy_unsigned_statistics() {
+  parquet_file file(fixture("parquet_legacy_unsigned.parquet"));
+  int u32 = file.find_column("u32");
+  ASSERT_GE(u32, 0);
+  flexible_type min, max;
+  ASSERT_FALSE(file.column_bounds(0, u32, min, max));
+  auto values = read_all(file, "u32");
+  for (size_t i = 0; i < N; ++i) {
+    ASSERT_EQ(values[i].get<flex_int>(), (flex_int(1) << 31) - 150 + flex_int(i));
+  }
+}
+
+/**
+ * Corrupt pages and column chunks throw instead of being read.
+ */
+void test_corrupt_files() {
+  for (const auto& name: {"parquet_negative_page_size.parquet", "parquet_short_chunk.parquet"}) {
+    parquet_file file(fixture(name));
+    bool thrown = false;
+    try {
+      std::vector<flexible_type> values;
+      for (size_t c = 0; c < file.columns().size(); ++c) file.read_column(0, c, values);
+    } catch (...) {
+      thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+  }
+}
+
+int main() {
+  test_read_fixture("parquet_snappy_v1.parquet", 3, false);
+  test_read_fixture("parquet_none_v2.parquet", 3, false);
+  test_read_fixture("parquet_snappy_v2_plain.parquet", 1, false);
+  test_read_fixture("parquet_int96.parquet", 3, true);
+  test_legacy_timestamp();
+  test_statistics_pruning();
+  test_legacy_unsigned_statistics();
+  test_corrupt_files();
+  return 0;
+}
@@ -0,0 +1,193 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sarray.hpp>
+
+using namespace graphlab;
+
+/**
+ * An aggregator without removal whose result depends on the order of the
+ * values: the values joined by commas. Added values are only joined in
+ * partial_finalize(), and combine() checks both sides were finalized.
+ */
+class sequence: public group_aggregate_value {
+ public:
+  group_aggregate_value* new_instance() const { return new sequence; }
+  void add_element_simple(const flexible_type& flex) {
+    m_pending.push_back(flex.get<flex_int>());
+  }
+  void partial_finalize() {
+    m_value = joined();
+    m_pending.clear();
+  }
+  void combine(const group_aggregate_value& other) {
+    const auto& o = dynamic_cast<const sequence&>(other);
+    ASSERT_TRUE(m_pending.empty() && o.m_pending.empty());
+    if (!m_value.empty() && !o.m_value.empty()) m_value += ",";
+    m_value += o.m_value;
+  }
+  flexible_type emit() const { return joined(); }
+  bool support_type(flex_type_enum type) const { return type == flex_type_enum::INTEGER; }
+  std::string name() const { return "sequence"; }
+  void save(oarchive& oarc) const { oarc << m_value << m_pending; }
+  void load(iarchive& iarc) { iarc >> m_value >> m_pending; }
+
+ private:
+  std::string joined() const {
+    std::string ret = m_value;
+    for (flex_int value: m_pending) {
+      if (!ret.empty()) ret += ",";
+      ret += std::to_string(value);
+    }
+    return ret;
+  }
+
+  std::string m_value;
+  std::vector<flex_int> m_pending;
+};
+
+static std::vector<flexible_type> make_values(size_t n, flex_type_enum type) {
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<flex_int> dist(-1000, 1000);
+  std::vector<flexible_type> values;
+  for (size_t i = 0; i < n; ++i) {
+    if (i % 9 == 4) values.push_back(FLEX_UNDEFINED);
+    else if (type == flex_type_enum::FLOAT) values.push_back(dist(gen) * 0.37 + 1e3);
+    else values.push_back(dist(gen));
+  }
+  return values;
+}
+
+/// The aggregate of values [begin, end) by a fresh aggregator.
+static flexible_type naive(const group_aggregate_value& prototype,
+                           const std::vector<flexible_type>& values,
+                           ssize_t begin, ssize_t end) {
+  std::unique_ptr<group_aggregate_value> agg(prototype.new_instance());
+  for (ssize_t i = std::max<ssize_t>(begin, 0);
+       i < std::min<ssize_t>(end, values.size()); ++i) {
+    if (values[i].get_type() != flex_type_enum::UNDEFINED) agg->add_element_simple(values[i]);
+  }
+  return agg->emit();
+}
+
+/**
+ * Floats are compared to a relative tolerance, of the squares when
+ * "squared" is set: a standard deviation amplifies the rounding error of a
+ * variance near 0.
+ */
+static void check_equal(const flexible_type& actual, const flexible_type& expected,
+                        bool squared = false) {
+  ASSERT_TRUE(actual.get_type() == expected.get_type());
+  if (expected.get_type() == flex_type_enum::FLOAT) {
+    double x = actual.get<flex_float>(), y = expected.get<flex_float>();
+    if (squared) {
+      x *= x;
+      y *= y;
+    }
+    ASSERT_LE(std::fabs(x - y), 1e-6 * std::max(1.0, std::fabs(y)));
+  } else if (expected.get_type() != flex_type_enum::UNDEFINED) {
+    ASSERT_TRUE(actual == expected);
+  }
+}
+
+/**
+ * Slides windows of several widths over a stream and compares each window
+ * with the aggregate of its values.
+ */
+static void check_sliding(group_aggregate_value& prototype, flex_type_enum type) {
+  prototype.set_input_types({type});
+  auto values = make_values(3000, type);
+  bool squared = prototype.name() == "stdv";
+  for (size_t width: {1, 2, 7, 100}) {
+    sliding_window_aggregate window(prototype);
+    for (size_t i = 0; i < values.size(); ++i) {
+      window.push_back(values[i]);
+      if (window.size() > width) window.pop_front();
+      ASSERT_EQ(window.size(), std::min(width, i + 1));
+      check_equal(window.emit(),
+                  naive(prototype, values, ssize_t(i + 1) - ssize_t(width), i + 1), squared);
+    }
+    window.clear();
+    ASSERT_EQ(window.size(), 0);
+    ASSERT_EQ(window.num_non_null(), 0);
+  }
+}
+
+void test_sliding_window_aggregate() {
+  for (auto type: {flex_type_enum::INTEGER, flex_type_enum::FLOAT}) {
+    for (auto name: {"__builtin__sum__", "__builtin__avg__", "__builtin__var__",
+                     "__builtin__stdv__", "__builtin__min__", "__builtin__max__",
+                     "__builtin__count__"}) {
+      auto aggregator = rolling_operators::get_builtin_rolling_aggregator(name);
+      ASSERT_TRUE(aggregator != nullptr);
+      ASSERT_TRUE(dynamic_cast<invertible_aggregate_value*>(aggregator.get()) != nullptr);
+      check_sliding(*aggregator, type);
+    }
+  }
+  ASSERT_TRUE(rolling_operators::get_builtin_rolling_aggregator("__builtin__median__") == nullptr);
+
+  // the two stacks of an aggregator without removal keep the value order
+  sequence seq;
+  group_aggregate_value* base = &seq;
+  ASSERT_TRUE(dynamic_cast<invertible_aggregate_value*>(base) == nullptr);
+  check_sliding(seq, flex_type_enum::INTEGER);
+}
+
+/**
+ * rolling_scan over a sub range of the rows, windows reaching outside the
+ * values, and the min_observations rules.
+ */
+void test_rolling_scan() {
+  auto values = make_values(200, flex_type_enum::INTEGER);
+  rolling_operators::sum sum;
+  sum.set_input_types({flex_type_enum::INTEGER});
+  for (ssize_t window_start: {-5, -2, 0, 3}) {
+    ssize_t window_end = window_start + 4;
+    size_t window_size = window_end - window_start + 1;
+    for (size_t min_observations: {size_t(0), size_t(1), size_t(4), size_t(-1)}) {
+      ssize_t begin = 30, end = 200;
+      ssize_t next = std::max<ssize_t>(0, begin + window_start);
+      std::vector<flexible_type> out;
+      gl_sarray_impl::rolling_scan(begin, end, values.size(), window_start, window_end,
+                                   min_observations, sum,
+                                   [&]() { return values[next++]; },
+                                   [&](const flexible_type& v) { out.push_back(v); });
+      ASSERT_EQ(out.size(), end - begin);
+      for (ssize_t i = begin; i < end; ++i) {
+        size_t non_null = 0;
+        for (ssize_t j = i + window_start; j <= i + window_end; ++j) {
+          if (j >= 0 && j < ssize_t(values.size()) &&
+              values[j].get_type() != flex_type_enum::UNDEFINED) {
+            ++non_null;
+          }
+        }
+        if (gl_sarray_impl::window_has_min_observations(non_null, window_size, min_observations)) {
+          check_equal(out[i - begin], naive(sum, values, i + window_start, i + window_end + 1));
+        } else {
+          ASSERT_TRUE(out[i - begin].get_type() == flex_type_enum::UNDEFINED);
+        }
+      }
+    }
+  }
+  ASSERT_TRUE(gl_sarray_impl::window_has_min_observations(3, 3, size_t(-1)));
+  ASSERT_FALSE(gl_sarray_impl::window_has_min_observations(2, 3, size_t(-1)));
+  ASSERT_TRUE(gl_sarray_impl::window_has_min_observations(0, 3, 0));
+  ASSERT_FALSE(gl_sarray_impl::window_has_min_observations(1, 3, 2));
+}
+
+int main() {
+  test_sliding_window_aggregate();
+  test_rolling_scan();
+  return 0;
+}
@@ -0,0 +1,129 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+#include <graphlab/sdk/gl_sgraph.hpp>
+#include <graphlab/sdk/gl_sgraph_adjacency.hpp>
+
+using namespace graphlab;
+using gl_sgraph_impl::adjacency_index;
+using gl_sgraph_impl::compact_id_array;
+using gl_sgraph_impl::edge_table;
+using gl_sgraph_impl::vertex_table;
+
+/**
+ * The out and in adjacency of a small multigraph with a self loop and an
+ * isolated vertex, against its edge list.
+ */
+void test_adjacency_index() {
+  const size_t nvertices = 6;
+  std::vector<size_t> source{0, 2, 0, 3, 2, 4, 0, 3};
+  std::vector<size_t> target{1, 1, 2, 3, 0, 2, 1, 0};
+  adjacency_index out, in;
+  ASSERT_TRUE(out.empty());
+  out.build(nvertices, source, target);
+  in.build(nvertices, target, source);
+  ASSERT_FALSE(out.empty());
+  ASSERT_EQ(out.offsets.size(), nvertices + 1);
+  ASSERT_EQ(out.offsets.back(), source.size());
+
+  for (size_t v = 0; v < nvertices; ++v) {
+    std::vector<std::pair<size_t, size_t> > expected_out, expected_in, actual_out, actual_in;
+    for (size_t eid = 0; eid < source.size(); ++eid) {
+      if (source[eid] == v) expected_out.push_back({target[eid], eid});
+      if (target[eid] == v) expected_in.push_back({source[eid], eid});
+    }
+    for (size_t i = out.offsets[v]; i < out.offsets[v + 1]; ++i) {
+      actual_out.push_back({out.neighbors[i], out.edge_ids[i]});
+    }
+    for (size_t i = in.offsets[v]; i < in.offsets[v + 1]; ++i) {
+      actual_in.push_back({in.neighbors[i], in.edge_ids[i]});
+    }
+    // the counting sort keeps the edges of a vertex in edge id order
+    ASSERT_TRUE(actual_out == expected_out);
+    ASSERT_TRUE(actual_in == expected_in);
+  }
+  ASSERT_EQ(out.offsets[5], out.offsets[6]);
+  ASSERT_EQ(out.neighbors.value_size(), sizeof(uint32_t));
+  ASSERT_EQ(out.edge_ids.value_size(), sizeof(uint32_t));
+  ASSERT_EQ(adjacency_index::estimate_memory(nvertices, source.size()),
+            (nvertices + 1) * sizeof(size_t) + 2 * source.size() * sizeof(uint32_t));
+}
+
+/**
+ * Ids take 32 bits up to 2^32 - 1, and 64 bits above.
+ */
+void test_compact_id_array() {
+  const size_t narrow_max = std::numeric_limits<uint32_t>::max();
+  compact_id_array ids;
+  ids.assign(3, narrow_max);
+  ASSERT_EQ(ids.size(), 3);
+  ASSERT_EQ(ids.value_size(), sizeof(uint32_t));
+  ids.set(1, narrow_max);
+  ASSERT_EQ(ids[0], 0);
+  ASSERT_EQ(ids[1], narrow_max);
+
+  ids.assign(2, narrow_max + 1);
+  ASSERT_EQ(ids.value_size(), sizeof(uint64_t));
+  ids.set(0, narrow_max + 1);
+  ids.set(1, size_t(1) << 40);
+  ASSERT_EQ(ids[0], narrow_max + 1);
+  ASSERT_EQ(ids[1], size_t(1) << 40);
+  ASSERT_EQ(compact_id_array::value_size(narrow_max), sizeof(uint32_t));
+  ASSERT_EQ(compact_id_array::value_size(narrow_max + 1), sizeof(uint64_t));
+}
+
+/**
+ * The edge table holds the endpoints and fields of each edge at the
+ * position of its row in the edge data.
+ */
+void test_edge_table() {
+  std::vector<flexible_type> ids, source, target, weight;
+  for (flex_int v = 0; v < 5; ++v) ids.push_back(v * 10);
+  for (flex_int i = 0; i < 1000; ++i) {
+    source.push_back((i % 5) * 10);
+    target.push_back(((i * 3 + 1) % 5) * 10);
+    weight.push_back(flex_float(i));
+  }
+  gl_sgraph g(gl_sframe({{"__id", ids}}),
+              gl_sframe({{"__src_id", source}, {"__dst_id", target}, {"weight", weight}}));
+  vertex_table vertices(g.get_vertices(), {});
+  edge_table edges(g.get_edges(), vertices, {"weight"});
+  ASSERT_EQ(edges.num_edges(), g.num_edges());
+  ASSERT_EQ(edges.source.value_size(), sizeof(uint32_t));
+  size_t eid = 0;
+  for (const auto& row: g.get_edges()[{"__src_id", "__dst_id", "weight"}].range_iterator()) {
+    ASSERT_TRUE(vertices.ids()[edges.source[eid]] == row[0]);
+    ASSERT_TRUE(vertices.ids()[edges.target[eid]] == row[1]);
+    ASSERT_TRUE(edges.row(eid)[0] == row[2]);
+    ++eid;
+  }
+  ASSERT_EQ(eid, edges.num_edges());
+}
+
+void test_edge_directions() {
+  ASSERT_TRUE(gl_sgraph_impl::has_in_edges(edge_dir_enum::IN_EDGES));
+  ASSERT_TRUE(gl_sgraph_impl::has_in_edges(edge_dir_enum::ALL_EDGES));
+  ASSERT_FALSE(gl_sgraph_impl::has_in_edges(edge_dir_enum::OUT_EDGES));
+  ASSERT_TRUE(gl_sgraph_impl::has_out_edges(edge_dir_enum::OUT_EDGES));
+  ASSERT_FALSE(gl_sgraph_impl::has_out_edges(edge_dir_enum::NO_EDGES));
+}
+
+int main() {
+  test_adjacency_index();
+  test_compact_id_array();
+  test_edge_table();
+  test_edge_directions();
+  return 0;
+}
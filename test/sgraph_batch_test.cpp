@@ -0,0 +1,185 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+#include <graphlab/sdk/gl_sgraph.hpp>
+#include <graphlab/sgraph/sgraph_constants.hpp>
+
+using namespace graphlab;
+
+static const flex_int NUM_VERTICES = 20;
+static const flex_int BIG = flex_int(1) << 60;
+
+/**
+ * Vertex v has edges to v + 2 and 7v + 3 (mod 20), with a weight of
+ * v + 1 on the first and 0.5 on the second. "prev" is 0.1 (v + 1), and
+ * "count" is 2^60 + v, which a double cannot hold.
+ */
+static gl_sgraph make_graph() {
+  std::vector<flexible_type> ids, pr, prev, count, source, target, weight, visits;
+  for (flex_int v = 0; v < NUM_VERTICES; ++v) {
+    ids.push_back(v);
+    pr.push_back(flex_float(0));
+    prev.push_back(0.1 * (v + 1));
+    count.push_back(BIG + v);
+    source.push_back(v);
+    target.push_back((v + 2) % NUM_VERTICES);
+    weight.push_back(flex_float(v + 1));
+    source.push_back(v);
+    target.push_back((7 * v + 3) % NUM_VERTICES);
+    weight.push_back(0.5);
+  }
+  visits.assign(source.size(), flex_int(0));
+  gl_sframe vertices({{"__id", ids}, {"pr", pr}, {"prev", prev}, {"count", count}});
+  gl_sframe edges({{"__src_id", source}, {"__dst_id", target},
+                   {"weight", weight}, {"visits", visits}});
+  return gl_sgraph(vertices, edges);
+}
+
+/// A vertex field by vertex id.
+static std::map<flex_int, flexible_type> vertex_values(const gl_sgraph& g,
+                                                       const std::string& field) {
+  std::map<flex_int, flexible_type> values;
+  for (const auto& row: g.get_vertices()[{"__id", field}].range_iterator()) {
+    values[row[0].get<flex_int>()] = row[1];
+  }
+  return values;
+}
+
+/// An edge field by (source, target).
+static std::map<std::pair<flex_int, flex_int>, flexible_type>
+edge_values(const gl_sgraph& g, const std::string& field) {
+  std::map<std::pair<flex_int, flex_int>, flexible_type> values;
+  for (const auto& row: g.get_edges()[{"__src_id", "__dst_id", field}].range_iterator()) {
+    values[{row[0].get<flex_int>(), row[1].get<flex_int>()}] = row[2];
+  }
+  return values;
+}
+
+/**
+ * A batch is renumbered over the vertices it references.
+ */
+void test_renumber_batch_vertices() {
+  std::vector<size_t> source{900000, 7, 42, 7}, target{42, 900000, 3, 3};
+  std::vector<size_t> original_source = source, original_target = target;
+  std::vector<size_t> vertices;
+  gl_sgraph_impl::renumber_batch_vertices(source, target, vertices);
+  ASSERT_TRUE(vertices == std::vector<size_t>({3, 7, 42, 900000}));
+  for (size_t i = 0; i < source.size(); ++i) {
+    ASSERT_EQ(vertices[source[i]], original_source[i]);
+    ASSERT_EQ(vertices[target[i]], original_target[i]);
+  }
+}
+
+/**
+ * Missing values are NaN in the batch, and missing again when written back
+ * as NaN. Integer fields get integers back without a round trip through
+ * double.
+ */
+void test_numeric_result() {
+  using gl_sgraph_impl::numeric_result;
+  using gl_sgraph_impl::accumulated_result;
+  const flex_type_enum INTEGER = flex_type_enum::INTEGER, FLOAT = flex_type_enum::FLOAT;
+  double missing = gl_sgraph_impl::numeric_value(FLEX_UNDEFINED);
+  ASSERT_TRUE(std::isnan(missing));
+  ASSERT_TRUE(numeric_result(missing + 1.0, FLOAT, FLEX_UNDEFINED).get_type() ==
+              flex_type_enum::UNDEFINED);
+  // a missing value the lambda overwrote is kept
+  ASSERT_EQ(numeric_result(2.5, FLOAT, FLEX_UNDEFINED).get<flex_float>(), 2.5);
+  // a NaN which was a value stays a value
+  flexible_type nan = numeric_result(std::nan(""), FLOAT, 1.0);
+  ASSERT_TRUE(nan.get_type() == flex_type_enum::FLOAT);
+  ASSERT_TRUE(std::isnan(nan.get<flex_float>()));
+
+  // integers are written back as integers, and unchanged ones exactly
+  flex_int big = (flex_int(1) << 60) + 1;
+  flexible_type same = numeric_result(double(big), INTEGER, big);
+  ASSERT_TRUE(same.get_type() == flex_type_enum::INTEGER);
+  ASSERT_EQ(same.get<flex_int>(), big);
+  flexible_type changed = numeric_result(6.0, INTEGER, flex_int(5));
+  ASSERT_TRUE(changed.get_type() == flex_type_enum::INTEGER);
+  ASSERT_EQ(changed.get<flex_int>(), 6);
+  ASSERT_TRUE(numeric_result(std::nan(""), INTEGER, flex_int(5)).get_type() ==
+              flex_type_enum::UNDEFINED);
+
+  // accumulators are added to the original integer
+  flexible_type sum = accumulated_result(big, INTEGER, 2.0);
+  ASSERT_TRUE(sum.get_type() == flex_type_enum::INTEGER);
+  ASSERT_EQ(sum.get<flex_int>(), big + 2);
+  ASSERT_EQ(accumulated_result(1.5, FLOAT, 2.0).get<flex_float>(), 3.5);
+  ASSERT_TRUE(accumulated_result(FLEX_UNDEFINED, INTEGER, 2.0).get_type() ==
+              flex_type_enum::UNDEFINED);
+}
+
+/**
+ * The block mode triple apply, over batches smaller than the graph, updates
+ * the vertices and edges as the triple apply over maps does. Integer
+ * vertex fields above 2^53 are incremented exactly.
+ */
+void test_batch_triple_apply() {
+  gl_sgraph g = make_graph();
+  auto untyped = [](edge_triple& triple) {
+    triple.target["pr"] += triple.source["prev"] * triple.edge["weight"];
+    triple.target["count"] += 1;
+    triple.edge["visits"] += 1;
+  };
+  enum { PR = 0, PREV = 1, COUNT = 2 };
+  enum { WEIGHT = 0, VISITS = 1 };
+  auto batched = [](edge_triple_batch& batch) {
+    const double* prev = batch.vertex_field(PREV);
+    const double* weight = batch.edge_field(WEIGHT);
+    double* visits = batch.edge_field(VISITS);
+    double* pr = batch.vertex_accumulator(PR);
+    double* count = batch.vertex_accumulator(COUNT);
+    for (size_t i = 0; i < batch.num_edges; ++i) {
+      pr[batch.target[i]] += prev[batch.source[i]] * weight[i];
+      count[batch.target[i]] += 1;
+      visits[i] += 1;
+    }
+  };
+  SGRAPH_TRIPLE_APPLY_EDGE_BATCH_SIZE = 7;
+  gl_sgraph expected = g.triple_apply(untyped, {"pr", "count", "visits"});
+  gl_sgraph actual = g.batch_triple_apply(batched, {"pr", "count", "visits"},
+                                          {"pr", "prev", "count"}, {"weight", "visits"});
+  ASSERT_EQ(actual.num_vertices(), expected.num_vertices());
+  ASSERT_EQ(actual.num_edges(), expected.num_edges());
+
+  auto expected_pr = vertex_values(expected, "pr");
+  auto actual_pr = vertex_values(actual, "pr");
+  ASSERT_EQ(actual_pr.size(), (size_t)NUM_VERTICES);
+  for (const auto& value: expected_pr) {
+    ASSERT_LT(std::fabs(actual_pr[value.first].get<flex_float>() -
+                        value.second.get<flex_float>()), 1e-9);
+  }
+  auto count = vertex_values(actual, "count");
+  ASSERT_TRUE(count == vertex_values(expected, "count"));
+  for (const auto& value: count) {
+    ASSERT_TRUE(value.second.get_type() == flex_type_enum::INTEGER);
+    ASSERT_GE(value.second.get<flex_int>(), BIG + value.first);
+  }
+  auto visits = edge_values(actual, "visits");
+  ASSERT_TRUE(visits == edge_values(expected, "visits"));
+  for (const auto& value: visits) {
+    ASSERT_TRUE(value.second.get_type() == flex_type_enum::INTEGER);
+    ASSERT_EQ(value.second.get<flex_int>(), 1);
+  }
+  ASSERT_TRUE(vertex_values(actual, "prev") == vertex_values(g, "prev"));
+}
+
+int main() {
+  test_renumber_batch_vertices();
+  test_numeric_result();
+  test_batch_triple_apply();
+  return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sarray.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+#include <graphlab/sdk/gl_sgraph.hpp>
+#include <graphlab/sdk/gl_sgraph_engine.hpp>
+
+using namespace graphlab;
+
+static const flex_int NUM_VERTICES = 20;
+
+/**
+ * Vertex v has edges to v + 2 and 7v + 3 (mod 20). "pr" is 0.1 (v + 1),
+ * and "out_degree" and "acc" are 0.
+ */
+static gl_sgraph make_graph() {
+  std::vector<flexible_type> ids, pr, source, target;
+  for (flex_int v = 0; v < NUM_VERTICES; ++v) {
+    ids.push_back(v);
+    pr.push_back(0.1 * (v + 1));
+    source.push_back(v);
+    target.push_back((v + 2) % NUM_VERTICES);
+    source.push_back(v);
+    target.push_back((7 * v + 3) % NUM_VERTICES);
+  }
+  gl_sframe vertices({{"__id", ids}, {"pr", pr}});
+  vertices.add_column(flex_int(0), "out_degree");
+  vertices.add_column(flex_float(0), "acc");
+  gl_sframe edges({{"__src_id", source}, {"__dst_id", target}});
+  return gl_sgraph(vertices, edges);
+}
+
+/// A vertex field by vertex id.
+static std::map<flex_int, flexible_type> vertex_values(const gl_sgraph& g,
+                                                       const std::string& field) {
+  std::map<flex_int, flexible_type> values;
+  for (const auto& row: g.get_vertices()[{"__id", field}].range_iterator()) {
+    values[row[0].get<flex_int>()] = row[1];
+  }
+  return values;
+}
+
+enum { PAGERANK = 0, OUT_DEGREE = 1 };
+
+/// The pagerank program of the gl_sgraph_engine documentation.
+static gas_vertex_program pagerank_program(double tolerance) {
+  gas_vertex_program pr;
+  pr.gather_edges = gas_edge_dir_enum::IN_EDGES;
+  pr.gather = [](const flexible_type*, const flexible_type*,
+                 const flexible_type* src) -> flexible_type {
+    return src[PAGERANK].get<flex_float>() / src[OUT_DEGREE].get<flex_int>();
+  };
+  pr.apply = [tolerance](flexible_type* v, const flexible_type& total) {
+    double sum = total.get_type() == flex_type_enum::UNDEFINED ? 0.0 : (double)total;
+    double newval = 0.15 + 0.85 * sum;
+    bool changed = std::fabs(newval - v[PAGERANK].get<flex_float>()) > tolerance;
+    v[PAGERANK] = newval;
+    return changed;
+  };
+  pr.scatter_edges = gas_edge_dir_enum::OUT_EDGES;
+  return pr;
+}
+
+/// The out degree of each vertex, counted by the triple apply over maps.
+static gl_sgraph with_out_degree(const gl_sgraph& g) {
+  return g.triple_apply([](edge_triple& triple) { triple.source["out_degree"] += 1; },
+                        {"out_degree"});
+}
+
+/**
+ * Iterations of the engine match the same pagerank iterations run with the
+ * triple apply over maps, one graph per iteration.
+ */
+void test_engine_pagerank() {
+  const size_t niterations = 5;
+  gl_sgraph g = with_out_degree(make_graph());
+
+  gl_sgraph expected = g;
+  for (size_t iter = 0; iter < niterations; ++iter) {
+    gl_sgraph summed = expected.triple_apply([](edge_triple& triple) {
+      triple.target["acc"] += triple.source["pr"] / triple.source["out_degree"];
+    }, {"acc"});
+    gl_sframe vertices = summed.get_vertices();
+    vertices.replace_add_column(vertices["acc"] * 0.85 + 0.15, "pr");
+    vertices.replace_add_column(gl_sarray::from_const(flex_float(0), vertices.size()), "acc");
+    expected = gl_sgraph(vertices, summed.get_edges());
+  }
+
+  // a tolerance of -1 keeps every vertex active
+  gl_sgraph_engine engine(g, {"pr", "out_degree"});
+  ASSERT_EQ(engine.num_vertices(), (size_t)NUM_VERTICES);
+  ASSERT_EQ(engine.num_active_vertices(), (size_t)NUM_VERTICES);
+  ASSERT_EQ(engine.run(pagerank_program(-1), niterations), niterations);
+  ASSERT_EQ(engine.num_iterations(), niterations);
+  ASSERT_FALSE(engine.converged());
+
+  gl_sgraph actual = engine.result({"pr"});
+  ASSERT_EQ(actual.num_vertices(), expected.num_vertices());
+  ASSERT_EQ(actual.num_edges(), expected.num_edges());
+  auto expected_pr = vertex_values(expected, "pr");
+  auto actual_pr = vertex_values(actual, "pr");
+  ASSERT_EQ(actual_pr.size(), (size_t)NUM_VERTICES);
+  for (const auto& value: expected_pr) {
+    ASSERT_LT(std::fabs(actual_pr[value.first].get<flex_float>() -
+                        value.second.get<flex_float>()), 1e-9);
+    ASSERT_LT(std::fabs(engine.get_vertex_field(value.first, "pr").get<flex_float>() -
+                        value.second.get<flex_float>()), 1e-9);
+  }
+  // fields which are not written out are unchanged
+  ASSERT_TRUE(vertex_values(actual, "out_degree") == vertex_values(g, "out_degree"));
+}
+
+/**
+ * Every vertex has an in degree of 2 and an out degree of 2, so pagerank
+ * converges to 1. Vertices which do not change stop being scheduled.
+ */
+void test_engine_convergence() {
+  gl_sgraph g = with_out_degree(make_graph());
+  gl_sgraph_engine engine(g, {"pr", "out_degree"});
+  size_t niterations = engine.run(pagerank_program(1e-9), 1000);
+  ASSERT_LT(niterations, 1000);
+  ASSERT_TRUE(engine.converged());
+  ASSERT_EQ(engine.num_active_vertices(), 0);
+  for (const auto& value: vertex_values(engine.result(), "pr")) {
+    ASSERT_LT(std::fabs(value.second.get<flex_float>() - 1.0), 1e-6);
+  }
+
+  // a signaled vertex at the fixed point is updated once, and schedules
+  // no neighbor
+  engine.signal(flex_int(4));
+  ASSERT_EQ(engine.num_active_vertices(), 1);
+  ASSERT_EQ(engine.run(pagerank_program(1e-3), 50), 1);
+  ASSERT_TRUE(engine.converged());
+  ASSERT_EQ(engine.num_iterations(), niterations + 1);
+}
+
+int main() {
+  test_engine_pagerank();
+  test_engine_convergence();
+  return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+#include <graphlab/sdk/gl_sgraph.hpp>
+
+using namespace graphlab;
+using gl_sgraph_impl::value_distance;
+
+static const flex_int NUM_VERTICES = 50;
+
+/**
+ * Vertex v has edges to v + 1 and v + 7 (mod 50), with a weight of v + 1 on
+ * the first and 0.5 on the second. "vid" is v, "pr" is 0, and "prev" is 1
+ * for the multiples of 3 and 0 otherwise.
+ */
+static gl_sgraph make_graph() {
+  std::vector<flexible_type> ids, pr, prev, source, target, weight, visits;
+  for (flex_int v = 0; v < NUM_VERTICES; ++v) {
+    ids.push_back(v);
+    pr.push_back(flex_float(0));
+    prev.push_back(flex_float(v % 3 == 0 ? 1 : 0));
+    source.push_back(v);
+    target.push_back((v + 1) % NUM_VERTICES);
+    weight.push_back(flex_float(v + 1));
+    source.push_back(v);
+    target.push_back((v + 7) % NUM_VERTICES);
+    weight.push_back(0.5);
+  }
+  visits.assign(source.size(), flex_int(0));
+  gl_sframe vertices({{"__id", ids}, {"vid", ids}, {"pr", pr}, {"prev", prev}});
+  gl_sframe edges({{"__src_id", source}, {"__dst_id", target},
+                   {"weight", weight}, {"visits", visits}});
+  return gl_sgraph(vertices, edges);
+}
+
+/// A vertex field by vertex id.
+static std::map<flex_int, flexible_type> vertex_values(const gl_sgraph& g,
+                                                       const std::string& field) {
+  std::map<flex_int, flexible_type> values;
+  for (const auto& row: g.get_vertices()[{"__id", field}].range_iterator()) {
+    values[row[0].get<flex_int>()] = row[1];
+  }
+  return values;
+}
+
+/// An edge field by (source, target).
+static std::map<std::pair<flex_int, flex_int>, flexible_type>
+edge_values(const gl_sgraph& g, const std::string& field) {
+  std::map<std::pair<flex_int, flex_int>, flexible_type> values;
+  for (const auto& row: g.get_edges()[{"__src_id", "__dst_id", field}].range_iterator()) {
+    values[{row[0].get<flex_int>(), row[1].get<flex_int>()}] = row[2];
+  }
+  return values;
+}
+
+/**
+ * Runs a frontier triple apply adding weight * (source vid + 1) into the
+ * target "pr" (and counting the visits of each edge when mutate_edges is
+ * set), and checks it against the triple apply over maps restricted to the
+ * edges of the frontier by is_active and edges.
+ */
+static void check_frontier_triple_apply(const triple_apply_frontier& frontier,
+                                        const std::function<bool(flex_int)>& is_active,
+                                        frontier_edges_enum edges, bool mutate_edges) {
+  gl_sgraph g = make_graph();
+  auto untyped = [&](edge_triple& triple) {
+    bool source = is_active(triple.source["vid"].get<flex_int>());
+    bool target = is_active(triple.target["vid"].get<flex_int>());
+    bool visited = edges == frontier_edges_enum::SOURCE ? source
+                   : edges == frontier_edges_enum::TARGET ? target
+                   : source || target;
+    if (!visited) return;
+    triple.target["pr"] += (triple.source["vid"] + 1) * triple.edge["weight"];
+    if (mutate_edges) triple.edge["visits"] += 1;
+  };
+  enum { VID = 0, PR = 1 };
+  enum { WEIGHT = 0, VISITS = 1 };
+  auto typed = [&](typed_edge_triple& triple) {
+    triple.target_as<flex_float>(PR) +=
+        (triple.source_as<flex_int>(VID) + 1) * triple.edge_as<flex_float>(WEIGHT);
+    if (mutate_edges) triple.edge_as<flex_int>(VISITS) += 1;
+  };
+  std::vector<std::string> mutated{"pr"};
+  if (mutate_edges) mutated.push_back("visits");
+  gl_sgraph expected = g.triple_apply(untyped, mutated);
+  gl_sgraph actual = g.frontier_triple_apply(typed, mutated, {"vid", "pr"},
+                                             {"weight", "visits"}, frontier);
+  ASSERT_EQ(actual.num_vertices(), expected.num_vertices());
+  ASSERT_EQ(actual.num_edges(), expected.num_edges());
+  // all the values are exact in double
+  ASSERT_TRUE(vertex_values(actual, "pr") == vertex_values(expected, "pr"));
+  ASSERT_TRUE(vertex_values(actual, "prev") == vertex_values(g, "prev"));
+  ASSERT_TRUE(edge_values(actual, "visits") == edge_values(expected, "visits"));
+  ASSERT_TRUE(edge_values(actual, "weight") == edge_values(g, "weight"));
+}
+
+/**
+ * The distance a delta frontier compares to epsilon.
+ */
+void test_value_distance() {
+  ASSERT_EQ(value_distance(flex_int(3), flex_float(0.5)), 2.5);
+  ASSERT_EQ(value_distance(flex_vec{1, 2, 3}, flex_vec{1, 5, 2.5}), 3.0);
+  ASSERT_EQ(value_distance(FLEX_UNDEFINED, FLEX_UNDEFINED), 0.0);
+  ASSERT_TRUE(std::isinf(value_distance(FLEX_UNDEFINED, flex_int(1))));
+  ASSERT_TRUE(std::isinf(value_distance(flex_vec{1}, flex_vec{1, 2})));
+}
+
+/**
+ * The two ways of building a frontier.
+ */
+void test_frontier_construction() {
+  auto listed = triple_apply_frontier::vertices({flex_int(1), "a"}, frontier_edges_enum::SOURCE);
+  ASSERT_FALSE(listed.is_delta());
+  ASSERT_EQ(listed.active_vertices.size(), 2);
+  ASSERT_TRUE(listed.edges == frontier_edges_enum::SOURCE);
+
+  auto changed = triple_apply_frontier::changed("pagerank", "pagerank_prev", 1e-3);
+  ASSERT_TRUE(changed.is_delta());
+  ASSERT_EQ(changed.epsilon, 1e-3);
+  ASSERT_TRUE(changed.edges == frontier_edges_enum::ANY);
+  ASSERT_TRUE(changed.active_vertices.empty());
+}
+
+/**
+ * A frontier of a few listed vertices, whose edges are fetched by vertex id
+ * queries unless edges are mutated, visits the edges selected by each
+ * frontier_edges_enum exactly once.
+ */
+void test_listed_frontier_triple_apply() {
+  // 3 -> 4 and 3 -> 10 join two active vertices
+  auto is_active = [](flex_int v) { return v == 3 || v == 4 || v == 10; };
+  for (auto edges: {frontier_edges_enum::SOURCE, frontier_edges_enum::TARGET,
+                    frontier_edges_enum::ANY}) {
+    auto frontier = triple_apply_frontier::vertices({flex_int(3), flex_int(4), flex_int(10)},
+                                                    edges);
+    check_frontier_triple_apply(frontier, is_active, edges, false);
+    check_frontier_triple_apply(frontier, is_active, edges, true);
+  }
+}
+
+/**
+ * A delta frontier over a third of the vertices scans the edges.
+ */
+void test_delta_frontier_triple_apply() {
+  auto is_active = [](flex_int v) { return v % 3 == 0; };
+  for (auto edges: {frontier_edges_enum::TARGET, frontier_edges_enum::ANY}) {
+    auto frontier = triple_apply_frontier::changed("pr", "prev", 0.5, edges);
+    check_frontier_triple_apply(frontier, is_active, edges, false);
+    check_frontier_triple_apply(frontier, is_active, edges, true);
+  }
+}
+
+int main() {
+  test_value_distance();
+  test_frontier_construction();
+  test_listed_frontier_triple_apply();
+  test_delta_frontier_triple_apply();
+  return 0;
+}
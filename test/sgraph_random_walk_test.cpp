@@ -0,0 +1,195 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+#include <graphlab/sdk/gl_sgraph.hpp>
+#include <graphlab/sdk/gl_sgraph_random_walk.hpp>
+
+using namespace graphlab;
+
+// a cycle 0 -> 1 -> 2 -> 0 with a tail 2 -> 3 -> 4 -> 5, and 6 isolated
+static const std::vector<flex_int> SOURCE{0, 1, 2, 2, 3, 4};
+static const std::vector<flex_int> TARGET{1, 2, 0, 3, 4, 5};
+// the edge 4 -> 5 has a zero weight
+static const std::vector<flex_float> WEIGHT{1.0, 2.0, 1.0, 3.0, 1.0, 0.0};
+
+static gl_sgraph make_graph() {
+  std::vector<flexible_type> ids, source, target, weight;
+  for (flex_int v = 0; v < 7; ++v) ids.push_back(v);
+  for (size_t i = 0; i < SOURCE.size(); ++i) {
+    source.push_back(SOURCE[i]);
+    target.push_back(TARGET[i]);
+    weight.push_back(WEIGHT[i]);
+  }
+  gl_sframe vertices({{"__id", ids}});
+  gl_sframe edges({{"__src_id", source}, {"__dst_id", target}, {"weight", weight}});
+  return gl_sgraph(vertices, edges);
+}
+
+/// The out edges with a weight above min_weight, as (source, target) pairs.
+static std::set<std::pair<flex_int, flex_int> > out_edges(double min_weight) {
+  std::set<std::pair<flex_int, flex_int> > edges;
+  for (size_t i = 0; i < SOURCE.size(); ++i) {
+    if (WEIGHT[i] > min_weight) edges.insert({SOURCE[i], TARGET[i]});
+  }
+  return edges;
+}
+
+static std::vector<flex_list> to_lists(const gl_sarray& sa) {
+  std::vector<flex_list> lists;
+  for (const auto& value: sa.range_iterator()) lists.push_back(value.get<flex_list>());
+  return lists;
+}
+
+/**
+ * Checks each vertex starts walks_per_vertex walks, and each walk follows
+ * edges and stops short only at a vertex the walk cannot leave.
+ */
+static void check_walks(const std::vector<flex_list>& walks, size_t walk_length,
+                        size_t walks_per_vertex, double min_weight) {
+  auto edges = out_edges(min_weight);
+  std::set<flex_int> dead_ends{5, 6};
+  if (min_weight >= 0) dead_ends.insert(4);
+  ASSERT_EQ(walks.size(), 7 * walks_per_vertex);
+  std::map<flex_int, size_t> starts;
+  for (const flex_list& walk: walks) {
+    ASSERT_GE(walk.size(), 1);
+    ASSERT_LE(walk.size(), walk_length);
+    ++starts[walk[0].get<flex_int>()];
+    for (size_t i = 1; i < walk.size(); ++i) {
+      ASSERT_TRUE(edges.count({walk[i - 1].get<flex_int>(), walk[i].get<flex_int>()}) == 1);
+    }
+    if (walk.size() < walk_length) {
+      ASSERT_TRUE(dead_ends.count(walk.back().get<flex_int>()) == 1);
+    }
+  }
+  ASSERT_EQ(starts.size(), 7);
+  for (const auto& start: starts) ASSERT_EQ(start.second, walks_per_vertex);
+}
+
+void test_uniform_walks() {
+  gl_sgraph_random_walker walker(make_graph());
+  ASSERT_EQ(walker.num_vertices(), 7);
+  auto walks = to_lists(walker.random_walks(10, 3, 1.0, 1.0, 17));
+  check_walks(walks, 10, 3, -1);
+  // the same seed gives the same walks
+  ASSERT_TRUE(to_lists(walker.random_walks(10, 3, 1.0, 1.0, 17)) == walks);
+}
+
+/**
+ * Weighted walks never take the zero weight edge, and follow the weights:
+ * from 2, the edge to 3 has three times the weight of the edge to 0.
+ */
+void test_weighted_walks() {
+  gl_sgraph_random_walker walker(make_graph(), "weight");
+  auto walks = to_lists(walker.random_walks(2, 2000, 1.0, 1.0, 3));
+  check_walks(walks, 2, 2000, 0);
+  size_t to_zero = 0, to_three = 0;
+  for (const flex_list& walk: walks) {
+    if (walk[0].get<flex_int>() != 2) continue;
+    if (walk[1].get<flex_int>() == 0) ++to_zero;
+    else ++to_three;
+  }
+  ASSERT_EQ(to_zero + to_three, 2000);
+  ASSERT_GT(to_three, 2 * to_zero);
+  ASSERT_LT(to_three, 4 * to_zero);
+}
+
+/**
+ * node2vec walks are still walks on the graph; on the undirected cycle a
+ * tiny return parameter makes a walk mostly go back where it came from.
+ */
+void test_node2vec_walks() {
+  gl_sgraph_random_walker directed(make_graph());
+  check_walks(to_lists(directed.random_walks(8, 5, 0.5, 2.0, 5)), 8, 5, -1);
+
+  gl_sgraph_random_walker undirected(make_graph(), "", edge_dir_enum::ALL_EDGES);
+  auto walks = to_lists(undirected.random_walks(3, 200, 0.01, 1.0, 9));
+  size_t returns = 0, total = 0;
+  for (const auto& walk: walks) {
+    if (walk.size() == 3) {
+      ++total;
+      if (walk[2] == walk[0]) ++returns;
+    }
+  }
+  ASSERT_GT(total, 0);
+  ASSERT_GT(returns * 10, total * 9);
+}
+
+void test_sample_neighbors() {
+  gl_sgraph_random_walker walker(make_graph(), "", edge_dir_enum::ALL_EDGES);
+  std::map<flex_int, std::set<flex_int> > neighbors;
+  for (size_t i = 0; i < SOURCE.size(); ++i) {
+    neighbors[SOURCE[i]].insert(TARGET[i]);
+    neighbors[TARGET[i]].insert(SOURCE[i]);
+  }
+  gl_sarray vertices({2, 6, 0, 2}, flex_type_enum::INTEGER);
+  auto samples = to_lists(walker.sample_neighbors(vertices, 2));
+  ASSERT_EQ(samples.size(), 4);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    flex_int v = vertices[i].get<flex_int>();
+    std::set<flex_int> distinct;
+    for (const auto& x: samples[i]) {
+      ASSERT_TRUE(neighbors[v].count(x.get<flex_int>()) == 1);
+      distinct.insert(x.get<flex_int>());
+    }
+    ASSERT_EQ(distinct.size(), samples[i].size());
+    ASSERT_EQ(samples[i].size(), std::min<size_t>(2, neighbors[v].size()));
+  }
+
+  samples = to_lists(walker.sample_neighbors(vertices, 5, true));
+  ASSERT_EQ(samples[0].size(), 5);
+  ASSERT_EQ(samples[1].size(), 0);
+
+  bool thrown = false;
+  try {
+    walker.sample_neighbors(gl_sarray({42}, flex_type_enum::INTEGER), 2);
+  } catch (...) {
+    thrown = true;
+  }
+  ASSERT_TRUE(thrown);
+}
+
+/**
+ * The memory budget covers the merged neighbor lists and alias tables of
+ * the walker, besides the adjacency.
+ */
+void test_memory_budget() {
+  gl_sgraph g = make_graph();
+  size_t adjacency = gl_sgraph_adjacency::estimate_memory(7, SOURCE.size(), 1,
+                                                          edge_dir_enum::ALL_EDGES);
+  size_t walker = gl_sgraph_random_walker::estimate_memory(7, SOURCE.size(),
+                                                           edge_dir_enum::ALL_EDGES, true);
+  ASSERT_GT(walker, gl_sgraph_random_walker::estimate_memory(7, SOURCE.size(),
+                                                             edge_dir_enum::OUT_EDGES, false));
+  bool thrown = false;
+  try {
+    gl_sgraph_random_walker w(g, "weight", edge_dir_enum::ALL_EDGES, adjacency + walker - 1);
+  } catch (...) {
+    thrown = true;
+  }
+  ASSERT_TRUE(thrown);
+  gl_sgraph_random_walker w(g, "weight", edge_dir_enum::ALL_EDGES, adjacency + walker);
+  ASSERT_EQ(w.num_vertices(), 7);
+}
+
+int main() {
+  test_uniform_walks();
+  test_weighted_walks();
+  test_node2vec_walks();
+  test_sample_neighbors();
+  test_memory_budget();
+  return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+#include <graphlab/sdk/gl_sgraph.hpp>
+
+using namespace graphlab;
+using gl_sgraph_impl::atomic_reduce;
+
+static const flex_int NUM_VERTICES = 20;
+
+/**
+ * Vertex v has edges to v + 2 and 7v + 3 (mod 20), with a weight of
+ * v + 1 on the first and 0.5 on the second. "base" is 0.1 (v + 1), and the
+ * reduced fields start at degree 0, dist 100, max_weight 0 and
+ * sums [0, 0].
+ */
+static gl_sgraph make_graph() {
+  std::vector<flexible_type> ids, base, degree, dist, max_weight, sums;
+  std::vector<flexible_type> source, target, weight;
+  for (flex_int v = 0; v < NUM_VERTICES; ++v) {
+    ids.push_back(v);
+    base.push_back(0.1 * (v + 1));
+    degree.push_back(flex_int(0));
+    dist.push_back(flex_float(100));
+    max_weight.push_back(flex_float(0));
+    sums.push_back(flex_vec{0, 0});
+    source.push_back(v);
+    target.push_back((v + 2) % NUM_VERTICES);
+    weight.push_back(flex_float(v + 1));
+    source.push_back(v);
+    target.push_back((7 * v + 3) % NUM_VERTICES);
+    weight.push_back(0.5);
+  }
+  gl_sframe vertices({{"__id", ids}, {"base", base}, {"degree", degree}, {"dist", dist},
+                      {"max_weight", max_weight}, {"sums", sums}});
+  gl_sframe edges({{"__src_id", source}, {"__dst_id", target}, {"weight", weight}});
+  return gl_sgraph(vertices, edges);
+}
+
+/// A vertex field by vertex id.
+static std::map<flex_int, flexible_type> vertex_values(const gl_sgraph& g,
+                                                       const std::string& field) {
+  std::map<flex_int, flexible_type> values;
+  for (const auto& row: g.get_vertices()[{"__id", field}].range_iterator()) {
+    values[row[0].get<flex_int>()] = row[1];
+  }
+  return values;
+}
+
+/**
+ * Concurrent atomic reductions of integers and floats lose no update.
+ */
+void test_atomic_reduce() {
+  const size_t nthreads = 8, nvalues = 20000;
+  volatile flex_int sum = 0, max = -1;
+  volatile flex_float min = 1e300, float_sum = 0;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = 0; i < nvalues; ++i) {
+        flex_int value = flex_int(t * nvalues + i);
+        atomic_reduce(sum, triple_reduction_enum::SUM, value);
+        atomic_reduce(max, triple_reduction_enum::MAX, value);
+        atomic_reduce(min, triple_reduction_enum::MIN, flex_float(value) - 5);
+        atomic_reduce(float_sum, triple_reduction_enum::SUM, 0.5);
+      }
+    });
+  }
+  for (auto& thread: threads) thread.join();
+  flex_int n = nthreads * nvalues;
+  ASSERT_EQ(sum, n * (n - 1) / 2);
+  ASSERT_EQ(max, n - 1);
+  ASSERT_EQ(min, -5.0);
+  ASSERT_EQ(float_sum, 0.5 * n);
+}
+
+/**
+ * Vector reductions are elementwise, and a missing accumulator takes the
+ * value.
+ */
+void test_reduce_vector() {
+  flexible_type acc = FLEX_UNDEFINED;
+  gl_sgraph_impl::reduce_vector(acc, triple_reduction_enum::SUM, flex_vec{1, 2});
+  gl_sgraph_impl::reduce_vector(acc, triple_reduction_enum::SUM, flex_vec{3, -4});
+  ASSERT_TRUE(acc.get<flex_vec>() == flex_vec({4, -2}));
+  gl_sgraph_impl::reduce_vector(acc, triple_reduction_enum::MAX, flex_vec{0, 7});
+  ASSERT_TRUE(acc.get<flex_vec>() == flex_vec({4, 7}));
+  // missing contributions are ignored
+  gl_sgraph_impl::reduce_vector(acc, triple_reduction_enum::MIN, FLEX_UNDEFINED);
+  ASSERT_TRUE(acc.get<flex_vec>() == flex_vec({4, 7}));
+  bool thrown = false;
+  try {
+    gl_sgraph_impl::reduce_vector(acc, triple_reduction_enum::SUM, flex_vec{1});
+  } catch (...) {
+    thrown = true;
+  }
+  ASSERT_TRUE(thrown);
+}
+
+/**
+ * A triple apply with SUM, MIN and MAX reductions on integer, float and
+ * vector fields gives the vertex values of the locked triple apply over
+ * maps.
+ */
+void test_reduction_triple_apply() {
+  gl_sgraph g = make_graph();
+  auto untyped = [](edge_triple& triple) {
+    double weight = triple.edge["weight"];
+    triple.source["degree"] += 1;
+    triple.target["degree"] += 1;
+    double dist = triple.source["base"].get<flex_float>() + weight;
+    triple.target["dist"] = std::min(triple.target["dist"].get<flex_float>(), dist);
+    triple.source["max_weight"] = std::max(triple.source["max_weight"].get<flex_float>(),
+                                           weight);
+    triple.target["sums"] += flexible_type(flex_vec{1, weight});
+  };
+  enum { BASE = 0, DEGREE = 1, DIST = 2, MAX_WEIGHT = 3, SUMS = 4 };
+  auto reduced = [](typed_edge_triple& triple) {
+    double weight = triple.edge_as<flex_float>(0);
+    triple.source_as<flex_int>(DEGREE) += 1;
+    triple.target_as<flex_int>(DEGREE) += 1;
+    double dist = triple.source_as<flex_float>(BASE) + weight;
+    flex_float& target_dist = triple.target_as<flex_float>(DIST);
+    target_dist = std::min(target_dist, dist);
+    flex_float& source_max = triple.source_as<flex_float>(MAX_WEIGHT);
+    source_max = std::max(source_max, weight);
+    flex_vec& sums = triple.target_as<flex_vec>(SUMS);
+    sums[0] += 1;
+    sums[1] += weight;
+  };
+  std::vector<std::string> mutated{"degree", "dist", "max_weight", "sums"};
+  gl_sgraph expected = g.triple_apply(untyped, mutated);
+  gl_sgraph actual = g.triple_apply(reduced, mutated,
+                                    {"base", "degree", "dist", "max_weight", "sums"},
+                                    {"weight"},
+                                    {{"degree", triple_reduction_enum::SUM},
+                                     {"dist", triple_reduction_enum::MIN},
+                                     {"max_weight", triple_reduction_enum::MAX},
+                                     {"sums", triple_reduction_enum::SUM}});
+  ASSERT_EQ(actual.num_vertices(), expected.num_vertices());
+  for (const char* field: {"degree", "dist", "max_weight", "base"}) {
+    ASSERT_TRUE(vertex_values(actual, field) == vertex_values(expected, field));
+  }
+  auto expected_sums = vertex_values(expected, "sums");
+  auto actual_sums = vertex_values(actual, "sums");
+  ASSERT_EQ(actual_sums.size(), (size_t)NUM_VERTICES);
+  for (const auto& value: expected_sums) {
+    const flex_vec& sums = actual_sums[value.first].get<flex_vec>();
+    ASSERT_EQ(sums.size(), 2);
+    ASSERT_EQ(sums[0], value.second.get<flex_vec>()[0]);
+    ASSERT_LT(std::fabs(sums[1] - value.second.get<flex_vec>()[1]), 1e-9);
+  }
+  // every vertex has two out edges and two in edges
+  for (const auto& value: vertex_values(actual, "degree")) {
+    ASSERT_EQ(value.second.get<flex_int>(), 4);
+  }
+}
+
+int main() {
+  test_atomic_reduce();
+  test_reduce_vector();
+  test_reduction_triple_apply();
+  return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+#include <graphlab/sdk/gl_sgraph.hpp>
+
+using namespace graphlab;
+
+static const flex_int NUM_VERTICES = 20;
+
+/**
+ * Vertex v has edges to v + 2 and 7v + 3 (mod 20), with a weight of
+ * v + 1 on the first and 0.5 on the second. "prev" is 0.1 (v + 1).
+ */
+static gl_sgraph make_graph() {
+  std::vector<flexible_type> ids, pr, prev, source, target, weight, visits;
+  for (flex_int v = 0; v < NUM_VERTICES; ++v) {
+    ids.push_back(v);
+    pr.push_back(flex_float(0));
+    prev.push_back(0.1 * (v + 1));
+    source.push_back(v);
+    target.push_back((v + 2) % NUM_VERTICES);
+    weight.push_back(flex_float(v + 1));
+    source.push_back(v);
+    target.push_back((7 * v + 3) % NUM_VERTICES);
+    weight.push_back(0.5);
+  }
+  visits.assign(source.size(), flex_int(0));
+  gl_sframe vertices({{"__id", ids}, {"pr", pr}, {"prev", prev}});
+  gl_sframe edges({{"__src_id", source}, {"__dst_id", target},
+                   {"weight", weight}, {"visits", visits}});
+  return gl_sgraph(vertices, edges);
+}
+
+/// A vertex field by vertex id.
+static std::map<flex_int, flexible_type> vertex_values(const gl_sgraph& g,
+                                                       const std::string& field) {
+  std::map<flex_int, flexible_type> values;
+  for (const auto& row: g.get_vertices()[{"__id", field}].range_iterator()) {
+    values[row[0].get<flex_int>()] = row[1];
+  }
+  return values;
+}
+
+/// An edge field by (source, target).
+static std::map<std::pair<flex_int, flex_int>, flexible_type>
+edge_values(const gl_sgraph& g, const std::string& field) {
+  std::map<std::pair<flex_int, flex_int>, flexible_type> values;
+  for (const auto& row: g.get_edges()[{"__src_id", "__dst_id", field}].range_iterator()) {
+    values[{row[0].get<flex_int>(), row[1].get<flex_int>()}] = row[2];
+  }
+  return values;
+}
+
+/**
+ * Field names resolve to the slots of the requested fields, and an unknown
+ * field throws.
+ */
+void test_resolve_fields() {
+  std::vector<std::string> available{"__id", "pagerank", "pagerank_prev", "degree"};
+  auto slots = gl_sgraph_impl::resolve_fields({"pagerank_prev", "__id"}, available, "Vertex");
+  ASSERT_TRUE(slots == std::vector<size_t>({2, 0}));
+  bool thrown = false;
+  try {
+    gl_sgraph_impl::resolve_fields({"weight"}, available, "Vertex");
+  } catch (...) {
+    thrown = true;
+  }
+  ASSERT_TRUE(thrown);
+}
+
+/**
+ * The lambda of the gl_sgraph documentation, over flat rows addressed by
+ * slot: writes through the typed references land in the rows.
+ */
+void test_typed_edge_triple() {
+  enum { PAGERANK = 0, PAGERANK_PREV = 1 };
+  std::vector<flexible_type> source{flex_float(0), flex_float(0.5)};
+  std::vector<flexible_type> target{flex_float(1), flex_float(0.25)};
+  std::vector<flexible_type> edge{flex_float(4)};
+  typed_edge_triple triple;
+  triple.source = source.data();
+  triple.edge = edge.data();
+  triple.target = target.data();
+  triple.target_as<flex_float>(PAGERANK) +=
+      triple.source_as<flex_float>(PAGERANK_PREV) * triple.edge_as<flex_float>(0);
+  ASSERT_EQ(target[PAGERANK].get<flex_float>(), 3.0);
+  triple.edge_as<flex_float>(0) = 2;
+  ASSERT_EQ(edge[0].get<flex_float>(), 2.0);
+  ASSERT_EQ(source[PAGERANK].get<flex_float>(), 0.0);
+}
+
+/**
+ * The schema-compiled triple apply updates the vertices and edges of a
+ * graph as the triple apply over maps does, with fields in a different
+ * slot order than the graph columns.
+ */
+void test_typed_triple_apply() {
+  gl_sgraph g = make_graph();
+  auto untyped = [](edge_triple& triple) {
+    triple.target["pr"] += triple.source["prev"] * triple.edge["weight"];
+    triple.edge["visits"] += 1;
+  };
+  enum { PREV = 0, PR = 1 };
+  enum { VISITS = 0, WEIGHT = 1 };
+  auto typed = [](typed_edge_triple& triple) {
+    triple.target_as<flex_float>(PR) +=
+        triple.source_as<flex_float>(PREV) * triple.edge_as<flex_float>(WEIGHT);
+    triple.edge_as<flex_int>(VISITS) += 1;
+  };
+  gl_sgraph expected = g.triple_apply(untyped, {"pr", "visits"});
+  gl_sgraph actual = g.triple_apply(typed, {"pr", "visits"}, {"prev", "pr"},
+                                    {"visits", "weight"});
+  ASSERT_EQ(actual.num_vertices(), expected.num_vertices());
+  ASSERT_EQ(actual.num_edges(), expected.num_edges());
+
+  auto expected_pr = vertex_values(expected, "pr");
+  auto actual_pr = vertex_values(actual, "pr");
+  ASSERT_EQ(actual_pr.size(), (size_t)NUM_VERTICES);
+  for (const auto& value: expected_pr) {
+    ASSERT_LT(std::fabs(actual_pr[value.first].get<flex_float>() -
+                        value.second.get<flex_float>()), 1e-9);
+  }
+  // fields which are not mutated are unchanged
+  ASSERT_TRUE(vertex_values(actual, "prev") == vertex_values(g, "prev"));
+  ASSERT_TRUE(edge_values(actual, "weight") == edge_values(g, "weight"));
+
+  auto visits = edge_values(actual, "visits");
+  ASSERT_TRUE(visits == edge_values(expected, "visits"));
+  for (const auto& value: visits) ASSERT_EQ(value.second.get<flex_int>(), 1);
+}
+
+int main() {
+  test_resolve_fields();
+  test_typed_edge_triple();
+  test_typed_triple_apply();
+  return 0;
+}
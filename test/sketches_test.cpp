@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sketches/quantile_sketch.hpp>
+#include <graphlab/sketches/hyperloglog.hpp>
+#include <graphlab/sketches/space_saving.hpp>
+#include <graphlab/util/cityhash_gl.hpp>
+
+using namespace graphlab;
+
+/// The rank of value in sorted, as a fraction of its size
+static double rank_of(const std::vector<double>& sorted, double value) {
+  return double(std::lower_bound(sorted.begin(), sorted.end(), value) - sorted.begin()) /
+         sorted.size();
+}
+
+/**
+ * Merges pairs of partials which never compacted, and so share the state
+ * of their coin, as a groupby does with small groups. The compaction of
+ * each merge keeps either the even or the odd half of the sorted
+ * elements; both must happen, or quantiles are biased.
+ */
+void test_quantile_merge_same_state() {
+  size_t num_odd = 0;
+  for (size_t i = 0; i < 64; ++i) {
+    sdk_sketches::quantile_sketch evens, odds;
+    size_t n = 120 + i;
+    for (size_t j = 0; j < n; ++j) {
+      evens.add(2 * j);
+      odds.add(2 * j + 1);
+    }
+    evens.combine(odds);
+    ASSERT_EQ(evens.size(), 2 * n);
+    // the largest element left is 2n - 2 or 2n - 1
+    double max = evens.query({1.0})[0];
+    ASSERT_GE(max, 2 * n - 2);
+    num_odd += size_t(max) % 2;
+  }
+  ASSERT_GE(num_odd, 16);
+  ASSERT_LE(num_odd, 48);
+
+  // merging identical sketches keeps the median
+  sdk_sketches::quantile_sketch a, b;
+  for (int i = 0; i < 1000; ++i) {
+    a.add(i);
+    b.add(i);
+  }
+  a.combine(b);
+  ASSERT_DELTA(a.query({0.5})[0], 500, 20);
+}
+
+/**
+ * Merges sketches of random streams, and checks the quantiles of the
+ * result against the exact ones.
+ */
+void test_quantile_merge_reference() {
+  std::mt19937 rng(1);
+  std::normal_distribution<double> normal(10, 3);
+  std::vector<double> all;
+  sdk_sketches::quantile_sketch merged;
+  for (size_t p = 0; p < 16; ++p) {
+    sdk_sketches::quantile_sketch partial;
+    for (size_t i = 0; i < 20000 + 1000 * p; ++i) {
+      double value = normal(rng);
+      partial.add(value);
+      all.push_back(value);
+    }
+    merged.combine(partial);
+  }
+  std::sort(all.begin(), all.end());
+  std::vector<double> fractions{0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99};
+  std::vector<double> quantiles = merged.query(fractions);
+  for (size_t i = 0; i < fractions.size(); ++i) {
+    ASSERT_DELTA(rank_of(all, quantiles[i]), fractions[i], 0.02);
+  }
+
+  // save and load keep the sketch
+  std::stringstream stream;
+  {
+    oarchive oarc(stream);
+    merged.save(oarc);
+  }
+  sdk_sketches::quantile_sketch loaded;
+  {
+    iarchive iarc(stream);
+    loaded.load(iarc);
+  }
+  ASSERT_TRUE(loaded.query(fractions) == quantiles);
+}
+
+void test_hyperloglog() {
+  sdk_sketches::hyperloglog a, b;
+  for (uint64_t i = 0; i < 100000; ++i) a.add(hash64(i));
+  for (uint64_t i = 50000; i < 200000; ++i) b.add(hash64(i));
+  a.combine(b);
+  ASSERT_DELTA(a.estimate(), 200000, 200000 * 4 * a.relative_error());
+}
+
+void test_space_saving() {
+  sdk_sketches::space_saving<int> a(10), b(10);
+  std::mt19937 rng(2);
+  for (int i = 0; i < 100000; ++i) {
+    // 1 and 2 are heavy, the rest is spread over many values
+    int value = i % 4 == 0 ? 1 : i % 4 == 1 ? 2 : 1000 + int(rng() % 100000);
+    (i % 3 ? a : b).add(value);
+  }
+  a.combine(b);
+  auto items = a.frequent_items(10000);
+  ASSERT_EQ(items.size(), 2);
+  ASSERT_GE(items[0].count, 25000);
+  ASSERT_GE(items[1].count, 25000);
+}
+
+int main() {
+  test_quantile_merge_same_state();
+  test_quantile_merge_reference();
+  test_hyperloglog();
+  test_space_saving();
+  return 0;
+}
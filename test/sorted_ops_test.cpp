@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+
+using namespace graphlab;
+using gl_sframe_impl::compare_sort_keys;
+
+static bool throws(const std::function<void()>& fn) {
+  try {
+    fn();
+  } catch (...) {
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Keys compare lexicographically, with missing values before all others.
+ */
+void test_compare_sort_keys() {
+  ASSERT_LT(gl_sframe_impl::compare_sort_values(FLEX_UNDEFINED, flexible_type(-100)), 0);
+  ASSERT_GT(gl_sframe_impl::compare_sort_values(flexible_type("a"), FLEX_UNDEFINED), 0);
+  ASSERT_EQ(gl_sframe_impl::compare_sort_values(FLEX_UNDEFINED, FLEX_UNDEFINED), 0);
+  ASSERT_LT(compare_sort_keys({1, "b"}, {2, "a"}), 0);
+  ASSERT_GT(compare_sort_keys({2, "b"}, {2, "a"}), 0);
+  ASSERT_EQ(compare_sort_keys({2, "a"}, {2, "a"}), 0);
+  ASSERT_LT(compare_sort_keys({2, FLEX_UNDEFINED}, {2, "a"}), 0);
+  ASSERT_EQ(compare_sort_keys({}, {}), 0);
+}
+
+typedef std::tuple<flex_int, flex_int, flex_int> triple;
+
+static std::multiset<triple> to_triples(const gl_sframe& sf) {
+  std::multiset<triple> ret;
+  for (const auto& row: sf.range_iterator()) {
+    std::vector<flex_int> values;
+    for (size_t i = 0; i < 3; ++i) {
+      values.push_back(row[i].get_type() == flex_type_enum::UNDEFINED ? -1 : row[i].get<flex_int>());
+    }
+    ret.insert(triple(values[0], values[1], values[2]));
+  }
+  return ret;
+}
+
+/**
+ * The merge join of sorted inputs, with runs of equal keys spanning the
+ * split points, gives the rows of the hash join, in key order.
+ */
+void test_merge_join() {
+  std::vector<flexible_type> left_key, left_value, right_key, right_value;
+  for (flex_int i = 0; i < 20000; ++i) {
+    left_key.push_back(i / 40);
+    left_value.push_back(i);
+  }
+  for (flex_int i = 0; i < 3000; ++i) {
+    right_key.push_back(300 + i / 5);
+    right_value.push_back(i);
+  }
+  gl_sframe left({{"k", left_key}, {"v", left_value}});
+  gl_sframe right({{"k", right_key}, {"w", right_value}});
+  for (const std::string how: {"inner", "left", "right", "outer"}) {
+    gl_sframe merged = left.merge_join(right, {"k"}, how);
+    ASSERT_TRUE(to_triples(merged) == to_triples(left.hash_join(right, {"k"}, how)));
+    flexible_type previous = FLEX_UNDEFINED;
+    for (const auto& row: merged.range_iterator()) {
+      ASSERT_LE(gl_sframe_impl::compare_sort_values(previous, row[0]), 0);
+      previous = row[0];
+    }
+  }
+  gl_sframe unsorted({{"k", {1, 3, 2}}, {"w", {0, 0, 0}}});
+  ASSERT_TRUE(throws([&]() { left.merge_join(unsorted, {"k"}).materialize(); }));
+}
+
+/**
+ * The sorted groupby gives the groups of the hash groupby, in key order,
+ * with groups spanning the segments combined.
+ */
+void test_sorted_groupby() {
+  std::vector<flexible_type> key, value;
+  for (flex_int i = 0; i < 50000; ++i) {
+    key.push_back(i / 3000);
+    value.push_back(i % 13);
+  }
+  gl_sframe sf({{"k", key}, {"x", value}});
+  std::map<std::string, aggregate::groupby_descriptor_type> operators{
+    {"count", aggregate::COUNT()}, {"sum", aggregate::SUM("x")}};
+  gl_sframe sorted = sf.sorted_groupby({"k"}, operators);
+  gl_sframe hashed = sf.groupby({"k"}, operators);
+  ASSERT_EQ(sorted.size(), 17);
+  ASSERT_TRUE(to_triples(sorted.select_columns({"k", "count", "sum"})) ==
+              to_triples(hashed.select_columns({"k", "count", "sum"})));
+  flex_int previous = -1;
+  for (const auto& row: sorted.range_iterator()) {
+    ASSERT_LT(previous, row[sorted.column_index("k")].get<flex_int>());
+    previous = row[sorted.column_index("k")].get<flex_int>();
+  }
+  gl_sframe unsorted({{"k", {2, 1, 2}}, {"x", {0, 0, 0}}});
+  ASSERT_TRUE(throws([&]() { unsorted.sorted_groupby({"k"}, operators).materialize(); }));
+}
+
+int main() {
+  test_compare_sort_keys();
+  test_merge_join();
+  test_sorted_groupby();
+  return 0;
+}
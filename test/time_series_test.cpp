@@ -0,0 +1,136 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+
+using namespace graphlab;
+
+static bool throws(const std::function<void()>& fn) {
+  try {
+    fn();
+  } catch (...) {
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Integers, floats and datetimes share one axis, with datetime offsets in
+ * seconds; missing and other values are rejected.
+ */
+void test_ordering_key() {
+  ASSERT_EQ(gl_sframe_impl::ordering_key(flexible_type(3), "t"), 3.0);
+  ASSERT_EQ(gl_sframe_impl::ordering_key(flexible_type(-2.5), "t"), -2.5);
+  flex_date_time dt(1400000000, 0, 250);
+  ASSERT_EQ(gl_sframe_impl::ordering_key(flexible_type(dt), "t"), 1400000000000250.0);
+  ASSERT_EQ(gl_sframe_impl::ordering_offset(-300, flex_type_enum::DATETIME), -300000000.0);
+  ASSERT_EQ(gl_sframe_impl::ordering_offset(-300, flex_type_enum::INTEGER), -300.0);
+  ASSERT_TRUE(throws([]() { gl_sframe_impl::ordering_key(FLEX_UNDEFINED, "t"); }));
+  ASSERT_TRUE(throws([]() { gl_sframe_impl::ordering_key(flexible_type("x"), "t"); }));
+  ASSERT_FALSE(throws([]() { gl_sframe_impl::check_sorted(1.0, 1.0, "t"); }));
+  ASSERT_TRUE(throws([]() { gl_sframe_impl::check_sorted(1.0, 0.5, "t"); }));
+}
+
+/**
+ * Range windows over a sorted key with duplicates and gaps, against the
+ * windows computed row by row.
+ */
+void test_rolling_apply_by_range() {
+  std::vector<flexible_type> keys, values;
+  flex_int key = 0;
+  for (flex_int i = 0; i < 3000; ++i) {
+    key += (i % 7 == 0) ? 0 : (i % 13 == 0 ? 50 : 3);
+    keys.push_back(key);
+    values.push_back(i % 11 == 5 ? flexible_type(FLEX_UNDEFINED) : flexible_type(i % 17));
+  }
+  gl_sframe sf({{"t", keys}, {"x", values}});
+  for (auto range: std::vector<std::pair<double, double> >{{-10, 0}, {-4, 4}, {2, 30}, {0, 0}}) {
+    for (size_t min_observations: {size_t(0), size_t(2), size_t(-1)}) {
+      // size_t(-1) is the default
+      gl_sarray sums = min_observations == size_t(-1)
+          ? sf.rolling_apply_by_range("t", "x", "__builtin__sum__", range.first, range.second)
+          : sf.rolling_apply_by_range("t", "x", "__builtin__sum__", range.first, range.second,
+                                      min_observations);
+      ASSERT_EQ(sums.size(), keys.size());
+      size_t i = 0;
+      for (const auto& actual: sums.range_iterator()) {
+        flex_int sum = 0;
+        size_t rows = 0, count = 0;
+        for (size_t j = 0; j < keys.size(); ++j) {
+          flex_int k = keys[j].get<flex_int>() - keys[i].get<flex_int>();
+          if (k < range.first || k > range.second) continue;
+          ++rows;
+          if (values[j].get_type() != flex_type_enum::UNDEFINED) {
+            sum += values[j].get<flex_int>();
+            ++count;
+          }
+        }
+        bool present = min_observations == 0 ||
+            (rows > 0 && gl_sarray_impl::window_has_min_observations(count, rows, min_observations));
+        if (!present) ASSERT_TRUE(actual.get_type() == flex_type_enum::UNDEFINED);
+        else if (count > 0) ASSERT_EQ(actual.get<flex_int>(), sum);
+        ++i;
+      }
+    }
+  }
+
+  gl_sframe unsorted({{"t", {3, 1}}, {"x", {1, 2}}});
+  ASSERT_TRUE(throws([&]() { unsorted.rolling_apply_by_range("t", "x", "__builtin__sum__", -1, 0); }));
+  ASSERT_TRUE(throws([&]() { sf.rolling_apply_by_range("t", "x", "__builtin__nope__", -1, 0); }));
+  ASSERT_TRUE(throws([&]() { sf.rolling_apply_by_range("t", "x", "__builtin__sum__", 1, 0); }));
+}
+
+/**
+ * Each trade gets the last quote of its symbol at or before its time.
+ */
+void test_asof_join() {
+  std::vector<flexible_type> quote_t, quote_sym, quote_price;
+  for (flex_int i = 0; i < 500; ++i) {
+    quote_t.push_back(i * 2);
+    quote_sym.push_back(i % 3 == 0 ? "a" : "b");
+    quote_price.push_back(i * 0.5);
+  }
+  std::vector<flexible_type> trade_t, trade_sym, trade_qty;
+  for (flex_int i = 0; i < 400; ++i) {
+    trade_t.push_back(i * 2 + 1 - (i % 2));
+    trade_sym.push_back(i % 4 == 0 ? "a" : (i % 4 == 1 ? "b" : "c"));
+    trade_qty.push_back(i);
+  }
+  gl_sframe quotes({{"t", quote_t}, {"sym", quote_sym}, {"price", quote_price}, {"qty", quote_t}});
+  gl_sframe trades({{"t", trade_t}, {"sym", trade_sym}, {"qty", trade_qty}});
+
+  gl_sframe left = trades.asof_join(quotes, "t", {"sym"});
+  ASSERT_TRUE(left.column_names() == std::vector<std::string>({"t", "sym", "qty", "price", "qty.1"}));
+  ASSERT_EQ(left.size(), trades.size());
+  size_t nmatched = 0;
+  for (const auto& row: left.range_iterator()) {
+    flexible_type expected = FLEX_UNDEFINED;
+    for (size_t j = 0; j < quote_t.size(); ++j) {
+      if (quote_t[j] <= row[0] && quote_sym[j] == row[1]) expected = quote_price[j];
+    }
+    ASSERT_TRUE(row[3].get_type() == expected.get_type());
+    if (expected.get_type() != flex_type_enum::UNDEFINED) {
+      ASSERT_EQ(row[3].get<flex_float>(), expected.get<flex_float>());
+      ASSERT_EQ(row[4].get<flex_int>(), flex_int(expected.get<flex_float>() * 4));
+      ++nmatched;
+    }
+  }
+  ASSERT_EQ(trades.asof_join(quotes, "t", {"sym"}, "inner").size(), nmatched);
+  ASSERT_TRUE(throws([&]() { trades.asof_join(quotes, "t", {"sym"}, "outer"); }));
+}
+
+int main() {
+  test_ordering_key();
+  test_rolling_apply_by_range();
+  test_asof_join();
+  return 0;
+}
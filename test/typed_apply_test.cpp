@@ -0,0 +1,86 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sarray.hpp>
+
+using namespace graphlab;
+
+/**
+ * Values of the input type are taken as is, others are converted, and
+ * missing values are reported.
+ */
+void test_unbox() {
+  flex_float f = -1;
+  ASSERT_TRUE(gl_sarray_impl::unbox(flexible_type(2.5), f));
+  ASSERT_EQ(f, 2.5);
+  ASSERT_TRUE(gl_sarray_impl::unbox(flexible_type(3), f));
+  ASSERT_EQ(f, 3.0);
+  f = -1;
+  ASSERT_FALSE(gl_sarray_impl::unbox(flexible_type(FLEX_UNDEFINED), f));
+  ASSERT_EQ(f, -1.0);
+
+  flex_int i = 0;
+  ASSERT_TRUE(gl_sarray_impl::unbox(flexible_type(7.9), i));
+  ASSERT_EQ(i, 7);
+  flex_string s;
+  ASSERT_TRUE(gl_sarray_impl::unbox(flexible_type(12), s));
+  ASSERT_EQ(s, "12");
+}
+
+/**
+ * The typed apply gives the values of the untyped apply, in row order,
+ * over more rows than a block, with missing values kept missing.
+ */
+void test_typed_apply() {
+  std::vector<flexible_type> values;
+  for (flex_int i = 0; i < 100000; ++i) {
+    if (i % 11 == 0) values.push_back(FLEX_UNDEFINED);
+    else values.push_back(i);
+  }
+  gl_sarray sa(values, flex_type_enum::INTEGER);
+  gl_sarray typed = sa.apply<flex_int, flex_float>([](flex_int x) { return 0.5 * x + 1; });
+  ASSERT_TRUE(typed.dtype() == flex_type_enum::FLOAT);
+  gl_sarray untyped = sa.apply([](const flexible_type& x) { return 0.5 * x + 1; },
+                               flex_type_enum::FLOAT, true);
+  ASSERT_EQ(typed.size(), values.size());
+  ASSERT_EQ(typed.num_missing(), untyped.num_missing());
+  std::vector<flexible_type> expected;
+  for (const auto& value: untyped.range_iterator()) expected.push_back(value);
+  size_t row = 0;
+  for (const auto& value: typed.range_iterator()) {
+    ASSERT_TRUE(value.get_type() == expected[row].get_type());
+    if (value.get_type() != flex_type_enum::UNDEFINED) {
+      ASSERT_EQ(value.get<flex_float>(), expected[row].get<flex_float>());
+    }
+    ++row;
+  }
+  ASSERT_EQ(row, values.size());
+
+  gl_sarray lengths = sa.apply<flex_string, flex_int>([](const flex_string& x) {
+    return flex_int(x.size());
+  });
+  ASSERT_EQ(lengths[12].get<flex_int>(), 2);
+  ASSERT_TRUE(lengths[22].get_type() == flex_type_enum::UNDEFINED);
+
+  // without skipping, missing values are passed to fn as a default In
+  gl_sarray all = sa.apply<flex_int, flex_float>([](flex_int x) { return 0.5 * x + 1; },
+                                                 false);
+  ASSERT_EQ(all.num_missing(), 0);
+  ASSERT_EQ(all[0].get<flex_float>(), 1.0);
+  ASSERT_EQ(all[11].get<flex_float>(), 1.0);
+  ASSERT_EQ(all[12].get<flex_float>(), 7.0);
+}
+
+int main() {
+  test_unbox();
+  test_typed_apply();
+  return 0;
+}
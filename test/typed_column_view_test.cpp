@@ -0,0 +1,109 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sframe/sframe_rows.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+
+using namespace graphlab;
+
+/**
+ * Values, validity bits across a word boundary and the null count of a
+ * column with missing values.
+ */
+void test_assign() {
+  std::vector<flexible_type> column;
+  for (flex_int i = 0; i < 130; ++i) {
+    if (i % 10 == 3) column.push_back(FLEX_UNDEFINED);
+    else if (i % 2) column.push_back(flex_float(i) + 0.5);
+    else column.push_back(i);
+  }
+  typed_column_view<flex_float> view;
+  ASSERT_TRUE(view.assign(column));
+  ASSERT_EQ(view.size(), 130);
+  ASSERT_EQ(view.null_count(), 13);
+  for (size_t i = 0; i < column.size(); ++i) {
+    bool valid = i % 10 != 3;
+    ASSERT_EQ(view.is_valid(i), valid);
+    ASSERT_EQ(bool((view.validity()[i / 64] >> (i % 64)) & 1), valid);
+    if (!valid) ASSERT_EQ(view.data()[i], 0.0);
+    else ASSERT_EQ(view.data()[i], column[i].to<flex_float>());
+  }
+
+  // floats are not integers, and reusing the view resets it
+  typed_column_view<flex_int> ints;
+  ASSERT_FALSE(ints.assign(column));
+  ASSERT_EQ(ints.size(), 0);
+  ASSERT_EQ(ints.null_count(), 0);
+  ASSERT_TRUE(ints.assign({flexible_type(4), FLEX_UNDEFINED, flexible_type(-2)}));
+  ASSERT_EQ(ints.size(), 3);
+  ASSERT_EQ(ints.null_count(), 1);
+  ASSERT_EQ(ints.data()[2], -2);
+
+  ASSERT_FALSE(view.assign({flexible_type(1.0), flexible_type("x")}));
+  ASSERT_EQ(view.size(), 0);
+}
+
+/**
+ * The numeric columns of a gl_sframe read through typed views add up to
+ * the sums of the columns, and a string column cannot be read.
+ */
+void test_materialize_typed() {
+  std::vector<flexible_type> x, y, name;
+  flex_float expected = 0;
+  for (flex_int i = 0; i < 50000; ++i) {
+    x.push_back(i % 7 == 0 ? flexible_type(FLEX_UNDEFINED) : flexible_type(i));
+    y.push_back(0.25 * i);
+    name.push_back(std::to_string(i));
+    if (i % 7 != 0) expected += i * 0.25 * i;
+  }
+  gl_sframe sf({{"x", x}, {"y", y}, {"name", name}});
+
+  std::vector<double> dot(4, 0);
+  std::atomic<size_t> rows(0), missing(0);
+  sf.materialize_to_callback<flex_float>({"x", "y"},
+      [&](size_t threadid, const std::vector<typed_column_view<flex_float> >& cols) {
+        ASSERT_EQ(cols.size(), 2);
+        for (size_t i = 0; i < cols[0].size(); ++i) {
+          dot[threadid] += cols[0].data()[i] * cols[1].data()[i];
+        }
+        rows += cols[0].size();
+        missing += cols[0].null_count();
+        return false;
+      }, 4);
+  ASSERT_EQ(rows.load(), 50000);
+  ASSERT_EQ(missing.load(), sf["x"].num_missing());
+  ASSERT_EQ(dot[0] + dot[1] + dot[2] + dot[3], expected);
+
+  std::vector<flex_int> sums(4, 0);
+  sf["x"].materialize_to_callback<flex_int>(
+      [&](size_t threadid, const typed_column_view<flex_int>& values) {
+        for (size_t i = 0; i < values.size(); ++i) sums[threadid] += values.data()[i];
+        return false;
+      }, 4);
+  ASSERT_EQ(sums[0] + sums[1] + sums[2] + sums[3], sf["x"].sum().get<flex_int>());
+
+  bool thrown = false;
+  try {
+    sf.materialize_to_callback<flex_float>({"name"},
+        [](size_t, const std::vector<typed_column_view<flex_float> >&) { return false; });
+  } catch (...) {
+    thrown = true;
+  }
+  ASSERT_TRUE(thrown);
+}
+
+int main() {
+  test_assign();
+  test_materialize_typed();
+  return 0;
+}
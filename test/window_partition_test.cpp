@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2016 Turi
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/sdk/gl_sframe.hpp>
+
+using namespace graphlab;
+using gl_sframe_impl::window_row;
+
+static window_row make_row(flex_int group, flex_int order, flex_int value, size_t row_number) {
+  window_row row;
+  row.group = group;
+  row.order = order;
+  row.values = {value, value};
+  row.row_number = row_number;
+  return row;
+}
+
+/**
+ * Rows spilled by partition are read back whole, and the spill file goes
+ * with the run.
+ */
+void test_spill_window_rows() {
+  std::vector<std::vector<window_row> > buckets(3);
+  for (size_t i = 0; i < 100; ++i) buckets[i % 3].push_back(make_row(i % 7, -i, i * 10, i));
+  std::string filename;
+  {
+    gl_sframe_impl::sort_run_file file = gl_sframe_impl::spill_window_rows(buckets);
+    filename = file.filename;
+    for (const auto& bucket: buckets) ASSERT_TRUE(bucket.empty());
+    for (size_t p = 0; p < 3; ++p) {
+      std::vector<window_row> rows;
+      gl_sframe_impl::read_window_rows(file, p, rows);
+      ASSERT_EQ(rows.size(), p == 0 ? 34 : 33);
+      for (size_t i = 0; i < rows.size(); ++i) {
+        size_t row_number = p + 3 * i;
+        ASSERT_EQ(rows[i].row_number, row_number);
+        ASSERT_EQ(rows[i].group.get<flex_int>(), flex_int(row_number % 7));
+        ASSERT_EQ(rows[i].order.get<flex_int>(), -flex_int(row_number));
+        ASSERT_EQ(rows[i].values[1].get<flex_int>(), flex_int(row_number * 10));
+      }
+    }
+    ASSERT_EQ(access(filename.c_str(), F_OK), 0);
+  }
+  ASSERT_TRUE(access(filename.c_str(), F_OK) != 0);
+}
+
+/**
+ * A cumulative sum and a moving sum over two groups, ordered against the
+ * row order, with a missing value; the records come back in row order.
+ */
+void test_window_partition() {
+  std::vector<aggregate::window_descriptor_type> descriptors{
+    aggregate::CUMULATIVE(std::make_shared<rolling_operators::sum>(), "x"),
+    aggregate::ROLLING(std::make_shared<rolling_operators::sum>(), "x", -1, 0, 1)};
+  descriptors[0].m_aggregator->set_input_types({flex_type_enum::INTEGER});
+  gl_sarray_impl::init_rolling_aggregator(*descriptors[1].m_aggregator, flex_type_enum::INTEGER,
+                                          -1, 0);
+  std::vector<window_row> rows;
+  std::map<flex_int, std::vector<std::pair<flex_int, flex_int> > > groups;
+  for (size_t i = 0; i < 20; ++i) {
+    flex_int group = i % 2;
+    flex_int order = 100 - flex_int(i);
+    rows.push_back(make_row(group, order, flex_int(i), i));
+    if (i == 7) rows.back().values = {FLEX_UNDEFINED, FLEX_UNDEFINED};
+  }
+  auto records = gl_sframe_impl::window_partition(rows, descriptors, true);
+  ASSERT_TRUE(rows.empty());
+  ASSERT_EQ(records.size(), 20);
+
+  // each group runs from its last row to its first
+  std::vector<flex_int> cumulative(20), moving(20);
+  for (flex_int group = 0; group < 2; ++group) {
+    flex_int total = 0, previous = 0;
+    for (flex_int i = 18 + group; i >= 0; i -= 2) {
+      flex_int value = i == 7 ? 0 : i;
+      total += value;
+      cumulative[i] = total;
+      moving[i] = value + previous;
+      previous = value;
+    }
+  }
+  for (size_t i = 0; i < records.size(); ++i) {
+    std::string key;
+    gl_sframe_impl::append_big_endian(key, i);
+    ASSERT_TRUE(records[i].key == key);
+    ASSERT_EQ(records[i].values[0].get<flex_int>(), cumulative[i]);
+    ASSERT_EQ(records[i].values[1].get<flex_int>(), moving[i]);
+  }
+}
+
+int main() {
+  test_spill_window_rows();
+  test_window_partition();
+  return 0;
+}